@@ -0,0 +1,148 @@
+/**
+ * Times whole frames of a triangle mesh drawn with each object shader, to
+ * compare frame times before and after a change to the effects or their
+ * shaders.  The mesh is a wavy grid with normals; each shader is timed three
+ * times over a number of frames, and a hash of its last image printed, so
+ * that a change meant to keep the output can be checked to do so.
+ *
+ * Needs a GL context, created off screen with EGL, and the shaders directory
+ * in the working directory.
+ *
+ * Usage: frame_time_benchmark [grid side, default 1000] [frames, default 10]
+ */
+
+#include <GL/glew.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "tucanow/scene.hpp"
+
+#include "offscreen_context.hpp"
+
+namespace
+{
+    const int width = 512;
+    const int height = 512;
+
+    /// A wavy grid of side x side vertices in [-0.5,0.5]^2, with normals
+    void makeGrid(int side, std::vector<float> &vertices, std::vector<unsigned int> &indices, std::vector<float> &normals)
+    {
+        for ( int j = 0; j < side; ++j )
+        {
+            for ( int i = 0; i < side; ++i )
+            {
+                const float x = float(i)/side - 0.5f, y = float(j)/side - 0.5f;
+                vertices.insert(vertices.end(), { x, y, 0.1f*std::sin(10.f*x) });
+                normals.insert(normals.end(), { -std::cos(10.f*x), 0.f, 1.f });
+            }
+        }
+        for ( int j = 0; j + 1 < side; ++j )
+        {
+            for ( int i = 0; i + 1 < side; ++i )
+            {
+                const unsigned int a = j*side + i, b = a + 1, c = a + side, d = c + 1;
+                indices.insert(indices.end(), { a, b, c, b, d, c });
+            }
+        }
+    }
+
+    /// Milliseconds per frame over a number of frames, after one frame that warms up the shader
+    double frameTime(tucanow::Scene &scene, int frames)
+    {
+        scene.render();
+        glFinish();
+
+        const auto start = std::chrono::steady_clock::now();
+        for ( int f = 0; f < frames; ++f )
+        {
+            scene.render();
+        }
+        glFinish();
+
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count()/frames;
+    }
+
+    /// FNV-1a hash of the framebuffer
+    std::uint64_t imageHash()
+    {
+        std::vector<unsigned char> pixels(4*width*height);
+        glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+
+        std::uint64_t hash = 14695981039346656037ull;
+        for ( unsigned char c : pixels )
+        {
+            hash = (hash ^ c)*1099511628211ull;
+        }
+        return hash;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    const int side = (argc > 1) ? std::atoi(argv[1]) : 1000;
+    const int frames = (argc > 2) ? std::atoi(argv[2]) : 10;
+    if ( (side < 2) || (frames < 1) )
+    {
+        std::fprintf(stderr, "usage: %s [grid side] [frames]\n", argv[0]);
+        return 1;
+    }
+
+    if ( !benchmarks::makeOffscreenContext(width, height) )
+    {
+        std::printf("no OpenGL context, skipped\n");
+        return 77;
+    }
+
+    tucanow::Scene scene;
+    scene.initialize(width, height);
+    // nothing is picked
+    scene.setAutomaticBvh(false);
+
+    std::vector<float> vertices, normals;
+    std::vector<unsigned int> indices;
+    makeGrid(side, vertices, indices, normals);
+    const std::size_t num_triangles = indices.size()/3;
+
+    if ( !scene.loadTriangleMesh(1, std::move(vertices), std::move(indices), std::move(normals)) )
+    {
+        std::fprintf(stderr, "cannot load the mesh\n");
+        return 1;
+    }
+
+    std::printf("%zu triangles, %dx%d, %d frames\n", num_triangles, width, height, frames);
+
+    const struct
+    {
+        tucanow::ObjectShader shader;
+        const char *name;
+    } shaders[] = {
+        { tucanow::ObjectShader::DirectColor, "DirectColor" },
+        { tucanow::ObjectShader::Phong, "Phong" },
+        { tucanow::ObjectShader::Toon, "Toon" },
+        { tucanow::ObjectShader::OnePassWireframe, "Wireframe" },
+    };
+
+    for ( const auto &entry : shaders )
+    {
+        scene.setObjectShader(1, entry.shader);
+
+        // the spread between runs shows how far the timings can be trusted
+        double fastest = 0.0, slowest = 0.0;
+        for ( int run = 0; run < 3; ++run )
+        {
+            const double ms = frameTime(scene, frames);
+            fastest = (run == 0) ? ms : std::min(fastest, ms);
+            slowest = (run == 0) ? ms : std::max(slowest, ms);
+        }
+        std::printf("%-12s %8.1f - %6.1f ms/frame  image %016llx\n", entry.name, fastest, slowest,
+                static_cast<unsigned long long>(imageHash()));
+    }
+
+    return 0;
+}
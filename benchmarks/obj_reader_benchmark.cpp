@@ -0,0 +1,66 @@
+/**
+ * Times Tucano::MeshImporter::ObjReader on a Wavefront OBJ file and reports
+ * its throughput in MB/s.  Only parses the file into main memory: no GL
+ * context is needed.
+ *
+ * Usage: obj_reader_benchmark file.obj [threads, default 0: one per hardware thread] [runs, default 3]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+#include <tucano/utils/mappedfile.hpp>
+#include <tucano/utils/objreader.hpp>
+
+int main(int argc, char *argv[])
+{
+    if ( argc < 2 )
+    {
+        std::fprintf(stderr, "usage: %s file.obj [threads] [runs]\n", argv[0]);
+        return 1;
+    }
+    const char *filename = argv[1];
+    unsigned int threads = (argc > 2) ? static_cast<unsigned int>(std::atoi(argv[2])) : 0;
+    if ( threads == 0 )
+    {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    const int runs = (argc > 3) ? std::max(1, std::atoi(argv[3])) : 3;
+
+    Tucano::MappedFile file;
+    if ( !file.open(filename) )
+    {
+        std::fprintf(stderr, "cannot open %s\n", filename);
+        return 1;
+    }
+    const double megabytes = file.size()/(1024.0*1024.0);
+    file.close();
+
+    // the first run also pages the file in; the best run is reported
+    double best = 0.0;
+    for ( int r = 0; r < runs; ++r )
+    {
+        Tucano::MeshImporter::ObjData data;
+        Tucano::MeshImporter::ObjReader reader;
+
+        const auto start = std::chrono::steady_clock::now();
+        const bool read = reader.read(filename, data, threads);
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if ( !read )
+        {
+            std::fprintf(stderr, "cannot read %s\n", filename);
+            return 1;
+        }
+
+        std::printf("run %d: %.3f s, %.1f MB/s, %zu vertices, %zu triangles\n", r + 1, seconds, megabytes/seconds,
+                data.vertices.size()/3, data.indices.size()/3);
+        best = (r == 0) ? seconds : std::min(best, seconds);
+    }
+
+    std::printf("%s, %.1f MB, %u threads: best %.1f MB/s\n", filename, megabytes, threads, megabytes/best);
+
+    return 0;
+}
@@ -0,0 +1,113 @@
+/**
+ * Times the operations of tucanow::ObjectMap against the std::map it replaced:
+ * insertion, lookup, iteration over every object and erasure, with ids
+ * inserted and looked up in random order.
+ *
+ * Usage: object_map_benchmark [number of objects, default 100000]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "object_map.hpp"
+
+namespace
+{
+    /// Stands in for an ObjectDescriptor: a few hundred bytes, one field read per visit
+    struct Object
+    {
+        char payload[400];
+        int shader = 1;
+    };
+
+    /// Milliseconds taken by a call
+    template<typename Function>
+    double time(const Function &function)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        function();
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    const int num_objects = (argc > 1) ? std::atoi(argv[1]) : 100000;
+    if ( num_objects <= 0 )
+    {
+        std::fprintf(stderr, "usage: %s [number of objects]\n", argv[0]);
+        return 1;
+    }
+
+    // sparse ids, as users number their objects
+    std::vector<int> ids(num_objects);
+    for ( int i = 0; i < num_objects; ++i )
+    {
+        ids[i] = 7*i + 3;
+    }
+    std::shuffle(ids.begin(), ids.end(), std::mt19937(1));
+
+    const int lookup_rounds = 10;
+    const int iteration_rounds = 10;
+    long checksum = 0;
+
+    std::map<int, std::unique_ptr<Object>> map;
+    tucanow::ObjectMap<Object> object_map;
+
+    const double map_insert = time([&] {
+            for ( int id : ids )
+                map[id].reset(new Object());
+        });
+    const double object_map_insert = time([&] {
+            for ( int id : ids )
+                object_map.insert(id, std::unique_ptr<Object>(new Object()));
+        });
+
+    const double map_lookup = time([&] {
+            for ( int r = 0; r < lookup_rounds; ++r )
+                for ( int id : ids )
+                    checksum += map.find(id)->second->shader;
+        });
+    const double object_map_lookup = time([&] {
+            for ( int r = 0; r < lookup_rounds; ++r )
+                for ( int id : ids )
+                    checksum += object_map.find(id)->shader;
+        });
+
+    const double map_iterate = time([&] {
+            for ( int r = 0; r < iteration_rounds; ++r )
+                for ( auto &entry : map )
+                    checksum += entry.second->shader;
+        });
+    const double object_map_iterate = time([&] {
+            for ( int r = 0; r < iteration_rounds; ++r )
+                for ( auto entry : object_map )
+                    checksum += entry.object->shader;
+        });
+
+    // half of the objects, which also runs one compaction of the object map
+    const int num_erased = num_objects/2;
+    const double map_erase = time([&] {
+            for ( int i = 0; i < num_erased; ++i )
+                map.erase(ids[i]);
+        });
+    const double object_map_erase = time([&] {
+            for ( int i = 0; i < num_erased; ++i )
+                object_map.erase(ids[i]);
+        });
+
+    std::printf("%d objects             std::map   ObjectMap (ms)\n", num_objects);
+    std::printf("insert %-16d %10.2f %11.2f\n", num_objects, map_insert, object_map_insert);
+    std::printf("lookup %-16d %10.2f %11.2f\n", lookup_rounds*num_objects, map_lookup, object_map_lookup);
+    std::printf("iterate %2d x %-10d %10.2f %11.2f\n", iteration_rounds, num_objects, map_iterate, object_map_iterate);
+    std::printf("erase %-17d %10.2f %11.2f\n", num_erased, map_erase, object_map_erase);
+    std::printf("(checksum %ld)\n", checksum);
+
+    return 0;
+}
@@ -0,0 +1,61 @@
+#ifndef TUCANOW_BENCHMARKS_OFFSCREEN_CONTEXT
+#define TUCANOW_BENCHMARKS_OFFSCREEN_CONTEXT
+
+
+/** @file offscreen_context.hpp benchmarks/offscreen_context.hpp
+ * */
+
+
+#include <EGL/egl.h>
+
+
+namespace benchmarks {
+
+
+/**
+ * @brief Make an off screen OpenGL context current, as tests/zero_copy_test.cpp does
+ *
+ * @param width Width of the pbuffer rendered to
+ * @param height Height of the pbuffer rendered to
+ *
+ * @return False if the platform has no EGL display or OpenGL context
+ */
+inline bool makeOffscreenContext(int width, int height)
+{
+    EGLDisplay display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    if ( (display == EGL_NO_DISPLAY) || !eglInitialize(display, nullptr, nullptr) )
+    {
+        return false;
+    }
+
+    const EGLint config_attributes[] = {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8, EGL_DEPTH_SIZE, 24,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_NONE
+    };
+    EGLConfig config;
+    EGLint num_configs = 0;
+    if ( !eglChooseConfig(display, config_attributes, &config, 1, &num_configs) || (num_configs == 0) )
+    {
+        return false;
+    }
+
+    const EGLint surface_attributes[] = { EGL_WIDTH, width, EGL_HEIGHT, height, EGL_NONE };
+    EGLSurface surface = eglCreatePbufferSurface(display, config, surface_attributes);
+
+    const EGLint context_attributes[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 4, EGL_CONTEXT_MINOR_VERSION, 3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_COMPATIBILITY_PROFILE_BIT,
+        EGL_NONE
+    };
+    eglBindAPI(EGL_OPENGL_API);
+    EGLContext context = eglCreateContext(display, config, EGL_NO_CONTEXT, context_attributes);
+
+    return (surface != EGL_NO_SURFACE) && (context != EGL_NO_CONTEXT) && eglMakeCurrent(display, surface, surface, context);
+}
+
+} // namespace benchmarks
+
+
+#endif
@@ -0,0 +1,75 @@
+/**
+ * Reports the size of the meshes of Sphere and the time taken to generate
+ * them, for each subdivision level: the first getMesh() call, which builds
+ * the unit sphere of the level, later getMesh() calls, which reuse it, and
+ * one getMeshes() call over many spheres.
+ *
+ * Usage: sphere_benchmark [number of spheres for getMeshes(), default 1000]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "tucanow/sphere.hpp"
+
+namespace
+{
+    /// Milliseconds taken by a call
+    template<typename Function>
+    double time(const Function &function)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        function();
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    const int num_spheres = (argc > 1) ? std::atoi(argv[1]) : 1000;
+    if ( num_spheres <= 0 )
+    {
+        std::fprintf(stderr, "usage: %s [number of spheres]\n", argv[0]);
+        return 1;
+    }
+
+    std::vector<float> centers(3*num_spheres), radii(num_spheres, 0.5f);
+    for ( int s = 0; s < num_spheres; ++s )
+    {
+        centers[3*s] = static_cast<float>(s);
+    }
+
+    std::printf("subdivisions  vertices  triangles  first getMesh (ms)  getMesh (us)  getMeshes x %d (ms)\n", num_spheres);
+    for ( std::size_t subdivisions = 0; subdivisions <= 6; ++subdivisions )
+    {
+        std::vector<float> vertices, normals;
+        std::vector<unsigned int> faces;
+        Sphere sphere;
+
+        const double first = time([&] {
+                sphere.getMesh(vertices, faces, normals, subdivisions);
+            });
+        const std::size_t num_vertices = vertices.size()/3, num_triangles = faces.size()/3;
+
+        // enough repetitions to time the small levels
+        const int repetitions = static_cast<int>(std::max<std::size_t>(1, 1000000/vertices.size()));
+        const double cached_us = time([&] {
+                for ( int r = 0; r < repetitions; ++r )
+                {
+                    sphere.setCenter(static_cast<float>(r), 0.f, 0.f);
+                    sphere.getMesh(vertices, faces, normals, subdivisions);
+                }
+            })*1000.0/repetitions;
+
+        const double many = time([&] {
+                Sphere::getMeshes(centers, radii, vertices, faces, normals, subdivisions);
+            });
+
+        std::printf("%12zu %9zu %10zu %19.3f %13.2f %20.2f\n", subdivisions, num_vertices, num_triangles, first, cached_us, many);
+    }
+
+    return 0;
+}
@@ -0,0 +1,129 @@
+/**
+ * Compares the draw throughput of a triangle mesh whose vertex attributes are
+ * kept one buffer per attribute with the same mesh interleaved in a single
+ * buffer (Scene::setObjectInterleavedAttributes()).  The mesh is a grid with
+ * positions, normals and RGBA colors, drawn with the Phong shader; each
+ * layout is timed twice, alternating, and the rendered images compared.
+ *
+ * Needs a GL context, created off screen with EGL, and the shaders directory
+ * in the working directory.
+ *
+ * Usage: vertex_layout_benchmark [grid side, default 1000] [frames, default 10]
+ */
+
+#include <GL/glew.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "tucanow/scene.hpp"
+
+#include "offscreen_context.hpp"
+
+namespace
+{
+    const int width = 512;
+    const int height = 512;
+
+    /// A wavy grid of side x side vertices in [-0.5,0.5]^2, with normals and colors
+    void makeGrid(int side, std::vector<float> &vertices, std::vector<unsigned int> &indices,
+            std::vector<float> &normals, std::vector<float> &colors)
+    {
+        for ( int j = 0; j < side; ++j )
+        {
+            for ( int i = 0; i < side; ++i )
+            {
+                const float x = float(i)/side - 0.5f, y = float(j)/side - 0.5f;
+                vertices.insert(vertices.end(), { x, y, 0.1f*std::sin(10.f*x) });
+                normals.insert(normals.end(), { -std::cos(10.f*x), 0.f, 1.f });
+                colors.insert(colors.end(), { x + 0.5f, y + 0.5f, 0.5f, 1.f });
+            }
+        }
+        for ( int j = 0; j + 1 < side; ++j )
+        {
+            for ( int i = 0; i + 1 < side; ++i )
+            {
+                const unsigned int a = j*side + i, b = a + 1, c = a + side, d = c + 1;
+                indices.insert(indices.end(), { a, b, c, b, d, c });
+            }
+        }
+    }
+
+    /// Milliseconds per frame over a number of frames, after one frame that uploads whatever changed
+    double frameTime(tucanow::Scene &scene, int frames)
+    {
+        scene.render();
+        glFinish();
+
+        const auto start = std::chrono::steady_clock::now();
+        for ( int f = 0; f < frames; ++f )
+        {
+            scene.render();
+        }
+        glFinish();
+
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count()/frames;
+    }
+
+    std::vector<unsigned char> readPixels()
+    {
+        std::vector<unsigned char> pixels(4*width*height);
+        glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+        return pixels;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    const int side = (argc > 1) ? std::atoi(argv[1]) : 1000;
+    const int frames = (argc > 2) ? std::atoi(argv[2]) : 10;
+    if ( (side < 2) || (frames < 1) )
+    {
+        std::fprintf(stderr, "usage: %s [grid side] [frames]\n", argv[0]);
+        return 1;
+    }
+
+    if ( !benchmarks::makeOffscreenContext(width, height) )
+    {
+        std::printf("no OpenGL context, skipped\n");
+        return 77;
+    }
+
+    tucanow::Scene scene;
+    scene.initialize(width, height);
+    // nothing is picked
+    scene.setAutomaticBvh(false);
+
+    std::vector<float> vertices, normals, colors;
+    std::vector<unsigned int> indices;
+    makeGrid(side, vertices, indices, normals, colors);
+    const double num_triangles = indices.size()/3;
+
+    if ( !scene.loadTriangleMesh(1, std::move(vertices), std::move(indices), std::move(normals)) ||
+         !scene.setObjectColorsRGBA(1, colors) )
+    {
+        std::fprintf(stderr, "cannot load the mesh\n");
+        return 1;
+    }
+
+    std::printf("%.0f triangles, %dx%d, %d frames\n", num_triangles, width, height, frames);
+
+    std::vector<unsigned char> images[2];
+    for ( int run = 0; run < 4; ++run )
+    {
+        const bool interleaved = (run % 2 == 1);
+        scene.setObjectInterleavedAttributes(1, interleaved);
+
+        const double ms = frameTime(scene, frames);
+        images[run % 2] = readPixels();
+        std::printf("%-11s %8.1f ms/frame %8.1f Mtriangles/s\n", interleaved ? "interleaved" : "separate", ms,
+                num_triangles/(ms*1000.0));
+    }
+
+    std::printf("images %s\n", (images[0] == images[1]) ? "identical" : "DIFFER");
+
+    return 0;
+}
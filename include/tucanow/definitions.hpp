@@ -4,6 +4,8 @@
 /** @file object_definitions.hpp tucanow/object_definitions.hpp
  * */
 
+#include <array>
+#include <cstddef>
 
 namespace tucanow {
 
@@ -13,7 +15,8 @@ enum class ObjectType {
     CurveMesh,
     TriangleMesh,
     PLY,
-    OBJ
+    OBJ,
+    Glyphs
 };
 
 enum class ObjectShader {
@@ -25,7 +28,62 @@ enum class ObjectShader {
     OnePassWireframe,
     Toon,
     // Require normals and accept textures
-    Phong
+    Phong,
+    // Draw each vertex as a ray-cast sphere (see Scene::setPointRadius())
+    SphereImpostors,
+    // Only for objects loaded with Scene::loadInstancedGlyphs()
+    InstancedGlyphs
+};
+
+enum class NormalWeighting {
+    // Triangles contribute to the normals of their vertices in proportion to their area
+    Area,
+    // Triangles contribute in proportion to their angle at each vertex
+    Angle
+};
+
+enum class IndexOptimization {
+    // Triangles are drawn in the order they were loaded
+    None,
+    // Triangles are reordered for the post-transform vertex cache
+    VertexCache,
+    // Triangles are reordered for the vertex cache, then in clusters for less overdraw
+    VertexCacheAndOverdraw
+};
+
+enum class ClusterCulling {
+    // Triangle meshes are drawn whole
+    None,
+    // Clusters of triangles outside the camera frustum are skipped
+    Frustum,
+    // Clusters outside the frustum, or whose triangles all face away from the camera, are skipped
+    FrustumAndBackfaces
+};
+
+enum class GlyphType {
+    // Unit radius sphere centered at the glyph position
+    Sphere,
+    // Unit length arrow pointing along +z from the glyph position
+    Arrow,
+    // Unit radius, unit length cylinder along +z from the glyph position
+    Cylinder,
+    // Unit radius, unit length cone along +z from the glyph position
+    Cone
+};
+
+enum class LoadStatus {
+    // No asynchronous load was started for the object
+    None,
+    // File is being read on a worker thread
+    Parsing,
+    // Mesh is being sent to the GPU, a slice per Scene::render() call
+    Uploading,
+    // Object replaced by the loaded mesh
+    Done,
+    // File could not be read
+    Failed,
+    // Load stopped by Scene::cancelLoad() or by reloading the object
+    Cancelled
 };
 
 enum class SceneOptions {
@@ -41,6 +99,46 @@ enum class SceneOptions {
     DisableRenderBoundingBoxBoundary
 };
 
+struct RenderStats {
+    // Draw calls issued in the last frame
+    std::size_t draw_calls = 0;
+    // GL state changes (shader programs, viewport, capabilities) issued in the last frame
+    std::size_t state_changes = 0;
+    // Redundant state changes skipped by the state cache in the last frame
+    std::size_t skipped_state_changes = 0;
+    // Objects drawn in the last frame
+    std::size_t drawn_objects = 0;
+    // Objects skipped in the last frame for lying outside the camera frustum
+    std::size_t culled_objects = 0;
+    // Triangles drawn in the last frame, at the levels of detail in use
+    std::size_t drawn_triangles = 0;
+    // Clusters of triangles skipped in the last frame by cluster culling
+    std::size_t culled_clusters = 0;
+};
+
+struct VertexCacheStats {
+    // Vertices shaded per triangle with a 16 entry FIFO cache: 3 at worst, about 0.5 at best
+    float acmr = 0.0f;
+    // Times each vertex is shaded with the same cache: 1 at best
+    float atvr = 0.0f;
+    // ACMR and ATVR of the triangle order the object was loaded with
+    float loaded_acmr = 0.0f;
+    float loaded_atvr = 0.0f;
+};
+
+struct PickResult {
+    // True if the ray hit a triangle; the other fields are only set then
+    bool hit = false;
+    // Object hit
+    int object_id = -1;
+    // Triangle hit, as its position in the object's triangles (indices 3*triangle to 3*triangle+2)
+    std::size_t triangle = 0;
+    // Weights of the triangle's three vertices at the hit point
+    std::array<float, 3> barycentrics = {{0.0f, 0.0f, 0.0f}};
+    // Hit point in world space
+    std::array<float, 3> point = {{0.0f, 0.0f, 0.0f}};
+};
+
 } // namespace tucanow
 
 
@@ -6,6 +6,7 @@
 
 #include "tucanow/definitions.hpp"
 
+#include<cstddef>
 #include<memory>
 #include<string>
 #include<vector>
@@ -127,9 +128,21 @@ class Scene
 
         /**
          * @brief Repaints screen buffer.
+         *
+         * Objects are drawn grouped by shader, texture and opacity, so that each
+         * shader is bound once per frame.  Within a group objects keep their id
+         * order.  Objects whose bounding box lies outside the camera frustum
+         * are skipped (see setFrustumCulling()).
          **/
         virtual void render();
 
+        /**
+         * @brief Get draw call, state change and culling counts of the last rendered frame
+         *
+         * @return Statistics of the last call to render()
+         */
+        virtual RenderStats getRenderStats();
+
         /**
          * @brief Render model with a single pass wireframe shader
          *
@@ -144,6 +157,16 @@ class Scene
          */
         void toggleRenderWireframe();
 
+        /**
+         * @brief Skip objects outside the camera frustum when rendering
+         *
+         * Culling is enabled by default; each object is tested with its
+         * world space axis aligned bounding box.
+         *
+         * @param enable Set false to draw every object
+         */
+        void setFrustumCulling(bool enable);
+
         /**
          * @brief Set the bounding box
          *
@@ -165,6 +188,39 @@ class Scene
                 const std::vector<float> &vertices 
                 );
 
+        /**
+         * @brief Load a point cloud to visualize
+         *
+         * Overloaded method: the buffer is uploaded to the GPU as is, no copies are made
+         *
+         * @param object_id Object index (integer valued)
+         * @param vertices Pointer to packed (x,y,z) point coordinates (must be non-null)
+         * @param vertices_size Number of floats in vertices (must be a non-zero multiple of 3)
+         *
+         * @return True if point cloud was set correctly
+         */
+        bool loadPointCloud(
+                int object_id,
+                const float *vertices,
+                std::size_t vertices_size
+                );
+
+        /**
+         * @brief Load a point cloud to visualize
+         *
+         * Overloaded method: takes ownership of the buffer and releases it as
+         * soon as it is uploaded to the GPU
+         *
+         * @param object_id Object index (integer valued)
+         * @param vertices Point cloud vertices (must be non-empty)
+         *
+         * @return True if point cloud was set correctly
+         */
+        bool loadPointCloud(
+                int object_id,
+                std::vector<float> &&vertices 
+                );
+
         /**
          * @brief Load a curve mesh to visualize
          *
@@ -198,6 +254,214 @@ class Scene
                 const std::vector<float> &vertex_normals = {}
                 );
 
+        /**
+         * @brief Load a triangle mesh to visualize
+         *
+         * Overloaded method: buffers are uploaded to the GPU as they are, no
+         * copies are made
+         *
+         * @param object_id Object index (integer valued)
+         * @param vertices Pointer to packed (x,y,z) vertex coordinates (must be non-null)
+         * @param vertices_size Number of floats in vertices (must be a non-zero multiple of 3)
+         * @param indices Pointer to mesh triangles (indices on the vertices' list)
+         * @param indices_size Number of indices (must be a non-zero multiple of 3)
+         * @param vertex_normals Pointer to normals per vertex, may be null
+         * @param vertex_normals_size Number of floats in vertex_normals (must equal vertices_size if non-null)
+         *
+         * @return True if mesh was set correctly
+         */
+        bool loadTriangleMesh(
+                int object_id,
+                const float *vertices, 
+                std::size_t vertices_size,
+                const unsigned int *indices,
+                std::size_t indices_size,
+                const float *vertex_normals = nullptr,
+                std::size_t vertex_normals_size = 0
+                );
+
+        /**
+         * @brief Load a triangle mesh to visualize
+         *
+         * Overloaded method: takes ownership of the buffers and releases them
+         * as soon as they are uploaded to the GPU
+         *
+         * @param object_id Object index (integer valued)
+         * @param vertices Mesh vertices (must be non-empty)
+         * @param indices Mesh triangles (vector of indices on the vertices' list)
+         * @param vertex_normals Normals per vertex
+         *
+         * @return True if mesh was set correctly
+         */
+        bool loadTriangleMesh(
+                int object_id,
+                std::vector<float> &&vertices, 
+                std::vector<unsigned int> &&indices,
+                std::vector<float> &&vertex_normals = {}
+                );
+
+        /**
+         * @brief Overwrite a range of an object's vertices in place
+         *
+         * The object's GL buffers are kept, only the given range is uploaded.
+         * Bounds, centroid and normalization scale are not recomputed; normals
+         * computed by tucanow are recomputed around the moved vertices.
+         * The picking hierarchy is refit to the moved vertices, and clusters
+         * for cluster culling keep their triangles while their bounds are
+         * recomputed before they are next culled, from the hierarchy's copy
+         * of the mesh or, without a hierarchy, from the mesh read back from
+         * the GPU.
+         *
+         * @param object_id Object index (integer valued)
+         * @param offset Index of the first vertex to overwrite
+         * @param vertices New vertex coordinates, laid out as when the object was loaded
+         *
+         * @return True if object exists and the range fits inside its vertices
+         */
+        bool updateObjectVertices(int object_id, std::size_t offset, const std::vector<float> &vertices);
+
+        /**
+         * @brief Overwrite a range of an object's vertices in place
+         *
+         * Overloaded method
+         *
+         * @param object_id Object index (integer valued)
+         * @param offset Index of the first vertex to overwrite
+         * @param vertices Pointer to new vertex coordinates, laid out as when the object was loaded
+         * @param vertices_size Number of floats in vertices
+         *
+         * @return True if object exists and the range fits inside its vertices
+         */
+        bool updateObjectVertices(int object_id, std::size_t offset, const float *vertices, std::size_t vertices_size);
+
+        /**
+         * @brief Overwrite a range of an object's normals in place
+         *
+         * @param object_id Object index (integer valued)
+         * @param offset Index of the first normal to overwrite
+         * @param vertex_normals New (x,y,z) normals
+         *
+         * @return True if object has normals and the range fits inside them
+         */
+        bool updateObjectNormals(int object_id, std::size_t offset, const std::vector<float> &vertex_normals);
+
+        /**
+         * @brief Overwrite a range of an object's normals in place
+         *
+         * Overloaded method
+         *
+         * @param object_id Object index (integer valued)
+         * @param offset Index of the first normal to overwrite
+         * @param vertex_normals Pointer to new (x,y,z) normals
+         * @param vertex_normals_size Number of floats in vertex_normals
+         *
+         * @return True if object has normals and the range fits inside them
+         */
+        bool updateObjectNormals(int object_id, std::size_t offset, const float *vertex_normals, std::size_t vertex_normals_size);
+
+        /**
+         * @brief Compute the vertex normals of a triangle mesh
+         *
+         * Normals are computed with one thread per range of triangles and
+         * the object is shaded with Phong if it used DirectColor.  A copy of
+         * the vertices and triangles is kept: later calls to
+         * updateObjectVertices() recompute and upload only the normals
+         * around the moved vertices, until the normals are set with
+         * updateObjectNormals() or the object is reloaded.
+         *
+         * @param object_id Object index (integer valued)
+         * @param weighting How triangles contribute to the normals of their vertices
+         *
+         * @return True if object is an indexed triangle mesh with float vertices
+         */
+        bool computeObjectNormals(int object_id, NormalWeighting weighting = NormalWeighting::Angle);
+
+        /**
+         * @brief Compute normals for triangle meshes loaded without them
+         *
+         * When enabled, loadTriangleMesh() without vertex_normals behaves as
+         * if computeObjectNormals() was called right after it.
+         *
+         * @param enable True to compute normals (default false)
+         * @param weighting How triangles contribute to the normals of their vertices
+         */
+        void setAutomaticNormals(bool enable, NormalWeighting weighting = NormalWeighting::Angle);
+
+        /**
+         * @brief Overwrite a range of an object's colours per vertex in place
+         *
+         * @param object_id Object index (integer valued)
+         * @param offset Index of the first colour to overwrite
+         * @param colors New colours, RGB or RGBA as set by setObjectColorsRGB() or setObjectColorsRGBA()
+         *
+         * @return True if object has colours per vertex and the range fits inside them
+         */
+        bool updateObjectColors(int object_id, std::size_t offset, const std::vector<float> &colors);
+
+        /**
+         * @brief Overwrite a range of an object's colours per vertex in place
+         *
+         * Overloaded method
+         *
+         * @param object_id Object index (integer valued)
+         * @param offset Index of the first colour to overwrite
+         * @param colors Pointer to new colours, RGB or RGBA as set by setObjectColorsRGB() or setObjectColorsRGBA()
+         * @param colors_size Number of floats in colors
+         *
+         * @return True if object has colours per vertex and the range fits inside them
+         */
+        bool updateObjectColors(int object_id, std::size_t offset, const float *colors, std::size_t colors_size);
+
+        /**
+         * @brief Set the sphere radius used by ObjectShader::SphereImpostors
+         *
+         * The radius is in the object's coordinates and is used for points
+         * without a radius of their own (see loadPointRadii()).  A radius of
+         * zero, the default, picks 0.5% of the object's bounding box diagonal.
+         *
+         * @param object_id Object index (integer valued)
+         * @param radius Sphere radius (must be non-negative)
+         *
+         * @return True if object exists and radius is valid
+         */
+        bool setPointRadius(int object_id, float radius);
+
+        /**
+         * @brief Load a sphere radius per vertex, used by ObjectShader::SphereImpostors
+         *
+         * @param object_id Object index (integer valued)
+         * @param radii One radius per vertex, in the object's coordinates
+         *
+         * @return True if object exists and there is one radius per vertex
+         */
+        bool loadPointRadii(int object_id, const std::vector<float> &radii);
+
+        /**
+         * @brief Load many copies of a glyph (sphere, arrow, cylinder or cone) to visualize
+         *
+         * The glyph mesh is uploaded once and every copy is drawn by a single
+         * instanced draw call, with position, scale, colour and orientation
+         * read per instance.  The object is rendered with
+         * ObjectShader::InstancedGlyphs.
+         *
+         * @param object_id Object index (integer valued)
+         * @param glyph_type Shape of the glyphs
+         * @param positions Packed (x,y,z) glyph positions (must be non-empty)
+         * @param scales One scale per glyph, or packed (sx,sy,sz) scales; empty for unit scale
+         * @param colors Packed RGB or RGBA colours per glyph; empty for the default colour
+         * @param orientations Packed unit quaternions (x,y,z,w) per glyph; empty to keep glyphs aligned with the axes
+         *
+         * @return True if glyphs were loaded successfully
+         */
+        bool loadInstancedGlyphs(
+                int object_id,
+                GlyphType glyph_type,
+                const std::vector<float> &positions,
+                const std::vector<float> &scales = {},
+                const std::vector<float> &colors = {},
+                const std::vector<float> &orientations = {}
+                );
+
         /**
          * @brief Load a Ply mesh file
          *
@@ -208,6 +472,343 @@ class Scene
          */
         bool loadPLY(int object_id, const std::string &filename);
 
+        /**
+         * @brief Load a Wavefront OBJ mesh file
+         *
+         * Positions, texture coordinates, normals and "v x y z r g b" colors
+         * are read; polygons are triangulated and materials are ignored.
+         *
+         * @param object_id Object index (integer valued)
+         * @param filename Name of file to open
+         *
+         * @return True if mesh was loaded successfully
+         */
+        bool loadOBJ(int object_id, const std::string &filename);
+
+        /**
+         * @brief Save an object to a binary cache file
+         *
+         * The cache holds the object's GPU buffers as they are, its bounds,
+         * shader and the name of its texture image, so that
+         * loadObjectCache() restores it without parsing or processing.
+         * Caches are meant for the machine that wrote them.  Objects loaded
+         * with loadInstancedGlyphs() cannot be cached.
+         *
+         * @param object_id Object index (integer valued)
+         * @param filename Name of the cache file
+         *
+         * @return True if the cache was written
+         */
+        bool saveObjectCache(int object_id, const std::string &filename);
+
+        /**
+         * @brief Load an object from a cache file written by saveObjectCache()
+         *
+         * @param object_id Object index (integer valued)
+         * @param filename Name of the cache file
+         *
+         * @return True if the object was loaded
+         */
+        bool loadObjectCache(int object_id, const std::string &filename);
+
+        /**
+         * @brief Keep a cache next to the files read by loadPLY() and loadOBJ()
+         *
+         * When enabled, loading "mesh.ply" first looks for "mesh.ply.tcache"
+         * and uses it if it was built from the current version of the file
+         * (same size, modification time and a hash of its first and last
+         * bytes); otherwise the file is read and the cache is (re)written.
+         * Asynchronous loads do not use the cache.
+         *
+         * @param enable True to use and write caches (default false)
+         */
+        void setAutomaticCache(bool enable);
+
+        /**
+         * @brief Reorder the triangles of meshes as they are loaded
+         *
+         * Applies to loadTriangleMesh(), loadPLY(), loadOBJ() and
+         * loadPLYAsync().  Triangles are reordered to shade each vertex as
+         * few times as possible and, with
+         * IndexOptimization::VertexCacheAndOverdraw, in clusters drawn from
+         * the outside of the mesh in.  Meshes read from files also have
+         * their vertices renumbered in the order the triangles use them,
+         * except asynchronous loads; vertices given to loadTriangleMesh()
+         * keep their numbers, so that updateObjectVertices() offsets still
+         * hold.  Objects restored from a cache keep the order they were
+         * saved with.
+         *
+         * @param optimization Reordering applied (default IndexOptimization::None)
+         */
+        void setIndexOptimization(IndexOptimization optimization);
+
+        /**
+         * @brief Get the vertex cache efficiency of a triangle mesh
+         *
+         * @param object_id Object index (integer valued)
+         * @param stats Receives the ratios of the current triangle order and
+         * of the order it was loaded with (the same if it was not reordered)
+         *
+         * @return True if object is an indexed triangle mesh
+         */
+        bool getObjectVertexCacheStats(int object_id, VertexCacheStats &stats);
+
+        /**
+         * @brief Build coarser levels of detail of a triangle mesh
+         *
+         * Each level is simplified from the previous one by collapsing the
+         * edges that change the surface the least; borders and seams
+         * between vertices at the same position are kept.  render() draws
+         * the coarsest level whose error stays below setLodPixelError()
+         * pixels on screen.  Levels are dropped whenever the mesh triangles
+         * are loaded again.
+         *
+         * @param object_id Object index (integer valued)
+         * @param triangle_budgets Triangles of each level, from the finest;
+         * empty for a quarter of the previous level each, down to a
+         * thousand triangles
+         *
+         * @return True if object is an indexed triangle mesh
+         */
+        bool buildObjectLod(int object_id, const std::vector<std::size_t> &triangle_budgets = {});
+
+        /**
+         * @brief Build levels of detail of triangle meshes as they are loaded
+         *
+         * Applies to loadTriangleMesh(), loadPLY(), loadOBJ(),
+         * loadPLYAsync() and loadObjectCache(), with the default budgets of
+         * buildObjectLod().
+         *
+         * @param enable True to build levels of detail (default false)
+         */
+        void setAutomaticLod(bool enable);
+
+        /**
+         * @brief Set the largest error of a level of detail on screen
+         *
+         * A coarser level is only switched to once its error is below three
+         * quarters of this bound, so that objects do not flicker between
+         * levels at a steady distance.
+         *
+         * @param pixels Error in pixels (default 1)
+         */
+        void setLodPixelError(float pixels);
+
+        /**
+         * @brief Draw an object at a given level of detail whatever its distance
+         *
+         * @param object_id Object index (integer valued)
+         * @param level Level, 0 being the full mesh; -1 to pick it from the
+         * distance again
+         *
+         * @return True if object exists and has this level
+         */
+        bool setObjectLod(int object_id, int level);
+
+        /**
+         * @brief Get the level of detail an object was last drawn at
+         *
+         * @param object_id Object index (integer valued)
+         *
+         * @return Level, 0 being the full mesh, or -1 if object does not exist
+         */
+        int getObjectLod(int object_id);
+
+        /**
+         * @brief Get the number of triangles of each level of detail of an object
+         *
+         * @param object_id Object index (integer valued)
+         *
+         * @return Triangles of each level, the full mesh first; empty if
+         * object is not a triangle mesh
+         */
+        std::vector<std::size_t> getObjectLodTriangles(int object_id);
+
+        /**
+         * @brief Skip the parts of triangle meshes that cannot be seen
+         *
+         * Triangle meshes loaded while culling is on are split into
+         * clusters of up to 128 neighbouring triangles.  Each frame, the
+         * clusters of objects drawn at full detail are tested against the
+         * camera frustum, and with ClusterCulling::FrustumAndBackfaces
+         * against the camera direction, and only the remaining ones are
+         * drawn.  Back faces are otherwise drawn: only cull them for closed
+         * surfaces or surfaces seen from one side.
+         *
+         * @param culling Clusters skipped (default ClusterCulling::None)
+         */
+        void setClusterCulling(ClusterCulling culling);
+
+        /**
+         * @brief Split a triangle mesh into clusters for cluster culling
+         *
+         * Reorders the triangles of the object; for objects loaded before
+         * setClusterCulling() was turned on.
+         *
+         * @param object_id Object index (integer valued)
+         *
+         * @return True if object is an indexed triangle mesh
+         */
+        bool buildObjectClusters(int object_id);
+
+        /**
+         * @brief Get the number of clusters of an object
+         *
+         * @param object_id Object index (integer valued)
+         *
+         * @return Number of clusters, 0 if object has none or does not exist
+         */
+        std::size_t getObjectClusterCount(int object_id);
+
+        /**
+         * @brief Find the triangle under a screen position
+         *
+         * Casts a ray from the camera through the position and intersects it
+         * with the triangle meshes on the CPU, through a bounding volume
+         * hierarchy over the triangles of each object and one over the
+         * objects, so no GPU work is waited for.  Back faces are hit as
+         * well, and meshes are hit at full detail whatever level is drawn.
+         * Objects with ObjectShader::None, point clouds, curves and glyphs
+         * are not picked.
+         *
+         * Hierarchies are built as meshes are loaded, see setAutomaticBvh(),
+         * or by buildObjectBvh(); meshes without one are not picked, so a
+         * pick never reads anything back from the GPU.
+         *
+         * @param xpos Horizontal screen position, as for rotateCamera()
+         * @param ypos Vertical screen position, from the top
+         *
+         * @return Nearest hit, or a result with hit set to false
+         */
+        PickResult pick(float xpos, float ypos);
+
+        /**
+         * @brief Build the picking hierarchy of a triangle mesh
+         *
+         * Keeps a copy of the mesh vertices and triangles on the CPU, read
+         * back from the GPU.  The hierarchy is refit when the vertices are
+         * updated and built again when the triangles are reordered.
+         *
+         * @param object_id Object index (integer valued)
+         *
+         * @return True if object is a triangle mesh
+         */
+        bool buildObjectBvh(int object_id);
+
+        /**
+         * @brief Build picking hierarchies of triangle meshes as they are loaded
+         *
+         * Applies to loadTriangleMesh(), loadPLY(), loadOBJ(),
+         * loadPLYAsync() and loadObjectCache(); loadPLYAsync() builds them
+         * on its worker thread.
+         *
+         * @param enable True to build hierarchies on load (default true)
+         */
+        void setAutomaticBvh(bool enable);
+
+        /**
+         * @brief Track the object under a screen position on the GPU
+         *
+         * Meant to be called on every mouse move.  Each render() draws the
+         * ids of the triangle meshes pick() can hit, hierarchy or not, into
+         * the few pixels around the position, and starts copying them back
+         * without waiting for the GPU; a later render() takes the copy once the GPU
+         * is done with it, so getHoveredObject() follows the position a
+         * frame or two behind.  Nothing is built on the CPU.
+         *
+         * @param xpos Horizontal screen position, as for rotateCamera()
+         * @param ypos Vertical screen position, from the top
+         */
+        void setHoverPosition(float xpos, float ypos);
+
+        /**
+         * @brief Stop tracking the object under the hover position
+         */
+        void clearHoverPosition();
+
+        /**
+         * @brief Get the object under the hover position
+         *
+         * When the position falls between objects, the nearest object drawn
+         * within a few pixels of it is taken.
+         *
+         * @param object_id Object index (integer valued)
+         * @param triangle Triangle of the object, as in PickResult
+         *
+         * @return True if an object is under the hover position
+         */
+        bool getHoveredObject(int &object_id, std::size_t &triangle);
+
+        /**
+         * @brief Highlight the object under the hover position
+         *
+         * The object is drawn again over itself, blended with the color set
+         * by setHoverHighlightColor().
+         *
+         * @param enable True to highlight (default false)
+         */
+        void setHoverHighlight(bool enable);
+
+        /**
+         * @brief Set the color of the hover highlight
+         *
+         * @param r Red channel
+         * @param g Green channel
+         * @param b Blue channel
+         * @param a Alpha channel, weight of the color over the object
+         */
+        void setHoverHighlightColor(float r, float g, float b, float a = 0.4f);
+
+        /**
+         * @brief Load a Ply mesh file without blocking the rendering thread
+         *
+         * The file is read on a worker thread and the mesh is then sent to
+         * the GPU in slices, during the following calls to render().  An
+         * object already using this id stays visible until the new mesh is
+         * complete.  Loading the object by other means, or removing it,
+         * cancels the load.
+         *
+         * @param object_id Object index (integer valued), also used to query the load
+         * @param filename Name of file to open
+         *
+         * @return True if the load was started
+         */
+        bool loadPLYAsync(int object_id, const std::string &filename);
+
+        /**
+         * @brief Get the status of the last asynchronous load of an object
+         *
+         * @param object_id Object index (integer valued)
+         *
+         * @return LoadStatus::None if no asynchronous load was started for the object
+         */
+        LoadStatus getLoadStatus(int object_id) const;
+
+        /**
+         * @brief Get the progress of the current stage of an asynchronous load
+         *
+         * @param object_id Object index (integer valued)
+         *
+         * @return Fraction in [0, 1] of the file read while parsing, or of the mesh sent to the GPU while uploading
+         */
+        float getLoadProgress(int object_id) const;
+
+        /**
+         * @brief Stop an asynchronous load, leaving the object as it was
+         *
+         * @param object_id Object index (integer valued)
+         *
+         * @return True if a load was pending for the object
+         */
+        bool cancelLoad(int object_id);
+
+        /**
+         * @brief Set how much data asynchronous loads may send to the GPU per frame
+         *
+         * @param bytes_per_frame Upload budget of a render() call (default 16 MiB)
+         */
+        void setUploadBudget(std::size_t bytes_per_frame);
+
         /**
          * @brief Clear Scene
          */
@@ -225,6 +826,10 @@ class Scene
         /**
          * @brief Set object's shader
          *
+         * Glyph objects only accept ObjectShader::InstancedGlyphs and
+         * ObjectShader::None, and ObjectShader::InstancedGlyphs is only
+         * accepted by glyph objects.
+         *
          * @param object_id Object index (integer valued)
          * @param shader Shader
          *
@@ -232,6 +837,36 @@ class Scene
          */
         bool setObjectShader(int object_id, const ObjectShader& shader);
 
+        /**
+         * @brief Store all of the object's vertex attributes in a single interleaved buffer
+         *
+         * Attributes are packed once, the next time the object is rendered.
+         *
+         * @param object_id Object index (integer valued)
+         * @param interleave Set true for a single interleaved buffer, false for one buffer per attribute
+         *
+         * @return True if object exists
+         */
+        bool setObjectInterleavedAttributes(int object_id, bool interleave);
+
+        /**
+         * @brief Store the object's positions, normals and colors in compact form
+         *
+         * Positions become 16 bit offsets inside the object's bounding box,
+         * normals two 16 bit octahedral coordinates and colors RGBA8: 14
+         * bytes per vertex instead of 40, decoded by the shaders.  Precision
+         * is about 1/65535 of the object's extent.  Quantized attributes
+         * cannot be changed with updateObjectVertices(), updateObjectNormals()
+         * or updateObjectColors() until the object is switched back to floats.
+         * Objects loaded with loadInstancedGlyphs() are not quantized.
+         *
+         * @param object_id Object index (integer valued)
+         * @param quantize Set true for compact attributes, false to go back to floats
+         *
+         * @return True if object exists and can be quantized
+         */
+        bool setObjectQuantizedAttributes(int object_id, bool quantize);
+
         /**
          * @brief Set object's single colour -- does not affect mesh loaded from a ply file
          *
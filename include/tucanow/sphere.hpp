@@ -2,6 +2,13 @@
 #define TUCANOW_SPHERE
 
 
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 #include <Eigen/Dense>
 
@@ -25,75 +32,189 @@ class Sphere {
             return true;
         }
 
+        /**
+         * @brief Get a triangle mesh of the sphere
+         *
+         * The sphere is a subdivided octahedron whose vertices are shared
+         * between neighbouring triangles.  The unit sphere of each
+         * subdivision level is built once and reused by later calls.
+         *
+         * @param vertices Packed (x,y,z) vertex coordinates
+         * @param faces Triangles (indices on the vertices' list)
+         * @param normals Packed (x,y,z) normals per vertex
+         * @param subdivisions Number of times the octahedron triangles are split in 4
+         */
         void getMesh(std::vector<float> &vertices, std::vector<unsigned int> &faces, std::vector<float> &normals, size_t subdivisions = 4)
         {
-            std::vector< Eigen::Vector4f > vert;
+            const UnitSphere &unit = unitSphere(subdivisions);
 
-            vert.push_back ( Eigen::Vector4f( 1.0, 0.0, 0.0, 1.0) );
-            vert.push_back ( Eigen::Vector4f(-1.0, 0.0, 0.0, 1.0) );
-            vert.push_back ( Eigen::Vector4f( 0.0, 1.0, 0.0, 1.0) );
-            vert.push_back ( Eigen::Vector4f( 0.0,-1.0, 0.0, 1.0) );
-            vert.push_back ( Eigen::Vector4f( 0.0, 0.0, 1.0, 1.0) );
-            vert.push_back ( Eigen::Vector4f( 0.0, 0.0,-1.0, 1.0) );
+            faces = unit.faces;
+            normals = unit.points;
+            vertices.resize(unit.points.size());
 
-            /* int a[24] = { 0, 4, 2, 2, 4, 1, 1, 4, 3, 3, 4, 0, 0, 2, 5, 2, 1, 5, 1, 3, 5, 3, 0, 5 }; */
-            /* faces.insert(faces.end(), a, a+24); */
-            faces = { 0, 4, 2, 2, 4, 1, 1, 4, 3, 3, 4, 0, 0, 2, 5, 2, 1, 5, 1, 3, 5, 3, 0, 5 };
+            placeVertices(unit, center_x, center_y, center_z, radius, vertices.data());
+        }
+
+        /**
+         * @brief Get a single triangle mesh holding many spheres
+         *
+         * @param centers Packed (x,y,z) sphere centers
+         * @param radii One radius per sphere (must be positive)
+         * @param vertices Packed (x,y,z) vertex coordinates of all spheres
+         * @param faces Triangles of all spheres (indices on the vertices' list)
+         * @param normals Packed (x,y,z) normals per vertex of all spheres
+         * @param subdivisions Number of times the octahedron triangles are split in 4
+         *
+         * @return True if there is one positive radius per center
+         */
+        static bool getMeshes(const std::vector<float> &centers, const std::vector<float> &radii,
+                std::vector<float> &vertices, std::vector<unsigned int> &faces, std::vector<float> &normals,
+                size_t subdivisions = 4)
+        {
+            if ( (centers.size() % 3 != 0) || (centers.size() != 3*radii.size()) )
+                return false;
+
+            for ( float r : radii )
+                if ( !(r > 0.f) )
+                    return false;
+
+            const UnitSphere &unit = unitSphere(subdivisions);
+            const size_t num_spheres = radii.size();
+            const size_t num_points = unit.points.size();
+            const size_t num_faces = unit.faces.size();
+            const unsigned int num_vertices = static_cast<unsigned int>(num_points/3);
+
+            vertices.resize(num_spheres*num_points);
+            normals.resize(num_spheres*num_points);
+            faces.resize(num_spheres*num_faces);
+
+            // every sphere writes its own range, so the loop can be split among threads
+            for ( size_t s = 0; s < num_spheres; ++s )
+            {
+                placeVertices(unit, centers[3*s + 0], centers[3*s + 1], centers[3*s + 2], radii[s], &vertices[s*num_points]);
+
+                std::copy(unit.points.begin(), unit.points.end(), normals.begin() + s*num_points);
+
+                const unsigned int offset = static_cast<unsigned int>(s)*num_vertices;
+                for ( size_t i = 0; i < num_faces; ++i )
+                {
+                    faces[s*num_faces + i] = unit.faces[i] + offset;
+                }
+            }
+
+            return true;
+        }
+
+    private:
+        struct UnitSphere
+        {
+            /// Packed (x,y,z) points on the unit sphere, which are also the normals
+            std::vector<float> points;
+
+            /// Triangles (indices on the points' list)
+            std::vector<unsigned int> faces;
+        };
+
+        /// Scales and translates the unit sphere into out, which holds unit.points.size() floats
+        static void placeVertices(const UnitSphere &unit, float x, float y, float z, float r, float *out)
+        {
+            const size_t num_points = unit.points.size();
+            for ( size_t i = 0; i < num_points; i += 3 )
+            {
+                out[i + 0] = x + r*unit.points[i + 0];
+                out[i + 1] = y + r*unit.points[i + 1];
+                out[i + 2] = z + r*unit.points[i + 2];
+            }
+        }
+
+        /// Unit sphere of a subdivision level, built on first use
+        static const UnitSphere& unitSphere(size_t subdivisions)
+        {
+            static std::mutex cache_mutex;
+            static std::map<size_t, std::unique_ptr<UnitSphere>> cache;
+
+            std::lock_guard<std::mutex> lock(cache_mutex);
+
+            std::unique_ptr<UnitSphere> &unit = cache[subdivisions];
+            if ( unit == nullptr )
+            {
+                unit.reset(new UnitSphere(buildUnitSphere(subdivisions)));
+            }
+
+            return *unit;
+        }
+
+        static UnitSphere buildUnitSphere(size_t subdivisions)
+        {
+            std::vector< Eigen::Vector3f > vert;
+
+            vert.push_back ( Eigen::Vector3f( 1.0, 0.0, 0.0) );
+            vert.push_back ( Eigen::Vector3f(-1.0, 0.0, 0.0) );
+            vert.push_back ( Eigen::Vector3f( 0.0, 1.0, 0.0) );
+            vert.push_back ( Eigen::Vector3f( 0.0,-1.0, 0.0) );
+            vert.push_back ( Eigen::Vector3f( 0.0, 0.0, 1.0) );
+            vert.push_back ( Eigen::Vector3f( 0.0, 0.0,-1.0) );
+
+            std::vector< unsigned int > faces = { 0, 4, 2, 2, 4, 1, 1, 4, 3, 3, 4, 0, 0, 2, 5, 2, 1, 5, 1, 3, 5, 3, 0, 5 };
 
-            // now subdivide, divide each triangle into 4
+            // now subdivide, divide each triangle into 4; the midpoint of an
+            // edge is created once and shared by the two triangles around it
             for (unsigned int s = 0; s < subdivisions; ++s)
             {
+                std::unordered_map< std::uint64_t, unsigned int > midpoints;
+                midpoints.reserve(faces.size()/2);
+
+                auto midpoint = [&]( unsigned int a, unsigned int b ) {
+                    std::uint64_t key = (static_cast<std::uint64_t>(std::min(a, b)) << 32) | std::max(a, b);
+                    auto it = midpoints.find(key);
+                    if ( it != midpoints.end() )
+                    {
+                        return it->second;
+                    }
+
+                    unsigned int ind = static_cast<unsigned int>(vert.size());
+                    vert.push_back( ((vert[a] + vert[b])*0.5f).normalized() );
+                    midpoints.emplace(key, ind);
+
+                    return ind;
+                };
+
                 std::vector< unsigned int > sub_faces;
-                for (unsigned int i = 0; i < (unsigned int)faces.size(); i+=3)
+                sub_faces.reserve(4*faces.size());
+                for (size_t i = 0; i < faces.size(); i+=3)
                 {
-                    Eigen::Vector4f p0 = vert[faces[i+0]];
-                    Eigen::Vector4f p1 = vert[faces[i+1]];
-                    Eigen::Vector4f p2 = vert[faces[i+2]];
-
-                    Eigen::Vector4f p3 = (p0 + p1)*0.5;
-                    Eigen::Vector4f p4 = (p0 + p2)*0.5;
-                    Eigen::Vector4f p5 = (p1 + p2)*0.5;
-                    p3.head(3).normalize();
-                    p4.head(3).normalize();
-                    p5.head(3).normalize();
-
-                    vert.push_back(p3);
-                    vert.push_back(p4);
-                    vert.push_back(p5);
-
-                    unsigned int ind = vert.size()-3;
+                    unsigned int p0 = faces[i+0];
+                    unsigned int p1 = faces[i+1];
+                    unsigned int p2 = faces[i+2];
+
+                    unsigned int p3 = midpoint(p0, p1);
+                    unsigned int p4 = midpoint(p0, p2);
+                    unsigned int p5 = midpoint(p1, p2);
+
                     // new faces are: (p0, p3, p4), (p4, p5, p2), (p3, p5, p4), (p3, p1, p5)
                     unsigned int b[12] = {
-                        (unsigned int)faces[i+0], ind, ind+1, 
-                        ind+1, ind+2, (unsigned int)faces[i+2], 
-                        ind, ind+2, ind+1, 
-                        ind, (unsigned int)faces[i+1], ind+2};
-                    sub_faces.insert(sub_faces.end(), b, b+12);  
+                        p0, p3, p4,
+                        p4, p5, p2,
+                        p3, p5, p4,
+                        p3, p1, p5};
+                    sub_faces.insert(sub_faces.end(), b, b+12);
                 }
-                faces.clear();
-                faces = sub_faces;
+                faces.swap(sub_faces);
             }
 
-            vertices.resize(3*vert.size());
-            normals.resize(3*vert.size());
-
-            /* std::cout << "\nSphere (" << center_x << ", " << center_y << ", " << center_z << "), r = " << radius << ": \n"; */
-
+            UnitSphere unit;
+            unit.faces = std::move(faces);
+            unit.points.resize(3*vert.size());
             for ( size_t i = 0; i < vert.size(); ++i )
             {
-                vertices[3*i + 0] = center_x + radius*vert[i][0];
-                vertices[3*i + 1] = center_y + radius*vert[i][1];
-                vertices[3*i + 2] = center_z + radius*vert[i][2];
-
-                /* std::cout << "( x = " << vertices[3*i + 0] << ", y = " << vertices[3*i + 1] << ", z = " << vertices[3*i + 2] << ")\n"; */
-
-                normals[3*i + 0] = vert[i][0];
-                normals[3*i + 1] = vert[i][1];
-                normals[3*i + 2] = vert[i][2];
+                unit.points[3*i + 0] = vert[i][0];
+                unit.points[3*i + 1] = vert[i][1];
+                unit.points[3*i + 2] = vert[i][2];
             }
+
+            return unit;
         }
 
-    private:
         float center_x = 0.f;
         float center_y = 0.f;
         float center_z = 0.f;
@@ -0,0 +1,224 @@
+#ifndef TUCANOW_OBJECT_MAP
+#define TUCANOW_OBJECT_MAP
+
+
+/** @file object_map.hpp src/object_map.hpp
+ * */
+
+
+#include <cstddef>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+
+namespace tucanow {
+
+
+/**
+ * @brief Map from user chosen ids to objects, with dense storage
+ *
+ * Objects are kept in a contiguous array in insertion order, and an id ->
+ * slot hash table serves lookups.  Erasing leaves an empty slot behind, so
+ * the order of the remaining objects never changes; empty slots are
+ * compacted away (preserving order) once they are half of the array.
+ *
+ * Objects are heap allocated, so pointers to them remain valid until they
+ * are erased.
+ */
+template<typename T>
+class ObjectMap
+{
+    public:
+        struct Entry
+        {
+            int id;
+            T* object;
+        };
+
+        class Iterator
+        {
+            public:
+                Iterator( const ObjectMap *map, std::size_t slot ) : map(map), slot_index(slot)
+                {
+                    skipEmptySlots();
+                }
+
+                Entry operator*() const
+                {
+                    return Entry{ map->ids[slot_index], map->objects[slot_index].get() };
+                }
+
+                Iterator& operator++()
+                {
+                    ++slot_index;
+                    skipEmptySlots();
+                    return *this;
+                }
+
+                bool operator!=( const Iterator &other ) const
+                {
+                    return slot_index != other.slot_index;
+                }
+
+            private:
+                void skipEmptySlots()
+                {
+                    while ( (slot_index < map->objects.size()) && (map->objects[slot_index] == nullptr) )
+                    {
+                        ++slot_index;
+                    }
+                }
+
+                const ObjectMap *map;
+                std::size_t slot_index;
+        };
+
+        /**
+         * @brief Get object with given id
+         *
+         * @return Pointer to object, or nullptr if id is not in the map
+         */
+        T* find( int id ) const
+        {
+            auto it = slots.find(id);
+            if ( it == slots.end() )
+            {
+                return nullptr;
+            }
+
+            return objects[it->second].get();
+        }
+
+        /**
+         * @brief Insert object with given id, replacing any object with the same id
+         *
+         * A replaced object keeps its position in the iteration order.
+         *
+         * @return Pointer to inserted object
+         */
+        T* insert( int id, std::unique_ptr<T> object )
+        {
+            auto it = slots.find(id);
+            if ( it != slots.end() )
+            {
+                objects[it->second] = std::move(object);
+                return objects[it->second].get();
+            }
+
+            slots.emplace(id, objects.size());
+            ids.push_back(id);
+            objects.push_back(std::move(object));
+
+            return objects.back().get();
+        }
+
+        /**
+         * @brief Erase object with given id
+         *
+         * @return True if id was in the map
+         */
+        bool erase( int id )
+        {
+            auto it = slots.find(id);
+            if ( it == slots.end() )
+            {
+                return false;
+            }
+
+            objects[it->second].reset();
+            slots.erase(it);
+            ++num_empty_slots;
+
+            if ( 2*num_empty_slots > objects.size() )
+            {
+                compact();
+            }
+
+            return true;
+        }
+
+        /**
+         * @brief Erase all objects
+         */
+        void clear()
+        {
+            slots.clear();
+            ids.clear();
+            objects.clear();
+            num_empty_slots = 0;
+        }
+
+        std::size_t size() const
+        {
+            return slots.size();
+        }
+
+        bool empty() const
+        {
+            return slots.empty();
+        }
+
+        /**
+         * @brief Reserve storage for a number of objects
+         */
+        void reserve( std::size_t num_objects )
+        {
+            slots.reserve(num_objects);
+            ids.reserve(num_objects);
+            objects.reserve(num_objects);
+        }
+
+        Iterator begin() const
+        {
+            return Iterator(this, 0);
+        }
+
+        Iterator end() const
+        {
+            return Iterator(this, objects.size());
+        }
+
+    private:
+        /// Move objects over empty slots, keeping their relative order
+        void compact()
+        {
+            std::size_t last = 0;
+            for ( std::size_t slot = 0; slot < objects.size(); ++slot )
+            {
+                if ( objects[slot] == nullptr )
+                {
+                    continue;
+                }
+
+                if ( slot != last )
+                {
+                    ids[last] = ids[slot];
+                    objects[last] = std::move(objects[slot]);
+                    slots[ids[last]] = last;
+                }
+                ++last;
+            }
+
+            ids.resize(last);
+            objects.resize(last);
+            num_empty_slots = 0;
+        }
+
+        /// id -> slot
+        std::unordered_map<int, std::size_t> slots;
+
+        /// Ids of the objects, in slot order
+        std::vector<int> ids;
+
+        /// Objects in insertion order; erased objects leave a nullptr behind
+        std::vector<std::unique_ptr<T>> objects;
+
+        std::size_t num_empty_slots = 0;
+};
+
+
+} // namespace tucanow
+
+
+#endif
@@ -43,6 +43,17 @@ void Scene::initialize(int width, int height)
     pimpl->toon.initialize();
     pimpl->phong.initialize();
     pimpl->wireframe.initialize();
+    pimpl->glyphs.initialize();
+    pimpl->sphere_impostors.initialize();
+    pimpl->picking.initialize();
+
+    pimpl->directcolor.setFrameUniforms(pimpl->frame_uniforms);
+    pimpl->toon.setFrameUniforms(pimpl->frame_uniforms);
+    pimpl->phong.setFrameUniforms(pimpl->frame_uniforms);
+    pimpl->wireframe.setFrameUniforms(pimpl->frame_uniforms);
+    pimpl->glyphs.setFrameUniforms(pimpl->frame_uniforms);
+    pimpl->sphere_impostors.setFrameUniforms(pimpl->frame_uniforms);
+    pimpl->picking.setFrameUniforms(pimpl->frame_uniforms);
 
     pimpl->camera.setPerspectiveMatrix(60.0, (float)width/(float)height, 0.1f, 100.0f);
     pimpl->camera.setRenderFlag(false);
@@ -58,11 +69,25 @@ void Scene::initialize(int width, int height)
     pimpl->phong.setSpecularCoeff(0.0875);
     pimpl->phong.setShininessCoeff(3.475);
 
+    pimpl->glyphs.setAmbientCoeff(0.525);
+    pimpl->glyphs.setDiffuseCoeff(0.75);
+    pimpl->glyphs.setSpecularCoeff(0.0875);
+    pimpl->glyphs.setShininessCoeff(3.475);
+
+    pimpl->sphere_impostors.setAmbientCoeff(0.525);
+    pimpl->sphere_impostors.setDiffuseCoeff(0.75);
+    pimpl->sphere_impostors.setSpecularCoeff(0.0875);
+    pimpl->sphere_impostors.setShininessCoeff(3.475);
+
     glEnable(GL_DEPTH_TEST);
 }
 
 void Scene::render()
 {
+    auto &state = Tucano::GLStateCache::Instance();
+    state.resetCounters();
+    state.begin();
+
     glClearColor(
             Impl().clear_color[0],
             Impl().clear_color[1],
@@ -71,18 +96,30 @@ void Scene::render()
         );
     glClear(GL_COLOR_BUFFER_BIT|GL_DEPTH_BUFFER_BIT);
 
-    if ( Impl().render_bbox_boundary )
-    {
-        Impl().render( &Impl().bbox_boundary );
-    }
+    // Meshes that finish uploading are drawn in this frame already
+    Impl().advanceLoads();
 
-    for ( auto &entry : Impl().objects )
-    {
-        Impl().render(entry.second.get());
+    // Camera and light are the same for every object in the frame
+    Impl().frame_uniforms->update(Impl().camera, Impl().light);
 
-    }
+    Impl().renderObjects();
+    Impl().renderHoverHighlight();
 
     Impl().camera.render();
+
+    // After the frame, so that reading the ids back does not wait on it
+    Impl().updateHover();
+
+    state.end();
+
+    Impl().render_stats.draw_calls = state.getDrawCalls();
+    Impl().render_stats.state_changes = state.getStateChanges();
+    Impl().render_stats.skipped_state_changes = state.getSkippedStateChanges();
+}
+
+RenderStats Scene::getRenderStats()
+{
+    return Impl().render_stats;
 }
 
 void Scene::renderWireframe(bool wireframe)
@@ -95,6 +132,11 @@ void Scene::toggleRenderWireframe()
     render_wireframe = !render_wireframe;
 }
 
+void Scene::setFrustumCulling(bool enable)
+{
+    Impl().frustum_culling = enable;
+}
+
 // /**
 //  * @brief Set path for the shader's dir
 //  *
@@ -144,7 +186,27 @@ bool Scene::loadPointCloud(
         const std::vector<float> &vertices 
         )
 {
-    if ( vertices.empty() )
+    return loadPointCloud(object_id, vertices.data(), vertices.size());
+}
+
+bool Scene::loadPointCloud(
+        int object_id,
+        std::vector<float> &&vertices 
+        )
+{
+    // Take ownership so that the buffer is freed right after the upload
+    std::vector<float> owned_vertices(std::move(vertices));
+
+    return loadPointCloud(object_id, owned_vertices.data(), owned_vertices.size());
+}
+
+bool Scene::loadPointCloud(
+        int object_id,
+        const float *vertices,
+        std::size_t vertices_size
+        )
+{
+    if ( (vertices == nullptr) || (vertices_size == 0) )
     {
         /* std::cout << "\nError: vertices.empty() != true\n"; */
         return false;
@@ -157,7 +219,8 @@ bool Scene::loadPointCloud(
     }
 
     // TODO: destroy object in case of failure
-    bool success = object->mesh.loadVertices(vertices);
+    bool success = object->mesh.loadVertices(vertices, vertices_size);
+    object->mesh.releaseSpareAttributes();
     if ( !success )
     {
         /* object->mesh.normalizeModelMatrix(); */
@@ -165,6 +228,7 @@ bool Scene::loadPointCloud(
         return false;
     }
     object->shader = ObjectShader::DirectColor;
+    object->type = ObjectType::PointCloud;
     /*     std::cout << "\nGot mesh\n"; */
 
     return success;
@@ -201,6 +265,7 @@ bool Scene::loadCurveMesh( int object_id,
         return false;
     }
     object->mesh.loadIndices(indices);
+    object->mesh.releaseSpareAttributes();
     object->mesh.selectPrimitive(Tucano::Mesh::CURVE);
     object->shader = ObjectShader::DirectColor;
     object->type = ObjectType::CurveMesh;
@@ -215,19 +280,55 @@ bool Scene::loadTriangleMesh( int object_id,
         const std::vector<float> &vertex_normals
         )
 {
-    if ( vertices.empty() )
+    return loadTriangleMesh(object_id,
+            vertices.data(), vertices.size(),
+            indices.data(), indices.size(),
+            vertex_normals.data(), vertex_normals.size()
+            );
+}
+
+bool Scene::loadTriangleMesh( int object_id,
+        std::vector<float> &&vertices, 
+        std::vector<unsigned int> &&indices, 
+        std::vector<float> &&vertex_normals
+        )
+{
+    // Take ownership so that the buffers are freed right after the upload
+    std::vector<float> owned_vertices(std::move(vertices));
+    std::vector<unsigned int> owned_indices(std::move(indices));
+    std::vector<float> owned_normals(std::move(vertex_normals));
+
+    return loadTriangleMesh(object_id,
+            owned_vertices.data(), owned_vertices.size(),
+            owned_indices.data(), owned_indices.size(),
+            owned_normals.data(), owned_normals.size()
+            );
+}
+
+bool Scene::loadTriangleMesh( int object_id,
+        const float *vertices, 
+        std::size_t vertices_size,
+        const unsigned int *indices,
+        std::size_t indices_size,
+        const float *vertex_normals,
+        std::size_t vertex_normals_size
+        )
+{
+    if ( (vertices == nullptr) || (vertices_size == 0) )
     {
         /* std::cout << "\nError: vertices.empty() != true\n"; */
         return false;
     }
 
-    if ( indices.empty() || (indices.size() % 3 != 0) )
+    if ( (indices == nullptr) || (indices_size == 0) || (indices_size % 3 != 0) )
     {
         return false;
     }
 
-    if ( !vertex_normals.empty() )
-    if ( vertices.size() != vertex_normals.size() )
+    bool has_normals = (vertex_normals != nullptr) && (vertex_normals_size > 0);
+
+    if ( has_normals )
+    if ( vertices_size != vertex_normals_size )
     {
         /* std::cout << "\nError: vertices.size() != normals.size()\n"; */
         return false;
@@ -240,28 +341,188 @@ bool Scene::loadTriangleMesh( int object_id,
     }
 
     // TODO: destroy object in case of failure
-    bool success = object->mesh.loadVertices(vertices);
+    bool success = object->mesh.loadVertices(vertices, vertices_size);
     if ( !success )
     {
         /* object->mesh.normalizeModelMatrix(); */
         /* std::cout << "\nGot mesh\n"; */
         return false;
     }
-    object->mesh.loadIndices(indices);
+    object->mesh.loadIndices(indices, indices_size);
     object->shader = ObjectShader::DirectColor;
     object->type = ObjectType::TriangleMesh;
     /*     std::cout << "\nGot mesh\n"; */
 
-    if ( success && !vertex_normals.empty() )
+    if ( success && has_normals )
     {
-        object->mesh.loadNormals(vertex_normals);
+        object->mesh.loadNormals(vertex_normals, vertex_normals_size);
         object->shader = ObjectShader::Phong;
         /* std::cout << "\nGot normals\n"; */
     }
+    else if ( success && Impl().automatic_normals )
+    {
+        Impl().generateNormals(object,
+                std::vector<float>(vertices, vertices + vertices_size),
+                std::vector<unsigned int>(indices, indices + indices_size),
+                Impl().normal_weighting);
+    }
+    // the caller's vertex numbers are kept for updateObjectVertices()
+    Impl().optimizeIndices(object, false);
+    object->mesh.releaseSpareAttributes();
+    if ( success )
+    {
+        Impl().buildAutomaticClusters(object);
+        Impl().buildAutomaticLod(object);
+        Impl().buildAutomaticBvh(object);
+    }
 
     return success;
 }
 
+bool Scene::setPointRadius(int object_id, float radius)
+{
+    auto object = Impl().Object(object_id);
+    if ( (object == nullptr) || !(radius >= 0.0f) )
+    {
+        return false;
+    }
+
+    object->point_radius = radius;
+
+    return true;
+}
+
+bool Scene::loadPointRadii(int object_id, const std::vector<float> &radii)
+{
+    auto object = Impl().Object(object_id);
+    if ( object == nullptr )
+    {
+        return false;
+    }
+
+    if ( radii.empty() || (radii.size() != static_cast<std::size_t>(object->mesh.getNumberOfVertices())) )
+    {
+        return false;
+    }
+
+    object->mesh.loadAttribute("in_Radius", radii.data(), radii.size(), 1);
+
+    return true;
+}
+
+bool Scene::loadInstancedGlyphs(
+        int object_id,
+        GlyphType glyph_type,
+        const std::vector<float> &positions,
+        const std::vector<float> &scales,
+        const std::vector<float> &colors,
+        const std::vector<float> &orientations
+        )
+{
+    if ( positions.empty() || (positions.size() % 3 != 0) )
+    {
+        return false;
+    }
+
+    const std::size_t num_glyphs = positions.size()/3;
+
+    bool uniform_scales = (scales.size() == num_glyphs);
+    if ( !scales.empty() && !uniform_scales && (scales.size() != 3*num_glyphs) )
+    {
+        return false;
+    }
+
+    bool rgb_colors = (colors.size() == 3*num_glyphs);
+    if ( !colors.empty() && !rgb_colors && (colors.size() != 4*num_glyphs) )
+    {
+        return false;
+    }
+
+    if ( !orientations.empty() && (orientations.size() != 4*num_glyphs) )
+    {
+        return false;
+    }
+
+    auto object = Impl().createObject(object_id);
+    if ( object == nullptr )
+    {
+        return false;
+    }
+
+    if ( !Impl().loadGlyphMesh(object, glyph_type) )
+    {
+        return false;
+    }
+
+    // Scales and colours are expanded only when they are not given per instance in the GPU layout
+    std::vector<float> scales3;
+    if ( scales.empty() || uniform_scales )
+    {
+        scales3.resize(3*num_glyphs);
+        for ( std::size_t i = 0; i < num_glyphs; ++i )
+        {
+            float scale = scales.empty() ? 1.0f : scales[i];
+            scales3[3*i + 0] = scale;
+            scales3[3*i + 1] = scale;
+            scales3[3*i + 2] = scale;
+        }
+    }
+    const std::vector<float> &instance_scales = scales3.empty() ? scales : scales3;
+
+    std::vector<float> default_colors;
+    if ( colors.empty() )
+    {
+        Eigen::Vector4f color = object->mesh.getColor();
+        default_colors.resize(4*num_glyphs);
+        for ( std::size_t i = 0; i < num_glyphs; ++i )
+        {
+            Eigen::Vector4f::Map(&default_colors[4*i]) = color;
+        }
+    }
+    const std::vector<float> &instance_colors = colors.empty() ? default_colors : colors;
+
+    object->mesh.createInstanceAttribute("in_InstancePosition", positions.data(), positions.size(), 3);
+    object->mesh.createInstanceAttribute("in_InstanceScale", instance_scales.data(), instance_scales.size(), 3);
+    object->mesh.createInstanceAttribute("in_InstanceColor", instance_colors.data(), instance_colors.size(), rgb_colors ? 3 : 4);
+    if ( !orientations.empty() )
+    {
+        object->mesh.createInstanceAttribute("in_InstanceOrientation", orientations.data(), orientations.size(), 4);
+    }
+    object->mesh.releaseSpareAttributes();
+
+    // Bounds of all instances: exact for axis aligned glyphs, the glyph's
+    // bounding sphere around the origin otherwise
+    const Eigen::AlignedBox3f &glyph_box = object->mesh.getBoundingBox();
+    float glyph_radius = glyph_box.min().cwiseAbs().cwiseMax(glyph_box.max().cwiseAbs()).norm();
+
+    object->instance_bounds.setEmpty();
+    for ( std::size_t i = 0; i < num_glyphs; ++i )
+    {
+        Eigen::Vector3f position = Eigen::Vector3f::Map(&positions[3*i]);
+        Eigen::Vector3f scale = Eigen::Vector3f::Map(&instance_scales[3*i]);
+
+        if ( orientations.empty() )
+        {
+            Eigen::Vector3f a = scale.cwiseProduct(glyph_box.min());
+            Eigen::Vector3f b = scale.cwiseProduct(glyph_box.max());
+            object->instance_bounds.extend(position + a.cwiseMin(b));
+            object->instance_bounds.extend(position + a.cwiseMax(b));
+        }
+        else
+        {
+            Eigen::Vector3f extent = Eigen::Vector3f::Constant(scale.cwiseAbs().maxCoeff()*glyph_radius);
+            object->instance_bounds.extend(position - extent);
+            object->instance_bounds.extend(position + extent);
+        }
+    }
+    object->world_bounds_dirty = true;
+
+    object->shader = ObjectShader::InstancedGlyphs;
+    object->type = ObjectType::Glyphs;
+
+    return true;
+}
+
 bool Scene::loadPLY(int object_id, const std::string &filename)
 {
     auto object = Impl().createObject(object_id);
@@ -270,7 +531,17 @@ bool Scene::loadPLY(int object_id, const std::string &filename)
         return false;
     }
 
+    if ( Impl().loadAutomaticCache(object, filename) )
+    {
+        object->mesh.releaseSpareAttributes();
+        Impl().buildAutomaticClusters(object);
+        Impl().buildAutomaticLod(object);
+        Impl().buildAutomaticBvh(object);
+        return true;
+    }
+
     bool success = Tucano::MeshImporter::loadPlyFile(&object->mesh, filename);
+    object->mesh.releaseSpareAttributes();
     if (success)
     {
         object->shader = ObjectShader::Phong;
@@ -287,11 +558,417 @@ bool Scene::loadPLY(int object_id, const std::string &filename)
  
             setMeshTexture(object_id, tex_file_with_dir);
         }
+
+        Impl().optimizeIndices(object, true);
+        Impl().saveAutomaticCache(object, filename);
+        Impl().buildAutomaticClusters(object);
+        Impl().buildAutomaticLod(object);
+        Impl().buildAutomaticBvh(object);
     }
 
     return success;
 }
 
+bool Scene::loadOBJ(int object_id, const std::string &filename)
+{
+    auto object = Impl().createObject(object_id);
+    if ( object == nullptr )
+    {
+        return false;
+    }
+
+    if ( Impl().loadAutomaticCache(object, filename) )
+    {
+        object->mesh.releaseSpareAttributes();
+        Impl().buildAutomaticClusters(object);
+        Impl().buildAutomaticLod(object);
+        Impl().buildAutomaticBvh(object);
+        return true;
+    }
+
+    bool success = Tucano::MeshImporter::loadObjFile(&object->mesh, filename);
+    object->mesh.releaseSpareAttributes();
+    if (success)
+    {
+        object->shader = ObjectShader::Phong;
+        object->type = ObjectType::OBJ;
+
+        Impl().optimizeIndices(object, true);
+        Impl().saveAutomaticCache(object, filename);
+        Impl().buildAutomaticClusters(object);
+        Impl().buildAutomaticLod(object);
+        Impl().buildAutomaticBvh(object);
+    }
+
+    return success;
+}
+
+bool Scene::saveObjectCache(int object_id, const std::string &filename)
+{
+    auto object = Impl().Object(object_id);
+    if ( ( object == nullptr ) || filename.empty() )
+    {
+        return false;
+    }
+
+    return Impl().saveObjectCache(object, filename, Tucano::MeshImporter::MeshCacheSource());
+}
+
+bool Scene::loadObjectCache(int object_id, const std::string &filename)
+{
+    auto object = Impl().createObject(object_id);
+    if ( object == nullptr )
+    {
+        return false;
+    }
+
+    bool success = Impl().loadObjectCache(object, filename);
+    object->mesh.releaseSpareAttributes();
+    if ( success )
+    {
+        Impl().buildAutomaticClusters(object);
+        Impl().buildAutomaticLod(object);
+        Impl().buildAutomaticBvh(object);
+    }
+
+    return success;
+}
+
+void Scene::setAutomaticCache(bool enable)
+{
+    Impl().automatic_cache = enable;
+}
+
+void Scene::setIndexOptimization(IndexOptimization optimization)
+{
+    Impl().index_optimization = optimization;
+}
+
+bool Scene::getObjectVertexCacheStats(int object_id, VertexCacheStats &stats)
+{
+    auto object = Impl().Object(object_id);
+    if ( (object == nullptr) || (object->mesh.getPrimitive() != Tucano::Mesh::TRIANGLE) || (object->mesh.getNumberOfElements() < 3) )
+    {
+        return false;
+    }
+
+    std::vector<GLuint> indices;
+    object->mesh.readBackIndices(indices);
+
+    Tucano::MeshOptimizer::VertexCacheStats current = Tucano::MeshOptimizer::analyzeVertexCache(
+            indices.data(), indices.size(), object->mesh.getNumberOfVertices());
+    const Tucano::MeshOptimizer::VertexCacheStats &loaded = object->indices_reordered ? object->loaded_cache_stats : current;
+
+    stats.acmr = current.acmr;
+    stats.atvr = current.atvr;
+    stats.loaded_acmr = loaded.acmr;
+    stats.loaded_atvr = loaded.atvr;
+
+    return true;
+}
+
+bool Scene::buildObjectLod(int object_id, const std::vector<std::size_t> &triangle_budgets)
+{
+    auto object = Impl().Object(object_id);
+    if ( object == nullptr )
+    {
+        return false;
+    }
+
+    return Impl().buildLod(object, triangle_budgets);
+}
+
+void Scene::setAutomaticLod(bool enable)
+{
+    Impl().automatic_lod = enable;
+}
+
+void Scene::setLodPixelError(float pixels)
+{
+    if ( pixels > 0.0f )
+    {
+        Impl().lod_pixel_error = pixels;
+    }
+}
+
+bool Scene::setObjectLod(int object_id, int level)
+{
+    auto object = Impl().Object(object_id);
+    if ( (object == nullptr) || (level < -1) || (level >= static_cast<int>(object->mesh.getNumberOfLevels())) )
+    {
+        return false;
+    }
+
+    object->forced_lod = level;
+    object->mesh.selectLevel( (level < 0) ? 0 : level );
+
+    return true;
+}
+
+int Scene::getObjectLod(int object_id)
+{
+    auto object = Impl().Object(object_id);
+    if ( object == nullptr )
+    {
+        return -1;
+    }
+
+    return object->mesh.getSelectedLevel();
+}
+
+std::vector<std::size_t> Scene::getObjectLodTriangles(int object_id)
+{
+    std::vector<std::size_t> triangles;
+    auto object = Impl().Object(object_id);
+    if ( (object == nullptr) || (object->mesh.getPrimitive() != Tucano::Mesh::TRIANGLE) )
+    {
+        return triangles;
+    }
+
+    for ( unsigned int level = 0; level < object->mesh.getNumberOfLevels(); ++level )
+    {
+        triangles.push_back(object->mesh.getNumberOfLevelElements(level)/3);
+    }
+
+    return triangles;
+}
+
+void Scene::setClusterCulling(ClusterCulling culling)
+{
+    Impl().cluster_culling = culling;
+}
+
+bool Scene::buildObjectClusters(int object_id)
+{
+    auto object = Impl().Object(object_id);
+    if ( object == nullptr )
+    {
+        return false;
+    }
+
+    return Impl().buildClusters(object);
+}
+
+std::size_t Scene::getObjectClusterCount(int object_id)
+{
+    auto object = Impl().Object(object_id);
+    if ( object == nullptr )
+    {
+        return 0;
+    }
+
+    return object->clusters.size();
+}
+
+PickResult Scene::pick(float xpos, float ypos)
+{
+    float scaled_xpos = Impl().scale_width * xpos;
+    float scaled_ypos = Impl().scale_height * ypos;
+
+    return Impl().pick(scaled_xpos, scaled_ypos);
+}
+
+bool Scene::buildObjectBvh(int object_id)
+{
+    auto object = Impl().Object(object_id);
+    if ( object == nullptr )
+    {
+        return false;
+    }
+
+    return Impl().buildBvh(object);
+}
+
+void Scene::setAutomaticBvh(bool enable)
+{
+    Impl().automatic_bvh = enable;
+}
+
+void Scene::setHoverPosition(float xpos, float ypos)
+{
+    Impl().hover = true;
+    Impl().hover_position = Eigen::Vector2f(Impl().scale_width * xpos, Impl().scale_height * ypos);
+}
+
+void Scene::clearHoverPosition()
+{
+    Impl().hover = false;
+    Impl().hovered_object = -1;
+    Impl().hovered_triangle = 0;
+}
+
+bool Scene::getHoveredObject(int &object_id, std::size_t &triangle)
+{
+    if ( (Impl().hovered_object < 0) || (Impl().Object(Impl().hovered_object) == nullptr) )
+    {
+        return false;
+    }
+
+    object_id = Impl().hovered_object;
+    triangle = Impl().hovered_triangle;
+
+    return true;
+}
+
+void Scene::setHoverHighlight(bool enable)
+{
+    Impl().hover_highlight = enable;
+}
+
+void Scene::setHoverHighlightColor(float r, float g, float b, float a)
+{
+    Impl().hover_color = Eigen::Vector4f(r, g, b, a);
+}
+
+bool Scene::loadPLYAsync(int object_id, const std::string &filename)
+{
+    if ( filename.empty() )
+    {
+        return false;
+    }
+
+    Impl().startPlyLoad(object_id, filename);
+
+    return true;
+}
+
+LoadStatus Scene::getLoadStatus(int object_id) const
+{
+    return Impl().loadStatus(object_id, nullptr);
+}
+
+float Scene::getLoadProgress(int object_id) const
+{
+    float progress = 0.0f;
+    Impl().loadStatus(object_id, &progress);
+
+    return progress;
+}
+
+bool Scene::cancelLoad(int object_id)
+{
+    return Impl().cancelLoad(object_id);
+}
+
+void Scene::setUploadBudget(std::size_t bytes_per_frame)
+{
+    Impl().upload_budget = bytes_per_frame;
+}
+
+bool Scene::updateObjectVertices(int object_id, std::size_t offset, const std::vector<float> &vertices)
+{
+    return updateObjectVertices(object_id, offset, vertices.data(), vertices.size());
+}
+
+bool Scene::updateObjectVertices(int object_id, std::size_t offset, const float *vertices, std::size_t vertices_size)
+{
+    auto object = Impl().Object(object_id);
+    if ( object == nullptr )
+    {
+        return false;
+    }
+
+    object->world_bounds_dirty = true;
+
+    if ( !object->mesh.updateVertices(offset, vertices, vertices_size) )
+    {
+        return false;
+    }
+
+    // only the normals around the moved vertices are recomputed and uploaded
+    std::size_t first = 0, count = 0;
+    if ( (object->generated_normals != nullptr) &&
+         object->generated_normals->update(offset, vertices, vertices_size, first, count) && (count > 0) )
+    {
+        object->mesh.updateNormals(first, &object->generated_normals->normals()[3*first], 3*count);
+    }
+
+    // the clusters keep their triangles, their bounds are recomputed before the next cull
+    object->cluster_bounds_dirty = (object->clusters.size() > 0);
+
+    // the picking hierarchy keeps its tree and is refit to its own copy of the vertices
+    if ( object->bvh.update(offset, vertices, vertices_size) )
+    {
+        Impl().object_bvh_dirty = true;
+    }
+
+    return true;
+}
+
+bool Scene::updateObjectNormals(int object_id, std::size_t offset, const std::vector<float> &vertex_normals)
+{
+    return updateObjectNormals(object_id, offset, vertex_normals.data(), vertex_normals.size());
+}
+
+bool Scene::updateObjectNormals(int object_id, std::size_t offset, const float *vertex_normals, std::size_t vertex_normals_size)
+{
+    auto object = Impl().Object(object_id);
+    if ( object == nullptr )
+    {
+        return false;
+    }
+
+    // normals set by hand are no longer recomputed when vertices move
+    object->generated_normals.reset();
+
+    return object->mesh.updateNormals(offset, vertex_normals, vertex_normals_size);
+}
+
+bool Scene::computeObjectNormals(int object_id, NormalWeighting weighting)
+{
+    auto object = Impl().Object(object_id);
+    if ( (object == nullptr) || (object->mesh.getPrimitive() != Tucano::Mesh::TRIANGLE) || (object->mesh.getNumberOfElements() == 0) )
+    {
+        return false;
+    }
+
+    Tucano::VertexAttribute *position = object->mesh.getAttribute("in_Position");
+    if ( (position == nullptr) || (position->getType() != GL_FLOAT) || (position->getElementSize() < 3) )
+    {
+        return false;
+    }
+
+    std::vector<char> packed;
+    object->mesh.readBackAttribute(*position, packed);
+
+    const std::size_t num_vertices = position->getSize();
+    const std::size_t element_size = position->getElementSize();
+    std::vector<float> vertices(3*num_vertices);
+    for (std::size_t v = 0; v < num_vertices; ++v)
+    {
+        std::memcpy(&vertices[3*v], &packed[v*element_size*sizeof(float)], 3*sizeof(float));
+    }
+
+    std::vector<unsigned int> indices;
+    object->mesh.readBackIndices(indices);
+
+    Impl().generateNormals(object, std::move(vertices), std::move(indices), weighting);
+
+    return true;
+}
+
+void Scene::setAutomaticNormals(bool enable, NormalWeighting weighting)
+{
+    Impl().automatic_normals = enable;
+    Impl().normal_weighting = weighting;
+}
+
+bool Scene::updateObjectColors(int object_id, std::size_t offset, const std::vector<float> &colors)
+{
+    return updateObjectColors(object_id, offset, colors.data(), colors.size());
+}
+
+bool Scene::updateObjectColors(int object_id, std::size_t offset, const float *colors, std::size_t colors_size)
+{
+    auto object = Impl().Object(object_id);
+    if ( object == nullptr )
+    {
+        return false;
+    }
+
+    return object->mesh.updateColors(offset, colors, colors_size);
+}
+
 bool Scene::eraseObject( int object_id )
 {
     return Impl().eraseObject(object_id);
@@ -319,11 +996,53 @@ bool Scene::setObjectShader(int object_id, const ObjectShader& shader)
         return false;
     }
 
+    // Glyph meshes are only meaningful with their instance attributes
+    bool is_glyph = (object->type == ObjectType::Glyphs);
+    if ( (shader != ObjectShader::None) && (is_glyph != (shader == ObjectShader::InstancedGlyphs)) )
+    {
+        return false;
+    }
+
     object->shader = shader;
 
     return true;
 }
 
+bool Scene::setObjectInterleavedAttributes(int object_id, bool interleave)
+{
+    auto object = Impl().Object(object_id);
+    if ( object == nullptr )
+    {
+        return false;
+    }
+
+    object->mesh.setVertexLayout(interleave ? Tucano::Mesh::INTERLEAVED : Tucano::Mesh::SEPARATE);
+
+    return true;
+}
+
+bool Scene::setObjectQuantizedAttributes(int object_id, bool quantize)
+{
+    auto object = Impl().Object(object_id);
+    if ( ( object == nullptr ) || ( object->type == ObjectType::Glyphs ) )
+    {
+        return false;
+    }
+
+    if (quantize)
+    {
+        object->mesh.quantizePositions();
+        object->mesh.quantizeNormals();
+        object->mesh.quantizeColors();
+    }
+    else
+    {
+        object->mesh.dequantizeAttributes();
+    }
+
+    return true;
+}
+
 bool Scene::setObjectColor(int object_id, float r, float g, float b, float a)
 {
     auto object = Impl().Object(object_id);
@@ -417,15 +1136,7 @@ bool Scene::setMeshTexture(int object_id, const std::string &tex_file)
         return false;
     }
 
-    Tucano::Texture texture;
-    bool success = Tucano::ImageImporter::loadImage(tex_file, &texture);
-    if (success)
-    {        
-        object->texture = texture;
-        object->texture.setTexParameters( GL_CLAMP, GL_CLAMP, GL_LINEAR, GL_LINEAR );
-    }
-
-    return success;
+    return Impl().loadTexture(object, tex_file);
 }
 
 bool Scene::setViewport(int width, int height)
@@ -9,116 +9,1301 @@
 /* #include <GL/glew.h> */
 
 #include <memory>
-#include <map>
 #include <string>
 #include <array>
+#include <vector>
+#include <map>
+#include <tuple>
+#include <utility>
+#include <limits>
+#include <algorithm>
+#include <numeric>
+#include <atomic>
+#include <thread>
+#include <cstdint>
+#include <cstring>
+
+#include <Eigen/Dense>
+
+#include <tucano/texture.hpp>
+#include <tucano/effects/directcolor.hpp>
+#include <tucano/effects/toon.hpp>
+#include <tucano/effects/phongshader.hpp>
+#include <tucano/effects/wireframe.hpp>
+#include <tucano/effects/glyphs.hpp>
+#include <tucano/effects/sphereimpostors.hpp>
+#include <tucano/effects/picking.hpp>
+#include <tucano/shapes/sphere.hpp>
+#include <tucano/shapes/arrow.hpp>
+#include <tucano/shapes/cylinder.hpp>
+#include <tucano/shapes/cone.hpp>
+#include <tucano/gui/base.hpp>
+#include <tucano/utils/trackball.hpp>
+#include <tucano/utils/plyimporter.hpp>
+#include <tucano/utils/objimporter.hpp>
+#include <tucano/utils/meshcache.hpp>
+#include <tucano/utils/vertexnormals.hpp>
+#include <tucano/utils/meshoptimizer.hpp>
+#include <tucano/utils/meshsimplifier.hpp>
+#include <tucano/utils/meshclusters.hpp>
+#include <tucano/utils/bvh.hpp>
+#include <tucano/utils/imageIO.hpp>
+#include <tucano/utils/frustum.hpp>
+
+#include "tucanow/definitions.hpp"
+#include "tucanow/scene.hpp"
+
+#include "object_map.hpp"
+
+namespace tucanow {
+
+
+struct ObjectDescriptor {
+    Tucano::Mesh mesh;
+    Tucano::Texture texture;
+    /// Image file the texture was loaded from, empty if none
+    std::string texture_file;
+    ObjectType type;
+    ObjectShader shader;
+    bool opaque = true;
+
+    /// Mesh bounding box in world space, recomputed when world_bounds_dirty is set
+    Eigen::AlignedBox3f world_bounds;
+
+    /// Set whenever the mesh vertices or model matrix change
+    bool world_bounds_dirty = true;
+
+    /// Object space bounds of all instances, for instanced meshes
+    Eigen::AlignedBox3f instance_bounds;
+
+    /// Sphere radius for ObjectShader::SphereImpostors (0 picks one from the bounding box)
+    float point_radius = 0.0f;
+
+    /// Normals computed by tucanow, kept with a copy of the mesh to follow vertex updates
+    std::unique_ptr<Tucano::VertexNormals> generated_normals;
+
+    /// Set when the triangles were reordered on load
+    bool indices_reordered = false;
+
+    /// Vertex cache efficiency of the triangle order the mesh was loaded with, when reordered
+    Tucano::MeshOptimizer::VertexCacheStats loaded_cache_stats;
+
+    /// Error of each level of detail of the mesh in object units, level 0 first; empty without levels
+    std::vector<float> lod_errors;
+
+    /// Level of detail drawn whatever the distance, -1 to pick it from the distance
+    int forced_lod = -1;
+
+    /// Clusters of the triangles of the mesh, culled one by one; empty without them
+    Tucano::MeshClusters clusters;
+
+    /// Set when vertices moved, so that the cluster bounds are recomputed before the next cull
+    bool cluster_bounds_dirty = false;
+
+    /// Hierarchy over the triangles of the mesh for picking; empty without it
+    Tucano::MeshBVH bvh;
+};
+
+/// Coarser levels of detail of a triangle mesh, see SceneImpl::computeLod()
+struct LodChain
+{
+    /// Triangles of all levels, one level after the other
+    std::vector<unsigned int> indices;
+
+    /// Number of indices of each level, from the finest to the coarsest
+    std::vector<std::size_t> sizes;
+
+    /// Error of each level, in object units
+    std::vector<float> errors;
+};
+
+/// A PLY file read on a worker thread, then sent to the GPU in slices by SceneImpl::advanceLoads()
+struct AsyncPlyLoad
+{
+    /// One attribute, array of vertex records or index buffer to be uploaded
+    struct Stream
+    {
+        enum class Kind { Attribute, Records, Indices, LevelsOfDetail };
+
+        Kind kind;
+        /// Attribute name; for records, any attribute read from them
+        std::string attribute;
+        const void *values;
+        std::size_t count;
+        std::size_t element_bytes;
+    };
+
+    LoadStatus status = LoadStatus::Parsing;
+
+    /// Written by the worker, read by the render thread once parsed is set
+    Tucano::MeshImporter::PlyData data;
+    std::string texture_file;
+    bool success = false;
+
+    /// Set by the worker when it reordered the triangles, with the efficiency of the original order
+    bool indices_reordered = false;
+    Tucano::MeshOptimizer::VertexCacheStats loaded_cache_stats;
+
+    /// Levels of detail built by the worker, if asked for
+    LodChain lod;
+
+    /// Clusters built by the worker, if asked for
+    Tucano::MeshClusters clusters;
+
+    /// Picking hierarchy built by the worker, if asked for
+    Tucano::MeshBVH bvh;
+
+    std::atomic<bool> parsed{false};
+    Tucano::MeshImporter::PlyProgress progress;
+    std::thread worker;
+
+    /// Object being filled during upload, swapped into the scene when complete
+    std::unique_ptr<ObjectDescriptor> object;
+    std::vector<Stream> streams;
+    std::size_t stream = 0;
+    std::size_t offset = 0;
+    std::size_t uploaded_bytes = 0;
+    std::size_t total_bytes = 0;
+
+    AsyncPlyLoad() = default;
+    AsyncPlyLoad(const AsyncPlyLoad &) = delete;
+    AsyncPlyLoad& operator=(const AsyncPlyLoad &) = delete;
+
+    ~AsyncPlyLoad()
+    {
+        progress.cancel = true;
+        if ( worker.joinable() )
+        {
+            worker.join();
+        }
+    }
+};
+
+struct SceneImpl 
+{
+    /// Ratio framebuffer_width/window_width
+    float scale_width = 1.0f; 
+
+    /// Ratio framebuffer_height/window_height
+    float scale_height = 1.0f; 
+
+    /// Bounding box origin
+    std::array<float, 3> bbox_origin = {-1.0f, -1.0f, -1.0f};
+
+    /// Bounding box size
+    std::array<float, 3> bbox_size = {2.0f, 2.0f, 2.0f};
+
+    /// Bounding box normalization scale (1/max{bbox_size}) -- used to normalize Tucano::Model::ModelMatrix
+    float model_scale = 1.0f;
+
+    /// Bounding box centroid -- used to normalize Tucano::Model::ModelMatrix
+    Eigen::Vector3f model_centroid = Eigen::Vector3f::Zero();
+
+    /// Bounding box boundary mesh to be rendered in this scene
+    ObjectDescriptor bbox_boundary;
+
+    /// Objects to be rendered in this scene
+    ObjectMap<ObjectDescriptor> objects;
+
+    /// DirectColor shader effect to render meshes
+    Tucano::Effects::DirectColor directcolor;
+
+    /// Toon shader effect to render meshes
+    Tucano::Effects::Toon toon;
+
+    /// Phong shader effect to render meshes
+    Tucano::Effects::Phong phong;
+
+    /// Single pass wireframe shader effect to render meshes
+    Tucano::Effects::Wireframe wireframe;
+
+    /// Phong shader effect to render instanced glyphs
+    Tucano::Effects::Glyphs glyphs;
+
+    /// Ray-cast spheres effect to render point clouds
+    Tucano::Effects::SphereImpostors sphere_impostors;
+
+    /// Ids of the objects under the hover position, and their highlight
+    Tucano::Effects::Picking picking;
+
+    /// Camera and light uniforms shared by all effects, updated once per frame
+    std::shared_ptr<Tucano::FrameUniforms> frame_uniforms = std::make_shared<Tucano::FrameUniforms>();
+
+    /// Trackball for manipulating the camera
+    Tucano::Trackball camera;
+
+    /// Trackball for manipulating light direction
+    Tucano::DirectionalTrackball light;
+
+    /// Path to shader's dir
+    std::string shader_dir;
+
+    /// OpenGL clear color
+    Eigen::Vector4f clear_color = Eigen::Vector4f(1.f, 1.f, 1.f, 0.f);
+
+    /// Source of current mesh
+    bool render_bbox_boundary = false;
+
+    /// Skip objects outside the camera frustum
+    bool frustum_culling = true;
+
+    /// Camera frustum, updated every frame
+    Tucano::Frustum frustum{ Eigen::Matrix4f::Identity() };
+
+    /// Objects (id, descriptor) to be drawn in the current frame, sorted by render state
+    std::vector<std::pair<int, ObjectDescriptor*>> render_queue;
+
+    /// Draw call and state change counts of the last frame
+    RenderStats render_stats;
+
+    /// Asynchronous loads by object id, kept after they finish to report their status
+    std::map<int, std::unique_ptr<AsyncPlyLoad>> async_loads;
+
+    /// Bytes sent to the GPU by asynchronous loads in each frame
+    std::size_t upload_budget = 16u << 20;
+
+    /// Keep a cache next to each file read by Scene::loadPLY() and Scene::loadOBJ()
+    bool automatic_cache = false;
+
+    /// Compute normals for triangle meshes loaded without them
+    bool automatic_normals = false;
+
+    /// Weighting of the normals computed by tucanow
+    NormalWeighting normal_weighting = NormalWeighting::Angle;
+
+    /// Reordering applied to the triangles of meshes as they are loaded
+    IndexOptimization index_optimization = IndexOptimization::None;
+
+    /// Build levels of detail for triangle meshes as they are loaded
+    bool automatic_lod = false;
+
+    /// Largest error of a level of detail on screen, in pixels
+    float lod_pixel_error = 1.0f;
+
+    /// A coarser level is only picked once its error is below this fraction of lod_pixel_error
+    static constexpr float lod_hysteresis = 0.75f;
+
+    /// Default levels of detail stop before going below this number of triangles
+    static const std::size_t min_lod_triangles = 1024;
+
+    /// Culling of clusters of triangles, which are built as meshes are loaded when on
+    ClusterCulling cluster_culling = ClusterCulling::None;
+
+    /// Most triangles of a cluster
+    static const unsigned int cluster_triangles = 128;
+
+    /// Object space frustum of the object being culled, and the index ranges that survive
+    Tucano::Frustum cluster_frustum{ Eigen::Matrix4f::Identity() };
+    std::vector<GLsizei> cluster_counts;
+    std::vector<const GLvoid*> cluster_offsets;
+
+    /// Build picking hierarchies for triangle meshes as they are loaded; pick() only looks at meshes with one
+    bool automatic_bvh = true;
+
+    /// Hierarchy over the objects with a picking hierarchy, by their world space bounds
+    Tucano::BVH object_bvh;
+    std::vector<std::pair<int, ObjectDescriptor*>> bvh_objects;
+
+    /// Set when objects come and go, move, or gain or lose their picking hierarchy
+    bool object_bvh_dirty = true;
+
+    /// Track the object under hover_position, in framebuffer pixels from the top left
+    bool hover = false;
+    Eigen::Vector2f hover_position = Eigen::Vector2f::Zero();
+
+    /// Frustum of the pixels around hover_position
+    Tucano::Frustum hover_frustum{ Eigen::Matrix4f::Identity() };
+
+    /// Scene ids of the objects drawn by the id pass being read back, by the id written for them minus one
+    std::vector<int> hover_ids;
+
+    /// Object (-1 for none) and triangle under hover_position as of the last readback
+    int hovered_object = -1;
+    std::size_t hovered_triangle = 0;
+
+    /// Draw the hovered object again, blended with hover_color
+    bool hover_highlight = false;
+    Eigen::Vector4f hover_color = Eigen::Vector4f(1.f, 0.6f, 0.f, 0.4f);
+
+    ObjectDescriptor* Object( int object_id ) 
+    {
+        return objects.find( object_id );
+    };
+
+    ObjectDescriptor* createObject( int object_id )
+    {
+        // Whatever is loaded now supersedes a pending asynchronous load
+        cancelLoad( object_id );
+
+        ObjectDescriptor* object = objects.find( object_id );
+        if ( object == nullptr )
+        {
+            return objects.insert( object_id, std::make_unique<ObjectDescriptor>() );
+        }
+
+        // Reloading an existing object: start afresh but keep the mesh's GL
+        // buffers aside, so that attributes and indices reloaded with the
+        // same size are rewritten in place instead of reallocated; anything
+        // else, including the primitive and the counts, starts from scratch
+        object->mesh.reset(true);
+        object->texture = Tucano::Texture();
+        object->texture_file.clear();
+        object->opaque = true;
+        object->world_bounds_dirty = true;
+        object->instance_bounds.setEmpty();
+        object->point_radius = 0.0f;
+        object->generated_normals.reset();
+        object->indices_reordered = false;
+        object->lod_errors.clear();
+        object->forced_lod = -1;
+        object->clusters.clear();
+        object->cluster_bounds_dirty = false;
+        object->bvh.clear();
+        object_bvh_dirty = true;
+
+        return object;
+    }
+
+    bool eraseObject( int object_id )
+    {
+        cancelLoad( object_id );
+        object_bvh_dirty = true;
+
+        return objects.erase(object_id);
+    }
+
+    bool loadTexture( ObjectDescriptor *ptr, const std::string &tex_file )
+    {
+        Tucano::Texture texture;
+        bool success = Tucano::ImageImporter::loadImage(tex_file, &texture);
+        if (success)
+        {
+            ptr->texture = texture;
+            ptr->texture.setTexParameters( GL_CLAMP, GL_CLAMP, GL_LINEAR, GL_LINEAR );
+            ptr->texture_file = tex_file;
+        }
+
+        return success;
+    }
+
+    /// Computes and loads the normals of a triangle mesh, keeping the mesh to recompute them after vertex updates
+    void generateNormals( ObjectDescriptor *ptr, std::vector<float> &&vertices, std::vector<unsigned int> &&indices, NormalWeighting weighting )
+    {
+        ptr->generated_normals = std::make_unique<Tucano::VertexNormals>();
+        ptr->generated_normals->set( std::move(vertices), std::move(indices),
+                (weighting == NormalWeighting::Area) ? Tucano::VertexNormals::AREA : Tucano::VertexNormals::ANGLE );
+
+        ptr->mesh.loadNormals( ptr->generated_normals->normals() );
+        if ( ptr->shader == ObjectShader::DirectColor )
+        {
+            ptr->shader = ObjectShader::Phong;
+        }
+    }
+
+    /// Reorders the triangles of a mesh just loaded, as set by index_optimization, and its vertices if asked to
+    void optimizeIndices( ObjectDescriptor *ptr, bool reorder_vertices )
+    {
+        if ( index_optimization == IndexOptimization::None )
+        {
+            return;
+        }
+
+        const bool overdraw = (index_optimization == IndexOptimization::VertexCacheAndOverdraw);
+        ptr->indices_reordered = Tucano::MeshOptimizer::optimizeMesh( &ptr->mesh, overdraw, reorder_vertices, &ptr->loaded_cache_stats );
+    }
+
+    /// Reorders the triangles of a parsed PLY file before they are uploaded, leaving the vertices as they are
+    static bool optimizePlyIndices( Tucano::MeshImporter::PlyData &data, IndexOptimization optimization, Tucano::MeshOptimizer::VertexCacheStats &before )
+    {
+        const Tucano::MeshImporter::PlyData::MappedVertices &mapped = data.mapped_vertices;
+        const bool in_records = (mapped.position_offset >= 0);
+        const std::size_t num_vertices = in_records ? mapped.count : data.vertices.size()/3;
+        std::vector<unsigned int> &indices = data.indices;
+
+        if ( (optimization == IndexOptimization::None) || (indices.size() < 3) )
+        {
+            return false;
+        }
+
+        before = Tucano::MeshOptimizer::analyzeVertexCache( indices.data(), indices.size(), num_vertices );
+        if ( !Tucano::MeshOptimizer::optimizeVertexCache( indices.data(), indices.size(), num_vertices ) )
+        {
+            return false;
+        }
+
+        if ( optimization == IndexOptimization::VertexCacheAndOverdraw )
+        {
+            if ( in_records )
+                Tucano::MeshOptimizer::optimizeOverdraw( indices.data(), indices.size(), mapped.records + mapped.position_offset, mapped.stride, num_vertices );
+            else
+                Tucano::MeshOptimizer::optimizeOverdraw( indices.data(), indices.size(), data.vertices.data(), 3*sizeof(float), num_vertices );
+        }
+
+        return true;
+    }
+
+    /// Simplifies a triangle mesh into levels of detail with at most budgets triangles, or a quarter of the previous level each if none are given
+    static LodChain computeLod( std::vector<float> &&positions, std::vector<unsigned int> &&indices, std::vector<std::size_t> budgets, bool optimize )
+    {
+        LodChain chain;
+        const std::size_t num_vertices = positions.size()/3;
+
+        if ( budgets.empty() )
+        {
+            for ( std::size_t budget = indices.size()/12; budget >= min_lod_triangles; budget /= 4 )
+            {
+                budgets.push_back( budget );
+            }
+        }
+
+        Tucano::MeshSimplifier simplifier;
+        if ( budgets.empty() || !simplifier.set( std::move(positions), std::move(indices) ) )
+        {
+            return chain;
+        }
+        simplifier.buildLevels( budgets, chain.indices, chain.sizes, chain.errors );
+
+        // simplified triangles lose the order they were given
+        if ( optimize )
+        {
+            std::size_t first = 0;
+            for ( std::size_t size : chain.sizes )
+            {
+                Tucano::MeshOptimizer::optimizeVertexCache( &chain.indices[first], size, num_vertices );
+                first += size;
+            }
+        }
+
+        return chain;
+    }
+
+    /// Sends levels of detail to an object's mesh
+    void loadLod( ObjectDescriptor *ptr, const LodChain &chain )
+    {
+        ptr->mesh.loadLevelsOfDetail( chain.indices.data(), chain.sizes );
+        ptr->lod_errors.assign( 1, 0.0f );
+        ptr->lod_errors.insert( ptr->lod_errors.end(), chain.errors.begin(), chain.errors.end() );
+    }
+
+    /// Builds the levels of detail of a triangle mesh from its vertices and triangles on the GPU
+    bool buildLod( ObjectDescriptor *ptr, const std::vector<std::size_t> &budgets )
+    {
+        if ( (ptr->type == ObjectType::Glyphs) || (ptr->mesh.getPrimitive() != Tucano::Mesh::TRIANGLE) || (ptr->mesh.getNumberOfElements() < 3) )
+        {
+            return false;
+        }
+
+        std::vector<float> positions;
+        std::vector<GLuint> indices;
+        if ( !ptr->mesh.readBackPositions(positions) )
+        {
+            return false;
+        }
+        ptr->mesh.readBackIndices(indices);
+
+        loadLod( ptr, computeLod( std::move(positions), std::move(indices), budgets, index_optimization != IndexOptimization::None ) );
+
+        return true;
+    }
+
+    /// With automatic levels of detail on, builds them for a mesh just loaded
+    void buildAutomaticLod( ObjectDescriptor *ptr )
+    {
+        if ( automatic_lod )
+        {
+            buildLod( ptr, std::vector<std::size_t>() );
+        }
+    }
+
+    /// Partitions the triangles of a mesh into clusters, reordering them on the GPU
+    bool buildClusters( ObjectDescriptor *ptr )
+    {
+        ptr->clusters.clear();
+        ptr->mesh.clearDrawRanges();
+        if ( (ptr->type == ObjectType::Glyphs) || (ptr->mesh.getPrimitive() != Tucano::Mesh::TRIANGLE) || (ptr->mesh.getNumberOfElements() < 3) )
+        {
+            return false;
+        }
+
+        std::vector<float> positions;
+        std::vector<GLuint> indices;
+        if ( !ptr->mesh.readBackPositions(positions) )
+        {
+            return false;
+        }
+        ptr->mesh.readBackIndices(indices);
+
+        if ( !ptr->clusters.build( indices.data(), indices.size(), positions.data(), positions.size()/3, cluster_triangles ) )
+        {
+            return false;
+        }
+        // the same triangles: the levels of detail still hold, but not the triangle numbers of picking,
+        // so the hierarchy is built again from the reordered triangles in hand
+        ptr->mesh.updateIndices( 0, indices.data(), indices.size() );
+        ptr->cluster_bounds_dirty = false;
+        if ( ptr->bvh.size() > 0 )
+        {
+            ptr->bvh.build( std::move(positions), std::move(indices) );
+            object_bvh_dirty = true;
+        }
+
+        return true;
+    }
+
+    /// With cluster culling on, builds the clusters of a mesh just loaded
+    void buildAutomaticClusters( ObjectDescriptor *ptr )
+    {
+        if ( cluster_culling != ClusterCulling::None )
+        {
+            buildClusters( ptr );
+        }
+    }
+
+    /// Recomputes the cluster bounds after vertices moved, from the copy of the mesh kept for picking if there is one;
+    /// clusters that cannot be refit are dropped, and the whole mesh drawn
+    void refitClusters( ObjectDescriptor *ptr )
+    {
+        if ( !ptr->cluster_bounds_dirty )
+        {
+            return;
+        }
+        ptr->cluster_bounds_dirty = false;
+
+        bool refit = false;
+        if ( ptr->bvh.size() > 0 )
+        {
+            const std::vector<float> &positions = ptr->bvh.coordinates();
+            const std::vector<GLuint> &indices = ptr->bvh.triangles();
+            refit = ptr->clusters.refit( indices.data(), indices.size(), positions.data(), positions.size()/3 );
+        }
+        else
+        {
+            std::vector<float> positions;
+            std::vector<GLuint> indices;
+            if ( ptr->mesh.readBackPositions(positions) )
+            {
+                ptr->mesh.readBackIndices(indices);
+                refit = ptr->clusters.refit( indices.data(), indices.size(), positions.data(), positions.size()/3 );
+            }
+        }
+
+        if ( !refit )
+        {
+            ptr->clusters.clear();
+            ptr->mesh.clearDrawRanges();
+        }
+    }
+
+    /// Culls the clusters of an object drawn at full detail; false if none is left
+    bool cullClusters( ObjectDescriptor *ptr )
+    {
+        Tucano::Mesh &mesh = ptr->mesh;
+        if ( (cluster_culling != ClusterCulling::None) && (ptr->clusters.size() > 0) )
+        {
+            refitClusters( ptr );
+        }
+        if ( (cluster_culling == ClusterCulling::None) || (ptr->clusters.size() == 0) || (mesh.getSelectedLevel() > 0) || (mesh.getNumberOfInstances() > 0) )
+        {
+            mesh.clearDrawRanges();
+            return true;
+        }
+
+        const Eigen::Affine3f model_view = camera.getViewMatrix() * mesh.getShapeModelMatrix();
+        cluster_frustum.update( camera.getProjectionMatrix() * model_view.matrix() );
+        const Eigen::Vector3f eye = model_view.inverse().translation();
+
+        const std::size_t num_visible = ptr->clusters.cull( cluster_frustum, eye, cluster_culling == ClusterCulling::FrustumAndBackfaces,
+                cluster_counts, cluster_offsets );
+        render_stats.culled_clusters += ptr->clusters.size() - num_visible;
+        mesh.setDrawRanges( cluster_counts, cluster_offsets );
+
+        return num_visible > 0;
+    }
+
+    /// True for the objects pick() looks at: indexed triangle meshes, as point clouds keep the default primitive
+    static bool isPickable( ObjectDescriptor *ptr )
+    {
+        return (ptr->type != ObjectType::Glyphs) && (ptr->mesh.getPrimitive() == Tucano::Mesh::TRIANGLE) && (ptr->mesh.getNumberOfElements() >= 3)
+            && (ptr->mesh.getNumberOfInstances() == 0);
+    }
+
+    /// Builds the picking hierarchy of a triangle mesh from its vertices and triangles on the GPU
+    bool buildBvh( ObjectDescriptor *ptr )
+    {
+        ptr->bvh.clear();
+        object_bvh_dirty = true;
+        if ( !isPickable(ptr) )
+        {
+            return false;
+        }
+
+        std::vector<float> positions;
+        std::vector<GLuint> indices;
+        if ( !ptr->mesh.readBackPositions(positions) )
+        {
+            return false;
+        }
+        ptr->mesh.readBackIndices(indices);
+
+        return ptr->bvh.build( std::move(positions), std::move(indices) );
+    }
+
+    /// With automatic picking hierarchies on, builds the one of a mesh just loaded
+    void buildAutomaticBvh( ObjectDescriptor *ptr )
+    {
+        if ( automatic_bvh )
+        {
+            buildBvh( ptr );
+        }
+    }
+
+    /// Rebuilds the hierarchy over the objects after they changed; objects without a picking hierarchy are left out,
+    /// so that picking never reads meshes back from the GPU
+    void updateObjectBvh()
+    {
+        if ( !object_bvh_dirty )
+        {
+            return;
+        }
+
+        bvh_objects.clear();
+        for ( auto entry : objects )
+        {
+            ObjectDescriptor *ptr = entry.object;
+            if ( isPickable(ptr) && (ptr->bvh.size() > 0) )
+            {
+                bvh_objects.emplace_back( entry.id, ptr );
+            }
+        }
+
+        object_bvh.build( bvh_objects.size(), [this]( std::size_t i ) {
+            ObjectDescriptor *ptr = bvh_objects[i].second;
+            return transformBox( ptr->bvh.bounds(), ptr->mesh.getShapeModelMatrix() );
+        }, 1 );
+        object_bvh_dirty = false;
+    }
+
+    /// Casts a ray through a framebuffer position, down to the triangles of the objects it meets
+    PickResult pick( float x, float y )
+    {
+        PickResult result;
+        updateObjectBvh();
+
+        // the ray runs from the near plane (t = 0) to the far plane (t = 1)
+        const Eigen::Vector2i size = camera.getViewportSize();
+        const Eigen::Vector2f ndc( 2.0f*x/size[0] - 1.0f, 1.0f - 2.0f*y/size[1] );
+        const Eigen::Matrix4f unproject = (camera.getProjectionMatrix() * camera.getViewMatrix().matrix()).inverse();
+        const Eigen::Vector4f near_point = unproject * Eigen::Vector4f( ndc[0], ndc[1], -1.0f, 1.0f );
+        const Eigen::Vector4f far_point = unproject * Eigen::Vector4f( ndc[0], ndc[1], 1.0f, 1.0f );
+        const Eigen::Vector3f origin = near_point.head<3>()/near_point[3];
+        const Eigen::Vector3f direction = far_point.head<3>()/far_point[3] - origin;
+
+        float t = 1.0f;
+        std::size_t triangle = 0;
+        float u = 0.0f, v = 0.0f;
+        const bool hit = object_bvh.intersect( origin, direction, t, [&]( GLuint i, float &t_max ) {
+            ObjectDescriptor *ptr = bvh_objects[i].second;
+            if ( ptr->shader == ObjectShader::None )
+            {
+                return false;
+            }
+
+            // the object is hit in its own coordinates, along the same ray parameter
+            const Eigen::Affine3f inverse = ptr->mesh.getShapeModelMatrix().inverse();
+            if ( !ptr->bvh.intersect( inverse * origin, inverse.linear() * direction, t_max, triangle, u, v ) )
+            {
+                return false;
+            }
+            result.object_id = bvh_objects[i].first;
+            return true;
+        } );
+
+        if ( hit )
+        {
+            const Eigen::Vector3f point = origin + t*direction;
+            result.hit = true;
+            result.triangle = triangle;
+            result.barycentrics = {{ 1.0f - u - v, u, v }};
+            result.point = {{ point[0], point[1], point[2] }};
+        }
+
+        return result;
+    }
+
+    /// Takes the ids read back from an earlier frame once the GPU is done, then draws the ids under hover_position
+    void updateHover()
+    {
+        GLuint id = 0, primitive = 0;
+        if ( picking.resolveIds(id, primitive) && hover )
+        {
+            const bool found = (id > 0) && (id <= hover_ids.size()) && (Object(hover_ids[id-1]) != nullptr);
+            hovered_object = found ? hover_ids[id-1] : -1;
+            hovered_triangle = found ? primitive : 0;
+        }
+
+        if ( hover && !picking.isIdReadbackPending() )
+        {
+            renderHoverIds();
+        }
+    }
+
+    /// Draws the ids of the objects pick() would find, in the few pixels around hover_position
+    void renderHoverIds()
+    {
+        const Eigen::Matrix4f view_projection = picking.regionProjection(camera, hover_position) * camera.getViewMatrix().matrix();
+        hover_frustum.update(view_projection);
+
+        hover_ids.clear();
+        picking.beginIdRender(camera, hover_position);
+        for ( auto entry : objects )
+        {
+            ObjectDescriptor *ptr = entry.object;
+            if ( (ptr->shader == ObjectShader::None) || (ptr->shader == ObjectShader::SphereImpostors) || !isPickable(ptr) )
+            {
+                continue;
+            }
+
+            // bounds are otherwise only kept up to date by frustum culling
+            if ( ptr->world_bounds_dirty )
+            {
+                updateWorldBounds(ptr);
+            }
+            if ( !ptr->world_bounds.isEmpty() && hover_frustum.isCullable(ptr->world_bounds) )
+            {
+                continue;
+            }
+            hover_ids.push_back(entry.id);
+            const GLuint id = hover_ids.size();
+
+            // triangles are numbered at full detail, as in pick()
+            Tucano::Mesh &mesh = ptr->mesh;
+            const unsigned int level = mesh.getSelectedLevel();
+            mesh.selectLevel(0);
+            refitClusters( ptr );
+            if ( ptr->clusters.size() == 0 )
+            {
+                mesh.clearDrawRanges();
+                picking.renderIds(mesh, id);
+            }
+            else
+            {
+                // gl_PrimitiveID restarts with each range, so ranges are drawn one by one
+                cluster_frustum.update( view_projection * mesh.getShapeModelMatrix().matrix() );
+                ptr->clusters.cull( cluster_frustum, Eigen::Vector3f::Zero(), false, cluster_counts, cluster_offsets );
+                for ( std::size_t i = 0; i < cluster_counts.size(); ++i )
+                {
+                    mesh.setDrawRanges( { cluster_counts[i] }, { cluster_offsets[i] } );
+                    picking.renderIds( mesh, id, reinterpret_cast<std::size_t>(cluster_offsets[i])/(3*sizeof(GLuint)) );
+                }
+                mesh.clearDrawRanges();
+            }
+            mesh.selectLevel(level);
+        }
+        picking.endIdRender();
+    }
+
+    /// Draws the hovered object again blended with hover_color, if it was drawn in this frame
+    void renderHoverHighlight()
+    {
+        if ( !hover_highlight || (hovered_object < 0) )
+        {
+            return;
+        }
+
+        for ( auto &entry : render_queue )
+        {
+            if ( entry.first == hovered_object )
+            {
+                picking.renderHighlight(entry.second->mesh, camera, hover_color);
+                return;
+            }
+        }
+    }
+
+    /// Picks the level of detail of an object from the size of its bounding sphere on screen, with hysteresis
+    void selectLod( ObjectDescriptor *ptr )
+    {
+        Tucano::Mesh &mesh = ptr->mesh;
+        const unsigned int levels = mesh.getNumberOfLevels();
+        if ( (levels <= 1) || (ptr->lod_errors.size() != levels) )
+        {
+            return;
+        }
+
+        if ( ptr->forced_lod >= 0 )
+        {
+            mesh.selectLevel( ptr->forced_lod );
+            return;
+        }
+
+        // pixels per object unit at the point of the bounding sphere nearest to the camera
+        const Eigen::Affine3f model_view = camera.getViewMatrix() * mesh.getShapeModelMatrix();
+        const float scale = model_view.linear().colwise().norm().maxCoeff();
+        const Eigen::Vector3f center = model_view * mesh.getCentroid();
+        const float radius = mesh.getBoundingSphereRadius()*scale;
+        const Eigen::Matrix4f projection = camera.getProjectionMatrix();
+        const float w = projection(3,2)*(center.z() + radius) + projection(3,3);
+        if ( !(w > 0.0f) )
+        {
+            // the camera is inside the sphere
+            mesh.selectLevel( 0 );
+            return;
+        }
+        const float pixels = scale*projection(1,1)*0.5f*camera.getViewportSize()[1]/w;
+
+        auto coarsest = [&]( float limit ) {
+            unsigned int level = 0;
+            while ( (level + 1 < levels) && (ptr->lod_errors[level+1]*pixels <= limit) )
+            {
+                ++level;
+            }
+            return level;
+        };
+
+        unsigned int level = mesh.getSelectedLevel();
+        if ( ptr->lod_errors[level]*pixels > lod_pixel_error )
+        {
+            level = coarsest( lod_pixel_error );
+        }
+        else
+        {
+            level = std::max( level, coarsest( lod_pixel_error*lod_hysteresis ) );
+        }
+        mesh.selectLevel( level );
+    }
+
+    /// Packed (x,y,z) vertex coordinates of a parsed PLY file
+    static std::vector<float> plyPositions( const Tucano::MeshImporter::PlyData &data )
+    {
+        const Tucano::MeshImporter::PlyData::MappedVertices &mapped = data.mapped_vertices;
+        if ( mapped.position_offset < 0 )
+        {
+            return data.vertices;
+        }
+
+        std::vector<float> positions( 3*mapped.count );
+        for ( std::size_t v = 0; v < mapped.count; ++v )
+        {
+            std::memcpy( &positions[3*v], mapped.records + v*mapped.stride + mapped.position_offset, 3*sizeof(float) );
+        }
+        return positions;
+    }
+
+    /// Name of the cache kept next to a mesh file by the automatic cache
+    static std::string cacheFile( const std::string &filename )
+    {
+        return filename + ".tcache";
+    }
+
+    /// Writes an object's mesh, texture name and rendering settings to a cache file
+    bool saveObjectCache( ObjectDescriptor *ptr, const std::string &cache_file, const Tucano::MeshImporter::MeshCacheSource &source )
+    {
+        // glyph placement lives outside of the mesh
+        if ( ptr->type == ObjectType::Glyphs )
+        {
+            return false;
+        }
+
+        Tucano::MeshImporter::MeshCacheInfo info;
+        info.source = source;
+        info.texture_file = ptr->texture_file;
+        info.user_data[0] = static_cast<uint32_t>(ptr->type);
+        info.user_data[1] = static_cast<uint32_t>(ptr->shader);
+        info.user_data[2] = ptr->opaque ? 1 : 0;
+        std::memcpy(&info.user_data[3], &ptr->point_radius, sizeof(float));
+
+        return Tucano::MeshImporter::saveMeshCache(&ptr->mesh, cache_file, info);
+    }
+
+    /// Restores an object written by saveObjectCache(), if built from the expected source (when given)
+    bool loadObjectCache( ObjectDescriptor *ptr, const std::string &cache_file, const Tucano::MeshImporter::MeshCacheSource *expected = nullptr )
+    {
+        Tucano::MeshImporter::MeshCacheInfo info;
+        if ( !Tucano::MeshImporter::loadMeshCache(&ptr->mesh, cache_file, info, expected) )
+        {
+            return false;
+        }
+
+        ptr->type = static_cast<ObjectType>(info.user_data[0]);
+        ptr->shader = static_cast<ObjectShader>(info.user_data[1]);
+        ptr->opaque = (info.user_data[2] != 0);
+        std::memcpy(&ptr->point_radius, &info.user_data[3], sizeof(float));
+
+        if ( !info.texture_file.empty() )
+        {
+            loadTexture( ptr, info.texture_file );
+        }
+
+        return true;
+    }
+
+    /// With the automatic cache on, restores an object from the cache of a mesh file if the cache is up to date
+    bool loadAutomaticCache( ObjectDescriptor *ptr, const std::string &filename )
+    {
+        Tucano::MeshImporter::MeshCacheSource source;
+        return automatic_cache && Tucano::MeshImporter::readMeshCacheSource(filename, source) &&
+            loadObjectCache( ptr, cacheFile(filename), &source );
+    }
+
+    /// With the automatic cache on, writes the cache of an object just read from a mesh file
+    void saveAutomaticCache( ObjectDescriptor *ptr, const std::string &filename )
+    {
+        Tucano::MeshImporter::MeshCacheSource source;
+        if ( automatic_cache && Tucano::MeshImporter::readMeshCacheSource(filename, source) )
+        {
+            // a cache that cannot be written only costs the next load its speed
+            saveObjectCache( ptr, cacheFile(filename), source );
+        }
+    }
+
+    /// Starts reading a PLY file on a worker thread, replacing any load pending for the object
+    void startPlyLoad( int object_id, const std::string &filename )
+    {
+        cancelLoad( object_id );
+
+        std::unique_ptr<AsyncPlyLoad> load = std::make_unique<AsyncPlyLoad>();
+        AsyncPlyLoad *ptr = load.get();
+        IndexOptimization optimization = index_optimization;
+        bool build_lod = automatic_lod;
+        bool build_clusters = (cluster_culling != ClusterCulling::None);
+        bool build_bvh = automatic_bvh;
+
+        ptr->worker = std::thread([ptr, filename, optimization, build_lod, build_clusters, build_bvh]() {
+            try
+            {
+                ptr->success = Tucano::MeshImporter::readPlyFile(filename, ptr->data, &ptr->progress);
+                if ( ptr->success )
+                {
+                    ptr->indices_reordered = optimizePlyIndices( ptr->data, optimization, ptr->loaded_cache_stats );
+                    std::vector<float> positions;
+                    if ( (build_clusters || build_lod || build_bvh) && !ptr->data.indices.empty() )
+                    {
+                        positions = plyPositions( ptr->data );
+                    }
+                    if ( build_clusters && !positions.empty() )
+                    {
+                        ptr->clusters.build( ptr->data.indices.data(), ptr->data.indices.size(), positions.data(), positions.size()/3, cluster_triangles );
+                    }
+                    if ( build_bvh && !positions.empty() )
+                    {
+                        ptr->bvh.build( build_lod ? std::vector<float>( positions ) : std::move(positions), std::vector<unsigned int>( ptr->data.indices ) );
+                    }
+                    if ( build_lod && !positions.empty() )
+                    {
+                        ptr->lod = computeLod( std::move(positions), std::vector<unsigned int>( ptr->data.indices ),
+                                std::vector<std::size_t>(), optimization != IndexOptimization::None );
+                    }
+
+                    std::string tex_file = Tucano::MeshImporter::getPlyTextureFile(filename);
+                    if ( !tex_file.empty() )
+                    {
+                        size_t found = filename.find_last_of("/\\");
+                        ptr->texture_file = filename.substr(0, found) + "/" + tex_file;
+                    }
+                }
+            }
+            catch (...)
+            {
+                ptr->success = false;
+            }
+
+            ptr->parsed.store(true, std::memory_order_release);
+        });
+
+        async_loads[object_id] = std::move(load);
+    }
+
+    /// Stops a pending asynchronous load; returns false if none is pending for the object
+    bool cancelLoad( int object_id )
+    {
+        auto it = async_loads.find( object_id );
+        if ( it == async_loads.end() )
+        {
+            return false;
+        }
 
-#include <Eigen/Dense>
+        AsyncPlyLoad &load = *it->second;
+        if ( (load.status != LoadStatus::Parsing) && (load.status != LoadStatus::Uploading) )
+        {
+            return false;
+        }
 
-#include <tucano/texture.hpp>
-#include <tucano/effects/directcolor.hpp>
-#include <tucano/effects/toon.hpp>
-#include <tucano/effects/phongshader.hpp>
-#include <tucano/effects/wireframe.hpp>
-#include <tucano/gui/base.hpp>
-#include <tucano/utils/trackball.hpp>
-#include <tucano/utils/plyimporter.hpp>
-#include <tucano/utils/imageIO.hpp>
+        load.progress.cancel = true;
+        if ( load.worker.joinable() )
+        {
+            load.worker.join();
+        }
 
-#include "tucanow/definitions.hpp"
-#include "tucanow/scene.hpp"
+        finishLoad( load, LoadStatus::Cancelled );
 
-namespace tucanow {
+        return true;
+    }
 
+    /// Status of the asynchronous load of an object, with the completed fraction of its current stage
+    LoadStatus loadStatus( int object_id, float *progress ) const
+    {
+        auto it = async_loads.find( object_id );
+        if ( it == async_loads.end() )
+        {
+            if ( progress != nullptr )
+                *progress = 0.0f;
+            return LoadStatus::None;
+        }
 
-struct ObjectDescriptor {
-    Tucano::Mesh mesh;
-    Tucano::Texture texture;
-    ObjectType type;
-    ObjectShader shader;
-    bool opaque = true;
-};
+        const AsyncPlyLoad &load = *it->second;
+        if ( progress != nullptr )
+        {
+            switch ( load.status )
+            {
+                case LoadStatus::Parsing:
+                {
+                    long total = load.progress.elements_total;
+                    *progress = (total > 0) ? std::min(1.0f, static_cast<float>(load.progress.elements_read)/total) : 0.0f;
+                    break;
+                }
 
-struct SceneImpl 
-{
-    /// Ratio framebuffer_width/window_width
-    float scale_width = 1.0f; 
+                case LoadStatus::Uploading:
+                    *progress = (load.total_bytes > 0) ? static_cast<float>(load.uploaded_bytes)/load.total_bytes : 0.0f;
+                    break;
 
-    /// Ratio framebuffer_height/window_height
-    float scale_height = 1.0f; 
+                case LoadStatus::Done:
+                    *progress = 1.0f;
+                    break;
 
-    /// Bounding box origin
-    std::array<float, 3> bbox_origin = {-1.0f, -1.0f, -1.0f};
+                default:
+                    *progress = 0.0f;
+                    break;
+            }
+        }
 
-    /// Bounding box size
-    std::array<float, 3> bbox_size = {2.0f, 2.0f, 2.0f};
+        return load.status;
+    }
 
-    /// Bounding box normalization scale (1/max{bbox_size}) -- used to normalize Tucano::Model::ModelMatrix
-    float model_scale = 1.0f;
+    /// Releases the memory of a load, keeping only its final status
+    void finishLoad( AsyncPlyLoad &load, LoadStatus status )
+    {
+        load.status = status;
+        load.data = Tucano::MeshImporter::PlyData();
+        load.lod = LodChain();
+        load.clusters.clear();
+        load.bvh.clear();
+        load.streams.clear();
+        load.object.reset();
+    }
 
-    /// Bounding box centroid -- used to normalize Tucano::Model::ModelMatrix
-    Eigen::Vector3f model_centroid = Eigen::Vector3f::Zero();
+    /// Allocates the GPU buffers of a parsed PLY and lists what has to be uploaded into them
+    void beginUpload( AsyncPlyLoad &load )
+    {
+        const Tucano::MeshImporter::PlyData &data = load.data;
 
-    /// Bounding box boundary mesh to be rendered in this scene
-    ObjectDescriptor bbox_boundary;
+        load.object = std::make_unique<ObjectDescriptor>();
+        Tucano::Mesh &mesh = load.object->mesh;
 
-    /// Objects to be rendered in this scene
-    std::map<int, std::unique_ptr<ObjectDescriptor>> objects;
+        using Kind = AsyncPlyLoad::Stream::Kind;
+        auto add_stream = [&load]( Kind kind, const std::string &attribute, const void *values, std::size_t count, std::size_t element_bytes ) {
+            load.streams.push_back( AsyncPlyLoad::Stream{kind, attribute, values, count, element_bytes} );
+            load.total_bytes += count*element_bytes;
+        };
 
-    /// DirectColor shader effect to render meshes
-    Tucano::Effects::DirectColor directcolor;
+        // records left in the mapped file are uploaded as they are
+        const Tucano::MeshImporter::PlyData::MappedVertices &mapped = data.mapped_vertices;
+        if ( mapped.records != nullptr )
+        {
+            std::vector<Tucano::Mesh::RecordAttribute> attributes;
+            if ( mapped.position_offset >= 0 )
+                attributes.push_back( Tucano::Mesh::RecordAttribute{"in_Position", 3, mapped.position_offset} );
+            if ( mapped.normal_offset >= 0 )
+                attributes.push_back( Tucano::Mesh::RecordAttribute{"in_Normal", 3, mapped.normal_offset} );
 
-    /// Toon shader effect to render meshes
-    Tucano::Effects::Toon toon;
+            mesh.loadVertexRecords( nullptr, mapped.count, static_cast<GLsizei>(mapped.stride), attributes );
+            add_stream( Kind::Records, attributes[0].name, mapped.records, mapped.count, mapped.stride );
+        }
 
-    /// Phong shader effect to render meshes
-    Tucano::Effects::Phong phong;
+        if ( !data.vertices.empty() )
+        {
+            mesh.reserveVertices( 3, data.vertices.size()/3 );
+            add_stream( Kind::Attribute, "in_Position", data.vertices.data(), data.vertices.size()/3, 3*sizeof(float) );
+        }
+        if ( !data.normals.empty() )
+        {
+            mesh.reserveNormals( data.normals.size()/3 );
+            add_stream( Kind::Attribute, "in_Normal", data.normals.data(), data.normals.size()/3, 3*sizeof(float) );
+        }
+        if ( !data.tex_coords.empty() )
+        {
+            mesh.reserveTexCoords( data.tex_coords.size()/2 );
+            add_stream( Kind::Attribute, "in_TexCoords", data.tex_coords.data(), data.tex_coords.size()/2, 2*sizeof(float) );
+        }
+        if ( !data.colors.empty() )
+        {
+            mesh.reserveColors( 3, data.colors.size()/3 );
+            add_stream( Kind::Attribute, "in_Color", data.colors.data(), data.colors.size()/3, 3*sizeof(float) );
+        }
+        if ( !data.indices.empty() )
+        {
+            mesh.reserveIndices( data.indices.size() );
+            add_stream( Kind::Indices, "", data.indices.data(), data.indices.size(), sizeof(GLuint) );
+        }
+        if ( !load.lod.sizes.empty() )
+        {
+            mesh.loadLevelsOfDetail( nullptr, load.lod.sizes );
+            add_stream( Kind::LevelsOfDetail, "", load.lod.indices.data(), load.lod.indices.size(), sizeof(GLuint) );
+        }
 
-    /// Single pass wireframe shader effect to render meshes
-    Tucano::Effects::Wireframe wireframe;
+        load.status = LoadStatus::Uploading;
+    }
 
-    /// Trackball for manipulating the camera
-    Tucano::Trackball camera;
+    /// Uploads up to budget bytes of a load; returns true once everything was uploaded
+    bool uploadSlices( AsyncPlyLoad &load, std::size_t budget )
+    {
+        Tucano::Mesh &mesh = load.object->mesh;
 
-    /// Trackball for manipulating light direction
-    Tucano::DirectionalTrackball light;
+        while ( (load.stream < load.streams.size()) && (budget > 0) )
+        {
+            const AsyncPlyLoad::Stream &s = load.streams[load.stream];
 
-    /// Path to shader's dir
-    std::string shader_dir;
+            // at least one element per call, so that a tiny budget still makes progress
+            std::size_t length = std::min( s.count - load.offset, std::max<std::size_t>(1, budget/s.element_bytes) );
+            const char *values = static_cast<const char*>(s.values) + load.offset*s.element_bytes;
 
-    /// OpenGL clear color
-    Eigen::Vector4f clear_color = Eigen::Vector4f(1.f, 1.f, 1.f, 0.f);
+            switch ( s.kind )
+            {
+                case AsyncPlyLoad::Stream::Kind::Attribute:
+                    mesh.updateAttribute( s.attribute, load.offset, reinterpret_cast<const float*>(values), length*s.element_bytes/sizeof(float) );
+                    break;
+                case AsyncPlyLoad::Stream::Kind::Records:
+                    mesh.updateVertexRecords( s.attribute, load.offset, values, length );
+                    break;
+                case AsyncPlyLoad::Stream::Kind::Indices:
+                    mesh.updateIndices( load.offset, reinterpret_cast<const GLuint*>(values), length );
+                    break;
+                case AsyncPlyLoad::Stream::Kind::LevelsOfDetail:
+                    mesh.updateLevelsOfDetail( load.offset, reinterpret_cast<const GLuint*>(values), length );
+                    break;
+            }
 
-    /// Source of current mesh
-    bool render_bbox_boundary = false;
+            const std::size_t bytes = length*s.element_bytes;
+            budget -= std::min(budget, bytes);
+            load.uploaded_bytes += bytes;
+            load.offset += length;
 
-    ObjectDescriptor* Object( int object_id ) 
+            if ( load.offset == s.count )
+            {
+                ++load.stream;
+                load.offset = 0;
+            }
+        }
+
+        return load.stream == load.streams.size();
+    }
+
+    /// Swaps a fully uploaded mesh into the scene, in place of the object with the same id
+    void completeUpload( int object_id, AsyncPlyLoad &load )
     {
-        auto it = objects.find( object_id );
-        if ( it == objects.end() )
+        std::unique_ptr<ObjectDescriptor> object = std::move(load.object);
+
+        const Tucano::MeshImporter::PlyData::MappedVertices &mapped = load.data.mapped_vertices;
+        if ( mapped.position_offset >= 0 )
+            object->mesh.updateVertexBounds( mapped.records + mapped.position_offset, mapped.stride );
+        else
+            object->mesh.updateVertexBounds( load.data.vertices );
+        object->mesh.setDefaultAttribLocations();
+        object->shader = ObjectShader::Phong;
+        object->type = ObjectType::PLY;
+        object->indices_reordered = load.indices_reordered;
+        object->loaded_cache_stats = load.loaded_cache_stats;
+        std::swap( object->clusters, load.clusters );
+        std::swap( object->bvh, load.bvh );
+        object_bvh_dirty = true;
+        if ( !load.lod.sizes.empty() )
         {
-            return nullptr;
+            object->lod_errors.assign( 1, 0.0f );
+            object->lod_errors.insert( object->lod_errors.end(), load.lod.errors.begin(), load.lod.errors.end() );
         }
 
-        return it->second.get();
-    };
+        if ( !load.texture_file.empty() )
+        {
+            loadTexture( object.get(), load.texture_file );
+        }
 
-    ObjectDescriptor* createObject( int object_id )
+        objects.insert( object_id, std::move(object) );
+
+        finishLoad( load, LoadStatus::Done );
+    }
+
+    /// Moves asynchronous loads forward, sending at most upload_budget bytes to the GPU; call once per frame
+    void advanceLoads()
     {
-        objects[object_id] = std::make_unique<ObjectDescriptor>();
+        std::size_t budget = upload_budget;
+
+        for ( auto &entry : async_loads )
+        {
+            AsyncPlyLoad &load = *entry.second;
+
+            if ( load.status == LoadStatus::Parsing )
+            {
+                if ( !load.parsed.load(std::memory_order_acquire) )
+                {
+                    continue;
+                }
 
-        return Object(object_id);
+                load.worker.join();
+                if ( !load.success )
+                {
+                    finishLoad( load, LoadStatus::Failed );
+                    continue;
+                }
+
+                beginUpload( load );
+            }
+
+            if ( (load.status == LoadStatus::Uploading) && (budget > 0) )
+            {
+                std::size_t before = load.uploaded_bytes;
+                bool uploaded = uploadSlices( load, budget );
+                budget -= std::min(budget, load.uploaded_bytes - before);
+
+                if ( uploaded )
+                {
+                    completeUpload( entry.first, load );
+                }
+            }
+        }
     }
 
-    bool eraseObject( int object_id )
+    /// Loads the template mesh of a glyph, shared by all its instances
+    bool loadGlyphMesh(ObjectDescriptor *ptr, GlyphType glyph_type)
     {
-        auto it = objects.find(object_id);
-        if (it == objects.end())
+        std::vector<Eigen::Vector4f> vertices;
+        std::vector<Eigen::Vector3f> normals;
+        std::vector<GLuint> indices;
+
+        switch(glyph_type)
         {
-            return false;
+            case GlyphType::Sphere:
+                Tucano::Shapes::Sphere::generateGeometry(2, vertices, normals, indices);
+                break;
+
+            case GlyphType::Arrow:
+                Tucano::Shapes::Arrow::generateGeometry(0.05f, 0.8f, 0.1f, 0.2f, 16, vertices, normals, indices);
+                break;
+
+            case GlyphType::Cylinder:
+                Tucano::Shapes::Cylinder::generateGeometry(16, 0, true, vertices, normals, indices);
+                break;
+
+            case GlyphType::Cone:
+                Tucano::Shapes::Cone::generateGeometry(1.0f, 1.0f, 16, vertices, normals, indices);
+                break;
+
+            default:
+                return false;
         }
 
-        objects.erase(it);
+        ptr->mesh.loadVertices(vertices);
+        ptr->mesh.loadNormals(normals);
+        ptr->mesh.loadIndices(indices);
+
         return true;
     }
 
@@ -173,6 +1358,7 @@ struct SceneImpl
         bbox_boundary.mesh.selectPrimitive(Tucano::Mesh::CURVE);
         bbox_boundary.mesh.setColor(Eigen::Vector4f(0.0f, 0.0f, 0.0f, 1.0f));
         bbox_boundary.shader = ObjectShader::DirectColor;
+        bbox_boundary.world_bounds_dirty = true;
     }
 
     bool normalizeObjectModelMatrix(ObjectDescriptor* ptr)
@@ -183,6 +1369,8 @@ struct SceneImpl
         }
 
         ptr->mesh.normalizeModelMatrix(model_centroid, model_scale);
+        ptr->world_bounds_dirty = true;
+        object_bvh_dirty = true;
 
         return true;
     }
@@ -195,52 +1383,139 @@ struct SceneImpl
         }
 
         ptr->mesh.desnormalizeModelMatrix(model_centroid, model_scale);
+        ptr->world_bounds_dirty = true;
+        object_bvh_dirty = true;
 
         return true;
     }
 
     void normalizeAllModelMatrices()
     {
-        for (auto& entry : objects)
+        for (auto entry : objects)
         {
-            auto& obj = entry.second;
-            normalizeObjectModelMatrix(obj.get());
+            normalizeObjectModelMatrix(entry.object);
         }
     }
 
     void denormalizeAllModelMatrices()
     {
-        for (auto& entry : objects)
+        for (auto entry : objects)
         {
-            auto& obj = entry.second;
-            denormalizeObjectModelMatrix(obj.get());
+            denormalizeObjectModelMatrix(entry.object);
         }
     }
 
-    bool render(ObjectDescriptor *ptr)
+    void beginRender(ObjectShader shader)
     {
-        if ( ptr == nullptr )
+        switch(shader)
         {
-            return false;
+            case ObjectShader::Phong:
+                phong.beginRender(camera, light);
+                break;
+
+            case ObjectShader::OnePassWireframe:
+                wireframe.beginRender(camera, light);
+                break;
+
+            case ObjectShader::Toon:
+                toon.beginRender(camera, light);
+                break;
+
+            case ObjectShader::DirectColor:
+                directcolor.beginRender(camera);
+                break;
+
+            case ObjectShader::InstancedGlyphs:
+                glyphs.beginRender(camera, light);
+                break;
+
+            case ObjectShader::SphereImpostors:
+                sphere_impostors.beginRender(camera, light);
+                break;
+
+            case ObjectShader::None:
+                break;
+
+            default:
+                break;
         }
+    }
 
-        /* normalizeObjectModelMatrix(ptr); */
+    void endRender(ObjectShader shader)
+    {
+        switch(shader)
+        {
+            case ObjectShader::Phong:
+                phong.endRender();
+                break;
+
+            case ObjectShader::OnePassWireframe:
+                wireframe.endRender();
+                break;
+
+            case ObjectShader::Toon:
+                toon.endRender();
+                break;
+
+            case ObjectShader::DirectColor:
+                directcolor.endRender();
+                break;
+
+            case ObjectShader::InstancedGlyphs:
+                glyphs.endRender();
+                break;
+
+            case ObjectShader::SphereImpostors:
+                sphere_impostors.endRender();
+                break;
+
+            case ObjectShader::None:
+                break;
+
+            default:
+                break;
+        }
+    }
 
+    /// Sphere radius of the points of an object rendered with ObjectShader::SphereImpostors
+    float pointRadius(ObjectDescriptor *ptr)
+    {
+        if ( ptr->point_radius > 0.0f )
+        {
+            return ptr->point_radius;
+        }
+
+        const Eigen::AlignedBox3f &box = ptr->mesh.getBoundingBox();
+        return box.isEmpty() ? 0.0f : 0.005f*box.diagonal().norm();
+    }
+
+    /// Draws an object, the effect of its shader must have been begun
+    void renderMesh(ObjectDescriptor *ptr)
+    {
         switch(ptr->shader)
         {
             case ObjectShader::Phong:
-                phong.render(ptr->mesh, camera, light, ptr->texture);
+                phong.renderMesh(ptr->mesh, ptr->texture);
                 break;
 
             case ObjectShader::OnePassWireframe:
-                wireframe.render(ptr->mesh, camera, light);
+                wireframe.renderMesh(ptr->mesh);
                 break;
 
             case ObjectShader::Toon:
-                toon.render(ptr->mesh, camera, light);
+                toon.renderMesh(ptr->mesh);
+                break;
 
             case ObjectShader::DirectColor:
-                directcolor.render(ptr->mesh, camera);
+                directcolor.renderMesh(ptr->mesh);
+                break;
+
+            case ObjectShader::InstancedGlyphs:
+                glyphs.renderMesh(ptr->mesh);
+                break;
+
+            case ObjectShader::SphereImpostors:
+                sphere_impostors.renderMesh(ptr->mesh, pointRadius(ptr));
                 break;
 
             case ObjectShader::None:
@@ -249,11 +1524,167 @@ struct SceneImpl
             default:
                 break;
         }
+    }
+
+    bool render(ObjectDescriptor *ptr)
+    {
+        if ( ptr == nullptr )
+        {
+            return false;
+        }
+
+        /* normalizeObjectModelMatrix(ptr); */
+
+        beginRender(ptr->shader);
+        renderMesh(ptr);
+        endRender(ptr->shader);
 
         /* denormalizeObjectModelMatrix(ptr); */
 
         return true;
     }
+
+    /// Transforms the object space bounding box of the mesh to world space
+    void updateWorldBounds(ObjectDescriptor *ptr)
+    {
+        const Eigen::AlignedBox3f &box = (ptr->mesh.getNumberOfInstances() > 0) ?
+            ptr->instance_bounds : ptr->mesh.getBoundingBox();
+        ptr->world_bounds_dirty = false;
+
+        ptr->world_bounds = transformBox(box, ptr->mesh.getShapeModelMatrix());
+    }
+
+    /// Box holding a transformed box
+    static Eigen::AlignedBox3f transformBox(const Eigen::AlignedBox3f &box, const Eigen::Affine3f &model)
+    {
+        if ( box.isEmpty() )
+        {
+            return box;
+        }
+
+        // Transform center and half extents instead of the eight corners
+        Eigen::Vector3f center = model * box.center();
+        Eigen::Vector3f half_extents = model.linear().cwiseAbs() * (box.sizes()/2.0f);
+
+        return Eigen::AlignedBox3f(center - half_extents, center + half_extents);
+    }
+
+    /// True if the object lies outside the camera frustum
+    bool isCulled(ObjectDescriptor *ptr)
+    {
+        if ( ptr->world_bounds_dirty )
+        {
+            updateWorldBounds(ptr);
+        }
+
+        // Objects without vertices have nothing to draw, leave them to the effect
+        if ( ptr->world_bounds.isEmpty() )
+        {
+            return false;
+        }
+
+        // Spheres reach out of the box of their centers by their radius
+        if ( ptr->shader == ObjectShader::SphereImpostors )
+        {
+            if ( ptr->mesh.hasAttribute("in_Radius") )
+            {
+                return false;
+            }
+
+            float radius = pointRadius(ptr)*ptr->mesh.getShapeModelMatrix().linear().col(0).norm();
+            Eigen::Vector3f margin = Eigen::Vector3f::Constant(radius);
+
+            return frustum.isCullable(Eigen::AlignedBox3f(ptr->world_bounds.min() - margin, ptr->world_bounds.max() + margin));
+        }
+
+        return frustum.isCullable(ptr->world_bounds);
+    }
+
+    /// Queues an object for drawing, unless it is culled
+    void enqueue(int id, ObjectDescriptor *ptr)
+    {
+        if ( frustum_culling && isCulled(ptr) )
+        {
+            ++render_stats.culled_objects;
+            return;
+        }
+
+        selectLod(ptr);
+        if ( !cullClusters(ptr) )
+        {
+            ++render_stats.culled_objects;
+            return;
+        }
+        if ( ptr->mesh.getPrimitive() == Tucano::Mesh::TRIANGLE )
+        {
+            std::size_t instances = std::max(1, ptr->mesh.getNumberOfInstances());
+            std::size_t elements = ptr->mesh.getNumberOfLevelElements(ptr->mesh.getSelectedLevel());
+            if ( ptr->mesh.hasDrawRanges() )
+            {
+                elements = std::accumulate(cluster_counts.begin(), cluster_counts.end(), std::size_t(0));
+            }
+            render_stats.drawn_triangles += instances*(elements/3);
+        }
+
+        render_queue.emplace_back(id, ptr);
+    }
+
+    /// Draws the bounding box boundary (if enabled) and all objects, grouped by render state
+    void renderObjects()
+    {
+        render_queue.clear();
+        render_stats.culled_objects = 0;
+        render_stats.drawn_triangles = 0;
+        render_stats.culled_clusters = 0;
+
+        if ( frustum_culling )
+        {
+            frustum.update(camera);
+        }
+
+        if ( render_bbox_boundary )
+        {
+            enqueue(std::numeric_limits<int>::min(), &bbox_boundary);
+        }
+
+        for ( auto entry : objects )
+        {
+            if ( entry.object->shader != ObjectShader::None )
+            {
+                enqueue(entry.id, entry.object);
+            }
+        }
+
+        render_stats.drawn_objects = render_queue.size();
+
+        // Group by shader first, as binding a program is the most expensive
+        // change, then by opacity and texture; objects in a group are drawn
+        // in id order
+        auto key = []( const std::pair<int, ObjectDescriptor*> &entry ) {
+            ObjectDescriptor *ptr = entry.second;
+            GLuint texture_id = ptr->texture.isEmpty() ? 0 : ptr->texture.texID();
+            return std::make_tuple(static_cast<int>(ptr->shader), !ptr->opaque, texture_id, entry.first);
+        };
+
+        std::sort(render_queue.begin(), render_queue.end(), 
+                [&key]( const std::pair<int, ObjectDescriptor*> &a, const std::pair<int, ObjectDescriptor*> &b ) { return key(a) < key(b); }
+            );
+
+        ObjectShader current = ObjectShader::None;
+        for ( auto &entry : render_queue )
+        {
+            ObjectDescriptor *ptr = entry.second;
+            if ( ptr->shader != current )
+            {
+                endRender(current);
+                beginRender(ptr->shader);
+                current = ptr->shader;
+            }
+
+            renderMesh(ptr);
+        }
+        endRender(current);
+    }
 };
 
 
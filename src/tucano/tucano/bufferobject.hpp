@@ -250,6 +250,101 @@ public:
     ShaderStorageBufferInt (int s) : BufferObject<GLint>(s, GL_SHADER_STORAGE_BUFFER) {}
 };
 
+/**
+ * @brief The buffer object of type UniformBuffer with Float elements.
+ *
+ * Holds a uniform block shared by several shader programs. The layout of the data
+ * must follow the block declaration in the shaders (usually std140).
+ */
+class UniformBufferFloat: public BufferObject <GLfloat>
+{
+
+public:
+    /**
+     * @brief Float Uniform Buffer constructor.
+     * @param s Size of buffer (number of floats).
+     */
+    UniformBufferFloat (int s) : BufferObject<GLfloat>(s, GL_UNIFORM_BUFFER) {}
+
+    UniformBufferFloat (const UniformBufferFloat&) = delete;
+    UniformBufferFloat& operator= (const UniformBufferFloat&) = delete;
+
+    /**
+     * @brief Deletes the buffer.
+     */
+    virtual ~UniformBufferFloat (void)
+    {
+        glDeleteBuffers(1, &buffer_id);
+    }
+
+    /**
+     * @brief Replaces the whole content of the buffer.
+     *
+     * The storage is respecified, so the driver does not need to wait for draws still
+     * reading the previous content.
+     * @param data Array with as many floats as the buffer size.
+     */
+    void update (const GLfloat *data)
+    {
+        bind();
+        glBufferData(buffer_type, sizeof(GLfloat) * size, data, GL_DYNAMIC_DRAW);
+        unbind();
+    }
+};
+
+/**
+ * @brief The buffer object of type PixelPackBuffer with unsigned integer elements.
+ *
+ * Target of glReadPixels calls that return at once: the copy runs on the GPU, and the
+ * buffer is mapped once a fence placed after it has signaled (see Effects::Picking).
+ */
+class PixelPackBufferUInt: public BufferObject <GLuint>
+{
+
+public:
+    /**
+     * @brief Unsigned Integer Pixel Pack Buffer constructor.
+     * @param s Size of buffer (number of unsigned integers).
+     */
+    PixelPackBufferUInt (int s) : BufferObject<GLuint>(s, GL_PIXEL_PACK_BUFFER)
+    {
+        // written by the GPU and read back by the CPU
+        bind();
+        glBufferData(buffer_type, sizeof(GLuint) * size, NULL, GL_STREAM_READ);
+        unbind();
+    }
+
+    PixelPackBufferUInt (const PixelPackBufferUInt&) = delete;
+    PixelPackBufferUInt& operator= (const PixelPackBufferUInt&) = delete;
+
+    /**
+     * @brief Deletes the buffer.
+     */
+    virtual ~PixelPackBufferUInt (void)
+    {
+        glDeleteBuffers(1, &buffer_id);
+    }
+
+    /**
+     * @brief Maps the buffer for reading; call unmap() when done with the values.
+     * @return Pointer to the values, nullptr if the buffer could not be mapped
+     */
+    const GLuint* map (void)
+    {
+        bind();
+        return (const GLuint*)glMapBufferRange(buffer_type, 0, sizeof(GLuint) * size, GL_MAP_READ_BIT);
+    }
+
+    /**
+     * @brief Unmaps the buffer after map().
+     */
+    void unmap (void)
+    {
+        glUnmapBuffer(buffer_type);
+        unbind();
+    }
+};
+
 }
 
 #endif
@@ -26,6 +26,7 @@
 #include <Eigen/Dense>
 #include <vector>
 #include <tucano/shader.hpp>
+#include <tucano/frameuniforms.hpp>
 
 namespace Tucano
 {
@@ -74,6 +75,7 @@ public:
     {
         Shader* shader_ptr = new Shader(shader_name, shaders_dir);
         shader_ptr->initialize();
+        shader_ptr->setUniformBlockBinding(FrameUniforms::blockName(), FrameUniforms::bindingPoint());
         shaders_list.push_back(shader_ptr);
         return shader_ptr;
     }
@@ -82,6 +84,7 @@ public:
     {
 		shader.load(shader_name, shaders_dir);
         shader.initialize();
+        shader.setUniformBlockBinding(FrameUniforms::blockName(), FrameUniforms::bindingPoint());
         shaders_list.push_back(&shader);
     }
 
@@ -96,6 +99,7 @@ public:
     {
         Shader* shader_ptr = new Shader(shader_name, vertex_name, frag_name, geom_name);
         shader_ptr->initialize();
+        shader_ptr->setUniformBlockBinding(FrameUniforms::blockName(), FrameUniforms::bindingPoint());
         shaders_list.push_back(shader_ptr);
         return shader_ptr;
     }
@@ -123,6 +127,19 @@ public:
         }
     }
 
+    /**
+     * @brief Shares a per-frame uniform block (camera and light) with this effect.
+     *
+     * The owner of the block must update it once per frame, before rendering, so the effect
+     * only sets per-object uniforms. Without a shared block the effect updates its own block
+     * on every render call.
+     * @param uniforms Shared block, or nullptr to use the effect's own block.
+     */
+    void setFrameUniforms (std::shared_ptr < FrameUniforms > uniforms)
+    {
+        shared_frame_uniforms = uniforms;
+    }
+
 
 
 protected:
@@ -134,6 +151,47 @@ protected:
     /// Directory in which the shader files are stored.
     string shaders_dir;
 
+    /// Per-frame uniform block shared with other effects, updated by its owner
+    std::shared_ptr < FrameUniforms > shared_frame_uniforms;
+
+    /// Per-frame uniform block used when no block is shared
+    FrameUniforms frame_uniforms;
+
+    /**
+     * @brief Computes the matrix that transforms normals to camera space.
+     *
+     * It is the inverse transpose of the linear part of the model view matrix, computed once
+     * per object instead of once per vertex in the shaders.
+     * @param view_matrix Camera view matrix
+     * @param model_matrix Object model matrix
+     * @return Normal matrix
+     */
+    static Eigen::Matrix3f computeNormalMatrix (const Eigen::Affine3f& view_matrix, const Eigen::Affine3f& model_matrix)
+    {
+        return (view_matrix * model_matrix).linear().inverse().transpose();
+    }
+
+    /**
+     * @brief Updates the effect's own per-frame block, unless a shared block is set.
+     * @param camera Given camera
+     * @param light Given light camera
+     */
+    void updateFrameUniforms (const Tucano::Camera& camera, const Tucano::Camera& light)
+    {
+        if (!shared_frame_uniforms)
+            frame_uniforms.update(camera, light);
+    }
+
+    /**
+     * @brief Updates the camera part of the effect's own per-frame block, unless a shared block is set.
+     * @param camera Given camera
+     */
+    void updateFrameUniforms (const Tucano::Camera& camera)
+    {
+        if (!shared_frame_uniforms)
+            frame_uniforms.update(camera);
+    }
+
 };
 }
 #endif
@@ -70,33 +70,60 @@ public:
 		default_color = color;
 	}
 
-    /** * @brief Render the mesh given a camera 
-     * @param mesh Given mesh
+    /**
+     * @brief Binds the DirectColor shader for rendering a sequence of meshes with the same camera.
+     *
+     * Call renderMesh for each mesh and endRender at the end, so the shader is bound only once.
      * @param camera Given camera
      */
-    void render (Tucano::Mesh& mesh, const Tucano::Camera& camera)
+    void beginRender (const Tucano::Camera& camera)
     {
+        GLStateCache::Instance().viewport(camera.getViewport());
 
-        Eigen::Vector4f viewport = camera.getViewport();
-        glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+        // camera matrices go through the per-frame uniform block
+        updateFrameUniforms(camera);
 
         directcolor_shader.bind();
 
-        // sets all uniform variables for the phong shader
-        directcolor_shader.setUniform("projectionMatrix", camera.getProjectionMatrix());
+        GLStateCache::Instance().enable(GL_DEPTH_TEST);
+    }
+
+    /**
+     * @brief Renders a mesh between beginRender and endRender, setting only its own uniforms.
+     * @param mesh Given mesh
+     */
+    void renderMesh (Tucano::Mesh& mesh)
+    {
+        // sets all per-object uniform variables for the directcolor shader
         directcolor_shader.setUniform("modelMatrix", mesh.getShapeModelMatrix());
-        directcolor_shader.setUniform("viewMatrix", camera.getViewMatrix());
         directcolor_shader.setUniform("has_color", mesh.hasAttribute("in_Color"));
 		directcolor_shader.setUniform("default_color", mesh.getColor()); // JD: use mesh default colour instead of shader's
 
+        mesh.setDecodingUniforms(directcolor_shader);
         mesh.setAttributeLocation(directcolor_shader);
 
-        glEnable(GL_DEPTH_TEST);
         mesh.render();
+    }
 
+    /**
+     * @brief Unbinds the DirectColor shader after rendering a sequence of meshes.
+     */
+    void endRender (void)
+    {
         directcolor_shader.unbind();
     }
 
+    /** * @brief Render the mesh given a camera 
+     * @param mesh Given mesh
+     * @param camera Given camera
+     */
+    void render (Tucano::Mesh& mesh, const Tucano::Camera& camera)
+    {
+        beginRender(camera);
+        renderMesh(mesh);
+        endRender();
+    }
+
 };
 }
 }
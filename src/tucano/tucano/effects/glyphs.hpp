@@ -0,0 +1,186 @@
+/**
+ * Tucano - A library for rapid prototying with Modern OpenGL and GLSL
+ * Copyright (C) 2014
+ * LCG - Laboratório de Computação Gráfica (Computer Graphics Lab) - COPPE
+ * UFRJ - Federal University of Rio de Janeiro
+ *
+ * This file is part of Tucano Library.
+ *
+ * Tucano Library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Tucano Library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Tucano Library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GLYPHS__
+#define __GLYPHS__
+
+#include <tucano/effect.hpp>
+#include <tucano/camera.hpp>
+#include <tucano/mesh.hpp>
+
+namespace Tucano
+{
+namespace Effects
+{
+
+/**
+ * @brief Renders instanced glyphs (many copies of a small mesh) with Phong shading.
+ *
+ * Besides in_Position and in_Normal, the mesh must have the instance attributes in_InstancePosition
+ * (vec3), in_InstanceScale (vec3) and in_InstanceColor (RGB or RGBA), and optionally
+ * in_InstanceOrientation, a unit quaternion (x,y,z,w) per instance.
+ * See Mesh::createInstanceAttribute.
+ */
+class Glyphs : public Tucano::Effect
+{
+
+private:
+
+    /// Glyphs Shader
+    Tucano::Shader glyphs_shader;
+
+    /// Ambient coefficient
+    float ka = 0.5;
+
+    /// Diffuse coefficient
+    float kd = 0.8;
+
+    /// Specular coefficient
+    float ks = 0.5;
+
+    /// Shininess
+    float shininess = 10;
+
+    /// View matrix of the camera set in beginRender
+    Eigen::Affine3f view_matrix = Eigen::Affine3f::Identity();
+
+public:
+
+    /**
+     * @brief Default constructor.
+     */
+    Glyphs (void)
+    {}
+
+    /**
+     * @brief Load and initialize shaders
+     */
+    virtual void initialize (void)
+    {
+        loadShader(glyphs_shader, "glyphs") ;
+    }
+
+    /**
+    * @brief Set ambient coefficient
+    * @param value New ambient coeff (ka)
+    */
+    void setAmbientCoeff (float value)
+    {
+        ka = value;
+    }
+
+    /**
+    * @brief Set diffuse coefficient
+    * @param value New diffuse coeff (kd)
+    */
+    void setDiffuseCoeff (float value)
+    {
+        kd = value;
+    }
+
+    /**
+    * @brief Set specular coefficient
+    * @param New specular coeff (ks)
+    */
+    void setSpecularCoeff (float value)
+    {
+        ks = value;
+    }
+
+    /**
+    * @brief Set shininess exponent
+    * @param New shininess coeff (shininess)
+    */
+    void setShininessCoeff (float value)
+    {
+        shininess = value;
+    }
+
+    float getDiffuseCoeff (void ) {return kd;}
+    float getAmbientCoeff (void ) {return ka;}
+    float getSpecularCoeff (void ) {return ks;}
+    float getShininessCoeff (void ) {return shininess;}
+
+    /**
+     * @brief Binds the glyphs shader and sets the uniforms shared by all meshes.
+     * @param camera Given camera
+     * @param lightTrackball Given light camera
+     */
+    void beginRender (const Tucano::Camera& camera, const Tucano::Camera& lightTrackball)
+    {
+        GLStateCache::Instance().viewport(camera.getViewport());
+
+        updateFrameUniforms(camera, lightTrackball);
+        view_matrix = camera.getViewMatrix();
+
+        glyphs_shader.bind();
+
+        glyphs_shader.setUniform("ka", ka);
+        glyphs_shader.setUniform("kd", kd);
+        glyphs_shader.setUniform("ks", ks);
+        glyphs_shader.setUniform("shininess", shininess);
+
+        GLStateCache::Instance().enable(GL_DEPTH_TEST);
+    }
+
+    /**
+     * @brief Renders all instances of a mesh between beginRender and endRender.
+     * @param mesh Given mesh
+     */
+    void renderMesh (Tucano::Mesh& mesh)
+    {
+        glyphs_shader.setUniform("modelMatrix", mesh.getShapeModelMatrix());
+        glyphs_shader.setUniform("normalMatrix", computeNormalMatrix(view_matrix, mesh.getShapeModelMatrix()));
+        glyphs_shader.setUniform("has_orientation", mesh.hasAttribute("in_InstanceOrientation"));
+
+        mesh.setAttributeLocation(glyphs_shader);
+
+        mesh.render();
+    }
+
+    /**
+     * @brief Unbinds the glyphs shader after rendering a sequence of meshes.
+     */
+    void endRender (void)
+    {
+        glyphs_shader.unbind();
+    }
+
+    /**
+     * @brief Render all instances of the mesh given a camera and light
+     * @param mesh Given mesh
+     * @param camera Given camera
+     * @param lightTrackball Given light camera
+     */
+    void render (Tucano::Mesh& mesh, const Tucano::Camera& camera, const Tucano::Camera& lightTrackball)
+    {
+        beginRender(camera, lightTrackball);
+        renderMesh(mesh);
+        endRender();
+    }
+
+};
+}
+}
+
+
+#endif
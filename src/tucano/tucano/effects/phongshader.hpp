@@ -62,6 +62,9 @@ private:
     /// Texture
     Tucano::Texture texture;
 
+    /// View matrix of the camera set in beginRender
+    Eigen::Affine3f view_matrix = Eigen::Affine3f::Identity();
+
 public:
 
     /**
@@ -140,79 +143,45 @@ public:
     float getShininessCoeff (void ) {return shininess;}
     Tucano::Texture* getTexture (void) {return &texture;}
 
-    /** 
-     * @brief Render the mesh given a camera and light, using a Phong shader 
-     * @param mesh Given mesh
-     * @param camera Given camera 
-     * @param lightTrackball Given light camera 
+    /**
+     * @brief Binds the Phong shader and sets the uniforms shared by all meshes.
+     *
+     * Use it to render many meshes with the same camera and light: call renderMesh for each mesh
+     * and endRender at the end, so the shader is bound only once.
+     * @param camera Given camera
+     * @param lightTrackball Given light camera
      */
-    void render (Tucano::Mesh& mesh, const Tucano::Camera& camera, const Tucano::Camera& lightTrackball)
+    void beginRender (const Tucano::Camera& camera, const Tucano::Camera& lightTrackball)
     {
+        GLStateCache::Instance().viewport(camera.getViewport());
 
-        Eigen::Vector4f viewport = camera.getViewport();
-        glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+        // camera and light matrices go through the per-frame uniform block
+        updateFrameUniforms(camera, lightTrackball);
+        view_matrix = camera.getViewMatrix();
 
         phong_shader.bind();
 
-        // sets all uniform variables for the phong shader
-        phong_shader.setUniform("projectionMatrix", camera.getProjectionMatrix());
-        phong_shader.setUniform("modelMatrix", mesh.getShapeModelMatrix());
-        phong_shader.setUniform("viewMatrix", camera.getViewMatrix());
-        phong_shader.setUniform("lightViewMatrix", lightTrackball.getViewMatrix());
-        phong_shader.setUniform("has_color", mesh.hasAttribute("in_Color"));
-		phong_shader.setUniform("default_color", mesh.getColor());
         phong_shader.setUniform("ka", ka);
         phong_shader.setUniform("kd", kd);
         phong_shader.setUniform("ks", ks);
         phong_shader.setUniform("shininess", shininess);
 
-        bool has_texture = mesh.hasAttribute("in_TexCoords") && !texture.isEmpty();
- 
-        phong_shader.setUniform("has_texture", has_texture);
-        if (has_texture)
-            phong_shader.setUniform("model_texture", texture.bind());
-
-        else
-            phong_shader.setUniform("model_texture", 0);
-
-
-        mesh.setAttributeLocation(phong_shader);
-
         // JD: let's be sane and allow rendering multiple meshes
-        glEnable(GL_DEPTH_TEST);
-        mesh.render();
-
-        phong_shader.unbind();
-        if (has_texture)
-            texture.unbind();
+        GLStateCache::Instance().enable(GL_DEPTH_TEST);
     }
 
-    /** 
-     * @brief Render the mesh given a camera and light, using a Phong shader 
+    /**
+     * @brief Renders a mesh between beginRender and endRender, setting only its own uniforms.
      * @param mesh Given mesh
-     * @param camera Given camera 
-     * @param lightTrackball Given light camera 
-     * @param texture_ Given texture
+     * @param texture_ Given texture, used if the mesh has texture coordinates
      */
-    void render (Tucano::Mesh& mesh, const Tucano::Camera& camera, const Tucano::Camera& lightTrackball, Tucano::Texture &texture_)
+    void renderMesh (Tucano::Mesh& mesh, Tucano::Texture &texture_)
     {
-
-        Eigen::Vector4f viewport = camera.getViewport();
-        glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
-
-        phong_shader.bind();
-
-        // sets all uniform variables for the phong shader
-        phong_shader.setUniform("projectionMatrix", camera.getProjectionMatrix());
+        // sets all per-object uniform variables for the phong shader
         phong_shader.setUniform("modelMatrix", mesh.getShapeModelMatrix());
-        phong_shader.setUniform("viewMatrix", camera.getViewMatrix());
-        phong_shader.setUniform("lightViewMatrix", lightTrackball.getViewMatrix());
+        phong_shader.setUniform("normalMatrix", computeNormalMatrix(view_matrix, mesh.getShapeModelMatrix()));
         phong_shader.setUniform("has_color", mesh.hasAttribute("in_Color"));
 		phong_shader.setUniform("default_color", mesh.getColor());
-        phong_shader.setUniform("ka", ka);
-        phong_shader.setUniform("kd", kd);
-        phong_shader.setUniform("ks", ks);
-        phong_shader.setUniform("shininess", shininess);
 
         bool has_texture = mesh.hasAttribute("in_TexCoords") && !texture_.isEmpty();
  
@@ -224,17 +193,50 @@ public:
             phong_shader.setUniform("model_texture", 0);
 
 
+        mesh.setDecodingUniforms(phong_shader);
         mesh.setAttributeLocation(phong_shader);
 
-        // JD: let's be sane and allow rendering multiple meshes
-        glEnable(GL_DEPTH_TEST);
         mesh.render();
 
-        phong_shader.unbind();
         if (has_texture)
             texture_.unbind();
     }
 
+    /**
+     * @brief Unbinds the Phong shader after rendering a sequence of meshes.
+     */
+    void endRender (void)
+    {
+        phong_shader.unbind();
+    }
+
+    /** 
+     * @brief Render the mesh given a camera and light, using a Phong shader 
+     * @param mesh Given mesh
+     * @param camera Given camera 
+     * @param lightTrackball Given light camera 
+     */
+    void render (Tucano::Mesh& mesh, const Tucano::Camera& camera, const Tucano::Camera& lightTrackball)
+    {
+        beginRender(camera, lightTrackball);
+        renderMesh(mesh, texture);
+        endRender();
+    }
+
+    /** 
+     * @brief Render the mesh given a camera and light, using a Phong shader 
+     * @param mesh Given mesh
+     * @param camera Given camera 
+     * @param lightTrackball Given light camera 
+     * @param texture_ Given texture
+     */
+    void render (Tucano::Mesh& mesh, const Tucano::Camera& camera, const Tucano::Camera& lightTrackball, Tucano::Texture &texture_)
+    {
+        beginRender(camera, lightTrackball);
+        renderMesh(mesh, texture_);
+        endRender();
+    }
+
 
 };
 }
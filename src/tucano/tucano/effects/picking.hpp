@@ -21,7 +21,7 @@
  */
 
 #ifndef __PICKING__
-#define __PICKING___
+#define __PICKING__
 
 #include <tucano/tucano.hpp>
 
@@ -32,23 +32,50 @@ namespace Effects
 
 /**
  * @brief Picks a 3D position from screen position
+ *
+ * Also picks the object and primitive under a cursor without stalling the pipeline:
+ * beginIdRender(), renderIds() and endIdRender() draw ids into the few pixels around
+ * the cursor and start copying them to a pixel buffer, and resolveIds() reads them
+ * in a later frame, once a fence says the copy is done.
  */
 class Picking : public Tucano::Effect
 {
 
 public:
 
+    /// Side of the square of pixels around the cursor where ids are drawn
+    static const int region_size = 7;
+
     /**
      * @brief Default constructor.
      */
     Picking (void) {}
 
+    /**
+     * @brief Deletes the fence of a pending id readback.
+     */
+    virtual ~Picking (void)
+    {
+        if (ids_fence)
+        {
+            glDeleteSync(ids_fence);
+        }
+    }
+
     /**
      * @brief Load and initialize shaders
      */
     virtual void initialize (void)
     {
         loadShader(worldcoords_shader, "worldcoords");
+        loadShader(ids_shader, "pickingids");
+        loadShader(highlight_shader, "pickinghighlight");
+
+        // object and primitive ids, whatever the viewport size
+        ids_fbo.setInternalFormat(GL_RG32UI);
+        ids_fbo.setInputFormat(GL_RG_INTEGER);
+        ids_fbo.setInputType(GL_UNSIGNED_INT);
+        ids_fbo.create(region_size, region_size, 1);
     }
 
     /**
@@ -59,12 +86,12 @@ public:
     virtual void render (Tucano::Mesh& mesh, const Tucano::Camera& camera)
     {
         Eigen::Vector4f viewport = camera.getViewport();
-        glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
-
+        GLStateCache::Instance().viewport(viewport);
 
-        if (fbo.getWidth() != (viewport[2]-viewport[0]) || fbo.getHeight() != (viewport[3]-viewport[1]))
+        // only grows, so resizing the window does not reallocate it every frame
+        if (fbo.getWidth() < (viewport[2]-viewport[0]) || fbo.getHeight() < (viewport[3]-viewport[1]))
         {
-            fbo.create(viewport[2]-viewport[0], viewport[3]-viewport[1], 1);
+            fbo.create(std::max<int>(fbo.getWidth(), viewport[2]-viewport[0]), std::max<int>(fbo.getHeight(), viewport[3]-viewport[1]), 1);
         }
 
         // sets the FBO first (and only) attachment as output
@@ -109,13 +136,236 @@ public:
         return fbo.readPixel(0, pos);
     }
 
+    /**
+     * @brief Returns the camera projection narrowed to the pixels around a cursor position.
+     *
+     * The region_size square of pixels centered on the pixel under the cursor fills the
+     * whole clip space, so drawing with it into a region_size square draws that part of
+     * the camera image only. The frustum of this projection also bounds what is worth drawing.
+     * @param camera Given camera
+     * @param pos Cursor position in pixels, from the top left corner of the viewport
+     * @return Narrowed projection matrix
+     */
+    Eigen::Matrix4f regionProjection (const Tucano::Camera& camera, const Eigen::Vector2f& pos) const
+    {
+        const Eigen::Vector4f viewport = camera.getViewport();
+        const Eigen::Vector2f size = viewport.tail<2>();
+        const Eigen::Vector2f origin = regionOrigin(camera, pos).cast<float>();
+
+        // maps [origin, origin + region_size] from window to clip coordinates
+        Eigen::Matrix4f region = Eigen::Matrix4f::Identity();
+        for (int i = 0; i < 2; ++i)
+        {
+            region(i, i) = size[i]/region_size;
+            region(i, 3) = (size[i] - 2.0f*origin[i])/region_size - 1.0f;
+        }
+
+        return region * camera.getProjectionMatrix();
+    }
+
+    /**
+     * @brief Binds the id attachment and shader for drawing the meshes around a cursor position.
+     *
+     * Call renderIds for each mesh and endIdRender at the end. Only one readback is in
+     * flight at a time: wait for resolveIds to return true before starting another one.
+     * @param camera Given camera
+     * @param pos Cursor position in pixels, from the top left corner of the viewport
+     */
+    void beginIdRender (const Tucano::Camera& camera, const Eigen::Vector2f& pos)
+    {
+        ids_viewport = camera.getViewport();
+        ids_origin = regionOrigin(camera, pos);
+
+        ids_fbo.bindRenderBuffer(0);
+        GLStateCache::Instance().viewport(Eigen::Vector4f(0, 0, region_size, region_size));
+
+        // glClear is undefined for integer attachments
+        const GLuint background[4] = {0, 0, 0, 0};
+        const GLfloat depth = 1.0f;
+        glClearBufferuiv(GL_COLOR, 0, background);
+        glClearBufferfv(GL_DEPTH, 0, &depth);
+
+        ids_shader.bind();
+        ids_shader.setUniform("projectionMatrix", regionProjection(camera, pos));
+        ids_shader.setUniform("viewMatrix", camera.getViewMatrix());
+
+        GLStateCache::Instance().enable(GL_DEPTH_TEST);
+    }
+
+    /**
+     * @brief Draws the ids of a mesh between beginIdRender and endIdRender.
+     *
+     * The primitive id is the index of the primitive in the draw call plus first_primitive,
+     * so a mesh drawn through several index ranges is drawn once per range.
+     * @param mesh Given mesh
+     * @param id Id written for the mesh, greater than 0
+     * @param first_primitive Index in the mesh of the first primitive drawn
+     */
+    void renderIds (Tucano::Mesh& mesh, GLuint id, GLuint first_primitive = 0)
+    {
+        ids_shader.setUniform("modelMatrix", mesh.getShapeModelMatrix());
+        ids_shader.setUniform("object_id", static_cast<GLint>(id));
+        ids_shader.setUniform("first_primitive", static_cast<GLint>(first_primitive));
+
+        mesh.setDecodingUniforms(ids_shader);
+        mesh.setAttributeLocation(ids_shader);
+
+        mesh.render();
+    }
+
+    /**
+     * @brief Starts copying the ids to the pixel buffer, and restores the camera viewport.
+     */
+    void endIdRender (void)
+    {
+        ids_shader.unbind();
+
+        glReadBuffer(GL_COLOR_ATTACHMENT0);
+        ids_pbo.bind();
+        glReadPixels(0, 0, region_size, region_size, GL_RG_INTEGER, GL_UNSIGNED_INT, nullptr);
+        ids_pbo.unbind();
+
+        ids_fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+        ids_fbo.unbind();
+        GLStateCache::Instance().viewport(ids_viewport);
+    }
+
+    /**
+     * @brief Returns if a copy started by endIdRender was not resolved yet.
+     */
+    bool isIdReadbackPending (void) const
+    {
+        return ids_fence != nullptr;
+    }
+
+    /**
+     * @brief Reads the ids copied by endIdRender, if the GPU is done with them.
+     *
+     * Never waits: returns false at once while the copy is still running. The ids are
+     * those under the cursor, or else those of the nearest pixel of the region with a mesh.
+     * @param id Id given to renderIds, 0 if no mesh was drawn around the cursor
+     * @param primitive Primitive index in the mesh
+     * @return True if a readback was resolved
+     */
+    bool resolveIds (GLuint& id, GLuint& primitive)
+    {
+        if (!ids_fence)
+        {
+            return false;
+        }
+
+        GLenum status = glClientWaitSync(ids_fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+        if (status == GL_TIMEOUT_EXPIRED)
+        {
+            return false;
+        }
+        glDeleteSync(ids_fence);
+        ids_fence = nullptr;
+
+        id = 0;
+        primitive = 0;
+        const GLuint *ids = ids_pbo.map();
+        if (ids && status != GL_WAIT_FAILED)
+        {
+            // pixels outside the viewport were drawn with the narrowed projection only
+            const int center = region_size/2;
+            int nearest = std::numeric_limits<int>::max();
+            for (int y = 0; y < region_size; ++y)
+            {
+                for (int x = 0; x < region_size; ++x)
+                {
+                    const GLuint *pixel = ids + 2*(y*region_size + x);
+                    const int distance = (x - center)*(x - center) + (y - center)*(y - center);
+                    const Eigen::Vector2i window = ids_origin + Eigen::Vector2i(x, y);
+                    if (pixel[0] == 0 || distance >= nearest || (window.array() < 0).any() || window[0] >= ids_viewport[2] || window[1] >= ids_viewport[3])
+                    {
+                        continue;
+                    }
+                    nearest = distance;
+                    id = pixel[0];
+                    primitive = pixel[1];
+                }
+            }
+        }
+        ids_pbo.unmap();
+
+        return true;
+    }
+
+    /**
+     * @brief Draws a mesh again over itself, blended with a color.
+     *
+     * Meant to follow the mesh own rendering in the same frame, with the same level of
+     * detail and draw ranges, so that the same pixels pass the depth test.
+     * @param mesh Given mesh
+     * @param camera Given camera
+     * @param color Highlight color, its alpha is the blending weight
+     */
+    void renderHighlight (Tucano::Mesh& mesh, const Tucano::Camera& camera, const Eigen::Vector4f& color)
+    {
+        GLStateCache &state = GLStateCache::Instance();
+        state.viewport(camera.getViewport());
+        updateFrameUniforms(camera);
+
+        highlight_shader.bind();
+        highlight_shader.setUniform("modelMatrix", mesh.getShapeModelMatrix());
+        highlight_shader.setUniform("highlight_color", color);
+        mesh.setDecodingUniforms(highlight_shader);
+        mesh.setAttributeLocation(highlight_shader);
+
+        state.enable(GL_DEPTH_TEST);
+        state.enable(GL_BLEND);
+        state.enable(GL_POLYGON_OFFSET_FILL);
+        glDepthFunc(GL_LEQUAL);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        glPolygonOffset(-1.0f, -1.0f);
+
+        mesh.render();
+
+        glDepthFunc(GL_LESS);
+        state.disable(GL_POLYGON_OFFSET_FILL);
+        state.disable(GL_BLEND);
+
+        highlight_shader.unbind();
+    }
+
 private:
 
+    /**
+     * @brief Returns the window position of the bottom left pixel of the region around a cursor.
+     */
+    Eigen::Vector2i regionOrigin (const Tucano::Camera& camera, const Eigen::Vector2f& pos) const
+    {
+        const Eigen::Vector4f viewport = camera.getViewport();
+        const Eigen::Vector2i pixel(static_cast<int>(std::floor(pos[0])), static_cast<int>(std::floor(viewport[3] - pos[1])));
+        return pixel - Eigen::Vector2i::Constant(region_size/2);
+    }
+
     /// shader to write world coords to projected pixel positions
     Tucano::Shader worldcoords_shader;
 
     /// Buffer to store projected coords
     Tucano::Framebuffer fbo;
+
+    /// Shader to write object and primitive ids
+    Tucano::Shader ids_shader;
+
+    /// Shader to blend a color over a mesh
+    Tucano::Shader highlight_shader;
+
+    /// Object and primitive ids of the region around the cursor
+    Tucano::Framebuffer ids_fbo;
+
+    /// Copy of the ids, read once ids_fence signals
+    Tucano::PixelPackBufferUInt ids_pbo{2*region_size*region_size};
+
+    /// Fence after the copy in flight, if any
+    GLsync ids_fence = nullptr;
+
+    /// Camera viewport and window position of the region of the copy in flight
+    Eigen::Vector4f ids_viewport = Eigen::Vector4f::Zero();
+    Eigen::Vector2i ids_origin = Eigen::Vector2i::Zero();
 };
 }
 
@@ -6,17 +6,31 @@ in vec4 in_Color;
 out vec4 color;
 
 uniform mat4 modelMatrix;
-uniform mat4 viewMatrix;
-uniform mat4 projectionMatrix;
+
+layout(std140) uniform FrameUniforms
+{
+    mat4 projectionMatrix;
+    mat4 viewMatrix;
+    mat4 lightViewMatrix;
+    mat4 viewportMatrix;
+    vec4 viewLightDirection;
+    vec4 viewport;
+};
 
 uniform vec4 default_color;
 
 // if attribute in_Color exists or not
 uniform bool has_color;
 
+// decoding of quantized positions (see Mesh::setDecodingUniforms)
+uniform vec3 position_scale;
+uniform vec3 position_offset;
+
 void main(void)
 {
-	gl_Position = projectionMatrix * viewMatrix * modelMatrix * in_Position;
+    vec4 position = vec4(in_Position.xyz * position_scale + position_offset, in_Position.w);
+
+	gl_Position = projectionMatrix * viewMatrix * modelMatrix * position;
 
     if (has_color)
         color = in_Color;
@@ -0,0 +1,37 @@
+#version 150
+
+in vec4 color;
+in vec3 normal;
+in vec4 vert;
+
+out vec4 out_Color;
+
+layout(std140) uniform FrameUniforms
+{
+    mat4 projectionMatrix;
+    mat4 viewMatrix;
+    mat4 lightViewMatrix;
+    mat4 viewportMatrix;
+    vec4 viewLightDirection;
+    vec4 viewport;
+};
+
+uniform float ka;
+uniform float kd;
+uniform float ks;
+uniform float shininess;
+
+void main(void)
+{
+    vec3 lightDirection = normalize(viewLightDirection.xyz);
+
+    vec3 lightReflection = reflect(-lightDirection, normal);
+
+    vec3 eyeDirection = normalize(-vert.xyz);
+
+    vec4 ambientLight = color * ka;
+    vec4 diffuseLight = color * kd * max(dot(lightDirection, normal),0.0);
+    vec4 specularLight = vec4(vec3(ks), 1.0) *  max(pow(dot(lightReflection, eyeDirection), shininess),0.0);
+
+    out_Color = vec4(ambientLight.xyz + diffuseLight.xyz + specularLight.xyz, color.w);
+}
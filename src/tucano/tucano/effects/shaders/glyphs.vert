@@ -0,0 +1,57 @@
+#version 150
+
+in vec4 in_Position;
+in vec3 in_Normal;
+
+in vec3 in_InstancePosition;
+in vec3 in_InstanceScale;
+in vec4 in_InstanceColor;
+in vec4 in_InstanceOrientation;
+
+out vec4 color;
+out vec3 normal;
+out vec4 vert;
+
+uniform mat4 modelMatrix;
+uniform mat3 normalMatrix;
+
+layout(std140) uniform FrameUniforms
+{
+    mat4 projectionMatrix;
+    mat4 viewMatrix;
+    mat4 lightViewMatrix;
+    mat4 viewportMatrix;
+    vec4 viewLightDirection;
+    vec4 viewport;
+};
+
+// if attribute in_InstanceOrientation exists or not
+uniform bool has_orientation;
+
+// rotates v by the unit quaternion q = (x,y,z,w)
+vec3 rotate(vec4 q, vec3 v)
+{
+    return v + 2.0 * cross(q.xyz, cross(q.xyz, v) + q.w * v);
+}
+
+void main(void)
+{
+    vec3 position = in_InstanceScale * in_Position.xyz;
+    vec3 glyph_normal = in_Normal / in_InstanceScale;
+
+    if (has_orientation)
+    {
+        position = rotate(in_InstanceOrientation, position);
+        glyph_normal = rotate(in_InstanceOrientation, glyph_normal);
+    }
+
+    position += in_InstancePosition;
+
+    normal = normalize(normalMatrix * glyph_normal);
+
+    vert = viewMatrix * modelMatrix * vec4(position, 1.0);
+
+    gl_Position = projectionMatrix * vert;
+
+    color = in_InstanceColor;
+}
@@ -9,8 +9,16 @@ in float depth;
 
 out vec4 out_Color;
 
-uniform mat4 lightViewMatrix;
-uniform mat4 viewMatrix;
+layout(std140) uniform FrameUniforms
+{
+    mat4 projectionMatrix;
+    mat4 viewMatrix;
+    mat4 lightViewMatrix;
+    mat4 viewportMatrix;
+    vec4 viewLightDirection;
+    vec4 viewport;
+};
+
 uniform float ka;
 uniform float kd;
 uniform float ks;
@@ -27,8 +35,7 @@ void main(void)
         model_color = texture(model_texture, texCoords);
     }
 
-    vec3 lightDirection = (viewMatrix * inverse(lightViewMatrix) * vec4(0.0, 0.0, 1.0, 0.0)).xyz;
-    lightDirection = normalize(lightDirection);
+    vec3 lightDirection = normalize(viewLightDirection.xyz);
 
     vec3 lightReflection = reflect(-lightDirection, normal);
 
@@ -0,0 +1,10 @@
+#version 150
+
+uniform vec4 highlight_color;
+
+out vec4 out_Color;
+
+void main(void)
+{
+    out_Color = highlight_color;
+}
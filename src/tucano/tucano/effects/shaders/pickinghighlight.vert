@@ -0,0 +1,26 @@
+#version 150
+
+in vec4 in_Position;
+
+uniform mat4 modelMatrix;
+
+layout(std140) uniform FrameUniforms
+{
+    mat4 projectionMatrix;
+    mat4 viewMatrix;
+    mat4 lightViewMatrix;
+    mat4 viewportMatrix;
+    vec4 viewLightDirection;
+    vec4 viewport;
+};
+
+// decoding of quantized positions (see Mesh::setDecodingUniforms)
+uniform vec3 position_scale;
+uniform vec3 position_offset;
+
+void main(void)
+{
+    vec4 position = vec4(in_Position.xyz * position_scale + position_offset, in_Position.w);
+
+	gl_Position = projectionMatrix * viewMatrix * modelMatrix * position;
+}
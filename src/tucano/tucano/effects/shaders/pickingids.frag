@@ -0,0 +1,14 @@
+#version 150
+
+// 0 is left for the background
+uniform int object_id;
+
+// index of the first primitive of the draw call in the mesh
+uniform int first_primitive;
+
+out uvec2 out_Id;
+
+void main(void)
+{
+    out_Id = uvec2(uint(object_id), uint(first_primitive + gl_PrimitiveID));
+}
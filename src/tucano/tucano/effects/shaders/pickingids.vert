@@ -0,0 +1,20 @@
+#version 150
+
+in vec4 in_Position;
+
+uniform mat4 modelMatrix;
+uniform mat4 viewMatrix;
+
+// narrowed to the few pixels around the cursor (see Picking::regionProjection)
+uniform mat4 projectionMatrix;
+
+// decoding of quantized positions (see Mesh::setDecodingUniforms)
+uniform vec3 position_scale;
+uniform vec3 position_offset;
+
+void main(void)
+{
+    vec4 position = vec4(in_Position.xyz * position_scale + position_offset, in_Position.w);
+
+	gl_Position = projectionMatrix * viewMatrix * modelMatrix * position;
+}
@@ -0,0 +1,60 @@
+#version 150
+
+in vec4 color;
+in vec3 quad_position;
+flat in vec3 sphere_center;
+flat in float sphere_radius;
+
+out vec4 out_Color;
+
+layout(std140) uniform FrameUniforms
+{
+    mat4 projectionMatrix;
+    mat4 viewMatrix;
+    mat4 lightViewMatrix;
+    mat4 viewportMatrix;
+    vec4 viewLightDirection;
+    vec4 viewport;
+};
+
+uniform float ka;
+uniform float kd;
+uniform float ks;
+uniform float shininess;
+
+void main(void)
+{
+    // view ray through the fragment: from the eye, or along -z for orthographic cameras
+    vec3 origin = vec3(0.0);
+    vec3 direction = normalize(quad_position);
+    if (projectionMatrix[3][3] != 0.0)
+    {
+        origin = vec3(quad_position.xy, 0.0);
+        direction = vec3(0.0, 0.0, -1.0);
+    }
+
+    // nearest intersection with the sphere
+    vec3 oc = origin - sphere_center;
+    float b = dot(direction, oc);
+    float disc = b*b - dot(oc, oc) + sphere_radius*sphere_radius;
+    if (disc < 0.0)
+        discard;
+
+    vec3 vert = origin + (-b - sqrt(disc)) * direction;
+    vec3 normal = (vert - sphere_center) / sphere_radius;
+
+    vec4 clip = projectionMatrix * vec4(vert, 1.0);
+    gl_FragDepth = 0.5 * (clip.z / clip.w) + 0.5;
+
+    vec3 lightDirection = normalize(viewLightDirection.xyz);
+
+    vec3 lightReflection = reflect(-lightDirection, normal);
+
+    vec3 eyeDirection = -direction;
+
+    vec4 ambientLight = color * ka;
+    vec4 diffuseLight = color * kd * max(dot(lightDirection, normal),0.0);
+    vec4 specularLight = vec4(vec3(ks), 1.0) *  max(pow(dot(lightReflection, eyeDirection), shininess),0.0);
+
+    out_Color = vec4(ambientLight.xyz + diffuseLight.xyz + specularLight.xyz, color.w);
+}
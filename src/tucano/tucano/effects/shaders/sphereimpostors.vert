@@ -0,0 +1,50 @@
+#version 150
+
+in vec4 in_Position;
+in vec4 in_Color;
+in float in_Radius;
+
+out vec4 vert_color;
+out float vert_radius;
+
+uniform mat4 modelMatrix;
+
+layout(std140) uniform FrameUniforms
+{
+    mat4 projectionMatrix;
+    mat4 viewMatrix;
+    mat4 lightViewMatrix;
+    mat4 viewportMatrix;
+    vec4 viewLightDirection;
+    vec4 viewport;
+};
+
+uniform vec4 default_color;
+
+// if attribute in_Color exists or not
+uniform bool has_color;
+
+// if attribute in_Radius exists or not, radius is used otherwise
+uniform bool has_radius;
+uniform float radius;
+
+// decoding of quantized positions (see Mesh::setDecodingUniforms)
+uniform vec3 position_scale;
+uniform vec3 position_offset;
+
+void main(void)
+{
+    mat4 modelViewMatrix = viewMatrix * modelMatrix;
+
+    // sphere center in view space, the geometry shader builds the quad around it
+    vec4 position = vec4(in_Position.xyz * position_scale + position_offset, in_Position.w);
+    gl_Position = modelViewMatrix * position;
+
+    // object space radius scaled to view space (model matrices scale uniformly)
+    vert_radius = (has_radius ? in_Radius : radius) * length(modelViewMatrix[0].xyz);
+
+    if (has_color)
+        vert_color = in_Color;
+    else
+        vert_color = default_color;
+}
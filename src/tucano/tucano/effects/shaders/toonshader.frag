@@ -6,15 +6,22 @@ in vec4 vert;
 
 out vec4 out_Color;
 
-uniform mat4 lightViewMatrix;
-uniform mat4 viewMatrix;
+layout(std140) uniform FrameUniforms
+{
+    mat4 projectionMatrix;
+    mat4 viewMatrix;
+    mat4 lightViewMatrix;
+    mat4 viewportMatrix;
+    vec4 viewLightDirection;
+    vec4 viewport;
+};
+
 uniform float quantizationLevel;
 
 void main(void)
 {
 
-    vec3 lightDirection = (viewMatrix * inverse(lightViewMatrix) * vec4(0.0, 0.0, 1.0, 0.0)).xyz;
-    lightDirection = normalize(lightDirection);
+    vec3 lightDirection = normalize(viewLightDirection.xyz);
 
     vec3 lightReflection = reflect(-lightDirection, normal);
     vec3 eyeDirection = normalize(-vert.xyz);
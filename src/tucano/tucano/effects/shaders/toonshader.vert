@@ -9,22 +9,49 @@ out vec3 normal;
 out vec4 vert;
 
 uniform mat4 modelMatrix;
-uniform mat4 viewMatrix;
-uniform mat4 projectionMatrix;
+uniform mat3 normalMatrix;
+
+layout(std140) uniform FrameUniforms
+{
+    mat4 projectionMatrix;
+    mat4 viewMatrix;
+    mat4 lightViewMatrix;
+    mat4 viewportMatrix;
+    vec4 viewLightDirection;
+    vec4 viewport;
+};
 
 uniform bool has_color;
 uniform vec4 default_color;
 
+// decoding of quantized positions (see Mesh::setDecodingUniforms)
+uniform vec3 position_scale;
+uniform vec3 position_offset;
+
+// in_Normal.xy holds octahedral coordinates
+uniform bool octahedral_normals;
+
+vec3 decodeNormal(vec3 n)
+{
+    if (!octahedral_normals)
+        return n;
+
+    vec3 v = vec3(n.xy, 1.0 - abs(n.x) - abs(n.y));
+    if (v.z < 0.0)
+        v.xy = (1.0 - abs(v.yx)) * vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+    return normalize(v);
+}
+
 void main(void)
 {
     mat4 modelViewMatrix = viewMatrix*modelMatrix;
+    vec4 position = vec4(in_Position.xyz * position_scale + position_offset, in_Position.w);
 
-    mat4 normalMatrix = transpose(inverse(modelViewMatrix));
-    normal = normalize(vec3(normalMatrix * vec4(in_Normal.xyz,0.0)).xyz);
+    normal = normalize(normalMatrix * decodeNormal(in_Normal.xyz));
 
-    vert = modelViewMatrix * in_Position;
+    vert = modelViewMatrix * position;
 
-    gl_Position = (projectionMatrix * modelViewMatrix) * in_Position;
+    gl_Position = (projectionMatrix * modelViewMatrix) * position;
 
     if (has_color)
         color = in_Color;
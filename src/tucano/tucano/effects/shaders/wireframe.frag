@@ -10,8 +10,16 @@ noperspective in vec3 edge_dist;
 
 out vec4 out_Color;
 
-uniform mat4 viewMatrix;
-uniform mat4 lightViewMatrix;
+layout(std140) uniform FrameUniforms
+{
+    mat4 projectionMatrix;
+    mat4 viewMatrix;
+    mat4 lightViewMatrix;
+    mat4 viewportMatrix;
+    vec4 viewLightDirection;
+    vec4 viewport;
+};
+
 uniform float thickness;
 uniform vec4 line_color;
 //const float ka;
@@ -26,7 +34,7 @@ void main(void)
     //float edge_intensity = exp2(-1.0*min_dist*min_dist);
 
     // vec3 lightDirection = normalize((lightViewMatrix * vec4(0.0, 0.0, 1.0, 0.0)).xyz);
-    vec3 lightDirection = (viewMatrix * inverse(lightViewMatrix) * vec4(0.0, 0.0, 1.0, 0.0)).xyz;
+    vec3 lightDirection = viewLightDirection.xyz;
 
     vec4 diffuse_color = color * max(dot(lightDirection, normal),0.0);
 
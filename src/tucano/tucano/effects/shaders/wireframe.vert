@@ -14,6 +14,24 @@ uniform vec4 default_color;
 // if attribute in_Color exists or not
 uniform bool has_color;
 
+// decoding of quantized positions (see Mesh::setDecodingUniforms)
+uniform vec3 position_scale;
+uniform vec3 position_offset;
+
+// in_Normal.xy holds octahedral coordinates
+uniform bool octahedral_normals;
+
+vec3 decodeNormal(vec3 n)
+{
+    if (!octahedral_normals)
+        return n;
+
+    vec3 v = vec3(n.xy, 1.0 - abs(n.x) - abs(n.y));
+    if (v.z < 0.0)
+        v.xy = (1.0 - abs(v.yx)) * vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+    return normalize(v);
+}
+
 void main(void)
 {
     if (has_color)
@@ -21,8 +39,8 @@ void main(void)
     else
         vert_color = default_color;
 
-    vert_normal = in_Normal;
+    vert_normal = decodeNormal(in_Normal);
     vert_texcoords = in_TexCoords;
-	gl_Position = in_Position;
+	gl_Position = vec4(in_Position.xyz * position_scale + position_offset, in_Position.w);
 
 }
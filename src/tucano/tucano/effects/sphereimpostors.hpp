@@ -0,0 +1,191 @@
+/**
+ * Tucano - A library for rapid prototying with Modern OpenGL and GLSL
+ * Copyright (C) 2014
+ * LCG - Laboratório de Computação Gráfica (Computer Graphics Lab) - COPPE
+ * UFRJ - Federal University of Rio de Janeiro
+ *
+ * This file is part of Tucano Library.
+ *
+ * Tucano Library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Tucano Library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Tucano Library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __SPHEREIMPOSTORS__
+#define __SPHEREIMPOSTORS__
+
+#include <tucano/effect.hpp>
+#include <tucano/camera.hpp>
+#include <tucano/mesh.hpp>
+
+namespace Tucano
+{
+namespace Effects
+{
+
+/**
+ * @brief Renders the vertices of a mesh as spheres, ray-cast on camera facing quads.
+ *
+ * Each vertex is expanded by a geometry shader into a quad covering the sphere's silhouette, and the
+ * fragment shader intersects the view ray with the sphere, writing its exact depth and Phong shading.
+ * Sphere radii come from the in_Radius attribute if the mesh has one, or from a single radius given to
+ * renderMesh otherwise.  Radii are in object space, so they follow the model matrix scale.
+ */
+class SphereImpostors : public Tucano::Effect
+{
+
+private:
+
+    /// Sphere impostors shader
+    Tucano::Shader impostors_shader;
+
+    /// Ambient coefficient
+    float ka = 0.5;
+
+    /// Diffuse coefficient
+    float kd = 0.8;
+
+    /// Specular coefficient
+    float ks = 0.5;
+
+    /// Shininess
+    float shininess = 10;
+
+public:
+
+    /**
+     * @brief Default constructor.
+     */
+    SphereImpostors (void)
+    {}
+
+    /**
+     * @brief Load and initialize shaders
+     */
+    virtual void initialize (void)
+    {
+        loadShader(impostors_shader, "sphereimpostors") ;
+    }
+
+    /**
+    * @brief Set ambient coefficient
+    * @param value New ambient coeff (ka)
+    */
+    void setAmbientCoeff (float value)
+    {
+        ka = value;
+    }
+
+    /**
+    * @brief Set diffuse coefficient
+    * @param value New diffuse coeff (kd)
+    */
+    void setDiffuseCoeff (float value)
+    {
+        kd = value;
+    }
+
+    /**
+    * @brief Set specular coefficient
+    * @param New specular coeff (ks)
+    */
+    void setSpecularCoeff (float value)
+    {
+        ks = value;
+    }
+
+    /**
+    * @brief Set shininess exponent
+    * @param New shininess coeff (shininess)
+    */
+    void setShininessCoeff (float value)
+    {
+        shininess = value;
+    }
+
+    float getDiffuseCoeff (void ) {return kd;}
+    float getAmbientCoeff (void ) {return ka;}
+    float getSpecularCoeff (void ) {return ks;}
+    float getShininessCoeff (void ) {return shininess;}
+
+    /**
+     * @brief Binds the impostors shader and sets the uniforms shared by all meshes.
+     * @param camera Given camera
+     * @param lightTrackball Given light camera
+     */
+    void beginRender (const Tucano::Camera& camera, const Tucano::Camera& lightTrackball)
+    {
+        GLStateCache::Instance().viewport(camera.getViewport());
+
+        updateFrameUniforms(camera, lightTrackball);
+
+        impostors_shader.bind();
+
+        impostors_shader.setUniform("ka", ka);
+        impostors_shader.setUniform("kd", kd);
+        impostors_shader.setUniform("ks", ks);
+        impostors_shader.setUniform("shininess", shininess);
+
+        GLStateCache::Instance().enable(GL_DEPTH_TEST);
+    }
+
+    /**
+     * @brief Renders the vertices of a mesh as spheres between beginRender and endRender.
+     * @param mesh Given mesh
+     * @param radius Sphere radius, used if the mesh has no in_Radius attribute
+     */
+    void renderMesh (Tucano::Mesh& mesh, float radius)
+    {
+        impostors_shader.setUniform("modelMatrix", mesh.getShapeModelMatrix());
+        impostors_shader.setUniform("has_color", mesh.hasAttribute("in_Color"));
+        impostors_shader.setUniform("default_color", mesh.getColor());
+        impostors_shader.setUniform("has_radius", mesh.hasAttribute("in_Radius"));
+        impostors_shader.setUniform("radius", radius);
+
+        mesh.setDecodingUniforms(impostors_shader);
+        mesh.setAttributeLocation(impostors_shader);
+
+        // one sphere per vertex, whatever the mesh primitives are
+        mesh.bindBuffers();
+        mesh.drawArrays(GL_POINTS);
+        mesh.unbindBuffers();
+        GLStateCache::Instance().countDrawCall();
+    }
+
+    /**
+     * @brief Unbinds the impostors shader after rendering a sequence of meshes.
+     */
+    void endRender (void)
+    {
+        impostors_shader.unbind();
+    }
+
+    /**
+     * @brief Render the vertices of the mesh as spheres given a camera and light
+     * @param mesh Given mesh
+     * @param camera Given camera
+     * @param lightTrackball Given light camera
+     * @param radius Sphere radius, used if the mesh has no in_Radius attribute
+     */
+    void render (Tucano::Mesh& mesh, const Tucano::Camera& camera, const Tucano::Camera& lightTrackball, float radius)
+    {
+        beginRender(camera, lightTrackball);
+        renderMesh(mesh, radius);
+        endRender();
+    }
+
+};
+}
+}
+
+
+#endif
@@ -45,6 +45,9 @@ private:
     /// Number of colors that will be used in color quantization to create the toonish effect.
     float quantization_level = 8;
 
+    /// View matrix of the camera set in beginRender
+    Eigen::Affine3f view_matrix = Eigen::Affine3f::Identity();
+
 public:
 
 	/**
@@ -80,31 +83,59 @@ public:
 	}
 
     /**
-     * @brief Render the mesh given a camera and light trackball, using a Toon shader
-     * @param mesh Given mesh
+     * @brief Binds the Toon shader and sets the uniforms shared by all meshes.
+     *
+     * Call renderMesh for each mesh and endRender at the end, so the shader is bound only once.
      * @param cameraTrackball Given camera trackball
      * @param lightTrackball Given light trackball
      */
-    virtual void render (Tucano::Mesh& mesh, const Tucano::Camera& cameraTrackball, const Tucano::Camera& lightTrackball)
-	{       
+    void beginRender (const Tucano::Camera& cameraTrackball, const Tucano::Camera& lightTrackball)
+    {
+        GLStateCache::Instance().viewport(cameraTrackball.getViewport());
 
-        Eigen::Vector4f viewport = cameraTrackball.getViewport();
-        glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+        updateFrameUniforms(cameraTrackball, lightTrackball);
+        view_matrix = cameraTrackball.getViewMatrix();
 
         toon_shader.bind();
 
-        toon_shader.setUniform("projectionMatrix", cameraTrackball.getProjectionMatrix());
+        toon_shader.setUniform("quantizationLevel", quantization_level);
+    }
+
+    /**
+     * @brief Renders a mesh between beginRender and endRender, setting only its own uniforms.
+     * @param mesh Given mesh
+     */
+    void renderMesh (Tucano::Mesh& mesh)
+    {
         toon_shader.setUniform("modelMatrix", mesh.getShapeModelMatrix());
-        toon_shader.setUniform("viewMatrix", cameraTrackball.getViewMatrix());
-        toon_shader.setUniform("lightViewMatrix", lightTrackball.getViewMatrix());
+        toon_shader.setUniform("normalMatrix", computeNormalMatrix(view_matrix, mesh.getShapeModelMatrix()));
         toon_shader.setUniform("has_color", mesh.hasAttribute("in_Color"));
         toon_shader.setUniform("default_color", mesh.getColor());
-        toon_shader.setUniform("quantizationLevel", quantization_level);
 
+        mesh.setDecodingUniforms(toon_shader);
         mesh.setAttributeLocation(toon_shader);
 		mesh.render();
+    }
 
+    /**
+     * @brief Unbinds the Toon shader after rendering a sequence of meshes.
+     */
+    void endRender (void)
+    {
         toon_shader.unbind();
+    }
+
+    /**
+     * @brief Render the mesh given a camera and light trackball, using a Toon shader
+     * @param mesh Given mesh
+     * @param cameraTrackball Given camera trackball
+     * @param lightTrackball Given light trackball
+     */
+    virtual void render (Tucano::Mesh& mesh, const Tucano::Camera& cameraTrackball, const Tucano::Camera& lightTrackball)
+	{       
+        beginRender(cameraTrackball, lightTrackball);
+        renderMesh(mesh);
+        endRender();
 	}
 };
 }
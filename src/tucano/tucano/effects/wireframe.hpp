@@ -52,6 +52,9 @@ private:
     /// Flag to draw faces
     bool draw_faces = true;
 
+    /// View matrix of the camera set in beginRender
+    Eigen::Affine3f view_matrix = Eigen::Affine3f::Identity();
+
 public:
 
     /**
@@ -87,46 +90,66 @@ public:
     }
 
 
-    /** 
-     * @brief Render the mesh given a camera and light, using a Wireframe shader 
-     * @param mesh Given mesh
-     * @param camera Given camera 
-     * @param lightTrackball Given light camera 
+    /**
+     * @brief Binds the Wireframe shader and sets the uniforms shared by all meshes.
+     *
+     * Call renderMesh for each mesh and endRender at the end, so the shader is bound only once.
+     * @param camera Given camera
+     * @param lightTrackball Given light camera
      */
-    void render (Tucano::Mesh& mesh, const Tucano::Camera& camera, const Tucano::Camera& lightTrackball)
+    void beginRender (const Tucano::Camera& camera, const Tucano::Camera& lightTrackball)
     {
+        GLStateCache::Instance().viewport(camera.getViewport());
 
-        Eigen::Vector4f viewport = camera.getViewport();
-        glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+        // camera, viewport and light matrices go through the per-frame uniform block
+        updateFrameUniforms(camera, lightTrackball);
+        view_matrix = camera.getViewMatrix();
 
         wireframe_shader.bind();
 
-        Eigen::Matrix4f viewportMatrix; 
-        viewportMatrix <<
-                (viewport[2]-viewport[0])/2.0f,                            .0f,  .0f, (viewport[2]+viewport[0])/2.0,
-                                           .0f, (viewport[3]-viewport[1])/2.0f,  .0f, (viewport[3]+viewport[1])/2.0,
-                                           .0f,                            .0f, 1.0f,                          1.0f,
-                                           .0f,                            .0f,  .0f,                          1.0f;
+		wireframe_shader.setUniform("line_color", line_color);
+        wireframe_shader.setUniform("thickness", thickness);
+    }
 
-        // sets all uniform variables for the wireframe shader
-        wireframe_shader.setUniform("projectionMatrix", camera.getProjectionMatrix());
+    /**
+     * @brief Renders a mesh between beginRender and endRender, setting only its own uniforms.
+     * @param mesh Given mesh
+     */
+    void renderMesh (Tucano::Mesh& mesh)
+    {
+        // sets all per-object uniform variables for the wireframe shader
         wireframe_shader.setUniform("modelMatrix", mesh.getShapeModelMatrix());
-        wireframe_shader.setUniform("viewMatrix", camera.getViewMatrix());
-        wireframe_shader.setUniform("lightViewMatrix", lightTrackball.getViewMatrix());
-        wireframe_shader.setUniform("viewportMatrix", viewportMatrix);
+        wireframe_shader.setUniform("normalMatrix", computeNormalMatrix(view_matrix, mesh.getShapeModelMatrix()));
         wireframe_shader.setUniform("has_color", mesh.hasAttribute("in_Color"));
 		wireframe_shader.setUniform("default_color", mesh.getColor());
-		wireframe_shader.setUniform("line_color", line_color);
-        wireframe_shader.setUniform("thickness", thickness);
 
         /* Tucano::Misc::errorCheckFunc(__FILE__, __LINE__); */
+        mesh.setDecodingUniforms(wireframe_shader);
         mesh.setAttributeLocation(wireframe_shader);
 
         mesh.render();
+    }
 
+    /**
+     * @brief Unbinds the Wireframe shader after rendering a sequence of meshes.
+     */
+    void endRender (void)
+    {
         wireframe_shader.unbind();
     }
 
+    /** 
+     * @brief Render the mesh given a camera and light, using a Wireframe shader 
+     * @param mesh Given mesh
+     * @param camera Given camera 
+     * @param lightTrackball Given light camera 
+     */
+    void render (Tucano::Mesh& mesh, const Tucano::Camera& camera, const Tucano::Camera& lightTrackball)
+    {
+        beginRender(camera, lightTrackball);
+        renderMesh(mesh);
+        endRender();
+    }
 
 };
 }
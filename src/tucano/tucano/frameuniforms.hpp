@@ -0,0 +1,161 @@
+/**
+ * Tucano - A library for rapid prototying with Modern OpenGL and GLSL
+ * Copyright (C) 2014
+ * LCG - Laboratório de Computação Gráfica (Computer Graphics Lab) - COPPE
+ * UFRJ - Federal University of Rio de Janeiro
+ *
+ * This file is part of Tucano Library.
+ *
+ * Tucano Library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Tucano Library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Tucano Library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __FRAMEUNIFORMS__
+#define __FRAMEUNIFORMS__
+
+#include <tucano/bufferobject.hpp>
+#include <tucano/camera.hpp>
+#include <Eigen/Dense>
+#include <memory>
+
+namespace Tucano
+{
+
+/**
+ * @brief Per-frame camera and light uniforms, stored in an uniform buffer shared by several shaders.
+ *
+ * Shaders declare the block as:
+ *
+ *     layout(std140) uniform FrameUniforms
+ *     {
+ *         mat4 projectionMatrix;
+ *         mat4 viewMatrix;
+ *         mat4 lightViewMatrix;
+ *         mat4 viewportMatrix;
+ *         vec4 viewLightDirection;
+ *         vec4 viewport;
+ *     };
+ *
+ * where viewLightDirection is the direction of the light in camera space.
+ * Updating the block once per frame replaces setting these uniforms for every rendered object.
+ */
+class FrameUniforms
+{
+
+private:
+
+    /// Number of floats in the block: four mat4 and two vec4, all of them 16 bytes aligned in std140
+    static const int block_size = 4*16 + 2*4;
+
+    /// Uniform buffer holding the block, created with the first update
+    std::shared_ptr < UniformBufferFloat > buffer;
+
+    /// CPU copy of the block
+    GLfloat data[block_size];
+
+public:
+
+    /**
+     * @brief Name of the uniform block in the shaders.
+     * @return Block name.
+     */
+    static const char* blockName (void)
+    {
+        return "FrameUniforms";
+    }
+
+    /**
+     * @brief Uniform buffer binding point used by the block.
+     * @return Binding point.
+     */
+    static GLuint bindingPoint (void)
+    {
+        return 0;
+    }
+
+    /**
+     * @brief Default constructor.
+     */
+    FrameUniforms (void)
+    {
+        std::fill(data, data + block_size, 0.0f);
+    }
+
+    /**
+     * @brief Uploads the camera and light matrices and binds the buffer to its binding point.
+     * @param camera Given camera
+     * @param light Given light camera, its view matrix defines the light direction
+     */
+    void update (const Tucano::Camera& camera, const Tucano::Camera& light)
+    {
+        setLight(light, camera.getViewMatrix());
+        update(camera);
+    }
+
+    /**
+     * @brief Uploads the camera matrices and binds the buffer to its binding point.
+     *
+     * The light part of the block is kept from the last update with a light.
+     * @param camera Given camera
+     */
+    void update (const Tucano::Camera& camera)
+    {
+        Eigen::Vector4f viewport = camera.getViewport();
+        Eigen::Matrix4f viewport_matrix;
+        viewport_matrix <<
+                (viewport[2]-viewport[0])/2.0f,                            .0f,  .0f, (viewport[2]+viewport[0])/2.0f,
+                                           .0f, (viewport[3]-viewport[1])/2.0f,  .0f, (viewport[3]+viewport[1])/2.0f,
+                                           .0f,                            .0f, 1.0f,                           1.0f,
+                                           .0f,                            .0f,  .0f,                           1.0f;
+
+        Eigen::Matrix4f::Map(data) = camera.getProjectionMatrix();
+        Eigen::Matrix4f::Map(data + 16) = camera.getViewMatrix().matrix();
+        Eigen::Matrix4f::Map(data + 48) = viewport_matrix;
+        Eigen::Vector4f::Map(data + 68) = viewport;
+
+        if (!buffer)
+            buffer = std::make_shared < UniformBufferFloat > (block_size);
+        buffer->update(data);
+        bind();
+    }
+
+    /**
+     * @brief Binds the buffer to the block binding point.
+     */
+    void bind (void)
+    {
+        if (buffer)
+            buffer->bindBase(bindingPoint());
+    }
+
+private:
+
+    /**
+     * @brief Fills the light part of the block.
+     * @param light Given light camera
+     * @param view_matrix View matrix of the camera, used to compute the light direction in camera space
+     */
+    void setLight (const Tucano::Camera& light, const Eigen::Affine3f& view_matrix)
+    {
+        Eigen::Affine3f light_view_matrix = light.getViewMatrix();
+        Eigen::Vector3f direction = (view_matrix * light_view_matrix.inverse()).linear() * Eigen::Vector3f(0.0, 0.0, 1.0);
+
+        Eigen::Matrix4f::Map(data + 32) = light_view_matrix.matrix();
+        Eigen::Vector4f::Map(data + 64) = Eigen::Vector4f(direction[0], direction[1], direction[2], 0.0);
+    }
+
+};
+
+}
+
+#endif
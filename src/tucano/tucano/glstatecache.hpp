@@ -0,0 +1,262 @@
+/**
+ * Tucano - A library for rapid prototying with Modern OpenGL and GLSL
+ * Copyright (C) 2014
+ * LCG - Laboratório de Computação Gráfica (Computer Graphics Lab) - COPPE
+ * UFRJ - Federal University of Rio de Janeiro
+ *
+ * This file is part of Tucano Library.
+ *
+ * Tucano Library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Tucano Library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Tucano Library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GLSTATECACHE__
+#define __GLSTATECACHE__
+
+#include <GL/glew.h>
+#include <Eigen/Dense>
+#include <vector>
+#include <utility>
+
+namespace Tucano
+{
+
+/**
+ * @brief Keeps track of the GL state set through Tucano, and skips calls that would not change it.
+ *
+ * Caching is only active between begin and end, since state changed by direct GL calls
+ * is not tracked. While inactive the calls go straight to GL. In both cases the number of
+ * state changes and draw calls is counted, so rendering costs can be inspected per frame.
+ *
+ * Like the TextureManager, there is a single instance, as Tucano assumes one current context.
+ */
+class GLStateCache {
+
+public:
+
+    /**
+     * @brief Returns the unique instance.
+     */
+    static GLStateCache &Instance (void)
+    {
+        static GLStateCache _instance;
+        return _instance;
+    }
+
+    /**
+     * @brief Starts caching. The current state is unknown, so the first call of each kind reaches GL.
+     */
+    void begin (void)
+    {
+        invalidate();
+        caching = true;
+    }
+
+    /**
+     * @brief Stops caching, applying any deferred program unbind.
+     */
+    void end (void)
+    {
+        if (pending_unbind)
+        {
+            glUseProgram(0);
+            ++state_changes;
+        }
+        invalidate();
+        caching = false;
+    }
+
+    /**
+     * @brief Forgets the cached state. Call it after changing GL state directly while caching.
+     */
+    void invalidate (void)
+    {
+        program_known = false;
+        pending_unbind = false;
+        viewport_known = false;
+        capabilities.clear();
+    }
+
+    /**
+     * @brief Binds a shader program.
+     *
+     * While caching, unbinding (program 0) is deferred, so binding the same program again
+     * right after, as when drawing a sequence of objects with the same shader, costs nothing.
+     * @param program Program handle, or 0 to unbind.
+     */
+    void useProgram (GLuint program)
+    {
+        if (!caching)
+        {
+            glUseProgram(program);
+            ++state_changes;
+            return;
+        }
+
+        if (program == 0)
+        {
+            pending_unbind = program_known && current_program != 0;
+            return;
+        }
+
+        pending_unbind = false;
+        if (program_known && current_program == program)
+        {
+            ++skipped_changes;
+            return;
+        }
+        glUseProgram(program);
+        current_program = program;
+        program_known = true;
+        ++state_changes;
+    }
+
+    /**
+     * @brief Sets the viewport.
+     * @param viewport Viewport as [minX, minY, width, height].
+     */
+    void viewport (const Eigen::Vector4f& viewport)
+    {
+        if (caching && viewport_known && current_viewport == viewport)
+        {
+            ++skipped_changes;
+            return;
+        }
+        glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+        current_viewport = viewport;
+        viewport_known = caching;
+        ++state_changes;
+    }
+
+    /**
+     * @brief Enables a server side capability, such as GL_DEPTH_TEST.
+     * @param cap Capability.
+     */
+    void enable (GLenum cap)
+    {
+        setCapability(cap, true);
+    }
+
+    /**
+     * @brief Disables a server side capability.
+     * @param cap Capability.
+     */
+    void disable (GLenum cap)
+    {
+        setCapability(cap, false);
+    }
+
+    /**
+     * @brief Counts one draw call. Called by the meshes when rendering.
+     */
+    void countDrawCall (void)
+    {
+        ++draw_calls;
+    }
+
+    /**
+     * @brief Resets the draw call and state change counters, usually at the beginning of a frame.
+     */
+    void resetCounters (void)
+    {
+        draw_calls = 0;
+        state_changes = 0;
+        skipped_changes = 0;
+    }
+
+    /**
+     * @brief Returns the number of draw calls since the last reset.
+     */
+    unsigned int getDrawCalls (void) const
+    {
+        return draw_calls;
+    }
+
+    /**
+     * @brief Returns the number of state changes sent to GL since the last reset.
+     */
+    unsigned int getStateChanges (void) const
+    {
+        return state_changes;
+    }
+
+    /**
+     * @brief Returns the number of redundant state changes skipped since the last reset.
+     */
+    unsigned int getSkippedStateChanges (void) const
+    {
+        return skipped_changes;
+    }
+
+private:
+
+    GLStateCache (void) {}
+    GLStateCache (const GLStateCache&) = delete;
+    GLStateCache& operator= (const GLStateCache&) = delete;
+
+    /**
+     * @brief Enables or disables a capability, skipping the call if it is already in that state.
+     * @param cap Capability.
+     * @param enabled New state.
+     */
+    void setCapability (GLenum cap, bool enabled)
+    {
+        if (caching)
+        {
+            for (auto &entry : capabilities)
+            {
+                if (entry.first == cap)
+                {
+                    if (entry.second == enabled)
+                    {
+                        ++skipped_changes;
+                        return;
+                    }
+                    entry.second = enabled;
+                    enabled ? glEnable(cap) : glDisable(cap);
+                    ++state_changes;
+                    return;
+                }
+            }
+            capabilities.emplace_back(cap, enabled);
+        }
+        enabled ? glEnable(cap) : glDisable(cap);
+        ++state_changes;
+    }
+
+    /// True between begin and end
+    bool caching = false;
+
+    /// Currently bound program, valid if program_known is true
+    GLuint current_program = 0;
+    bool program_known = false;
+
+    /// True if an unbind was requested while caching, and not yet applied
+    bool pending_unbind = false;
+
+    /// Current viewport, valid if viewport_known is true
+    Eigen::Vector4f current_viewport = Eigen::Vector4f::Zero();
+    bool viewport_known = false;
+
+    /// Known state of the capabilities set while caching (a handful at most)
+    std::vector< std::pair<GLenum, bool> > capabilities;
+
+    /// Counters
+    unsigned int draw_calls = 0;
+    unsigned int state_changes = 0;
+    unsigned int skipped_changes = 0;
+};
+
+}
+
+#endif
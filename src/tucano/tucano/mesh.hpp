@@ -25,7 +25,12 @@
 
 #include <tucano/model.hpp>
 #include <tucano/shader.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <map>
 #include <memory>
+#include <numeric>
 
 
 using ulong = unsigned long int;
@@ -62,6 +67,14 @@ public:
     GLenum type = GL_FLOAT;
     /// Type of attribute array (GL_ARRAY_BUFFER for most cases), indices are GL_ELEMENT_ARRAY_BUFFER
     GLenum array_type = GL_ARRAY_BUFFER;
+    /// Byte distance between consecutive values when the buffer is shared with other attributes (0 means tightly packed)
+    GLsizei stride = 0;
+    /// Byte offset of the first value inside the buffer
+    GLintptr offset = 0;
+    /// Number of instances sharing each value (0 for per-vertex attributes)
+    GLuint divisor = 0;
+    /// Integer values are mapped to [0,1] (unsigned) or [-1,1] (signed) when fetched by the shader
+    bool normalized = false;
 
     std::shared_ptr < GLuint > bufferID_sptr;
 
@@ -92,7 +105,7 @@ public:
      * @brief Returns the name of the attribute
      * @return Attribute's name
      */
-    string getName (void) const {return name;}
+    const string& getName (void) const {return name;}
 
     /**
      * @brief Returns the number of elements of this attribute (usually number of vertices in VAO)
@@ -170,6 +183,77 @@ public:
      */
     GLuint getBufferID (void) {return *bufferID_sptr;}
 
+    /**
+     * @brief Returns the byte distance between consecutive values of the attribute.
+     * @return Stride in bytes, or 0 if the attribute owns a tightly packed buffer
+     */
+    GLsizei getStride (void) const {return stride;}
+
+    /**
+     * @brief Returns the byte offset of the attribute's first value inside its buffer.
+     * @return Offset in bytes
+     */
+    GLintptr getOffset (void) const {return offset;}
+
+    /**
+     * @brief Returns whether the attribute shares an interleaved buffer with other attributes.
+     * @return True if interleaved, false otherwise
+     */
+    bool isInterleaved (void) const {return stride != 0;}
+
+    /**
+     * @brief Returns the number of instances that share each value of the attribute.
+     * @return Divisor, 0 if the attribute advances per vertex
+     */
+    GLuint getDivisor (void) const {return divisor;}
+
+    /**
+     * @brief Makes the attribute advance once every div instances instead of once per vertex.
+     * @param div Divisor, 0 for a per-vertex attribute
+     */
+    void setDivisor (GLuint div) {divisor = div;}
+
+    /**
+     * @brief Returns whether integer values reach the shader normalized to [0,1] or [-1,1].
+     * @return True if the values are normalized, false if converted as they are
+     */
+    bool isNormalized (void) const {return normalized;}
+
+    /**
+     * @brief Sets whether integer values reach the shader normalized to [0,1] or [-1,1].
+     * @param norm True to normalize the values, has no effect on float attributes
+     */
+    void setNormalized (bool norm) {normalized = norm;}
+
+    /**
+     * @brief Returns the size in bytes of one value of the attribute (ex. 12 for a vec3)
+     * @return Size of one value in bytes
+     */
+    uint getElementBytes (void) const {return element_size*getTypeSize();}
+
+    /**
+     * @brief Makes the attribute read its values from a buffer shared with other attributes.
+     * @param buffer_sptr Shared pointer to the interleaved buffer
+     * @param byte_stride Byte distance between consecutive values
+     * @param byte_offset Byte offset of the first value
+     */
+    void setInterleavedBuffer (const std::shared_ptr < GLuint > &buffer_sptr, GLsizei byte_stride, GLintptr byte_offset)
+    {
+        bufferID_sptr = buffer_sptr;
+        bufferID = *buffer_sptr;
+        stride = byte_stride;
+        offset = byte_offset;
+    }
+
+    /**
+     * @brief Makes the attribute own a new tightly packed buffer.
+     * @param buffer_sptr Shared pointer to the attribute's own buffer
+     */
+    void setSeparateBuffer (const std::shared_ptr < GLuint > &buffer_sptr)
+    {
+        setInterleavedBuffer(buffer_sptr, 0, 0);
+    }
+
     /// Bind the attribute
     void bind(void)
     {
@@ -189,8 +273,12 @@ public:
         if (location != -1)
         {
             glBindBuffer(array_type, *bufferID_sptr);
-            glVertexAttribPointer(location, element_size, type, GL_FALSE, 0, NULL);
+            glVertexAttribPointer(location, element_size, type, normalized ? GL_TRUE : GL_FALSE, stride, (GLvoid*)offset);
             glEnableVertexAttribArray(location);
+            if (divisor != 0)
+            {
+                glVertexAttribDivisor(location, divisor);
+            }
         }
     }
 
@@ -214,14 +302,23 @@ public:
     /** 
      * @brief Maps a range in the buffer so application can change its contents. The mapped range is write-only and the vertex
      * attribute must be bind() beforehand.
-     * @param offset is the offset in the buffer where the mapped range starts (in element units).
+     *
+     * If the attribute is interleaved, the returned pointer addresses its first value in the range and consecutive
+     * values are getStride() bytes apart; other attributes' values in the range are left untouched.
+     * @param first is the offset in the buffer where the mapped range starts (in element units).
      * @param length is the lenght of the mapped range (in element units).
      * @returns a pointer to the mapped buffer range. float* is used in order to unify return type.
      */
-    float* map( unsigned int offset, unsigned int length )
+    float* map( unsigned int first, unsigned int length )
     {
+        if ( isInterleaved() )
+        {
+            char* ptr = ( char * ) glMapBufferRange( array_type, first * stride, length * stride, GL_MAP_WRITE_BIT );
+            return ( ptr == nullptr ) ? nullptr : ( float * ) ( ptr + offset );
+        }
+
         int typeSize = getTypeSize();
-        float* ptr = ( float * ) glMapBufferRange( array_type, offset * typeSize * element_size ,
+        float* ptr = ( float * ) glMapBufferRange( array_type, first * typeSize * element_size ,
                                                    length * typeSize * element_size,
                                              GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT );
         return ptr;
@@ -257,12 +354,24 @@ public:
         PATCH = GL_PATCHES
     };
 
+    /// How vertex attributes are laid out in GL buffers
+    enum VertexLayout
+    {
+        /// One buffer per attribute
+        SEPARATE,
+        /// All attributes in a single buffer, one stride/offset per attribute
+        INTERLEAVED
+    };
+
 
 protected:
 
     ///Array of generic attributes
     vector < Tucano::VertexAttribute > vertex_attributes;
 
+    ///Attributes put aside by reset(true), their buffers are reused by a reload with the same layout
+    vector < Tucano::VertexAttribute > spare_attributes;
+
     ///Number of vertices in vertices array.
     unsigned int numberOfVertices = 0;
 
@@ -272,12 +381,21 @@ protected:
     ///Number of indices in indices array
     unsigned int numberOfElements = 0;
 
+    ///Number of indices the index buffer storage was allocated for
+    unsigned int numberOfAllocatedElements = 0;
+
+    ///Index buffer storage put aside by reset(true), rewritten in place by a reload with as many indices
+    unsigned int numberOfSpareElements = 0;
+
     ///Number of texture coordinates in texCoords array.
     unsigned int numberOfTexCoords = 0;
 
     ///Number of colors in colors array.
     unsigned int numberOfColors = 0;
 
+    ///Number of instances drawn per render call (0 draws the mesh once, without instancing).
+    unsigned int numberOfInstances = 0;
+
     /// Index Buffer
     GLuint index_buffer_id = 0;
 
@@ -295,6 +413,32 @@ protected:
 
     PrimitiveType primitiveType = TRIANGLE;
 
+    /// Selected vertex attribute layout
+    VertexLayout vertexLayout = SEPARATE;
+
+    /// True when the buffers no longer match the selected layout (ex. an attribute was loaded after interleaving)
+    bool vertexLayoutDirty = false;
+
+    /// Extent of the box quantized positions are relative to, see quantizePositions()
+    Eigen::Vector3f position_scale = Eigen::Vector3f::Ones();
+
+    /// Corner of the box quantized positions are relative to
+    Eigen::Vector3f position_offset = Eigen::Vector3f::Zero();
+
+    /// Index buffer with the triangles of every coarser level of detail, one level after the other
+    std::shared_ptr < GLuint > lod_buffer_sptr;
+
+    /// Number of indices of each coarser level of detail in lod_buffer_sptr
+    vector < size_t > lod_sizes;
+
+    /// Level of detail drawn, 0 for the index buffer itself
+    unsigned int lod_level = 0;
+
+    /// Ranges of the index buffer drawn instead of all of it, see setDrawRanges()
+    vector < GLsizei > draw_counts;
+    vector < const GLvoid* > draw_offsets;
+    bool draw_ranges = false;
+
 public:
 
     /**
@@ -409,6 +553,33 @@ public:
         return numberOfVertices;
     }
 
+    /**
+     * @brief Returns the number of instances drawn by each render call.
+     * @return Number of instances, 0 if the mesh has no instance attributes.
+     */
+    int getNumberOfInstances (void)
+    {
+        return numberOfInstances;
+    }
+
+    /**
+     * @brief Returns the primitive drawn by the mesh.
+     * @return Primitive type selected with selectPrimitive().
+     */
+    PrimitiveType getPrimitive (void) const
+    {
+        return primitiveType;
+    }
+
+    /**
+     * @brief Returns the vertex attributes of the mesh.
+     * @return Attributes in loading order.
+     */
+    const vector < Tucano::VertexAttribute >& getAttributes (void) const
+    {
+        return vertex_attributes;
+    }
+
     /**
      * @brief Resets all vertex attributes locations to -1.
      */
@@ -420,13 +591,42 @@ public:
         }
     }
 
-    void reset (void)
+    /**
+     * @brief Resets the mesh attributes and matrices.
+     * @param keep_buffers If true, attributes are put aside so that a subsequent load of an attribute with
+     * the same name and layout rewrites the existing GL buffer instead of allocating a new one.
+     * Call releaseSpareAttributes() once loading is done to free the ones that were not reused.
+     * Either way the mesh is left as a new one: no elements, no attributes and triangle primitives.
+     */
+    void reset (bool keep_buffers = false)
     {
         for (unsigned int i = 0; i < vertex_attributes.size(); ++i)
         {
             vertex_attributes[i].disable();
         }
+
+        spare_attributes.clear();
+        numberOfSpareElements = 0;
+        if (keep_buffers)
+        {
+            spare_attributes.swap(vertex_attributes);
+            numberOfSpareElements = numberOfAllocatedElements;
+        }
         vertex_attributes.clear();
+        primitiveType = TRIANGLE;
+        vertexLayout = SEPARATE;
+        vertexLayoutDirty = false;
+        numberOfVertices = 0;
+        numberOfNormals = 0;
+        numberOfElements = 0;
+        numberOfAllocatedElements = 0;
+        numberOfTexCoords = 0;
+        numberOfColors = 0;
+        numberOfInstances = 0;
+        position_scale = Eigen::Vector3f::Ones();
+        position_offset = Eigen::Vector3f::Zero();
+        clearLevelsOfDetail();
+        clearDrawRanges();
 
         /// Shape matrix holds information about intrinsic scaling of other affine transformation of the object
         shape_matrix = Eigen::Affine3f::Identity();
@@ -443,6 +643,9 @@ public:
         /// Radius of the mesh bounding sphere.
         radius = 1.0;
 
+        /// Object space bounding box.
+        bounding_box.setEmpty();
+
         /// The normalization scale factor, scales the model matrix to fit the model inside a unit cube.
         normalization_scale = 1.0;
 
@@ -450,6 +653,70 @@ public:
         default_color = Eigen::Vector4f (0.7, 0.7, 0.7, 1.0);
     }
 
+    /**
+     * @brief Selects how the vertex attributes are laid out in GL buffers.
+     *
+     * Attributes are always loaded into separate buffers; with INTERLEAVED they are packed into
+     * a single buffer the next time the mesh is bound (or when updateVertexLayout() is called).
+     * @param layout SEPARATE or INTERLEAVED
+     */
+    void setVertexLayout (VertexLayout layout)
+    {
+        vertexLayoutDirty = vertexLayoutDirty || (layout != vertexLayout);
+        vertexLayout = layout;
+    }
+
+    /**
+     * @brief Returns the selected vertex attribute layout.
+     * @return SEPARATE or INTERLEAVED
+     */
+    VertexLayout getVertexLayout (void) const
+    {
+        return vertexLayout;
+    }
+
+    /**
+     * @brief Rebuilds the GL buffers to match the selected layout, if needed.
+     *
+     * Attribute contents are read back from the GPU and repacked, which costs one readback
+     * per layout change; it is not done again while the layout is unchanged.
+     */
+    void updateVertexLayout (void)
+    {
+        if ( !vertexLayoutDirty )
+        {
+            return;
+        }
+
+        if ( vertexLayout == INTERLEAVED )
+        {
+            interleaveAttributes();
+        }
+        else
+        {
+            separateAttributes();
+        }
+
+        vertexLayoutDirty = false;
+    }
+
+    /**
+     * @brief Frees the buffers of attributes put aside by reset(true) and not reused since,
+     * and the index buffer storage if no indices were loaded since.
+     */
+    void releaseSpareAttributes (void)
+    {
+        spare_attributes.clear();
+
+        if (numberOfSpareElements > 0)
+        {
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, *index_buffer_sptr);
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, 0, NULL, GL_STATIC_DRAW);
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+            numberOfSpareElements = 0;
+        }
+    }
+
     /**
 	 * @brief Select the rendering primitive used when rendering this mesh.
 	 */
@@ -520,9 +787,13 @@ protected:
     {
         float xMax = 0; float xMin = 0; float yMax = 0; float yMin = 0; float zMax = 0; float zMin = 0;
 
+        bounding_box.setEmpty();
+
         int temp = 0;
         for(unsigned int i = 0; i < numberOfVertices*4; i+=4) {
 
+            bounding_box.extend(vert[temp].head<3>());
+
             //X:
             if(vert[temp][0] > xMax) {
                 xMax = vert[temp][0];
@@ -581,37 +852,66 @@ protected:
      */
     void processVertices3(const vector<float> &vert)
     {
+        processVertices3(vert.data());
+    }
+
+    /**
+     * @brief Computes bounding box and centroid and normalization factors (normalization_scale).
+     * @param vert Pointer to an array of numberOfVertices packed (x,y,z) triplets.
+     */
+    void processVertices3(const float *vert)
+    {
+        processVertices3(reinterpret_cast<const char*>(vert), 3*sizeof(float));
+    }
+
+    /**
+     * @brief Computes bounding box and centroid and normalization factors (normalization_scale).
+     * @param records Pointer to numberOfVertices records, each starting with (x,y,z) floats; need not be aligned.
+     * @param stride Distance between records in bytes.
+     */
+    void processVertices3(const char *records, size_t stride)
+    {
+        auto position = [&] (unsigned int i) {
+            Eigen::Vector3f p;
+            std::memcpy(p.data(), records + i*stride, 3*sizeof(float));
+            return p;
+        };
+
         float xMax = 0; float xMin = 0; float yMax = 0; float yMin = 0; float zMax = 0; float zMin = 0;
         centroid = Eigen::Vector3f::Zero();
+        bounding_box.setEmpty();
 
         for(unsigned int i = 0; i < numberOfVertices; ++i) {
 
+            const Eigen::Vector3f p = position(i);
+            bounding_box.extend(p);
+
             //X:
-            if(vert[3*i + 0] > xMax) {
-                xMax = vert[3*i + 0];
+            if(p[0] > xMax) {
+                xMax = p[0];
             }
-            if(vert[3*i + 0] < xMin) {
-                xMin = vert[3*i + 0];
+            if(p[0] < xMin) {
+                xMin = p[0];
             }
 
             //Y:
-            if(vert[3*i + 1] > yMax) {
-                yMax = vert[3*i + 1];
+            if(p[1] > yMax) {
+                yMax = p[1];
             }
-            if(vert[3*i + 1] < yMin) {
-                yMin = vert[3*i + 1];
+            if(p[1] < yMin) {
+                yMin = p[1];
             }
 
             //Z:
-            if(vert[3*i + 2] > zMax) {
-                zMax = vert[3*i + 2];
+            if(p[2] > zMax) {
+                zMax = p[2];
             }
-            if(vert[3*i + 2] < zMin) {
-                zMin = vert[3*i + 2];
+            if(p[2] < zMin) {
+                zMin = p[2];
             }
 
             //centroid:
-            centroid = centroid + Eigen::Vector3f(vert[3*i + 0], vert[3*i + 1], vert[3*i + 2]);
+            centroid = centroid + p;
 
         }
 
@@ -624,18 +924,11 @@ protected:
         float centerZ = (zMax+zMin)/2.0;
         objectCenter = Eigen::Vector3f(centerX, centerY, centerZ);
 
-        /* // compute the centroid (different from the box center) */
-        /* centroid = Eigen::Vector3f::Zero(); */
-        /* for(unsigned int i = 0; i < numberOfVertices; i++) { */
-        /*     centroid = centroid + Eigen::Vector3f(vert[i + 0], vert[i + 1], vert[i + 2]); */
-        /* } */
-        /* centroid = centroid / numberOfVertices; */
-
         // compute the radius of the bounding sphere
         // farthest point from the centroid
         radius = 0.0;
         for(unsigned int i = 0; i < numberOfVertices; i++) {
-            radius = max(radius, ( Eigen::Vector3f(vert[i + 0], vert[i + 1], vert[i + 2]) - centroid ).norm());
+            radius = max(radius, ( position(i) - centroid ).norm());
         }
 
         normalization_scale = 1.0/radius;
@@ -651,23 +944,13 @@ public:
      */
     void loadVertices (vector<Eigen::Vector4f> &vert)
     {
-        std::vector<float> vertices( 3*vert.size() );
-        for (size_t i = 0; i < vert.size(); ++i)
-        {
-            vertices[3*i + 0] = vert[i][0];
-            vertices[3*i + 1] = vert[i][1];
-            vertices[3*i + 2] = vert[i][2];
-        }
-
-        loadVertices(vertices);
+        numberOfVertices = vert.size();
 
-        /* numberOfVertices = vert.size(); */
+        // creates new attribute and load vertex coordinates straight from the Eigen storage
+        createAttribute("in_Position", vert);
 
-        /* // creates new attribute and load vertex coordinates */
-        /* createAttribute("in_Position", vert); */
-
-        /* // from now on we are just computing some information about the model such as bounding box, centroid ... */
-        /* processVertices(vert); */
+        // from now on we are just computing some information about the model such as bounding box, centroid ...
+        processVertices(vert);
     }
 
     /**
@@ -679,20 +962,34 @@ public:
      */
     bool loadVertices(const vector<float> &vert)
     {
-        if ( vert.empty() )
+        return loadVertices(vert.data(), vert.size());
+    }
+
+    /**
+     * @brief Load vertices (x,y,z) and creates appropriate vertex attribute.
+     * The buffer is handed directly to the GL, no intermediate copy is made.
+     * The default attribute name is "in_Position".
+     * Computes bounding box and centroid and normalization factors (normalization_scale).
+     * @param vert Pointer to packed (x,y,z) vertex coordinates.
+     * @param size Number of floats in vert.
+     * @return True if size is a non-zero multiple of 3, false otherwise.
+     */
+    bool loadVertices(const float *vert, size_t size)
+    {
+        if ( (vert == nullptr) || (size == 0) )
         {
             return false;
         }
 
-        if ( vert.size() % 3 != 0 )
+        if ( size % 3 != 0 )
         {
             return false;
         }
 
-        numberOfVertices = vert.size()/3;
+        numberOfVertices = size/3;
 
         // creates new attribute and load vertex coordinates
-        createAttribute3("in_Position", vert);
+        createAttribute3("in_Position", vert, size);
 
         // from now on we are just computing some information about the model such as bounding box, centroid ...
         processVertices3(vert);
@@ -718,19 +1015,127 @@ public:
      */
     bool loadNormals (const vector<float> &norm)
     {
-        if ( norm.empty() )
+        return loadNormals(norm.data(), norm.size());
+    }
+
+    /**
+     * @brief Load normals (x,y,z) as a vertex attribute, without intermediate copies.
+     * @param norm Pointer to packed (x,y,z) normals.
+     * @param size Number of floats in norm.
+     * @return True if size is a non-zero multiple of 3, false otherwise.
+     */
+    bool loadNormals (const float *norm, size_t size)
+    {
+        if ( (norm == nullptr) || (size == 0) )
+        {
+            return false;
+        }
+
+        if ( size % 3 != 0 )
         {
             return false;
         }
 
-        if ( norm.size() % 3 != 0 )
+        numberOfNormals = size/3;
+
+        createAttribute3("in_Normal", norm, size);
+
+        return true;
+    }
+
+    /// A float attribute read from an array of vertex records, see loadVertexRecords()
+    struct RecordAttribute
+    {
+        /// Name of the attribute (ex. "in_Position")
+        string name;
+
+        /// Number of floats per attribute value
+        int element_size;
+
+        /// Byte offset of the attribute inside a record
+        GLintptr offset;
+    };
+
+    /**
+     * @brief Loads float attributes straight from an array of vertex records.
+     *
+     * The records are handed to the GL as they are, in a single buffer shared by the attributes,
+     * so bytes belonging to other fields of the records are uploaded too.  Offsets and stride must
+     * be multiples of 4.  An "in_Position" attribute updates the bounding box, centroid and
+     * normalization factors, an "in_Normal" attribute the number of normals.
+     * @param records Pointer to count records, or NULL to only allocate the buffer (see updateVertexRecords()).
+     * @param count Number of records.
+     * @param stride Record size in bytes.
+     * @param attributes Attributes found in every record.
+     * @return True if the attributes were loaded, false if the layout is invalid.
+     */
+    bool loadVertexRecords (const void *records, size_t count, GLsizei stride, const vector<RecordAttribute> &attributes)
+    {
+        if ( (count == 0) || (stride <= 0) || (stride % 4 != 0) || attributes.empty() )
         {
             return false;
         }
 
-        numberOfNormals = norm.size()/3;
+        for (const RecordAttribute &attribute : attributes)
+        {
+            if ( (attribute.offset < 0) || (attribute.offset % 4 != 0) ||
+                 (attribute.offset + attribute.element_size*static_cast<GLintptr>(sizeof(float)) > stride) )
+            {
+                return false;
+            }
+        }
+
+        std::shared_ptr < GLuint > buffer_sptr = createBuffer();
+        glBindBuffer(GL_ARRAY_BUFFER, *buffer_sptr);
+        glBufferData(GL_ARRAY_BUFFER, count*stride, records, (records == NULL) ? GL_DYNAMIC_DRAW : GL_STATIC_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        for (const RecordAttribute &attribute : attributes)
+        {
+            VertexAttribute va (attribute.name, count, attribute.element_size, GL_FLOAT);
+            va.setInterleavedBuffer(buffer_sptr, stride, attribute.offset);
+            pushAttribute(va);
+
+            if ( !attribute.name.compare("in_Position") )
+            {
+                numberOfVertices = count;
+                if ( records != NULL )
+                {
+                    processVertices3(static_cast<const char*>(records) + attribute.offset, stride);
+                }
+            }
+            else if ( !attribute.name.compare("in_Normal") )
+            {
+                numberOfNormals = count;
+            }
+        }
+
+        #ifdef TUCANODEBUG
+        Misc::errorCheckFunc(__FILE__, __LINE__);
+        #endif
+
+        return true;
+    }
+
+    /**
+     * @brief Overwrites a range of whole records in the buffer created by loadVertexRecords().
+     * @param name Name of any attribute loaded from the records.
+     * @param first Index of the first record to overwrite.
+     * @param records Pointer to the new records.
+     * @param count Number of records.
+     * @return True if the range fits inside the buffer, false otherwise.
+     */
+    bool updateVertexRecords (const string &name, size_t first, const void *records, size_t count)
+    {
+        VertexAttribute *va = getAttribute(name);
+        if ( (va == NULL) || !va->isInterleaved() || (records == NULL) || (first + count > static_cast<size_t>(va->getSize())) )
+        {
+            return false;
+        }
 
-        createAttribute3("in_Normal", norm);
+        va->bind();
+        glBufferSubData(va->getArrayType(), first*va->getStride(), count*va->getStride(), records);
+        va->unbind();
 
         return true;
     }
@@ -922,21 +1327,33 @@ public:
      */
     void loadIndices(const vector<GLuint> &ind)
     {
-        numberOfElements = ind.size();
-
-        /* GLuint *indices = new GLuint[ind.size()]; */
+        loadIndices(ind.data(), ind.size());
+    }
 
-        /* //Indices: */
-        /* for(unsigned int i = 0; i < ind.size(); i++) */
-        /* { */
-        /*     indices[i] = ind[i]; */
-        /* } */
+    /**
+     * @brief Load indices into indices array, uploading the given buffer directly.
+     * @param ind Pointer to indices array.
+     * @param size Number of indices in ind.
+     */
+    void loadIndices(const GLuint *ind, size_t size)
+    {
+        numberOfElements = size;
+        clearLevelsOfDetail();
+        clearDrawRanges();
 
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, *index_buffer_sptr);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, ind.size()*sizeof(GLuint), ind.data(), GL_STATIC_DRAW);
+        if ( (size > 0) && ((size == numberOfAllocatedElements) || (size == numberOfSpareElements)) )
+        {
+            // same size as before, rewrite the existing storage
+            glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, size*sizeof(GLuint), ind);
+        }
+        else
+        {
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, size*sizeof(GLuint), ind, GL_STATIC_DRAW);
+        }
+        numberOfAllocatedElements = size;
+        numberOfSpareElements = 0;
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-
-        /* delete [] indices; */
     }
 
 
@@ -969,7 +1386,7 @@ public:
 	 */
     void reserveColors( const int element_size, const ulong size )
 	{
-		numberOfNormals = size;
+		numberOfColors = size;
 		createAttribute( "in_Color", element_size, size );
 	}
 	
@@ -990,9 +1407,13 @@ public:
 	void reserveIndices( const ulong size )
 	{
 		numberOfElements = size;
-		glGenBuffers( 1, &index_buffer_id );
-		glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, index_buffer_id );
+		clearLevelsOfDetail();
+		clearDrawRanges();
+		numberOfAllocatedElements = size;
+		numberOfSpareElements = 0;
+		glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, *index_buffer_sptr );
 		glBufferData( GL_ELEMENT_ARRAY_BUFFER, size * sizeof( uint ), NULL, GL_DYNAMIC_DRAW );
+		glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, 0 );
 	}
     
     /**
@@ -1049,7 +1470,7 @@ public:
 	uint* mapIndices( const ulong offset, const ulong length )
 	{
 		numberOfElements = length;
-		glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, index_buffer_id );
+		glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, *index_buffer_sptr );
 		uint* ptr = ( uint* ) glMapBufferRange( GL_ELEMENT_ARRAY_BUFFER, offset * sizeof( uint ), length * sizeof( uint ),
 												GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT );
 		return ptr;
@@ -1092,210 +1513,1185 @@ public:
 	 */
 	void unmapIndices()
 	{
-		glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, index_buffer_id );
+		glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, *index_buffer_sptr );
 		glUnmapBuffer( GL_ELEMENT_ARRAY_BUFFER );
 	}
-    
+
     /**
-     * @brief Sets default attribute locations.
-     * vertex coords -> location 0
-     * normals -> location 1
-     * colors -> location 2
-     * texCoords -> location 3
+     * @brief Overwrites a range of an existing float attribute in place, keeping its GL buffer.
+     * @param name Name of the attribute.
+     * @param offset Offset of the range start (in element units, e.g. vertices).
+     * @param attrib Pointer to the new values, packed with the attribute's element size.
+     * @param size Number of floats in attrib (must be a multiple of the attribute's element size).
+     * @return True if the attribute exists and the range fits inside it, false otherwise.
      */
-    void setDefaultAttribLocations (void)
+    bool updateAttribute( const string& name, const ulong offset, const float *attrib, const size_t size )
     {
-		resetLocations();
-        for (unsigned int i = 0; i < vertex_attributes.size(); ++i)
+        VertexAttribute *va = getAttribute(name);
+        if ( (va == nullptr) || (attrib == nullptr) || (va->getType() != GL_FLOAT) )
         {
-            if (!vertex_attributes[i].getName().compare("in_Position"))
-            {
-                vertex_attributes[i].setLocation(0);
-            }
-            else if (!vertex_attributes[i].getName().compare("in_Normal"))
-            {
-                vertex_attributes[i].setLocation(1);
-            }
-            else if (!vertex_attributes[i].getName().compare("in_Color"))
-            {
-                vertex_attributes[i].setLocation(2);
-            }
-            else if (!vertex_attributes[i].getName().compare("in_TexCoords"))
-            {
-                vertex_attributes[i].setLocation(3);
-            }
+            return false;
+        }
+
+        const size_t element_size = va->getElementSize();
+        if ( (size == 0) || (size % element_size != 0) )
+        {
+            return false;
+        }
+
+        const size_t length = size/element_size;
+        if ( offset + length > static_cast<size_t>(va->getSize()) )
+        {
+            return false;
         }
+
+        updateBufferWithAttribute(*va, offset, attrib, length);
+
+        return true;
     }
 
     /**
-     * @brief Returns whether an attribute exists or not.
-     * @param name Name of attribute to be queried.
-     * @return True if attribute exists, false otherwise.
+     * @brief Overwrites a range of the vertices attribute in place.
+     * @param offset Index of the first vertex to overwrite.
+     * @param vert Pointer to the new coordinates, same layout as loaded.
+     * @param size Number of floats in vert.
+     * @return True if the range fits inside the loaded vertices, false otherwise.
      */
-    bool hasAttribute (const string& name) const
+    bool updateVertices( const ulong offset, const float *vert, const size_t size )
     {
-        for (unsigned int i = 0; i < vertex_attributes.size(); ++i)
+        if ( !updateAttribute( "in_Position", offset, vert, size ) )
         {
-            if (!vertex_attributes[i].getName().compare(name))
-            {
-                return true;
-            }
+            return false;
         }
-        return false;
-    }
+
+        // Grow the bounding box over the new positions; it never shrinks, so it stays conservative
+        const size_t element_size = getAttribute("in_Position")->getElementSize();
+        for ( size_t i = 0; i + element_size <= size; i += element_size )
+        {
+            bounding_box.extend(Eigen::Vector3f(vert[i], vert[i+1], vert[i+2]));
+        }
+
+        return true;
+    }
+
+    /**
+     * @brief Overwrites a range of the index buffer in place.
+     * @param offset Index of the first index to overwrite.
+     * @param ind Pointer to the new indices.
+     * @param size Number of indices in ind.
+     * @return True if the range fits inside the allocated index buffer, false otherwise.
+     */
+    bool updateIndices( const ulong offset, const GLuint *ind, const size_t size )
+    {
+        if ( (ind == nullptr) || (size == 0) || (offset + size > numberOfAllocatedElements) )
+        {
+            return false;
+        }
+
+        glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, *index_buffer_sptr );
+        glBufferSubData( GL_ELEMENT_ARRAY_BUFFER, offset*sizeof(GLuint), size*sizeof(GLuint), ind );
+        glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, 0 );
+
+        return true;
+    }
+
+    /**
+     * @brief Loads coarser versions of the index buffer, drawn instead of it once selected with selectLevel().
+     *
+     * The levels index the same vertices as the index buffer.  They are dropped
+     * when the index buffer is loaded again.
+     * @param ind Pointer to the indices of all levels, one level after the other (null to only allocate them, see updateLevelsOfDetail()).
+     * @param sizes Number of indices of each level, from the finest to the coarsest.
+     */
+    void loadLevelsOfDetail( const GLuint *ind, const vector<size_t> &sizes )
+    {
+        clearLevelsOfDetail();
+        if ( sizes.empty() )
+        {
+            return;
+        }
+
+        lod_sizes = sizes;
+        lod_buffer_sptr = createBuffer();
+        glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, *lod_buffer_sptr );
+        glBufferData( GL_ELEMENT_ARRAY_BUFFER, std::accumulate(sizes.begin(), sizes.end(), size_t(0))*sizeof(GLuint), ind, GL_STATIC_DRAW );
+        glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, 0 );
+    }
+
+    /**
+     * @brief Overwrites a range of the indices of the levels of detail, counted over all levels.
+     * @param offset Index of the first index to overwrite.
+     * @param ind Pointer to the new indices.
+     * @param size Number of indices in ind.
+     * @return True if the range fits inside the levels of detail, false otherwise.
+     */
+    bool updateLevelsOfDetail( const ulong offset, const GLuint *ind, const size_t size )
+    {
+        if ( (ind == nullptr) || (size == 0) || (offset + size > std::accumulate(lod_sizes.begin(), lod_sizes.end(), size_t(0))) )
+        {
+            return false;
+        }
+
+        glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, *lod_buffer_sptr );
+        glBufferSubData( GL_ELEMENT_ARRAY_BUFFER, offset*sizeof(GLuint), size*sizeof(GLuint), ind );
+        glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, 0 );
+
+        return true;
+    }
+
+    /**
+     * @brief Drops the levels of detail, going back to drawing the index buffer.
+     */
+    void clearLevelsOfDetail( void )
+    {
+        lod_buffer_sptr.reset();
+        lod_sizes.clear();
+        lod_level = 0;
+    }
+
+    /**
+     * @brief Returns the number of levels of detail, counting the index buffer as level 0.
+     */
+    unsigned int getNumberOfLevels( void ) const
+    {
+        return 1 + lod_sizes.size();
+    }
+
+    /**
+     * @brief Selects the level of detail drawn.
+     * @param level 0 for the index buffer, up to getNumberOfLevels() - 1 for the coarsest level.
+     */
+    void selectLevel( unsigned int level )
+    {
+        lod_level = std::min<unsigned int>(level, lod_sizes.size());
+    }
+
+    /**
+     * @brief Returns the level of detail drawn.
+     */
+    unsigned int getSelectedLevel( void ) const
+    {
+        return lod_level;
+    }
+
+    /**
+     * @brief Returns the number of indices of a level of detail.
+     * @param level Level of detail, 0 for the index buffer.
+     */
+    size_t getNumberOfLevelElements( unsigned int level ) const
+    {
+        if ( level == 0 )
+            return numberOfElements;
+        return (level <= lod_sizes.size()) ? lod_sizes[level-1] : 0;
+    }
+
+    /**
+     * @brief Draws only some ranges of the index buffer, with a single glMultiDrawElements call.
+     *
+     * Applies to level 0 of non instanced meshes; an empty list draws nothing.
+     * @param counts Number of indices of each range.
+     * @param offsets Byte offset of each range in the index buffer.
+     */
+    void setDrawRanges( const vector<GLsizei> &counts, const vector<const GLvoid*> &offsets )
+    {
+        draw_counts.assign( counts.begin(), counts.end() );
+        draw_offsets.assign( offsets.begin(), offsets.begin() + std::min(counts.size(), offsets.size()) );
+        draw_counts.resize( draw_offsets.size() );
+        draw_ranges = true;
+    }
+
+    /**
+     * @brief Returns whether only some ranges of the index buffer are drawn, see setDrawRanges().
+     */
+    bool hasDrawRanges( void ) const
+    {
+        return draw_ranges;
+    }
+
+    /**
+     * @brief Goes back to drawing the whole index buffer.
+     */
+    void clearDrawRanges( void )
+    {
+        draw_counts.clear();
+        draw_offsets.clear();
+        draw_ranges = false;
+    }
+
+    /**
+     * @brief Recomputes bounding box, centroid and normalization factors from a copy of the vertices.
+     * Meant for vertices uploaded by parts, with reserveVertices() and updateVertices().
+     * @param vert Packed (x,y,z) vertex coordinates, as many vertices as reserved.
+     */
+    void updateVertexBounds (const vector<float> &vert)
+    {
+        if ( vert.empty() || (vert.size() != 3*static_cast<size_t>(numberOfVertices)) )
+        {
+            return;
+        }
+
+        processVertices3(vert);
+    }
+
+    /**
+     * @brief Recomputes bounding box, centroid and normalization factors from vertex records.
+     * Meant for records uploaded by parts, with loadVertexRecords() and updateVertexRecords().
+     * @param records Pointer to as many records as reserved vertices, each with (x,y,z) floats at the same offset.
+     * @param stride Record size in bytes.
+     */
+    void updateVertexBounds (const char *records, size_t stride)
+    {
+        if ( (records == NULL) || (numberOfVertices == 0) )
+        {
+            return;
+        }
+
+        processVertices3(records, stride);
+    }
+
+    /**
+     * @brief Overwrites a range of the normals attribute in place.
+     * @param offset Index of the first normal to overwrite.
+     * @param norm Pointer to the new (x,y,z) normals.
+     * @param size Number of floats in norm.
+     * @return True if the range fits inside the loaded normals, false otherwise.
+     */
+    bool updateNormals( const ulong offset, const float *norm, const size_t size )
+    {
+        return updateAttribute( "in_Normal", offset, norm, size );
+    }
+
+    /**
+     * @brief Overwrites a range of the colors attribute in place.
+     * @param offset Index of the first color to overwrite.
+     * @param clrs Pointer to the new colors, RGB or RGBA as loaded.
+     * @param size Number of floats in clrs.
+     * @return True if the range fits inside the loaded colors, false otherwise.
+     */
+    bool updateColors( const ulong offset, const float *clrs, const size_t size )
+    {
+        return updateAttribute( "in_Color", offset, clrs, size );
+    }
+    
+    /**
+     * @brief Sets default attribute locations.
+     * vertex coords -> location 0
+     * normals -> location 1
+     * colors -> location 2
+     * texCoords -> location 3
+     */
+    void setDefaultAttribLocations (void)
+    {
+		resetLocations();
+        for (unsigned int i = 0; i < vertex_attributes.size(); ++i)
+        {
+            if (!vertex_attributes[i].getName().compare("in_Position"))
+            {
+                vertex_attributes[i].setLocation(0);
+            }
+            else if (!vertex_attributes[i].getName().compare("in_Normal"))
+            {
+                vertex_attributes[i].setLocation(1);
+            }
+            else if (!vertex_attributes[i].getName().compare("in_Color"))
+            {
+                vertex_attributes[i].setLocation(2);
+            }
+            else if (!vertex_attributes[i].getName().compare("in_TexCoords"))
+            {
+                vertex_attributes[i].setLocation(3);
+            }
+        }
+    }
+
+    /**
+     * @brief Returns whether an attribute exists or not.
+     * @param name Name of attribute to be queried.
+     * @return True if attribute exists, false otherwise.
+     */
+    bool hasAttribute (const string& name) const
+    {
+        for (unsigned int i = 0; i < vertex_attributes.size(); ++i)
+        {
+            if (!vertex_attributes[i].getName().compare(name))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * @brief Returns whether an attribute exists or not.
+     * @param name Name of attribute to be queried.
+     * @param attrib_index Index of queried attribute, if found.
+     * @return True if attribute exists, false otherwise.
+     */
+    bool hasAttribute (const string& name, size_t &attrib_index ) const
+    {
+        for (unsigned int i = 0; i < vertex_attributes.size(); ++i)
+        {
+            if ( vertex_attributes[i].getName().compare(name) == 0 )
+            {
+                attrib_index = static_cast<size_t>(i);
+                return true;
+            }
+        }
+        return false;
+    }
+
+
+    /**
+    * @brief Returns a pointer to an attribute
+    * Given an attribute name, searches to see if it exists, if so, returns a pointer to it
+    * @param name Attribute name
+    * @return Pointer to attribute, or NULL if it does not exist
+    */
+    VertexAttribute* getAttribute(const string& name)
+    {
+        for (unsigned int i = 0; i < vertex_attributes.size(); ++i)
+        {
+            if (!vertex_attributes[i].getName().compare(name))
+            {
+                return &vertex_attributes[i];
+            }
+        }
+        return NULL;
+    }
+
+    /**
+     * @brief Automatically sets the attribute locations for a given Shader.
+     *
+     * For every mesh attribute, the Shader will be queried for an attribute with the same name,
+     * if one is found they will linked.
+     * @param shader A pointer to the given shader.
+     */
+    void setAttributeLocation (Shader *shader)
+    {       
+        for (unsigned int i = 0; i < vertex_attributes.size(); ++i)
+        {
+            GLint loc = shader->getAttributeLocation(vertex_attributes[i].getName().c_str());
+            vertex_attributes[i].setLocation(loc);
+        }
+        if (shader->getTessellationEvaluationShader() != 0)
+		{
+			primitiveType = PATCH;
+		}
+        
+    }
+
+	void setAttributeLocation (const Shader& shader)
+	{
+		setAttributeLocation((Shader*)(&shader));
+	}
+
+
+    /**
+     * @brief Sets the location of a generic vertex attribute.
+     * @param name Name of the given attribute
+     * @param loc Location of the attribute.
+     */
+    void setAttributeLocation (string name, GLint loc)
+    {
+        for (unsigned int i = 0; i < vertex_attributes.size(); ++i)
+        {
+            if (!name.compare(vertex_attributes[i].getName()))
+            {
+                vertex_attributes[i].setLocation(loc);
+            }
+        }
+    }
+
+
+    /**
+     * @brief Creates and loads a new mesh attribute of 4 floats.
+     *
+     * Eigen::Vector4f is tightly packed, so the vector storage is uploaded as is.
+     * @param name Name of the attribute.
+     * @param attrib Array with new attribute.
+     * @return Pointer to created attribute
+     */
+    VertexAttribute* createAttribute(string name, const vector<Eigen::Vector4f> &attrib)
+    {
+        return createAttribute4(std::move(name), attrib.empty() ? nullptr : attrib.data()->data(), 4*attrib.size());
+    }
+    
+    /**
+     * @brief Creates and loads a new mesh attribute of 4 floats.
+     * @param name Name of the attribute.
+     * @param attrib Array with new attribute.
+     * @return Pointer to created attribute
+     */
+    VertexAttribute* createAttribute4(string name, const vector<float> &attrib)
+    {
+        return createAttribute4(std::move(name), attrib.data(), attrib.size());
+    }
+
+    /**
+     * @brief Creates and loads a new mesh attribute of 4 floats.
+     * @param name Name of the attribute.
+     * @param attrib Pointer to the new attribute data, handed directly to the GL.
+     * @param size Number of floats in attrib.
+     * @return Pointer to created attribute
+     */
+    VertexAttribute* createAttribute4(string name, const float *attrib, size_t size)
+    {
+        return loadAttribute(std::move(name), attrib, size, 4);
+    }
+    
+    /**
+     * @brief Fill buffer with attribute data
+     *
+     * @param va Vertex attribute whose buffer is meant to be filled.
+     * @param attrib Array with new attribute data.
+     */
+    void fillBufferWithAttribute( VertexAttribute &va, const std::vector<float> &attrib )
+    {
+        fillBufferWithAttribute(va, attrib.data());
+    }
+
+    /**
+     * @brief Fill buffer with attribute data
+     *
+     * @param va Vertex attribute whose buffer is meant to be filled.
+     * @param attrib Pointer to at least va.getSize()*va.getElementSize() values of the attribute's type.
+     */
+    void fillBufferWithAttribute( VertexAttribute &va, const void *attrib )
+    {
+        // fill buffer with attribute data
+        va.bind();
+        glBufferData(va.getArrayType(), va.getSize()*va.getElementSize()*va.getTypeSize(), attrib, GL_STATIC_DRAW);
+        va.unbind();
+    }
+
+    /**
+     * @brief Overwrite a range of an attribute's buffer with glBufferSubData
+     *
+     * @param va Vertex attribute whose buffer is meant to be updated.
+     * @param offset Offset of the range start (in element units).
+     * @param attrib Pointer to the new values.
+     * @param length Length of the range (in element units).
+     */
+    void updateBufferWithAttribute( VertexAttribute &va, const ulong offset, const void *attrib, const ulong length )
+    {
+        const ulong element_bytes = va.getElementBytes();
+
+        va.bind();
+        if ( va.isInterleaved() )
+        {
+            // scatter into the strided slots, leaving the other attributes untouched
+            char *dst = reinterpret_cast<char*>( va.map(offset, length) );
+            const char *src = static_cast<const char*>( attrib );
+            if ( dst != nullptr )
+            {
+                for ( ulong i = 0; i < length; ++i )
+                {
+                    std::memcpy(dst + i*va.getStride(), src + i*element_bytes, element_bytes);
+                }
+            }
+            va.unmap();
+        }
+        else
+        {
+            glBufferSubData(va.getArrayType(), offset*element_bytes, length*element_bytes, attrib);
+        }
+        va.unbind();
+    }
+
+    /**
+     * @brief Reads back the values of every attribute from the GPU, tightly packed.
+     *
+     * Interleaved buffers are read only once even if shared by several attributes.
+     * @param packed One byte array per vertex attribute, in the same order as vertex_attributes.
+     */
+    void readBackAttributes( vector< vector<char> > &packed )
+    {
+        std::map< GLuint, vector<char> > buffers;
+        packed.assign(vertex_attributes.size(), vector<char>());
+
+        for (unsigned int i = 0; i < vertex_attributes.size(); ++i)
+        {
+            VertexAttribute &va = vertex_attributes[i];
+            const size_t element_bytes = va.getElementBytes();
+            const size_t count = va.getSize();
+
+            vector<char> &data = buffers[va.getBufferID()];
+            if ( data.empty() )
+            {
+                GLint64 buffer_bytes = 0;
+                va.bind();
+                glGetBufferParameteri64v(va.getArrayType(), GL_BUFFER_SIZE, &buffer_bytes);
+                data.resize(buffer_bytes);
+                glGetBufferSubData(va.getArrayType(), 0, buffer_bytes, data.data());
+                va.unbind();
+            }
+
+            const size_t stride = va.isInterleaved() ? va.getStride() : element_bytes;
+            packed[i].resize(count*element_bytes);
+            for (size_t v = 0; v < count; ++v)
+            {
+                std::memcpy(&packed[i][v*element_bytes], &data[va.getOffset() + v*stride], element_bytes);
+            }
+        }
+    }
+
+    /**
+     * @brief Reads back the index buffer from the GPU.
+     * @param ind Receives the numberOfElements indices, empty if the mesh has none.
+     */
+    void readBackIndices( vector<GLuint> &ind )
+    {
+        ind.resize(numberOfElements);
+        if ( ind.empty() )
+        {
+            return;
+        }
+
+        // the element array binding belongs to the VAO, read through the copy target instead
+        glBindBuffer(GL_COPY_READ_BUFFER, *index_buffer_sptr);
+        glGetBufferSubData(GL_COPY_READ_BUFFER, 0, ind.size()*sizeof(GLuint), ind.data());
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    }
+
+    /**
+     * @brief Packs all vertex attributes into a single interleaved buffer.
+     *
+     * Nothing is done unless every attribute is a GL_ARRAY_BUFFER with the same number of values.
+     * @return True if the attributes are interleaved after the call.
+     */
+    bool interleaveAttributes( void )
+    {
+        if ( vertex_attributes.empty() )
+        {
+            return false;
+        }
+
+        GLsizei stride = 0;
+        vector<GLintptr> offsets(vertex_attributes.size());
+        for (unsigned int i = 0; i < vertex_attributes.size(); ++i)
+        {
+            const VertexAttribute &va = vertex_attributes[i];
+            if ( (va.getArrayType() != GL_ARRAY_BUFFER) || (va.getSize() != vertex_attributes[0].getSize()) )
+            {
+                return false;
+            }
+
+            // keep every value 4-byte aligned
+            offsets[i] = stride;
+            stride += (va.getElementBytes() + 3) & ~3u;
+        }
+
+        vector< vector<char> > packed;
+        readBackAttributes(packed);
+
+        const size_t count = vertex_attributes[0].getSize();
+        vector<char> interleaved(count*stride, 0);
+        for (unsigned int i = 0; i < vertex_attributes.size(); ++i)
+        {
+            const size_t element_bytes = vertex_attributes[i].getElementBytes();
+            for (size_t v = 0; v < count; ++v)
+            {
+                std::memcpy(&interleaved[v*stride + offsets[i]], &packed[i][v*element_bytes], element_bytes);
+            }
+        }
+
+        std::shared_ptr < GLuint > buffer_sptr = createBuffer();
+        glBindBuffer(GL_ARRAY_BUFFER, *buffer_sptr);
+        glBufferData(GL_ARRAY_BUFFER, interleaved.size(), interleaved.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        for (unsigned int i = 0; i < vertex_attributes.size(); ++i)
+        {
+            vertex_attributes[i].setInterleavedBuffer(buffer_sptr, stride, offsets[i]);
+        }
+
+        #ifdef TUCANODEBUG
+        Misc::errorCheckFunc(__FILE__, __LINE__);
+        #endif
+
+        return true;
+    }
+
+    /**
+     * @brief Moves every interleaved attribute back to a buffer of its own.
+     */
+    void separateAttributes( void )
+    {
+        vector< vector<char> > packed;
+        readBackAttributes(packed);
+
+        for (unsigned int i = 0; i < vertex_attributes.size(); ++i)
+        {
+            VertexAttribute &va = vertex_attributes[i];
+            if ( !va.isInterleaved() )
+            {
+                continue;
+            }
+
+            va.setSeparateBuffer(createBuffer());
+            va.bind();
+            glBufferData(va.getArrayType(), packed[i].size(), packed[i].data(), GL_STATIC_DRAW);
+            va.unbind();
+        }
+    }
+
+    /**
+     * @brief Renumbers the vertices, moving the values of every per-vertex attribute in place.
+     *
+     * The index buffer is left as it is, remapping it is up to the caller.
+     * @param order Old number of each vertex, in the new order (a permutation of the vertices).
+     * @return False, leaving the mesh untouched, if order does not fit the per-vertex attributes.
+     */
+    bool reorderVertices( const vector<GLuint> &order )
+    {
+        for (const VertexAttribute &va : vertex_attributes)
+        {
+            if ( (va.getDivisor() == 0) && (static_cast<size_t>(va.getSize()) != order.size()) )
+            {
+                return false;
+            }
+        }
+        for (GLuint v : order)
+        {
+            if ( v >= order.size() )
+            {
+                return false;
+            }
+        }
+
+        vector< vector<char> > packed;
+        readBackAttributes(packed);
+
+        for (unsigned int i = 0; i < vertex_attributes.size(); ++i)
+        {
+            VertexAttribute &va = vertex_attributes[i];
+            if ( va.getDivisor() != 0 )
+            {
+                continue;
+            }
+
+            const size_t element_bytes = va.getElementBytes();
+            vector<char> moved (packed[i].size());
+            for (size_t v = 0; v < order.size(); ++v)
+            {
+                std::memcpy(&moved[v*element_bytes], &packed[i][order[v]*element_bytes], element_bytes);
+            }
+            updateBufferWithAttribute(va, 0, moved.data(), order.size());
+        }
+
+        return true;
+    }
+
+    /**
+     * @brief Reads back the values of one attribute from the GPU, tightly packed.
+     * @param va Attribute of the mesh.
+     * @param packed Receives va.getSize() values of va.getElementBytes() bytes.
+     */
+    void readBackAttribute( VertexAttribute &va, vector<char> &packed )
+    {
+        const size_t element_bytes = va.getElementBytes();
+        const size_t count = va.getSize();
+        const size_t stride = va.isInterleaved() ? va.getStride() : element_bytes;
+
+        packed.resize(count*element_bytes);
+        if ( count == 0 )
+        {
+            return;
+        }
+
+        // only the span holding the attribute's values
+        vector<char> data ((count - 1)*stride + element_bytes);
+        va.bind();
+        glGetBufferSubData(va.getArrayType(), va.getOffset(), data.size(), data.data());
+        va.unbind();
+
+        for (size_t v = 0; v < count; ++v)
+        {
+            std::memcpy(&packed[v*element_bytes], &data[v*stride], element_bytes);
+        }
+    }
+
+    /**
+     * @brief Reads back the (x,y,z) coordinates of the vertices, decoding quantized positions.
+     * @param xyz Receives 3*getNumberOfVertices() floats.
+     * @return False if the mesh has no float or quantized positions.
+     */
+    bool readBackPositions( vector<float> &xyz )
+    {
+        VertexAttribute *va = getAttribute("in_Position");
+        if ( (va == NULL) || (va->getElementSize() < 3) )
+        {
+            return false;
+        }
+
+        const bool quantized = va->isNormalized() && (va->getType() == GL_UNSIGNED_SHORT);
+        if ( !quantized && (va->getType() != GL_FLOAT) )
+        {
+            return false;
+        }
+
+        vector<char> packed;
+        readBackAttribute(*va, packed);
+
+        const size_t count = va->getSize();
+        const size_t element_size = va->getElementSize();
+        xyz.resize(3*count);
+        for (size_t v = 0; v < count; ++v)
+        {
+            if ( quantized )
+            {
+                for (int c = 0; c < 3; ++c)
+                {
+                    GLushort q;
+                    std::memcpy(&q, &packed[(v*element_size + c)*sizeof(GLushort)], sizeof(q));
+                    xyz[3*v + c] = position_offset[c] + position_scale[c] * (q / 65535.f);
+                }
+            }
+            else
+            {
+                std::memcpy(&xyz[3*v], &packed[v*element_size*sizeof(float)], 3*sizeof(float));
+            }
+        }
+
+        return true;
+    }
+
+    /**
+     * @brief Stores the positions as 16 bit normalized offsets inside their bounding box.
+     *
+     * Each position takes 6 bytes instead of 12 (or 16).  Shaders rebuild it as
+     * in_Position.xyz * position_scale + position_offset, see setDecodingUniforms().
+     * Quantized attributes cannot be updated or mapped as floats; dequantizeAttributes()
+     * brings them back.
+     * @return True if the positions are quantized after the call.
+     */
+    bool quantizePositions (void)
+    {
+        VertexAttribute *va = getAttribute("in_Position");
+        if ( (va == NULL) || va->isNormalized() )
+        {
+            return (va != NULL);
+        }
+        if ( (va->getType() != GL_FLOAT) || (va->getElementSize() < 3) || (va->getDivisor() != 0) || (va->getSize() == 0) )
+        {
+            return false;
+        }
+
+        vector<char> packed;
+        readBackAttribute(*va, packed);
+
+        const size_t count = va->getSize();
+        const int element_size = va->getElementSize();
+        auto position = [&] (size_t i) {
+            Eigen::Vector3f p;
+            std::memcpy(p.data(), &packed[i*element_size*sizeof(float)], 3*sizeof(float));
+            return p;
+        };
+
+        Eigen::AlignedBox3f box;
+        for (size_t i = 0; i < count; ++i)
+        {
+            box.extend(position(i));
+        }
+        const Eigen::Vector3f extent = box.sizes();
+
+        vector<GLushort> quantized (3*count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            const Eigen::Vector3f p = position(i);
+            for (int c = 0; c < 3; ++c)
+            {
+                float t = (extent[c] > 0.f) ? (p[c] - box.min()[c]) / extent[c] : 0.f;
+                t = (t > 0.f) ? std::min(t, 1.f) : 0.f;
+                quantized[3*i + c] = static_cast<GLushort>(t*65535.f + 0.5f);
+            }
+        }
+
+        VertexAttribute quantized_va ("in_Position", count, 3, GL_UNSIGNED_SHORT);
+        quantized_va.setNormalized(true);
+        fillBufferWithAttribute(quantized_va, quantized.data());
+        pushAttribute(quantized_va);
+
+        position_scale = extent;
+        position_offset = box.min();
+
+        return true;
+    }
 
     /**
-     * @brief Returns whether an attribute exists or not.
-     * @param name Name of attribute to be queried.
-     * @param attrib_index Index of queried attribute, if found.
-     * @return True if attribute exists, false otherwise.
+     * @brief Stores the normals as two 16 bit normalized octahedral coordinates.
+     *
+     * Each normal takes 4 bytes instead of 12; shaders decode it when octahedral_normals is set,
+     * see setDecodingUniforms().
+     * @return True if the normals are quantized after the call.
      */
-    bool hasAttribute (const string& name, size_t &attrib_index ) const
+    bool quantizeNormals (void)
     {
-        for (unsigned int i = 0; i < vertex_attributes.size(); ++i)
+        VertexAttribute *va = getAttribute("in_Normal");
+        if ( (va == NULL) || va->isNormalized() )
         {
-            if ( vertex_attributes[i].getName().compare(name) == 0 )
+            return (va != NULL);
+        }
+        if ( (va->getType() != GL_FLOAT) || (va->getElementSize() != 3) || (va->getDivisor() != 0) || (va->getSize() == 0) )
+        {
+            return false;
+        }
+
+        vector<char> packed;
+        readBackAttribute(*va, packed);
+
+        const size_t count = va->getSize();
+        vector<GLshort> quantized (2*count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            float n[3];
+            std::memcpy(n, &packed[3*i*sizeof(float)], sizeof(n));
+
+            // project on the octahedron |x|+|y|+|z| = 1, folding the lower half over the upper one
+            const float l1 = std::abs(n[0]) + std::abs(n[1]) + std::abs(n[2]);
+            float u = (l1 > 0.f) ? n[0] / l1 : 0.f;
+            float v = (l1 > 0.f) ? n[1] / l1 : 0.f;
+            if ( n[2] < 0.f )
             {
-                attrib_index = static_cast<size_t>(i);
-                return true;
+                const float folded_u = (1.f - std::abs(v)) * ((u >= 0.f) ? 1.f : -1.f);
+                const float folded_v = (1.f - std::abs(u)) * ((v >= 0.f) ? 1.f : -1.f);
+                u = folded_u;
+                v = folded_v;
             }
+
+            u = (u > -1.f) ? std::min(u, 1.f) : -1.f;
+            v = (v > -1.f) ? std::min(v, 1.f) : -1.f;
+            quantized[2*i + 0] = static_cast<GLshort>(std::lround(u*32767.f));
+            quantized[2*i + 1] = static_cast<GLshort>(std::lround(v*32767.f));
         }
-        return false;
-    }
 
+        VertexAttribute quantized_va ("in_Normal", count, 2, GL_SHORT);
+        quantized_va.setNormalized(true);
+        fillBufferWithAttribute(quantized_va, quantized.data());
+        pushAttribute(quantized_va);
+
+        return true;
+    }
 
     /**
-    * @brief Returns a pointer to an attribute
-    * Given an attribute name, searches to see if it exists, if so, returns a pointer to it
-    * @param name Attribute name
-    * @return Pointer to attribute, or NULL if it does not exist
-    */
-    VertexAttribute* getAttribute(const string& name)
+     * @brief Stores the colors as RGBA8, 4 bytes instead of 12 or 16.
+     *
+     * Colors are clamped to [0,1]; RGB colors get an opaque alpha.
+     * @return True if the colors are quantized after the call.
+     */
+    bool quantizeColors (void)
     {
-        for (unsigned int i = 0; i < vertex_attributes.size(); ++i)
+        VertexAttribute *va = getAttribute("in_Color");
+        if ( (va == NULL) || va->isNormalized() )
         {
-            if (!vertex_attributes[i].getName().compare(name))
+            return (va != NULL);
+        }
+        if ( (va->getType() != GL_FLOAT) || (va->getElementSize() < 3) || (va->getDivisor() != 0) || (va->getSize() == 0) )
+        {
+            return false;
+        }
+
+        vector<char> packed;
+        readBackAttribute(*va, packed);
+
+        const size_t count = va->getSize();
+        const int element_size = va->getElementSize();
+        vector<GLubyte> quantized (4*count, 255);
+        for (size_t i = 0; i < count; ++i)
+        {
+            float rgba[4];
+            std::memcpy(rgba, &packed[i*element_size*sizeof(float)], element_size*sizeof(float));
+            for (int c = 0; c < element_size; ++c)
             {
-                return &vertex_attributes[i];
+                const float t = (rgba[c] > 0.f) ? std::min(rgba[c], 1.f) : 0.f;
+                quantized[4*i + c] = static_cast<GLubyte>(t*255.f + 0.5f);
             }
         }
-        return NULL;
+
+        VertexAttribute quantized_va ("in_Color", count, 4, GL_UNSIGNED_BYTE);
+        quantized_va.setNormalized(true);
+        fillBufferWithAttribute(quantized_va, quantized.data());
+        pushAttribute(quantized_va);
+
+        return true;
     }
 
     /**
-     * @brief Automatically sets the attribute locations for a given Shader.
+     * @brief Brings quantized positions, normals and colors back to floats.
      *
-     * For every mesh attribute, the Shader will be queried for an attribute with the same name,
-     * if one is found they will linked.
-     * @param shader A pointer to the given shader.
+     * Values keep the precision lost when they were quantized.
      */
-    void setAttributeLocation (Shader *shader)
-    {       
-        for (unsigned int i = 0; i < vertex_attributes.size(); ++i)
+    void dequantizeAttributes (void)
+    {
+        VertexAttribute *va = getAttribute("in_Position");
+        if ( (va != NULL) && va->isNormalized() && (va->getType() == GL_UNSIGNED_SHORT) )
         {
-            GLint loc = shader->getAttributeLocation(vertex_attributes[i].getName().c_str());
-            vertex_attributes[i].setLocation(loc);
+            vector<char> packed;
+            readBackAttribute(*va, packed);
+
+            vector<float> values (packed.size()/sizeof(GLushort));
+            for (size_t i = 0; i < values.size(); ++i)
+            {
+                GLushort q;
+                std::memcpy(&q, &packed[i*sizeof(GLushort)], sizeof(q));
+                values[i] = position_offset[i % 3] + position_scale[i % 3] * (q / 65535.f);
+            }
+            loadAttribute("in_Position", values.data(), values.size(), 3);
+
+            position_scale = Eigen::Vector3f::Ones();
+            position_offset = Eigen::Vector3f::Zero();
         }
-        if (shader->getTessellationEvaluationShader() != 0)
-		{
-			primitiveType = PATCH;
-		}
-        
-    }
 
-	void setAttributeLocation (const Shader& shader)
-	{
-		setAttributeLocation((Shader*)(&shader));
-	}
+        va = getAttribute("in_Normal");
+        if ( (va != NULL) && va->isNormalized() && (va->getType() == GL_SHORT) )
+        {
+            vector<char> packed;
+            readBackAttribute(*va, packed);
+
+            const size_t count = va->getSize();
+            vector<float> values (3*count);
+            for (size_t i = 0; i < count; ++i)
+            {
+                GLshort q[2];
+                std::memcpy(q, &packed[2*i*sizeof(GLshort)], sizeof(q));
+
+                Eigen::Vector3f n (std::max(q[0] / 32767.f, -1.f), std::max(q[1] / 32767.f, -1.f), 0.f);
+                n[2] = 1.f - std::abs(n[0]) - std::abs(n[1]);
+                if ( n[2] < 0.f )
+                {
+                    const float x = (1.f - std::abs(n[1])) * ((n[0] >= 0.f) ? 1.f : -1.f);
+                    const float y = (1.f - std::abs(n[0])) * ((n[1] >= 0.f) ? 1.f : -1.f);
+                    n[0] = x;
+                    n[1] = y;
+                }
+                n.normalize();
+                std::memcpy(&values[3*i], n.data(), 3*sizeof(float));
+            }
+            loadAttribute("in_Normal", values.data(), values.size(), 3);
+        }
+
+        va = getAttribute("in_Color");
+        if ( (va != NULL) && va->isNormalized() && (va->getType() == GL_UNSIGNED_BYTE) )
+        {
+            vector<char> packed;
+            readBackAttribute(*va, packed);
 
+            vector<float> values (packed.size());
+            for (size_t i = 0; i < values.size(); ++i)
+            {
+                values[i] = static_cast<unsigned char>(packed[i]) / 255.f;
+            }
+            loadAttribute("in_Color", values.data(), values.size(), 4);
+        }
+    }
 
     /**
-     * @brief Sets the location of a generic vertex attribute.
-     * @param name Name of the given attribute
-     * @param loc Location of the attribute.
+     * @brief Returns whether positions, normals or colors are stored quantized.
+     * @return True if any of them was quantized.
      */
-    void setAttributeLocation (string name, GLint loc)
+    bool hasQuantizedAttributes (void)
     {
-        for (unsigned int i = 0; i < vertex_attributes.size(); ++i)
+        const char *names[3] = {"in_Position", "in_Normal", "in_Color"};
+        for (const char *name : names)
         {
-            if (!name.compare(vertex_attributes[i].getName()))
+            VertexAttribute *va = getAttribute(name);
+            if ( (va != NULL) && va->isNormalized() )
             {
-                vertex_attributes[i].setLocation(loc);
+                return true;
             }
         }
+
+        return false;
+    }
+
+    /**
+     * @brief Returns the extent of the box quantized positions are relative to.
+     * @return Per axis scale, ones if the positions are not quantized
+     */
+    const Eigen::Vector3f& getPositionScale (void) const
+    {
+        return position_scale;
     }
 
+    /**
+     * @brief Returns the corner of the box quantized positions are relative to.
+     * @return Per axis offset, zero if the positions are not quantized
+     */
+    const Eigen::Vector3f& getPositionOffset (void) const
+    {
+        return position_offset;
+    }
 
     /**
-     * @brief Creates and loads a new mesh attribute of 4 floats.
+     * @brief Sets the box quantized positions are relative to, for positions loaded already quantized.
+     * @param scale Extent of the box.
+     * @param offset Corner of the box.
+     */
+    void setPositionDecoding (const Eigen::Vector3f &scale, const Eigen::Vector3f &offset)
+    {
+        position_scale = scale;
+        position_offset = offset;
+    }
+
+    /**
+     * @brief Sets the uniforms a vertex shader needs to decode quantized attributes.
+     *
+     * Sets position_scale and position_offset (vec3) and octahedral_normals (bool); shaders
+     * without them only render meshes with float positions and normals.
+     * @param shader Shader bound for rendering the mesh.
+     */
+    void setDecodingUniforms (Shader &shader)
+    {
+        VertexAttribute *position = getAttribute("in_Position");
+        const bool quantized_position = (position != NULL) && position->isNormalized();
+        shader.setUniform("position_scale", quantized_position ? position_scale : Eigen::Vector3f::Ones().eval());
+        shader.setUniform("position_offset", quantized_position ? position_offset : Eigen::Vector3f::Zero().eval());
+
+        VertexAttribute *normal = getAttribute("in_Normal");
+        shader.setUniform("octahedral_normals", (normal != NULL) && normal->isNormalized() && (normal->getElementSize() == 2));
+    }
+
+    /**
+     * @brief Generates a GL buffer owned by a shared pointer.
+     * @return Shared pointer to the buffer id, the buffer is deleted with the last reference.
+     */
+    static std::shared_ptr < GLuint > createBuffer( void )
+    {
+        GLuint id = 0;
+        glGenBuffers(1, &id);
+
+        return std::shared_ptr < GLuint > ( 
+                    new GLuint (id),
+                    [] (GLuint *p) {
+                        glDeleteBuffers(1, p);
+                        delete p;
+                    }
+                    );
+    }
+
+    /**
+     * @brief Looks for an attribute whose GL buffer can be rewritten in place
+     *
+     * Live attributes are searched first, then the ones put aside by reset(true); a spare attribute
+     * that matches is moved back to the live attributes.
      * @param name Name of the attribute.
-     * @param attrib Array with new attribute.
-     * @return Pointer to created attribute
+     * @param num_elements Number of attribute values.
+     * @param element_size Number of elements per attribute value.
+     * @param type Type of the attribute elements.
+     * @return Pointer to the reusable attribute, or NULL if none has the same name and layout.
      */
-    VertexAttribute* createAttribute(string name, vector<Eigen::Vector4f> &attrib)
+    VertexAttribute* reusableAttribute( const string& name, int num_elements, int element_size, GLenum type )
     {
-        /* // create new vertex attribute */
-        /* VertexAttribute va (name, attrib.size(), 4, GL_FLOAT); */
+        auto matches = [&] ( const VertexAttribute &va ) {
+            return !va.getName().compare(name) && (va.getSize() == num_elements) 
+                && (va.getElementSize() == element_size) && (va.getType() == type);
+        };
 
-        /* float *attrib_array = new float[ va.getSize()*va.getElementSize() ]; */
-        std::vector<float> attrib_array( 4*attrib.size() );
+        // a spare attribute packed with others would leave the reloaded mesh interleaved
+        // behind the selected layout
+        auto reusable_spare = [&] ( const VertexAttribute &va ) {
+            return matches(va) && (!va.isInterleaved() || (vertexLayout == INTERLEAVED));
+        };
 
-        int temp = 0;
-        for(size_t i = 0; i < 4*attrib.size(); i+=4)
+        VertexAttribute *live = getAttribute(name);
+        if ( live != NULL )
         {
-            attrib_array[i] = attrib[temp][0];
-            attrib_array[i+1] = attrib[temp][1];
-            attrib_array[i+2] = attrib[temp][2];
-            attrib_array[i+3] = attrib[temp][3];
-            temp++;
+            return matches(*live) ? live : NULL;
         }
 
-        /* // fill buffer with attribute data */
-        /* va.bind(); */
-        /* glBufferData(va.getArrayType(), va.getSize()*va.getElementSize()*va.getTypeSize(), attrib_array, GL_STATIC_DRAW); */
-        /* va.unbind(); */
-
-        /* vertex_attributes.push_back(va); */
-        /* delete [] attrib_array; */
-        /* return &vertex_attributes[vertex_attributes.size()-1]; */
+        for (unsigned int i = 0; i < spare_attributes.size(); ++i)
+        {
+            if ( reusable_spare(spare_attributes[i]) )
+            {
+                VertexAttribute va = spare_attributes[i];
+                spare_attributes.erase(spare_attributes.begin() + i);
+                return pushAttribute(va);
+            }
+        }
 
-        return createAttribute4(std::move(name), attrib_array);
+        return NULL;
     }
-    
+
     /**
-     * @brief Creates and loads a new mesh attribute of 4 floats.
+     * @brief Creates and loads a mesh attribute of floats, rewriting the buffer of an attribute with
+     * the same name and layout instead of allocating new storage when possible.
      * @param name Name of the attribute.
-     * @param attrib Array with new attribute.
+     * @param attrib Pointer to the new attribute data, handed directly to the GL.
+     * @param size Number of floats in attrib.
+     * @param element_size Number of floats per attribute value.
      * @return Pointer to created attribute
      */
-    VertexAttribute* createAttribute4(string name, const vector<float> &attrib)
+    VertexAttribute* loadAttribute(string name, const float *attrib, size_t size, int element_size)
     {
+        const int num_elements = size/element_size;
+
+        VertexAttribute *reused = reusableAttribute(name, num_elements, element_size, GL_FLOAT);
+        if ( (reused != NULL) && (num_elements > 0) )
+        {
+            updateBufferWithAttribute(*reused, 0, attrib, num_elements);
+            return reused;
+        }
+
         // create new vertex attribute
-        VertexAttribute va (name, attrib.size()/4, 4, GL_FLOAT);
+        VertexAttribute va (name, num_elements, element_size, GL_FLOAT);
 
         // fill buffer with attribute data
-        /* va.bind(); */
-        /* glBufferData(va.getArrayType(), va.getSize()*va.getElementSize()*va.getTypeSize(), attrib.data(), GL_STATIC_DRAW); */
-        /* va.unbind(); */
         fillBufferWithAttribute(va, attrib);
 
-        /* vertex_attributes.push_back(va); */
-        /* return &vertex_attributes[vertex_attributes.size()-1]; */
         return pushAttribute(va);
     }
-    
+
     /**
-     * @brief Fill buffer with attribute data
+     * @brief Creates and loads a tightly packed attribute of any type, as read back by readBackAttributes().
      *
-     * @param va Vertex attribute whose buffer is meant to be filled.
-     * @param attrib Array with new attribute data.
+     * The vertex, normal, color, texture coordinate and instance counts follow the attribute's name and divisor.
+     * @param name Name of the attribute.
+     * @param attrib Pointer to count*element_size values of the given type, handed directly to the GL.
+     * @param count Number of attribute values.
+     * @param element_size Number of elements per attribute value.
+     * @param type Type of the attribute elements (ex. GL_FLOAT).
+     * @param divisor Number of instances sharing each value (0 for per-vertex attributes).
+     * @param normalized True if integer values are normalized when fetched by the shader.
+     * @return Pointer to created attribute
      */
-    void fillBufferWithAttribute( VertexAttribute &va, const std::vector<float> &attrib )
+    VertexAttribute* loadPackedAttribute(const string &name, const void *attrib, size_t count, int element_size, GLenum type, GLuint divisor = 0, bool normalized = false)
     {
-        // fill buffer with attribute data
-        va.bind();
-        glBufferData(va.getArrayType(), va.getSize()*va.getElementSize()*va.getTypeSize(), attrib.data(), GL_STATIC_DRAW);
-        va.unbind();
+        VertexAttribute *va = reusableAttribute(name, count, element_size, type);
+        if ( (va != NULL) && (count > 0) )
+        {
+            updateBufferWithAttribute(*va, 0, attrib, count);
+        }
+        else
+        {
+            VertexAttribute created (name, count, element_size, type);
+            fillBufferWithAttribute(created, attrib);
+            va = pushAttribute(created);
+        }
+        va->setDivisor(divisor);
+        va->setNormalized(normalized);
+
+        if ( divisor != 0 )
+        {
+            numberOfInstances = count;
+        }
+        else if ( !name.compare("in_Position") )
+        {
+            numberOfVertices = count;
+        }
+        else if ( !name.compare("in_Normal") )
+        {
+            numberOfNormals = count;
+        }
+        else if ( !name.compare("in_Color") )
+        {
+            numberOfColors = count;
+        }
+        else if ( !name.compare("in_TexCoords") )
+        {
+            numberOfTexCoords = count;
+        }
+
+        return va;
     }
 
     /**
@@ -1319,41 +2715,26 @@ public:
             vertex_attributes.push_back(va);
         }
 
+        // a new buffer has to be packed with the others
+        if ( (vertexLayout == INTERLEAVED) && !va.isInterleaved() )
+        {
+            vertexLayoutDirty = true;
+        }
+
         return &vertex_attributes[attrib_index];
     }
 
     /**
      * @brief Creates and loads a new mesh attribute of 3 floats.
+     *
+     * Eigen::Vector3f is tightly packed, so the vector storage is uploaded as is.
      * @param name Name of the attribute.
      * @param attrib Array with new attribute.
      * @return Pointer to created attribute
      */
-    VertexAttribute* createAttribute(string name, vector<Eigen::Vector3f> &attrib)
+    VertexAttribute* createAttribute(string name, const vector<Eigen::Vector3f> &attrib)
     {
-        /* // create new vertex attribute */
-        /* VertexAttribute va (name, attrib.size(), 3, GL_FLOAT); */
-
-        /* float *attrib_array = new float[ va.getSize()*va.getElementSize() ]; */
-        std::vector<float> attrib_array( 3*attrib.size() );
-
-        size_t temp = 0;
-        for(size_t i = 0; i < 3*attrib.size(); i+=3) {
-            attrib_array[i] = attrib[temp][0];
-            attrib_array[i+1] = attrib[temp][1];
-            attrib_array[i+2] = attrib[temp][2];
-            temp++;
-        }
-
-        /* // fill buffer with attribute data */
-        /* va.bind(); */
-        /* glBufferData(va.getArrayType(), va.getSize()*va.getElementSize()*va.getTypeSize(), attrib_array, GL_STATIC_DRAW); */
-        /* va.unbind(); */
-
-        /* vertex_attributes.push_back(va); */
-        /* delete [] attrib_array; */
-        /* return &vertex_attributes[vertex_attributes.size()-1]; */
-
-        return createAttribute3(std::move(name), attrib_array);
+        return createAttribute3(std::move(name), attrib.empty() ? nullptr : attrib.data()->data(), 3*attrib.size());
     }
 
     /**
@@ -1364,51 +2745,32 @@ public:
      */
     VertexAttribute* createAttribute3(string name, const vector<float> &attrib)
     {
-        // create new vertex attribute
-        VertexAttribute va (name, attrib.size()/3, 3, GL_FLOAT);
-
-        // fill buffer with attribute data
-        /* va.bind(); */
-        /* glBufferData(va.getArrayType(), va.getSize()*va.getElementSize()*va.getTypeSize(), attrib.data(), GL_STATIC_DRAW); */
-        /* va.unbind(); */
-        fillBufferWithAttribute(va, attrib);
+        return createAttribute3(std::move(name), attrib.data(), attrib.size());
+    }
 
-        /* vertex_attributes.push_back(va); */
-        /* return &vertex_attributes[vertex_attributes.size()-1]; */
-        return pushAttribute(va);
+    /**
+     * @brief Creates and loads a new mesh attribute of 3 floats.
+     * @param name Name of the attribute.
+     * @param attrib Pointer to the new attribute data, handed directly to the GL.
+     * @param size Number of floats in attrib.
+     * @return Pointer to created attribute
+     */
+    VertexAttribute* createAttribute3(string name, const float *attrib, size_t size)
+    {
+        return loadAttribute(std::move(name), attrib, size, 3);
     }
 
     /**
      * @brief Creates and loads a new mesh attribute of 2 floats.
+     *
+     * Eigen::Vector2f is tightly packed, so the vector storage is uploaded as is.
      * @param name Name of the attribute.
      * @param attrib Array with new attribute.
      * @return Pointer to created attribute
      */
-    VertexAttribute* createAttribute(string name, vector<Eigen::Vector2f> &attrib)
+    VertexAttribute* createAttribute(string name, const vector<Eigen::Vector2f> &attrib)
     {
-        /* // create new vertex attribute */
-        /* VertexAttribute va (name, attrib.size(), 2, GL_FLOAT); */
-
-        /* float * attrib_array = new float[va.getSize()*va.getElementSize()]; */
-        std::vector<float> attrib_array( 2*attrib.size() );
-
-        size_t temp = 0;
-        for(size_t i = 0; i < 2*attrib.size(); i+=2) {
-            attrib_array[i] = attrib[temp][0];
-            attrib_array[i+1] = attrib[temp][1];
-            temp++;
-        }
-
-        /* // fill buffer with attribute data */
-        /* va.bind(); */
-        /* glBufferData(va.getArrayType(), va.getSize()*va.getElementSize()*va.getTypeSize(), attrib_array, GL_STATIC_DRAW); */
-        /* va.unbind(); */
-
-        /* vertex_attributes.push_back(va); */
-        /* delete [] attrib_array; */
-        /* return &vertex_attributes[vertex_attributes.size()-1]; */
-
-        return createAttribute2(std::move(name), attrib_array);
+        return createAttribute2(std::move(name), attrib.empty() ? nullptr : attrib.data()->data(), 2*attrib.size());
     }
 
     /**
@@ -1419,18 +2781,40 @@ public:
      */
     VertexAttribute* createAttribute2(string name, const vector<float> &attrib)
     {
-        // create new vertex attribute
-        VertexAttribute va (name, attrib.size()/2, 2, GL_FLOAT);
+        return createAttribute2(std::move(name), attrib.data(), attrib.size());
+    }
 
-        // fill buffer with attribute data
-        /* va.bind(); */
-        /* glBufferData(va.getArrayType(), va.getSize()*va.getElementSize()*va.getTypeSize(), attrib.data(), GL_STATIC_DRAW); */
-        /* va.unbind(); */
-        fillBufferWithAttribute(va, attrib);
+    /**
+     * @brief Creates and loads a new mesh attribute of 2 floats.
+     * @param name Name of the attribute.
+     * @param attrib Pointer to the new attribute data, handed directly to the GL.
+     * @param size Number of floats in attrib.
+     * @return Pointer to created attribute
+     */
+    VertexAttribute* createAttribute2(string name, const float *attrib, size_t size)
+    {
+        return loadAttribute(std::move(name), attrib, size, 2);
+    }
 
-        /* vertex_attributes.push_back(va); */
-        /* return &vertex_attributes[vertex_attributes.size()-1]; */
-        return pushAttribute(va);
+    /**
+     * @brief Creates and loads a per-instance attribute of floats.
+     *
+     * The attribute advances once per instance instead of once per vertex, and the mesh is drawn
+     * once for each of its values with a single instanced draw call.  All instance attributes of a
+     * mesh must have the same number of values.
+     * @param name Name of the attribute.
+     * @param attrib Pointer to the new attribute data, handed directly to the GL.
+     * @param size Number of floats in attrib.
+     * @param element_size Number of floats per attribute value (1 to 4).
+     * @return Pointer to created attribute
+     */
+    VertexAttribute* createInstanceAttribute(string name, const float *attrib, size_t size, int element_size)
+    {
+        VertexAttribute *va = loadAttribute(std::move(name), attrib, size, element_size);
+        va->setDivisor(1);
+        numberOfInstances = va->getSize();
+
+        return va;
     }
 
 	/**
@@ -1465,10 +2849,16 @@ public:
     {
         assert (vao_sptr != 0);
 
+        updateVertexLayout();
+
 //        std::cout << *vao_sptr << std::endl;
         glBindVertexArray(*vao_sptr); //Vertex Array Object
 
-        if (*index_buffer_sptr)
+        if (lod_level > 0)
+        {
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, *lod_buffer_sptr);
+        }
+        else if (*index_buffer_sptr)
         {
             glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, *index_buffer_sptr);
         }
@@ -1499,6 +2889,54 @@ public:
         }
     }
 
+    /**
+     * @brief Draws the index buffer, once per instance if the mesh has instance attributes.
+     * @param mode Primitive type
+     */
+    void drawElements (GLenum mode)
+    {
+        // the selected level of detail, if any
+        GLsizei count = numberOfElements;
+        size_t first = 0;
+        if (lod_level > 0)
+        {
+            count = lod_sizes[lod_level-1];
+            first = std::accumulate(lod_sizes.begin(), lod_sizes.begin() + (lod_level-1), size_t(0));
+        }
+
+        if (numberOfInstances > 0)
+        {
+            glDrawElementsInstanced(mode, count, GL_UNSIGNED_INT, (GLvoid*)(first*sizeof(GLuint)), numberOfInstances);
+        }
+        else if (draw_ranges && (lod_level == 0))
+        {
+            if (!draw_counts.empty())
+            {
+                glMultiDrawElements(mode, draw_counts.data(), GL_UNSIGNED_INT, draw_offsets.data(), draw_counts.size());
+            }
+        }
+        else
+        {
+            glDrawElements(mode, count, GL_UNSIGNED_INT, (GLvoid*)(first*sizeof(GLuint)));
+        }
+    }
+
+    /**
+     * @brief Draws the vertices in order, once per instance if the mesh has instance attributes.
+     * @param mode Primitive type
+     */
+    void drawArrays (GLenum mode)
+    {
+        if (numberOfInstances > 0)
+        {
+            glDrawArraysInstanced(mode, 0, numberOfVertices, numberOfInstances);
+        }
+        else
+        {
+            glDrawArrays(mode, 0, numberOfVertices);
+        }
+    }
+
     /**
      * @brief Render only points. Uses index buffer if it is defined.
      */
@@ -1506,11 +2944,11 @@ public:
     {
 		if( numberOfElements > 0 )
 		{
-			glDrawElements( GL_POINTS, numberOfElements, GL_UNSIGNED_INT, (GLvoid*)0 );
+			drawElements( GL_POINTS );
 		}
 		else
 		{
-			glDrawArrays(GL_POINTS, 0, numberOfVertices);
+			drawArrays( GL_POINTS );
 		}
     }
 
@@ -1526,7 +2964,7 @@ public:
 		}
 		else
 		{
-			glDrawElements(GL_LINES, numberOfElements, GL_UNSIGNED_INT, (GLvoid*)0);
+			drawElements( GL_LINES );
 		}
     }
 
@@ -1542,7 +2980,7 @@ public:
 		}
 		else
 		{
-			glDrawElements(GL_TRIANGLES, numberOfElements, GL_UNSIGNED_INT, (GLvoid*)0);
+			drawElements( GL_TRIANGLES );
 		}
     }
 
@@ -1568,7 +3006,7 @@ public:
 		else
 		{
 			glPatchParameteri(GL_PATCH_VERTICES, 3);
-			glDrawElements(GL_PATCHES, numberOfElements,GL_UNSIGNED_INT, 0);
+			drawElements( GL_PATCHES );
 		}
     }
 
@@ -1588,6 +3026,7 @@ public:
             case TRIANGLE: renderElements(); break;
             case PATCH: renderPatches(); break;
         }
+        GLStateCache::Instance().countDrawCall();
 
         unbindBuffers();
     }
@@ -32,6 +32,9 @@ protected:
     /// Radius of the mesh bounding sphere.
     float radius = 1.0;
 
+    /// Axis aligned bounding box of the vertices, in object space (empty until vertices are loaded).
+    Eigen::AlignedBox3f bounding_box;
+
     /// The normalization scale factor, scales the model matrix to fit the model inside a unit cube.
     float normalization_scale = 1.0;
 
@@ -99,6 +102,32 @@ public:
      * @brief Returns the combined model and shape matrix.
      * @return Combine model and shape matrix as an Affine 3f matrix.
      */
+    /**
+     * @brief Returns the object space axis aligned bounding box of the vertices.
+     * @return Bounding box, empty if no vertices were loaded
+     */
+    const Eigen::AlignedBox3f& getBoundingBox (void) const
+    {
+        return bounding_box;
+    }
+
+    /**
+     * @brief Sets the bounds otherwise computed from the vertices, for models restored from a cache.
+     * @param box Axis-aligned bounding box.
+     * @param center Center of the bounding box.
+     * @param centroid_ Mean position of the vertices.
+     * @param radius_ Radius of the bounding sphere around the centroid.
+     * @param scale Normalization scale factor.
+     */
+    void setBounds (const Eigen::AlignedBox3f &box, const Eigen::Vector3f &center, const Eigen::Vector3f &centroid_, float radius_, float scale)
+    {
+        bounding_box = box;
+        objectCenter = center;
+        centroid = centroid_;
+        radius = radius_;
+        normalization_scale = scale;
+    }
+
     virtual Eigen::Affine3f getShapeModelMatrix ( void ) const
     {
         return model_matrix * shape_matrix;
@@ -24,11 +24,13 @@
 #define __TUCANOSHADER__
 
 #include "utils/misc.hpp"
+#include "glstatecache.hpp"
 
 #include <fstream>
 #include <vector>
 #include <Eigen/Dense>
 #include <memory>
+#include <cstring>
 
 using namespace std;
 
@@ -118,8 +120,121 @@ private:
     std::shared_ptr < GLuint > tessContID_sptr = 0;
     std::shared_ptr < GLuint > computeID_sptr = 0;
 
+    /**
+     * @brief Cached uniform and attribute locations of the linked program.
+     *
+     * Shared between copies of the shader, as they share the same program.
+     * Programs usually have a handful of active variables, so a linear search
+     * with strcmp is cheaper than hashing and does not allocate for each query.
+     */
+    struct LocationCache
+    {
+        vector< pair<string, GLint> > uniforms;
+        vector< pair<string, GLint> > attributes;
+    };
+
+    /// Shared pointer for the location cache, rebuilt every time the program is linked
+    std::shared_ptr < LocationCache > location_cache_sptr = 0;
+
+    /// Uniform block bindings, applied again every time the program is linked
+    vector< pair<string, GLuint> > uniform_block_bindings;
+
+    /**
+     * @brief Assigns a binding point to an uniform block of the linked program, if the block is active.
+     * @param block_name Name of the uniform block.
+     * @param binding Buffer binding point.
+     */
+    void applyUniformBlockBinding (const string &block_name, GLuint binding)
+    {
+        GLuint index = glGetUniformBlockIndex(*programID_sptr, block_name.c_str());
+        if (index != GL_INVALID_INDEX)
+            glUniformBlockBinding(*programID_sptr, index, binding);
+    }
+
+    /**
+     * @brief Counter of location queries issued to the driver by all shaders.
+     * @return Reference to the counter.
+     */
+    static unsigned long long& driverLocationQueries (void)
+    {
+        static unsigned long long queries = 0;
+        return queries;
+    }
+
+    /**
+     * @brief Searches a cached location, querying the driver and caching the result on a miss.
+     *
+     * Misses are cached as well (location -1), so names that are not active in the program
+     * do not reach the driver on every frame.
+     * @param cache List of cached locations.
+     * @param name Name of the variable in the shader.
+     * @param uniform If true queries an uniform location, otherwise an attribute location.
+     * @return The variable location, or -1 if not found.
+     */
+    GLint cachedLocation (vector< pair<string, GLint> > &cache, const GLchar* name, bool uniform) const
+    {
+        for (auto &entry : cache)
+        {
+            if (strcmp(entry.first.c_str(), name) == 0)
+                return entry.second;
+        }
+        ++driverLocationQueries();
+        GLint location = uniform ? glGetUniformLocation(*programID_sptr, name) : glGetAttribLocation(*programID_sptr, name);
+        cache.emplace_back(name, location);
+        return location;
+    }
+
+    /**
+     * @brief Rebuilds the location cache with all active uniforms and attributes of the program.
+     *
+     * Called after linking, since any previous location may have changed.
+     */
+    void buildLocationCache (void)
+    {
+        if (!location_cache_sptr)
+            location_cache_sptr = std::make_shared < LocationCache > ();
+        location_cache_sptr->uniforms.clear();
+        location_cache_sptr->attributes.clear();
+
+        GLint num_uniforms = 0, num_attribs = 0;
+        GLint max_uniform_length = 0, max_attrib_length = 0;
+        glGetProgramiv(*programID_sptr, GL_ACTIVE_UNIFORMS, &num_uniforms);
+        glGetProgramiv(*programID_sptr, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_uniform_length);
+        glGetProgramiv(*programID_sptr, GL_ACTIVE_ATTRIBUTES, &num_attribs);
+        glGetProgramiv(*programID_sptr, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH, &max_attrib_length);
+
+        vector<GLchar> name (std::max(std::max(max_uniform_length, max_attrib_length), 1));
+        GLsizei length = 0;
+        GLint size = 0;
+        GLenum type = 0;
+        for (GLint i = 0; i < num_uniforms; ++i)
+        {
+            glGetActiveUniform(*programID_sptr, i, name.size(), &length, &size, &type, name.data());
+            ++driverLocationQueries();
+            location_cache_sptr->uniforms.emplace_back(name.data(), glGetUniformLocation(*programID_sptr, name.data()));
+        }
+        for (GLint i = 0; i < num_attribs; ++i)
+        {
+            glGetActiveAttrib(*programID_sptr, i, name.size(), &length, &size, &type, name.data());
+            ++driverLocationQueries();
+            location_cache_sptr->attributes.emplace_back(name.data(), glGetAttribLocation(*programID_sptr, name.data()));
+        }
+    }
+
 public:
 
+    /**
+     * @brief Returns the number of uniform and attribute location queries issued to the driver.
+     *
+     * The count is global to all shaders. After the first frame, rendering with cached
+     * locations should not increase it.
+     * @return Number of glGetUniformLocation and glGetAttribLocation calls made so far.
+     */
+    static unsigned long long getDriverLocationQueries (void)
+    {
+        return driverLocationQueries();
+    }
+
     /**
      * @brief Copy Contructor
      * Copies the shader codes and recompiles to generate new program
@@ -526,6 +641,11 @@ public:
             std::cout << " Successfully linked : " << shaderName << std::endl << std::endl;
         }
         #endif
+
+        buildLocationCache();
+
+        for (auto &block : uniform_block_bindings)
+            applyUniformBlockBinding(block.first, block.second);
     }
 
 
@@ -1172,10 +1292,11 @@ public:
      * @brief Enables the shader program for usage.
      *
      * After enabling a shader any OpenGL draw call will use it for rendering.
+     * Goes through the GLStateCache, so binding an already bound program is skipped while caching.
      */
     void bind (void)
     {
-        glUseProgram(*programID_sptr);
+        GLStateCache::Instance().useProgram(*programID_sptr);
     }
 
     /**
@@ -1183,7 +1304,7 @@ public:
      */
     void unbind (void)
     {
-        glUseProgram(0);
+        GLStateCache::Instance().useProgram(0);
     }
 
     /**
@@ -1224,22 +1345,64 @@ public:
 
     /**
      * Given the name of a uniform used inside the shader, returns it's location.
+     *
+     * Locations are cached when the program is linked, so the driver is only queried
+     * for names that were not seen before. The returned location can be kept and passed
+     * to the location based setters, as long as the shader is not reloaded.
      * @param name Name of the uniform variable in shader.
      * @return The uniform location.
      */
     GLint getUniformLocation (const GLchar* name) const
     {
-        return glGetUniformLocation(*programID_sptr, name);
+        if (!location_cache_sptr)
+        {
+            ++driverLocationQueries();
+            return glGetUniformLocation(*programID_sptr, name);
+        }
+        return cachedLocation(location_cache_sptr->uniforms, name, true);
     }
 
     /**
      * Returns the location of an attribute, such as a vertex attribute
+     *
+     * As with uniforms, locations are cached and rebuilt when the program is linked.
      * @param name Name of the attribute variable in the shader.
      * @return The attribute location, or -1 if the attribute was not found or has an invalid name.
      */
     GLint getAttributeLocation (const GLchar* name) const
     {
-        return glGetAttribLocation(*programID_sptr, name);
+        if (!location_cache_sptr)
+        {
+            ++driverLocationQueries();
+            return glGetAttribLocation(*programID_sptr, name);
+        }
+        return cachedLocation(location_cache_sptr->attributes, name, false);
+    }
+
+    /**
+     * @brief Binds an uniform block of the shader to a buffer binding point.
+     *
+     * The binding is kept, so it survives reloading the shaders.
+     * Blocks not declared (or not used) in the shader are ignored.
+     * @param block_name Name of the uniform block in the shader.
+     * @param binding Binding point of the uniform buffer.
+     */
+    void setUniformBlockBinding (const GLchar* block_name, GLuint binding)
+    {
+        bool found = false;
+        for (auto &block : uniform_block_bindings)
+        {
+            if (block.first.compare(block_name) == 0)
+            {
+                block.second = binding;
+                found = true;
+            }
+        }
+        if (!found)
+            uniform_block_bindings.emplace_back(block_name, binding);
+
+        if (programID_sptr)
+            applyUniformBlockBinding(block_name, binding);
     }
 
     //============================Uniforms Setters==========================================================
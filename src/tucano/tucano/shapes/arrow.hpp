@@ -24,6 +24,7 @@
 #define __ARROW__
 
 #include <tucano/mesh.hpp>
+#include <tucano/camera.hpp>
 #include <Eigen/Dense>
 #include <cmath>
 
@@ -176,18 +177,25 @@ public:
 		#endif
 	}
 
-private:
-
 	/**
-	* @brief Define arrow geometry
+	* @brief Generates arrow geometry along the z axis, starting at the origin
 	*
+	* Used by createGeometry, and to share the arrow shape with other meshes (e.g. instanced glyphs).
+	* @param body_radius Radius of the body
+	* @param body_height Height of the body
+	* @param head_radius Radius of the head
+	* @param head_height Height of the head
 	* @param subdivisions Number of subdivisons for cap and body
+	* @param vert Output vertices
+	* @param norm Output normals
+	* @param faces Output triangle indices
 	*/
-	void createGeometry (int subdivisions)
+	static void generateGeometry (float body_radius, float body_height, float head_radius, float head_height, int subdivisions,
+			vector< Eigen::Vector4f > &vert, vector< Eigen::Vector3f > &norm, vector< GLuint > &faces)
 	{
-		vector< Eigen::Vector4f > vert;
-		vector< Eigen::Vector3f > norm;
-		vector< GLuint > faces;
+		vert.clear();
+		norm.clear();
+		faces.clear();
 
 		float x, y, theta;
 		// create vertices for top and bottom caps
@@ -275,6 +283,22 @@ private:
 			faces.push_back((i+1)%(subdivisions) + offset);
 			faces.push_back(center_index);
 		}
+	}
+
+private:
+
+	/**
+	* @brief Define arrow geometry
+	*
+	* @param subdivisions Number of subdivisons for cap and body
+	*/
+	void createGeometry (int subdivisions)
+	{
+		vector< Eigen::Vector4f > vert;
+		vector< Eigen::Vector3f > norm;
+		vector< GLuint > faces;
+
+		generateGeometry(body_radius, body_height, head_radius, head_height, subdivisions, vert, norm, faces);
 
 		loadVertices(vert);
 		loadNormals(norm);
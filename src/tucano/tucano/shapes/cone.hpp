@@ -24,6 +24,7 @@
 #define __CONE__
 
 #include <tucano/mesh.hpp>
+#include <tucano/camera.hpp>
 #include <Eigen/Dense>
 #include <cmath>
 
@@ -190,24 +191,23 @@ public:
 	}
 
 
-private:
-
-
 	/**
-	* @brief Define cone geometry
-	*
-	* Cone is created by creating one disk (cap) and a vertex, and generating triangles
-	* between them 
+	* @brief Generates cone geometry along the z axis, with its base at the origin
 	*
+	* Used by createGeometry, and to share the cone shape with other meshes (e.g. instanced glyphs).
+	* @param cone_radius Radius of the base
+	* @param cone_height Height of the apex
 	* @param subdivisions Number of subdivisons for cap and body
+	* @param vert Output vertices
+	* @param norm Output normals
+	* @param faces Output triangle indices
 	*/
-	void createGeometry (int subdivisions)
+	static void generateGeometry (float cone_radius, float cone_height, int subdivisions,
+			vector< Eigen::Vector4f > &vert, vector< Eigen::Vector3f > &norm, vector< GLuint > &faces)
 	{
-		reset();
-
-		vector< Eigen::Vector4f > vert;
-		vector< Eigen::Vector3f > norm;
-		vector< GLuint > faces;
+		vert.clear();
+		norm.clear();
+		faces.clear();
 
 		float x, y, theta;
 		// create vertices for body
@@ -252,7 +252,28 @@ private:
 			faces.push_back((i+1)%(subdivisions) + offset);
 			faces.push_back(center_index);
 		}
+	}
+
+private:
+
+
+	/**
+	* @brief Define cone geometry
+	*
+	* Cone is created by creating one disk (cap) and a vertex, and generating triangles
+	* between them 
+	*
+	* @param subdivisions Number of subdivisons for cap and body
+	*/
+	void createGeometry (int subdivisions)
+	{
+		reset();
+
+		vector< Eigen::Vector4f > vert;
+		vector< Eigen::Vector3f > norm;
+		vector< GLuint > faces;
 
+		generateGeometry(cone_radius, cone_height, subdivisions, vert, norm, faces);
 
 		loadVertices(vert);
 		loadNormals(norm);
@@ -24,6 +24,7 @@
 #define __CYLINDER__
 
 #include <tucano/mesh.hpp>
+#include <tucano/camera.hpp>
 #include <Eigen/Dense>
 #include <cmath>
 
@@ -186,21 +187,23 @@ public:
 		return cylinder_radius;
 	}
 
-private:
-
-
 	/**
-	* @brief Define cylinder geometry
-	*
-	* Cylinder is created by creating two disks (caps) and generating triangles between them
+	* @brief Generates a unit cylinder along the z axis, from z = 0 to z = 1
 	*
+	* Used by createGeometry, and to share the cylinder shape with other meshes (e.g. instanced glyphs).
+	* @param subs_xy Number of subdivisions around the axis
+	* @param subs_z Number of subdivisions along the axis
+	* @param with_cap Create top and bottom caps
+	* @param vert Output vertices
+	* @param norm Output normals
+	* @param faces Output triangle indices
 	*/
-	void createGeometry (int subs_xy, int subs_z)
+	static void generateGeometry (int subs_xy, int subs_z, bool with_cap,
+			vector< Eigen::Vector4f > &vert, vector< Eigen::Vector3f > &norm, vector< GLuint > &faces)
 	{
-
-		vector< Eigen::Vector4f > vert;
-		vector< Eigen::Vector3f > norm;
-		vector< GLuint > faces;
+		vert.clear();
+		norm.clear();
+		faces.clear();
 
 		float x, y, theta;
 
@@ -276,6 +279,25 @@ private:
                 faces.push_back((i+1)%(subs_xy) + offset);
             }
         }
+	}
+
+private:
+
+
+	/**
+	* @brief Define cylinder geometry
+	*
+	* Cylinder is created by creating two disks (caps) and generating triangles between them
+	*
+	*/
+	void createGeometry (int subs_xy, int subs_z)
+	{
+
+		vector< Eigen::Vector4f > vert;
+		vector< Eigen::Vector3f > norm;
+		vector< GLuint > faces;
+
+		generateGeometry(subs_xy, subs_z, with_cap, vert, norm, faces);
 
 		loadVertices(vert);
 		loadNormals(norm);
@@ -24,6 +24,7 @@
 #define __SPHERE__
 
 #include <tucano/mesh.hpp>
+#include <tucano/camera.hpp>
 #include <Eigen/Dense>
 #include <cmath>
 
@@ -158,21 +159,21 @@ public:
 		#endif
 	}
 
-private:
-
-
 	/**
-	* @brief Creates geometry for a unit-radius sphere
+	* @brief Generates a unit-radius sphere centered at the origin
 	*
-	* The sphere is created by starting with an octahedron and subdividing its triangles.
-	* For a nice reference, see: https://sites.google.com/site/dlampetest/python/triangulating-a-sphere-recursively
-	* No need to set normals, just use the positions in the shader since the values are the same.
+	* Used by createGeometry, and to share the sphere shape with other meshes (e.g. instanced glyphs).
+	* @param subdivisions The number of subdivisions applied to the base octahedron
+	* @param vert Output vertices
+	* @param norm Output normals, equal to the vertex positions
+	* @param faces Output triangle indices
 	*/
-	void createGeometry (int subdivisions)
+	static void generateGeometry (int subdivisions, vector< Eigen::Vector4f > &vert, vector< Eigen::Vector3f > &norm, vector< GLuint > &faces)
 	{
-		vector< Eigen::Vector4f > vert;
-		vector< GLuint > faces;
-	
+		vert.clear();
+		norm.clear();
+		faces.clear();
+
 		vert.push_back ( Eigen::Vector4f( 1.0, 0.0, 0.0, 1.0) );
 		vert.push_back ( Eigen::Vector4f(-1.0, 0.0, 0.0, 1.0) );
 		vert.push_back ( Eigen::Vector4f( 0.0, 1.0, 0.0, 1.0) );
@@ -213,6 +214,31 @@ private:
 			faces = sub_faces;
 		}
 
+		norm.resize(vert.size());
+		for (unsigned int i = 0; i < vert.size(); ++i)
+		{
+			norm[i] = vert[i].head<3>();
+		}
+	}
+
+private:
+
+
+	/**
+	* @brief Creates geometry for a unit-radius sphere
+	*
+	* The sphere is created by starting with an octahedron and subdividing its triangles.
+	* For a nice reference, see: https://sites.google.com/site/dlampetest/python/triangulating-a-sphere-recursively
+	* No need to set normals, just use the positions in the shader since the values are the same.
+	*/
+	void createGeometry (int subdivisions)
+	{
+		vector< Eigen::Vector4f > vert;
+		vector< Eigen::Vector3f > norm;
+		vector< GLuint > faces;
+
+		generateGeometry(subdivisions, vert, norm, faces);
+
 		loadVertices(vert);
 		loadIndices(faces);
 
@@ -25,3 +25,5 @@
 #include <tucano/framebuffer.hpp>
 #include <tucano/mesh.hpp>
 #include <tucano/camera.hpp>
+#include <tucano/frameuniforms.hpp>
+#include <tucano/glstatecache.hpp>
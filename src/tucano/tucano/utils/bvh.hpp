@@ -0,0 +1,682 @@
+/**
+ * Tucano - A library for rapid prototying with Modern OpenGL and GLSL
+ * Copyright (C) 2014
+ * LCG - Laboratório de Computação Gráfica (Computer Graphics Lab) - COPPE
+ * UFRJ - Federal University of Rio de Janeiro
+ *
+ * This file is part of Tucano Library.
+ *
+ * Tucano Library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Tucano Library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Tucano Library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __BVH__
+#define __BVH__
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <thread>
+#include <vector>
+
+#include <Eigen/Dense>
+
+#include <tucano/utils/meshoptimizer.hpp>
+
+
+namespace Tucano
+{
+
+/**
+ * @brief Bounding volume hierarchy over boxes, for casting rays against many primitives.
+ *
+ * build() splits the primitives top-down with the surface area heuristic,
+ * evaluated over a few bins of the primitive centers along the axis where they
+ * spread the most.  The two halves of large nodes are built on separate
+ * threads.  Nodes are stored depth first: the first child of an inner node
+ * follows it, the node keeps the index of the second.
+ *
+ * intersect() walks the nodes nearer to the ray origin first and leaves the
+ * primitives themselves to the caller, so the same hierarchy serves triangles
+ * (MeshBVH) and whole objects.
+ */
+class BVH
+{
+public:
+
+    /// Node of the hierarchy, 32 bytes
+    struct Node
+    {
+        float lower[3];
+        /// Second child of an inner node, or first primitive of a leaf in primitives()
+        GLuint offset;
+        float upper[3];
+        /// Number of primitives of a leaf, 0 for inner nodes
+        GLuint count;
+    };
+
+    /**
+     * @brief Builds the hierarchy over primitives given by their bounding boxes.
+     * @param num_primitives Number of primitives.
+     * @param bounds Callable returning the Eigen::AlignedBox3f of a primitive from its index; called from several threads.
+     * @param max_leaf Most primitives of a leaf.
+     */
+    template <class PrimitiveBounds>
+    void build (size_t num_primitives, const PrimitiveBounds &bounds, unsigned int max_leaf = 4)
+    {
+        clear();
+        if ( num_primitives == 0 )
+        {
+            return;
+        }
+
+        references.resize(num_primitives);
+        auto reference = [&] (size_t r, size_t num_ranges) {
+            const size_t begin = num_primitives*r/num_ranges, end = num_primitives*(r+1)/num_ranges;
+            for (size_t i = begin; i < end; ++i)
+            {
+                const Eigen::AlignedBox3f box = bounds(i);
+                for (int a = 0; a < 3; ++a)
+                {
+                    references[i].lower[a] = box.min()[a];
+                    references[i].upper[a] = box.max()[a];
+                }
+                references[i].primitive = static_cast<GLuint>(i);
+            }
+        };
+        const unsigned int threads = std::max(1u, std::thread::hardware_concurrency());
+        const size_t num_ranges = std::max<size_t>(1, std::min<size_t>(threads, num_primitives/min_parallel));
+        std::vector<std::thread> workers;
+        for (size_t r = 1; r < num_ranges; ++r)
+        {
+            workers.emplace_back(reference, r, num_ranges);
+        }
+        reference(0, num_ranges);
+        for (std::thread &worker : workers)
+        {
+            worker.join();
+        }
+
+        nodes.reserve(2*num_primitives/std::max(1u, max_leaf) + 1);
+        buildNode(0, num_primitives, 0, threads, std::max(1u, max_leaf), nodes);
+
+        order.resize(num_primitives);
+        for (size_t i = 0; i < num_primitives; ++i)
+        {
+            order[i] = references[i].primitive;
+        }
+        std::vector<Reference>().swap(references);
+    }
+
+    /**
+     * @brief Recomputes the node boxes after the primitives moved, keeping the tree.
+     *
+     * Much cheaper than build(), though rays slow down as the primitives drift away
+     * from the arrangement the tree was built for.
+     * @param bounds Callable returning the Eigen::AlignedBox3f of a primitive from its index.
+     */
+    template <class PrimitiveBounds>
+    void refit (const PrimitiveBounds &bounds)
+    {
+        // children follow their parent, so walking backwards reaches them first
+        for (size_t n = nodes.size(); n-- > 0; )
+        {
+            Node &node = nodes[n];
+            Eigen::AlignedBox3f box;
+            if ( node.count > 0 )
+            {
+                for (GLuint i = node.offset; i < node.offset + node.count; ++i)
+                {
+                    box.extend(bounds(order[i]));
+                }
+            }
+            else
+            {
+                box = nodeBox(nodes[n + 1]).merged(nodeBox(nodes[node.offset]));
+            }
+            for (int a = 0; a < 3; ++a)
+            {
+                node.lower[a] = box.min()[a];
+                node.upper[a] = box.max()[a];
+            }
+        }
+    }
+
+    /**
+     * @brief Finds the nearest primitive hit by a ray.
+     * @param origin Ray origin.
+     * @param direction Ray direction, not necessarily of unit length.
+     * @param t_max Farthest ray parameter looked at; lowered by the hits found.
+     * @param hit Callable (primitive, t_max) that intersects a primitive and lowers t_max if hit nearer, returning true then.
+     * @return True if a primitive was hit before t_max.
+     */
+    template <class PrimitiveHit>
+    bool intersect (const Eigen::Vector3f &origin, const Eigen::Vector3f &direction, float &t_max, const PrimitiveHit &hit) const
+    {
+        float t_near;
+        if ( nodes.empty() )
+        {
+            return false;
+        }
+
+        const Eigen::Vector3f inverse = direction.cwiseInverse();
+        if ( !slab(nodes[0], origin, inverse, t_max, t_near) )
+        {
+            return false;
+        }
+
+        // pending far children with the ray parameter at which they are entered
+        GLuint stack_nodes[max_depth];
+        float stack_near[max_depth];
+        int top = 0;
+        bool found = false;
+        GLuint index = 0;
+        while ( true )
+        {
+            const Node &node = nodes[index];
+            if ( node.count > 0 )
+            {
+                for (GLuint i = node.offset; i < node.offset + node.count; ++i)
+                {
+                    found |= hit(order[i], t_max);
+                }
+            }
+            else
+            {
+                float t_first, t_second;
+                const bool first = slab(nodes[index + 1], origin, inverse, t_max, t_first);
+                const bool second = slab(nodes[node.offset], origin, inverse, t_max, t_second);
+                if ( first && second )
+                {
+                    const bool swap = (t_second < t_first);
+                    stack_nodes[top] = swap ? index + 1 : node.offset;
+                    stack_near[top++] = swap ? t_first : t_second;
+                    index = swap ? node.offset : index + 1;
+                    continue;
+                }
+                if ( first || second )
+                {
+                    index = first ? index + 1 : node.offset;
+                    continue;
+                }
+            }
+
+            // skip the nodes entered beyond the nearest hit so far
+            while ( (top > 0) && (stack_near[top-1] > t_max) )
+            {
+                --top;
+            }
+            if ( top == 0 )
+            {
+                break;
+            }
+            index = stack_nodes[--top];
+        }
+
+        return found;
+    }
+
+    /**
+     * @brief Returns the bounding box of all primitives, empty without them.
+     */
+    Eigen::AlignedBox3f bounds (void) const
+    {
+        if ( nodes.empty() )
+        {
+            return Eigen::AlignedBox3f();
+        }
+        return nodeBox(nodes[0]);
+    }
+
+    /**
+     * @brief Returns the number of nodes.
+     */
+    size_t size (void) const
+    {
+        return nodes.size();
+    }
+
+    /**
+     * @brief Returns the primitives in the order the leaves refer to them.
+     */
+    const std::vector<GLuint>& primitives (void) const
+    {
+        return order;
+    }
+
+    /**
+     * @brief Drops the hierarchy.
+     */
+    void clear (void)
+    {
+        std::vector<Node>().swap(nodes);
+        std::vector<GLuint>().swap(order);
+        std::vector<Reference>().swap(references);
+    }
+
+private:
+
+    static Eigen::AlignedBox3f nodeBox (const Node &node)
+    {
+        return Eigen::AlignedBox3f(Eigen::Vector3f(node.lower[0], node.lower[1], node.lower[2]),
+                                   Eigen::Vector3f(node.upper[0], node.upper[1], node.upper[2]));
+    }
+
+    /// Ray parameter at which the ray enters a node, if before t_max
+    static bool slab (const Node &node, const Eigen::Vector3f &origin, const Eigen::Vector3f &inverse, float t_max, float &t_near)
+    {
+        float t_far = t_max;
+        t_near = 0.f;
+        for (int a = 0; a < 3; ++a)
+        {
+            const float t0 = (node.lower[a] - origin[a])*inverse[a];
+            const float t1 = (node.upper[a] - origin[a])*inverse[a];
+            t_near = std::max(t_near, std::min(t0, t1));
+            t_far = std::min(t_far, std::max(t0, t1));
+        }
+        return t_near <= t_far;
+    }
+
+    /// Bounding box of a primitive while building
+    struct Reference
+    {
+        float lower[3];
+        float upper[3];
+        GLuint primitive;
+    };
+
+    /// Box as a pair of corners, cheaper to grow than Eigen::AlignedBox3f in the build loops
+    struct Box
+    {
+        float lower[3] = { std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max() };
+        float upper[3] = { -std::numeric_limits<float>::max(), -std::numeric_limits<float>::max(), -std::numeric_limits<float>::max() };
+
+        void extend (const float *low, const float *high)
+        {
+            for (int a = 0; a < 3; ++a)
+            {
+                lower[a] = std::min(lower[a], low[a]);
+                upper[a] = std::max(upper[a], high[a]);
+            }
+        }
+
+        /// Surface area, up to a factor of 2
+        float halfArea (void) const
+        {
+            const float dx = upper[0] - lower[0], dy = upper[1] - lower[1], dz = upper[2] - lower[2];
+            return (dx < 0.f) ? 0.f : dx*dy + dy*dz + dz*dx;
+        }
+    };
+
+    /// Twice the center of a primitive's box along an axis
+    static float center (const Reference &r, int axis)
+    {
+        return r.lower[axis] + r.upper[axis];
+    }
+
+    /// Builds the subtree of references[begin, end), appending it to out; children may go to other threads
+    void buildNode (size_t begin, size_t end, int depth, unsigned int threads, unsigned int max_leaf, std::vector<Node> &out)
+    {
+        Box box, center_box;
+        for (size_t i = begin; i < end; ++i)
+        {
+            const Reference &r = references[i];
+            const float c[3] = { center(r, 0), center(r, 1), center(r, 2) };
+            box.extend(r.lower, r.upper);
+            center_box.extend(c, c);
+        }
+
+        const size_t index = out.size();
+        out.push_back(Node());
+        std::copy(box.lower, box.lower + 3, out[index].lower);
+        std::copy(box.upper, box.upper + 3, out[index].upper);
+
+        const size_t n = end - begin;
+        size_t middle = (depth < max_sah_depth) ? splitSah(begin, end, max_leaf, box, center_box) : begin;
+        if ( (middle == begin) && (n > max_leaf) )
+        {
+            // no split pays off, all centers coincide or the tree is too deep already: halve by count
+            int axis = 0;
+            for (int a = 1; a < 3; ++a)
+            {
+                if ( center_box.upper[a] - center_box.lower[a] > center_box.upper[axis] - center_box.lower[axis] )
+                {
+                    axis = a;
+                }
+            }
+            middle = begin + n/2;
+            std::nth_element(references.begin() + begin, references.begin() + middle, references.begin() + end,
+                    [axis] (const Reference &a, const Reference &b) { return center(a, axis) < center(b, axis); });
+        }
+        if ( middle == begin )
+        {
+            out[index].offset = static_cast<GLuint>(begin);
+            out[index].count = static_cast<GLuint>(n);
+            return;
+        }
+        out[index].count = 0;
+
+        if ( (threads > 1) && (n >= min_parallel) )
+        {
+            std::vector<Node> first, second;
+            std::thread worker ([&] () {
+                buildNode(begin, middle, depth + 1, threads/2, max_leaf, first);
+            });
+            buildNode(middle, end, depth + 1, threads - threads/2, max_leaf, second);
+            worker.join();
+
+            append(first, index + 1, out);
+            out[index].offset = static_cast<GLuint>(out.size());
+            append(second, out.size(), out);
+        }
+        else
+        {
+            buildNode(begin, middle, depth + 1, 1, max_leaf, out);
+            out[index].offset = static_cast<GLuint>(out.size());
+            buildNode(middle, end, depth + 1, 1, max_leaf, out);
+        }
+    }
+
+    /// Moves a subtree built on its own to position base of out
+    static void append (const std::vector<Node> &subtree, size_t base, std::vector<Node> &out)
+    {
+        for (Node node : subtree)
+        {
+            if ( node.count == 0 )
+            {
+                node.offset += static_cast<GLuint>(base);
+            }
+            out.push_back(node);
+        }
+    }
+
+    /// Partitions references[begin, end) at the cheapest binned split; returns begin if a leaf is cheaper
+    size_t splitSah (size_t begin, size_t end, unsigned int max_leaf, const Box &box, const Box &center_box)
+    {
+        const size_t n = end - begin;
+        if ( n <= 1 )
+        {
+            return begin;
+        }
+
+        // bins along the axis where the centers spread the most, as in Wald's binned builder
+        int axis = 0;
+        for (int a = 1; a < 3; ++a)
+        {
+            if ( center_box.upper[a] - center_box.lower[a] > center_box.upper[axis] - center_box.lower[axis] )
+            {
+                axis = a;
+            }
+        }
+        const float low = center_box.lower[axis], extent = center_box.upper[axis] - low;
+        if ( !(extent > 0.f) )
+        {
+            return begin;
+        }
+        const float scale = num_bins/extent;
+
+        Box bins[num_bins];
+        size_t counts[num_bins] = {};
+        for (size_t i = begin; i < end; ++i)
+        {
+            const Reference &r = references[i];
+            const int b = std::min(num_bins - 1, static_cast<int>((center(r, axis) - low)*scale));
+            bins[b].extend(r.lower, r.upper);
+            ++counts[b];
+        }
+
+        float right_area[num_bins];
+        size_t right_count[num_bins];
+        Box right;
+        size_t count = 0;
+        for (int b = num_bins - 1; b > 0; --b)
+        {
+            right.extend(bins[b].lower, bins[b].upper);
+            count += counts[b];
+            right_area[b] = right.halfArea();
+            right_count[b] = count;
+        }
+
+        // cost of a node relative to a primitive test, per unit of area of the parent
+        const float area = box.halfArea();
+        float best_cost = (n <= max_leaf) ? static_cast<float>(n) : std::numeric_limits<float>::max();
+        int best_bin = 0;
+        Box left;
+        count = 0;
+        for (int b = 1; b < num_bins; ++b)
+        {
+            left.extend(bins[b-1].lower, bins[b-1].upper);
+            count += counts[b-1];
+            if ( (count == 0) || (right_count[b] == 0) )
+            {
+                continue;
+            }
+            const float cost = traversal_cost + (left.halfArea()*count + right_area[b]*right_count[b])/area;
+            if ( cost < best_cost )
+            {
+                best_cost = cost;
+                best_bin = b;
+            }
+        }
+
+        if ( best_bin == 0 )
+        {
+            return begin;
+        }
+
+        auto middle = std::partition(references.begin() + begin, references.begin() + end, [&] (const Reference &r) {
+            return std::min(num_bins - 1, static_cast<int>((center(r, axis) - low)*scale)) < best_bin;
+        });
+        return static_cast<size_t>(middle - references.begin());
+    }
+
+    /// Bins of primitive centers when looking for a split
+    static const int num_bins = 16;
+
+    /// Cost of visiting a node, relative to a primitive test
+    static constexpr float traversal_cost = 1.f;
+
+    /// Smallest number of primitives handed to a thread
+    static const size_t min_parallel = 1u << 16;
+
+    /// Depth below which nodes are halved by count, which adds at most 32 levels for 32 bit primitive indices
+    static const int max_sah_depth = 64;
+
+    /// Deepest path intersect() can walk
+    static const int max_depth = 128;
+
+    /// Nodes, depth first from the root
+    std::vector<Node> nodes;
+
+    /// Primitives in leaf order
+    std::vector<GLuint> order;
+
+    /// Primitive boxes while building, reordered into the leaves
+    std::vector<Reference> references;
+};
+
+/**
+ * @brief Bounding volume hierarchy over the triangles of a mesh, for picking on the CPU.
+ *
+ * Keeps its own copy of the vertex positions and triangles, so rays are
+ * cast without reading anything back from the GPU.  update() moves vertices
+ * and refits the boxes instead of building the hierarchy again.
+ */
+class MeshBVH
+{
+public:
+
+    /**
+     * @brief Builds the hierarchy over triangles.
+     * @param xyz Packed (x,y,z) vertex coordinates, kept by the hierarchy.
+     * @param ind Triangles (indices on the vertices' list), kept by the hierarchy.
+     * @return False if an index is out of range or there are no triangles, leaving the hierarchy empty.
+     */
+    bool build (std::vector<float> &&xyz, std::vector<GLuint> &&ind)
+    {
+        clear();
+        const size_t num_triangles = ind.size()/3;
+        if ( (num_triangles == 0) || !MeshOptimizer::Internal::validIndices(ind.data(), 3*num_triangles, xyz.size()/3) )
+        {
+            return false;
+        }
+
+        positions = std::move(xyz);
+        indices = std::move(ind);
+        indices.resize(3*num_triangles);
+
+        bvh.build(num_triangles, [this] (size_t t) { return triangleBounds(t); });
+
+        return true;
+    }
+
+    /**
+     * @brief Moves a range of vertices and refits the hierarchy to them.
+     * @param first First vertex moved.
+     * @param xyz Packed (x,y,z) coordinates of the moved vertices.
+     * @param size Number of floats in xyz.
+     * @return False if the hierarchy is empty or the range is out of its vertices, changing nothing.
+     */
+    bool update (size_t first, const float *xyz, size_t size)
+    {
+        if ( indices.empty() || (xyz == nullptr) || (size % 3 != 0) || (3*first + size > positions.size()) )
+        {
+            return false;
+        }
+
+        std::copy(xyz, xyz + size, positions.begin() + 3*first);
+        bvh.refit([this] (size_t t) { return triangleBounds(t); });
+
+        return true;
+    }
+
+    /**
+     * @brief Finds the nearest triangle hit by a ray, from either side.
+     * @param origin Ray origin.
+     * @param direction Ray direction, not necessarily of unit length.
+     * @param t Farthest ray parameter looked at; set to the parameter of the hit.
+     * @param triangle Set to the index of the triangle hit (its vertices are indices 3*triangle to 3*triangle+2).
+     * @param u Set to the weight of the triangle's second vertex at the hit point.
+     * @param v Set to the weight of the triangle's third vertex at the hit point.
+     * @return True if a triangle was hit before t.
+     */
+    bool intersect (const Eigen::Vector3f &origin, const Eigen::Vector3f &direction, float &t, size_t &triangle, float &u, float &v) const
+    {
+        return bvh.intersect(origin, direction, t, [&] (GLuint p, float &t_max) {
+            // Moller-Trumbore
+            const size_t i = 3*static_cast<size_t>(p);
+            const Eigen::Vector3f a = vertex(indices[i]);
+            const Eigen::Vector3f e1 = vertex(indices[i+1]) - a, e2 = vertex(indices[i+2]) - a;
+            const Eigen::Vector3f q = direction.cross(e2);
+            const float det = e1.dot(q);
+            if ( det == 0.f )
+            {
+                return false;
+            }
+            const float inv_det = 1.f/det;
+            const Eigen::Vector3f s = origin - a;
+            const float bu = s.dot(q)*inv_det;
+            if ( (bu < 0.f) || (bu > 1.f) )
+            {
+                return false;
+            }
+            const Eigen::Vector3f r = s.cross(e1);
+            const float bv = direction.dot(r)*inv_det;
+            if ( (bv < 0.f) || (bu + bv > 1.f) )
+            {
+                return false;
+            }
+            const float th = e2.dot(r)*inv_det;
+            if ( (th < 0.f) || (th >= t_max) )
+            {
+                return false;
+            }
+
+            t_max = th;
+            triangle = p;
+            u = bu;
+            v = bv;
+            return true;
+        });
+    }
+
+    /**
+     * @brief Returns the bounding box of the triangles, empty without them.
+     */
+    Eigen::AlignedBox3f bounds (void) const
+    {
+        return bvh.bounds();
+    }
+
+    /**
+     * @brief Returns the number of triangles.
+     */
+    size_t size (void) const
+    {
+        return indices.size()/3;
+    }
+
+    /**
+     * @brief Returns the packed (x,y,z) vertex coordinates kept by the hierarchy.
+     */
+    const std::vector<float>& coordinates (void) const
+    {
+        return positions;
+    }
+
+    /**
+     * @brief Returns the triangles kept by the hierarchy.
+     */
+    const std::vector<GLuint>& triangles (void) const
+    {
+        return indices;
+    }
+
+    /**
+     * @brief Drops the hierarchy and its copy of the mesh.
+     */
+    void clear (void)
+    {
+        bvh.clear();
+        std::vector<float>().swap(positions);
+        std::vector<GLuint>().swap(indices);
+    }
+
+private:
+
+    Eigen::AlignedBox3f triangleBounds (size_t t) const
+    {
+        Eigen::AlignedBox3f box (vertex(indices[3*t]));
+        box.extend(vertex(indices[3*t + 1]));
+        box.extend(vertex(indices[3*t + 2]));
+        return box;
+    }
+
+    Eigen::Vector3f vertex (GLuint v) const
+    {
+        return Eigen::Vector3f(positions[3*static_cast<size_t>(v)], positions[3*static_cast<size_t>(v) + 1], positions[3*static_cast<size_t>(v) + 2]);
+    }
+
+    /// Hierarchy over the triangles
+    BVH bvh;
+
+    /// Packed (x,y,z) vertex coordinates
+    std::vector<float> positions;
+
+    /// Triangles, in the order of the mesh
+    std::vector<GLuint> indices;
+};
+
+}
+
+#endif
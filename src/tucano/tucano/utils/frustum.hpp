@@ -5,7 +5,7 @@
 #include <vector>
 #include <Eigen/Dense>
 #include <Eigen/Geometry>
-#include <camera.hpp>
+#include <tucano/camera.hpp>
 
 using namespace std;
 using namespace Eigen;
@@ -103,6 +103,10 @@ namespace Tucano
 		
 		const Matrix4f& viewProj() const { return m_viewProj; }
 		
+		/** @returns the i-th frustum plane, in the order left, right, top, bottom, near, far. Its normal points
+		 * outwards and has unit length. */
+		const Plane& plane( const int i ) const { return *m_planes[ i ]; }
+		
 	private:
 		/** Algorithm for extraction of the 6 frustum planes from the model-view-projection matrix as explained in paper
 		 * Fast Extraction of Viewing Frustum Planes from the World-View-Projection Matrix. Available in
@@ -175,21 +179,15 @@ namespace Tucano
 	{
 		//cout << "==== Starting culling ====" << endl << "Box: " << box << endl;
 		
-		Vector3f boxSizes = box.sizes();
 		Vector3f boxMin = box.min();
 		Vector3f boxMax = box.max();
 		
-		// Performs frustum plane dilatation, finds n only, since p is necessary just for detecting intersections points,
-		// and verifies if n is inside or outside the frustum.
+		// Plane normals point outwards, so it is enough to check the box corner farthest along -normal (the n vertex):
+		// if even that corner is in front of a plane the whole box is outside the frustum.
 		for( int i = 0; i < 6; ++i )
 		{
 			Plane* plane = m_planes[ i ];
 			Vector3f normal = plane->normal();
-			float dilatation = abs( boxSizes.dot( normal ) );
-			float offset = plane->offset() - dilatation;
-			Plane dilatatedPlane( normal, offset );
-			
-			//cout << endl << "Dilatation:" << dilatation << endl << "Dilatated plane:" << dilatatedPlane << endl;
 			
 			Vector3f n;
 			
@@ -197,7 +195,7 @@ namespace Tucano
 			n[ 1 ] = ( normal[ 1 ] < 0 ) ? boxMax[ 1 ] : boxMin[ 1 ];
 			n[ 2 ] = ( normal[ 2 ] < 0 ) ? boxMax[ 2 ] : boxMin[ 2 ];
 			
-			float signedDist = dilatatedPlane.signedDistance( n );
+			float signedDist = plane->signedDistance( n );
 			//cout << "n point: " << n << endl << "signedDist:" << signedDist << endl;
 			
 			if( signedDist > 0 )
@@ -0,0 +1,180 @@
+/**
+ * Tucano - A library for rapid prototying with Modern OpenGL and GLSL
+ * Copyright (C) 2014
+ * LCG - Laboratório de Computação Gráfica (Computer Graphics Lab) - COPPE
+ * UFRJ - Federal University of Rio de Janeiro
+ *
+ * This file is part of Tucano Library.
+ *
+ * Tucano Library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Tucano Library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Tucano Library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __MAPPEDFILE__
+#define __MAPPEDFILE__
+
+#include <cstddef>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define TUCANO_MAPPED_FILE_MMAP
+#endif
+
+
+namespace Tucano
+{
+
+/**
+ * @brief Read-only view of a whole file in memory.
+ *
+ * On POSIX systems the file is memory mapped, so its pages come straight
+ * from the page cache and are read ahead sequentially; reloading a file that
+ * is still cached costs little more than a memcpy.  Elsewhere the file is
+ * read into a heap buffer.
+ */
+class MappedFile
+{
+public:
+
+    MappedFile () = default;
+
+    MappedFile (const MappedFile &) = delete;
+    MappedFile& operator= (const MappedFile &) = delete;
+
+    ~MappedFile ()
+    {
+        close();
+    }
+
+    /**
+     * @brief Maps a file.
+     * @param filename Name of the file.
+     * @return True if the file could be opened (an empty file gives a null data() and zero size()).
+     */
+    bool open (const std::string &filename)
+    {
+        close();
+
+        #ifdef TUCANO_MAPPED_FILE_MMAP
+        int fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            return false;
+        }
+
+        struct stat info;
+        if ( (fstat(fd, &info) != 0) || !S_ISREG(info.st_mode) )
+        {
+            ::close(fd);
+            return false;
+        }
+
+        file_size = static_cast<size_t>(info.st_size);
+        if (file_size > 0)
+        {
+            void *address = mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (address != MAP_FAILED)
+            {
+                mapping = address;
+                file_data = static_cast<const char*>(address);
+
+                // the readers walk the file front to back
+                madvise(address, file_size, MADV_SEQUENTIAL);
+            }
+        }
+        ::close(fd);
+
+        if ( (file_size == 0) || (mapping != nullptr) )
+        {
+            return true;
+        }
+        #endif
+
+        // no mmap: read the file instead
+        std::ifstream in(filename, std::ios::binary | std::ios::ate);
+        if (!in)
+        {
+            file_size = 0;
+            return false;
+        }
+
+        contents.resize(static_cast<size_t>(in.tellg()));
+        in.seekg(0);
+        in.read(contents.data(), contents.size());
+        if (static_cast<size_t>(in.gcount()) != contents.size())
+        {
+            close();
+            return false;
+        }
+
+        file_data = contents.data();
+        file_size = contents.size();
+
+        return true;
+    }
+
+    /**
+     * @brief Unmaps the file.
+     */
+    void close ()
+    {
+        #ifdef TUCANO_MAPPED_FILE_MMAP
+        if (mapping != nullptr)
+        {
+            munmap(mapping, file_size);
+        }
+        #endif
+
+        mapping = nullptr;
+        contents.clear();
+        contents.shrink_to_fit();
+        file_data = nullptr;
+        file_size = 0;
+    }
+
+    /**
+     * @brief Pointer to the first byte of the file.
+     */
+    const char* data () const
+    {
+        return file_data;
+    }
+
+    /**
+     * @brief Size of the file in bytes.
+     */
+    size_t size () const
+    {
+        return file_size;
+    }
+
+private:
+
+    /// Address returned by mmap, null if the file is not mapped
+    void *mapping = nullptr;
+
+    /// File contents, when it could not be mapped
+    std::vector<char> contents;
+
+    const char *file_data = nullptr;
+    size_t file_size = 0;
+};
+
+}
+#endif
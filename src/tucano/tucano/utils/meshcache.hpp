@@ -0,0 +1,464 @@
+/**
+ * Tucano - A library for rapid prototying with Modern OpenGL and GLSL
+ * Copyright (C) 2014
+ * LCG - Laboratório de Computação Gráfica (Computer Graphics Lab) - COPPE
+ * UFRJ - Federal University of Rio de Janeiro
+ *
+ * This file is part of Tucano Library.
+ *
+ * Tucano Library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Tucano Library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Tucano Library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __MESHCACHE__
+#define __MESHCACHE__
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include <sys/stat.h>
+
+#include <tucano/mesh.hpp>
+#include <tucano/utils/mappedfile.hpp>
+
+using namespace std;
+
+namespace Tucano
+{
+
+namespace MeshImporter
+{
+
+/**
+ * @brief Identifies the version of a source file a mesh cache was built from.
+ *
+ * The hash only covers the first and last 64 KiB of the file and its size,
+ * so that checking a cache against a large source stays cheap; an edit that
+ * keeps the size and the modification time and only touches the middle of
+ * the file goes unnoticed.
+ */
+struct MeshCacheSource
+{
+    uint64_t size = 0;
+    int64_t mtime = 0;
+    uint64_t hash = 0;
+
+    bool operator== (const MeshCacheSource &other) const
+    {
+        return (size == other.size) && (mtime == other.mtime) && (hash == other.hash);
+    }
+};
+
+/**
+ * @brief Everything stored in a mesh cache besides the mesh itself.
+ */
+struct MeshCacheInfo
+{
+    /// Source file the mesh was read from, all zeros if none
+    MeshCacheSource source;
+
+    /// Texture image used by the mesh, empty if none
+    string texture_file;
+
+    /// Values kept on behalf of the application
+    uint32_t user_data[4] = {0, 0, 0, 0};
+};
+
+/// Layout of the mesh cache files, all numbers in the byte order of the machine that wrote them
+namespace MeshCacheFormat
+{
+    const char magic[8] = {'T', 'U', 'C', 'M', 'E', 'S', 'H', '\0'};
+    const uint32_t version = 2;
+    const uint32_t byte_order = 0x01020304;
+
+    /// Data blocks start at multiples of this many bytes
+    const uint64_t alignment = 64;
+
+    /// First bytes of the file
+    struct Header
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t byte_order;
+
+        uint64_t source_size;
+        int64_t source_mtime;
+        uint64_t source_hash;
+
+        float box_min[3];
+        float box_max[3];
+        float center[3];
+        float centroid[3];
+        float radius;
+        float normalization_scale;
+        float color[4];
+
+        uint32_t primitive;
+        uint32_t layout;
+        uint32_t num_attributes;
+        uint32_t texture_length;
+        uint64_t num_indices;
+        uint64_t indices_offset;
+        uint32_t user_data[4];
+
+        /// Decoding of quantized positions, see Mesh::quantizePositions()
+        float position_scale[3];
+        float position_offset[3];
+    };
+
+    /// One entry per vertex attribute, right after the header; the texture name follows the table
+    struct Attribute
+    {
+        char name[32];
+        uint32_t type;
+        uint32_t element_size;
+        uint32_t divisor;
+        /// Bit 0: integer values are normalized
+        uint32_t flags;
+        uint64_t count;
+        uint64_t offset;
+        uint64_t bytes;
+    };
+
+    static_assert(sizeof(Header) == 184, "unexpected mesh cache header padding");
+    static_assert(sizeof(Attribute) == 72, "unexpected mesh cache attribute padding");
+
+    /// Size in bytes of the attribute types a cache may hold, 0 for any other type
+    inline uint32_t typeSize (uint32_t type)
+    {
+        switch (type)
+        {
+            case GL_FLOAT:
+            case GL_UNSIGNED_INT:
+            case GL_INT: return 4;
+            case GL_DOUBLE: return 8;
+            case GL_BYTE:
+            case GL_UNSIGNED_BYTE: return 1;
+            case GL_SHORT:
+            case GL_UNSIGNED_SHORT: return 2;
+            default: return 0;
+        }
+    }
+
+    inline uint64_t align (uint64_t offset)
+    {
+        return (offset + alignment - 1) / alignment * alignment;
+    }
+}
+
+#if _WIN32  //define something for Windows (32-bit and 64-bit, this part is common)
+    #pragma warning(disable:4996)
+#else
+// avoid warnings of unused function
+static bool readMeshCacheSource (const string &filename, MeshCacheSource &source) __attribute__ ((unused));
+static bool saveMeshCache (Mesh *mesh, const string &filename, const MeshCacheInfo &info) __attribute__ ((unused));
+static bool loadMeshCache (Mesh *mesh, const string &filename, MeshCacheInfo &info, const MeshCacheSource *expected) __attribute__ ((unused));
+#endif
+
+/**
+ * @brief Reads the size, modification time and sampled hash of a file.
+ * @param filename Name of the file.
+ * @param source Receives the identification of the file.
+ * @return True if the file could be read.
+ */
+static bool readMeshCacheSource (const string &filename, MeshCacheSource &source)
+{
+    struct stat info;
+    if ( stat(filename.c_str(), &info) != 0 )
+    {
+        return false;
+    }
+
+    MappedFile file;
+    if ( !file.open(filename) )
+    {
+        return false;
+    }
+
+    // 64 bit FNV-1a over the head and tail of the file, only those pages are touched
+    const size_t sample = 64u << 10;
+    uint64_t hash = 14695981039346656037ull;
+    auto mix = [&hash] (const char *bytes, size_t length) {
+        for (size_t i = 0; i < length; ++i)
+        {
+            hash = (hash ^ static_cast<unsigned char>(bytes[i])) * 1099511628211ull;
+        }
+    };
+
+    const size_t head = std::min(file.size(), sample);
+    const size_t tail = std::min(file.size() - head, sample);
+    mix(file.data(), head);
+    mix(file.data() + file.size() - tail, tail);
+
+    const uint64_t size = file.size();
+    mix(reinterpret_cast<const char*>(&size), sizeof(size));
+
+    source.size = size;
+    source.mtime = static_cast<int64_t>(info.st_mtime);
+    source.hash = hash;
+
+    return true;
+}
+
+/**
+ * @brief Writes a mesh, as it currently is on the GPU, to a cache file.
+ *
+ * Attributes are stored tightly packed and GPU ready, together with the
+ * indices, the bounds, the primitive and vertex layout and the default
+ * color, so that loadMeshCache() restores the mesh without any processing.
+ * The file is written under a temporary name and then renamed, a reader
+ * never sees a partial cache.
+ *
+ * @param mesh Mesh to store.
+ * @param filename Name of the cache file.
+ * @param info Source, texture and application data stored along with the mesh.
+ * @return True if the cache was written.
+ */
+static bool saveMeshCache (Mesh *mesh, const string &filename, const MeshCacheInfo &info)
+{
+    using namespace MeshCacheFormat;
+
+    const vector<VertexAttribute> &attributes = mesh->getAttributes();
+    for (const VertexAttribute &va : attributes)
+    {
+        if ( (va.getName().size() >= sizeof(Attribute::name)) || (typeSize(va.getType()) == 0) )
+        {
+            return false;
+        }
+    }
+
+    vector< vector<char> > packed;
+    mesh->readBackAttributes(packed);
+
+    vector<GLuint> indices;
+    mesh->readBackIndices(indices);
+
+    Header header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, magic, sizeof(magic));
+    header.version = version;
+    header.byte_order = byte_order;
+
+    header.source_size = info.source.size;
+    header.source_mtime = info.source.mtime;
+    header.source_hash = info.source.hash;
+
+    const Eigen::AlignedBox3f &box = mesh->getBoundingBox();
+    const Eigen::Vector3f center = mesh->getObjectCenter();
+    const Eigen::Vector3f centroid = mesh->getCentroid();
+    const Eigen::Vector4f color = mesh->getColor();
+    for (int i = 0; i < 3; ++i)
+    {
+        header.box_min[i] = box.min()[i];
+        header.box_max[i] = box.max()[i];
+        header.center[i] = center[i];
+        header.centroid[i] = centroid[i];
+    }
+    for (int i = 0; i < 4; ++i)
+    {
+        header.color[i] = color[i];
+    }
+    for (int i = 0; i < 3; ++i)
+    {
+        header.position_scale[i] = mesh->getPositionScale()[i];
+        header.position_offset[i] = mesh->getPositionOffset()[i];
+    }
+    header.radius = mesh->getBoundingSphereRadius();
+    header.normalization_scale = mesh->getNormalizationScale();
+
+    header.primitive = mesh->getPrimitive();
+    header.layout = mesh->getVertexLayout();
+    header.num_attributes = attributes.size();
+    header.texture_length = info.texture_file.size();
+    header.num_indices = indices.size();
+    std::memcpy(header.user_data, info.user_data, sizeof(header.user_data));
+
+    // data blocks follow the header, the attribute table and the texture name
+    uint64_t offset = align(sizeof(Header) + attributes.size()*sizeof(Attribute) + info.texture_file.size());
+
+    vector<Attribute> table (attributes.size());
+    for (size_t i = 0; i < attributes.size(); ++i)
+    {
+        const VertexAttribute &va = attributes[i];
+
+        std::memset(&table[i], 0, sizeof(Attribute));
+        std::memcpy(table[i].name, va.getName().data(), va.getName().size());
+        table[i].type = va.getType();
+        table[i].element_size = va.getElementSize();
+        table[i].divisor = va.getDivisor();
+        table[i].flags = va.isNormalized() ? 1 : 0;
+        table[i].count = va.getSize();
+        table[i].offset = offset;
+        table[i].bytes = packed[i].size();
+
+        offset = align(offset + packed[i].size());
+    }
+    header.indices_offset = offset;
+
+    const string temporary = filename + ".tmp";
+    {
+        ofstream out (temporary, ios::binary | ios::trunc);
+        if ( !out )
+        {
+            return false;
+        }
+
+        const char padding[alignment] = {};
+        auto pad = [&out, &padding] () {
+            const uint64_t position = static_cast<uint64_t>(out.tellp());
+            out.write(padding, align(position) - position);
+        };
+
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(table.data()), table.size()*sizeof(Attribute));
+        out.write(info.texture_file.data(), info.texture_file.size());
+        pad();
+
+        for (const vector<char> &block : packed)
+        {
+            out.write(block.data(), block.size());
+            pad();
+        }
+        out.write(reinterpret_cast<const char*>(indices.data()), indices.size()*sizeof(GLuint));
+
+        if ( !out.flush() )
+        {
+            out.close();
+            std::remove(temporary.c_str());
+            return false;
+        }
+    }
+
+    if ( std::rename(temporary.c_str(), filename.c_str()) != 0 )
+    {
+        std::remove(temporary.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Loads a mesh written by saveMeshCache().
+ *
+ * The file is mapped and every block is handed straight to the GL.  Nothing
+ * is uploaded unless the whole file checks out.
+ *
+ * @param mesh Mesh to load into, its attributes with the same names are replaced.
+ * @param filename Name of the cache file.
+ * @param info Receives the source, texture and application data of the cache.
+ * @param expected If not null, the cache is only loaded if it was built from this source.
+ * @return True if the mesh was loaded, false if the file is missing, stale, malformed or from another machine.
+ */
+static bool loadMeshCache (Mesh *mesh, const string &filename, MeshCacheInfo &info, const MeshCacheSource *expected = nullptr)
+{
+    using namespace MeshCacheFormat;
+
+    MappedFile file;
+    if ( !file.open(filename) || (file.size() < sizeof(Header)) )
+    {
+        return false;
+    }
+
+    const char *data = file.data();
+    const uint64_t size = file.size();
+
+    Header header;
+    std::memcpy(&header, data, sizeof(header));
+    if ( (std::memcmp(header.magic, magic, sizeof(magic)) != 0) || (header.version != version) || (header.byte_order != byte_order) )
+    {
+        return false;
+    }
+
+    MeshCacheSource source;
+    source.size = header.source_size;
+    source.mtime = header.source_mtime;
+    source.hash = header.source_hash;
+    if ( (expected != nullptr) && !(source == *expected) )
+    {
+        return false;
+    }
+
+    const uint64_t table_bytes = static_cast<uint64_t>(header.num_attributes)*sizeof(Attribute);
+    if ( (table_bytes > size) || (sizeof(Header) + table_bytes + header.texture_length > size) )
+    {
+        return false;
+    }
+
+    vector<Attribute> table (header.num_attributes);
+    std::memcpy(table.data(), data + sizeof(Header), table_bytes);
+
+    // inside the file, checked so that neither sum can wrap around
+    auto fits = [size] (uint64_t offset, uint64_t bytes) {
+        return (offset <= size) && (bytes <= size - offset);
+    };
+
+    for (Attribute &attribute : table)
+    {
+        attribute.name[sizeof(attribute.name) - 1] = '\0';
+        const uint64_t type_size = typeSize(attribute.type);
+        if ( (type_size == 0) || (attribute.element_size < 1) || (attribute.element_size > 4) ||
+             (attribute.count > static_cast<uint64_t>(std::numeric_limits<int>::max())) ||
+             (attribute.bytes != attribute.count*attribute.element_size*type_size) ||
+             !fits(attribute.offset, attribute.bytes) )
+        {
+            return false;
+        }
+    }
+
+    if ( (header.num_indices > size/sizeof(GLuint)) || !fits(header.indices_offset, header.num_indices*sizeof(GLuint)) )
+    {
+        return false;
+    }
+
+    switch (header.primitive)
+    {
+        case Mesh::POINT:
+        case Mesh::CURVE:
+        case Mesh::TRIANGLE:
+        case Mesh::PATCH: break;
+        default: return false;
+    }
+
+    for (const Attribute &attribute : table)
+    {
+        mesh->loadPackedAttribute(attribute.name, data + attribute.offset, attribute.count,
+                attribute.element_size, attribute.type, attribute.divisor, (attribute.flags & 1) != 0);
+    }
+
+    // blocks are 64 byte aligned in the file, so the indices can be read in place
+    mesh->loadIndices(reinterpret_cast<const GLuint*>(data + header.indices_offset), header.num_indices);
+
+    mesh->selectPrimitive(static_cast<Mesh::PrimitiveType>(header.primitive));
+    mesh->setVertexLayout( (header.layout == Mesh::INTERLEAVED) ? Mesh::INTERLEAVED : Mesh::SEPARATE );
+
+    Eigen::AlignedBox3f box (Eigen::Vector3f(header.box_min), Eigen::Vector3f(header.box_max));
+    mesh->setBounds(box, Eigen::Vector3f(header.center), Eigen::Vector3f(header.centroid), header.radius, header.normalization_scale);
+    mesh->Model::setColor(Eigen::Vector4f(header.color));
+    mesh->setPositionDecoding(Eigen::Vector3f(header.position_scale), Eigen::Vector3f(header.position_offset));
+
+    info.source = source;
+    info.texture_file.assign(data + sizeof(Header) + table_bytes, header.texture_length);
+    std::memcpy(info.user_data, header.user_data, sizeof(info.user_data));
+
+    return true;
+}
+
+}
+}
+#endif
@@ -0,0 +1,427 @@
+/**
+ * Tucano - A library for rapid prototying with Modern OpenGL and GLSL
+ * Copyright (C) 2014
+ * LCG - Laboratório de Computação Gráfica (Computer Graphics Lab) - COPPE
+ * UFRJ - Federal University of Rio de Janeiro
+ *
+ * This file is part of Tucano Library.
+ *
+ * Tucano Library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Tucano Library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Tucano Library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __MESHCLUSTERS__
+#define __MESHCLUSTERS__
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <thread>
+#include <vector>
+
+#include <Eigen/Dense>
+
+#include <tucano/utils/frustum.hpp>
+#include <tucano/utils/meshoptimizer.hpp>
+
+
+namespace Tucano
+{
+
+/**
+ * @brief Partition of a triangle mesh into small clusters, culled one by one.
+ *
+ * build() grows each cluster from a seed triangle through the triangles sharing
+ * its vertices, breadth first, so clusters come out as compact patches of the
+ * surface.  The triangles are then reordered so that each cluster is a range of
+ * the index buffer, in the vertex cache order of optimizeVertexCache() inside
+ * the cluster.  Every cluster keeps a bounding sphere and a cone holding the
+ * normals of its triangles; refit() recomputes them after the vertices moved.
+ *
+ * cull() tests the spheres against the camera frustum and the cones against the
+ * direction of the camera, over arrays of each bound component so that the loop
+ * vectorizes, and on one thread per range of clusters for large meshes.  Runs of
+ * visible clusters are merged into the index ranges to draw.
+ */
+class MeshClusters
+{
+public:
+
+    /**
+     * @brief Partitions triangles into clusters, reordering them so that each cluster is a range of the indices.
+     * @param indices Triangles (indices on the vertices' list), reordered in place.
+     * @param num_indices Number of indices.
+     * @param positions Packed (x,y,z) vertex coordinates.
+     * @param num_vertices Number of vertices.
+     * @param max_triangles Most triangles of a cluster.
+     * @return False if an index is out of range, leaving the indices untouched.
+     */
+    bool build (GLuint *indices, size_t num_indices, const float *positions, size_t num_vertices, unsigned int max_triangles = 128)
+    {
+        clear();
+        const size_t num_triangles = num_indices/3;
+        if ( (num_triangles == 0) || (max_triangles == 0) || !MeshOptimizer::Internal::validIndices(indices, 3*num_triangles, num_vertices) )
+        {
+            return false;
+        }
+
+        // triangles around each vertex
+        std::vector<GLuint> adjacency_offsets (num_vertices + 1, 0);
+        for (size_t i = 0; i < 3*num_triangles; ++i)
+        {
+            ++adjacency_offsets[indices[i] + 1];
+        }
+        for (size_t v = 0; v < num_vertices; ++v)
+        {
+            adjacency_offsets[v+1] += adjacency_offsets[v];
+        }
+        std::vector<GLuint> adjacency (3*num_triangles);
+        {
+            std::vector<GLuint> fill (adjacency_offsets.begin(), adjacency_offsets.end() - 1);
+            for (size_t i = 0; i < 3*num_triangles; ++i)
+            {
+                adjacency[fill[indices[i]]++] = static_cast<GLuint>(i/3);
+            }
+        }
+
+        // grow the clusters breadth first, seeding each one from what was left around the previous one
+        std::vector<GLuint> order;
+        order.reserve(num_triangles);
+        std::vector<GLuint> queued (num_triangles, std::numeric_limits<GLuint>::max());
+        std::vector<char> assigned (num_triangles, 0);
+        std::vector<GLuint> queue, leftover;
+        size_t scan = 0;
+        while ( order.size() < num_triangles )
+        {
+            const GLuint cluster = static_cast<GLuint>(first.size());
+            GLuint seed = std::numeric_limits<GLuint>::max();
+            for (GLuint t : leftover)
+            {
+                if ( !assigned[t] )
+                {
+                    seed = t;
+                    break;
+                }
+            }
+            if ( seed == std::numeric_limits<GLuint>::max() )
+            {
+                while ( assigned[scan] )
+                {
+                    ++scan;
+                }
+                seed = static_cast<GLuint>(scan);
+            }
+
+            first.push_back(static_cast<GLuint>(3*order.size()));
+            queue.assign(1, seed);
+            queued[seed] = cluster;
+            size_t head = 0, size = 0;
+            while ( (head < queue.size()) && (size < max_triangles) )
+            {
+                const GLuint t = queue[head++];
+                assigned[t] = 1;
+                order.push_back(t);
+                ++size;
+
+                for (int c = 0; c < 3; ++c)
+                {
+                    const GLuint v = indices[3*static_cast<size_t>(t) + c];
+                    for (GLuint i = adjacency_offsets[v]; i < adjacency_offsets[v+1]; ++i)
+                    {
+                        const GLuint n = adjacency[i];
+                        if ( !assigned[n] && (queued[n] != cluster) )
+                        {
+                            queued[n] = cluster;
+                            queue.push_back(n);
+                        }
+                    }
+                }
+            }
+            count.push_back(static_cast<GLuint>(3*size));
+            leftover.assign(queue.begin() + head, queue.end());
+        }
+        std::vector<GLuint>().swap(adjacency);
+        std::vector<GLuint>().swap(adjacency_offsets);
+
+        std::vector<GLuint> clustered (3*num_triangles);
+        for (size_t i = 0; i < num_triangles; ++i)
+        {
+            std::copy(&indices[3*static_cast<size_t>(order[i])], &indices[3*static_cast<size_t>(order[i]) + 3], &clustered[3*i]);
+        }
+        std::copy(clustered.begin(), clustered.end(), indices);
+
+        orderClusters(indices);
+        computeBounds(indices, positions);
+
+        return true;
+    }
+
+    /**
+     * @brief Recomputes the bounds of every cluster after the vertices moved, keeping the partition.
+     * @param indices Triangles, clustered by build().
+     * @param num_indices Number of indices.
+     * @param positions Packed (x,y,z) vertex coordinates.
+     * @param num_vertices Number of vertices.
+     * @return False if the indices do not cover the clusters or an index is out of range, leaving the bounds untouched.
+     */
+    bool refit (const GLuint *indices, size_t num_indices, const float *positions, size_t num_vertices)
+    {
+        if ( (size() == 0) || (num_indices < static_cast<size_t>(first.back()) + count.back()) ||
+             !MeshOptimizer::Internal::validIndices(indices, static_cast<size_t>(first.back()) + count.back(), num_vertices) )
+        {
+            return false;
+        }
+
+        computeBounds(indices, positions);
+
+        return true;
+    }
+
+    /**
+     * @brief Finds the clusters inside the camera frustum, and facing the camera, and merges runs of them into index ranges.
+     * @param frustum Camera frustum, in the coordinates of the vertices (built from the model-view-projection matrix).
+     * @param eye Camera position, in the coordinates of the vertices.
+     * @param backfaces Also cull the clusters whose triangles all face away from the camera.
+     * @param counts Receives the number of indices of each range.
+     * @param offsets Receives the byte offset of each range in the index buffer.
+     * @return Number of visible clusters.
+     */
+    size_t cull (const Frustum &frustum, const Eigen::Vector3f &eye, bool backfaces, vector<GLsizei> &counts, vector<const GLvoid*> &offsets)
+    {
+        counts.clear();
+        offsets.clear();
+
+        const size_t num_clusters = size();
+        visible.resize(num_clusters);
+
+        float px[6], py[6], pz[6], pw[6];
+        for (int p = 0; p < 6; ++p)
+        {
+            const Eigen::Vector4f &coeffs = frustum.plane(p).coeffs();
+            px[p] = coeffs[0]; py[p] = coeffs[1]; pz[p] = coeffs[2]; pw[p] = coeffs[3];
+        }
+        const float ex = eye[0], ey = eye[1], ez = eye[2];
+
+        forClusterRanges([&] (size_t begin, size_t end) {
+            const float *cx = center_x.data(), *cy = center_y.data(), *cz = center_z.data(), *rad = radius.data();
+            const float *ax = axis_x.data(), *ay = axis_y.data(), *az = axis_z.data(), *cut = cutoff.data();
+            int *in = visible.data();
+
+            // one plane at a time over all clusters, without branches, so that the compiler runs several clusters at once
+            for (size_t c = begin; c < end; ++c)
+            {
+                in[c] = 1;
+            }
+            for (int p = 0; p < 6; ++p)
+            {
+                const float nx = px[p], ny = py[p], nz = pz[p], d = pw[p];
+                for (size_t c = begin; c < end; ++c)
+                {
+                    in[c] &= (nx*cx[c] + ny*cy[c] + nz*cz[c] + d <= rad[c]);
+                }
+            }
+
+            // culled if every point of the sphere sees every normal of the cone from behind
+            if ( backfaces )
+            {
+                for (size_t c = begin; c < end; ++c)
+                {
+                    const float dx = cx[c] - ex, dy = cy[c] - ey, dz = cz[c] - ez;
+                    const float distance = std::sqrt(dx*dx + dy*dy + dz*dz);
+                    in[c] &= (dx*ax[c] + dy*ay[c] + dz*az[c] < cut[c]*distance + rad[c]*(1.f + cut[c]));
+                }
+            }
+        });
+
+        // clusters follow each other in the index buffer: draw runs of visible ones at once
+        size_t num_visible = 0;
+        bool previous = false;
+        for (size_t c = 0; c < num_clusters; ++c)
+        {
+            if ( visible[c] )
+            {
+                if ( previous )
+                {
+                    counts.back() += count[c];
+                }
+                else
+                {
+                    counts.push_back(count[c]);
+                    offsets.push_back(reinterpret_cast<const GLvoid*>(static_cast<size_t>(first[c])*sizeof(GLuint)));
+                }
+                ++num_visible;
+            }
+            previous = visible[c];
+        }
+
+        return num_visible;
+    }
+
+    /**
+     * @brief Returns the number of clusters.
+     */
+    size_t size (void) const
+    {
+        return first.size();
+    }
+
+    /**
+     * @brief Drops the clusters.
+     */
+    void clear (void)
+    {
+        first.clear(); count.clear();
+        center_x.clear(); center_y.clear(); center_z.clear(); radius.clear();
+        axis_x.clear(); axis_y.clear(); axis_z.clear(); cutoff.clear();
+    }
+
+private:
+
+    /// Runs work(begin, end) over ranges of the clusters, on one thread per range for large meshes
+    template <class Work>
+    void forClusterRanges (const Work &work) const
+    {
+        const size_t num_clusters = size();
+        const size_t num_ranges = std::max<size_t>(1, std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()), num_clusters/min_clusters));
+        auto range = [&] (size_t r) {
+            work(num_clusters*r/num_ranges, num_clusters*(r+1)/num_ranges);
+        };
+
+        std::vector<std::thread> workers;
+        for (size_t r = 1; r < num_ranges; ++r)
+        {
+            workers.emplace_back(range, r);
+        }
+        range(0);
+        for (std::thread &worker : workers)
+        {
+            worker.join();
+        }
+    }
+
+    /// Orders the triangles of each cluster for the vertex cache
+    void orderClusters (GLuint *indices) const
+    {
+        forClusterRanges([&] (size_t begin, size_t end) {
+            std::vector<GLuint> local, vertices;
+            for (size_t c = begin; c < end; ++c)
+            {
+                GLuint *cluster = &indices[first[c]];
+
+                // renumber the few vertices of the cluster to reorder it
+                vertices.assign(cluster, cluster + count[c]);
+                std::sort(vertices.begin(), vertices.end());
+                vertices.erase(std::unique(vertices.begin(), vertices.end()), vertices.end());
+                local.resize(count[c]);
+                for (GLuint i = 0; i < count[c]; ++i)
+                {
+                    local[i] = static_cast<GLuint>(std::lower_bound(vertices.begin(), vertices.end(), cluster[i]) - vertices.begin());
+                }
+                MeshOptimizer::optimizeVertexCache(local.data(), local.size(), vertices.size(), 16);
+                for (GLuint i = 0; i < count[c]; ++i)
+                {
+                    cluster[i] = vertices[local[i]];
+                }
+            }
+        });
+    }
+
+    /// Computes the bounding sphere and normal cone of each cluster
+    void computeBounds (const GLuint *indices, const float *positions)
+    {
+        const size_t num_clusters = size();
+        center_x.resize(num_clusters); center_y.resize(num_clusters); center_z.resize(num_clusters); radius.resize(num_clusters);
+        axis_x.resize(num_clusters); axis_y.resize(num_clusters); axis_z.resize(num_clusters); cutoff.resize(num_clusters);
+
+        forClusterRanges([&] (size_t begin, size_t end) {
+            std::vector<GLuint> vertices;
+            std::vector<Eigen::Vector3f> normals;
+            for (size_t c = begin; c < end; ++c)
+            {
+                const GLuint *cluster = &indices[first[c]];
+
+                vertices.assign(cluster, cluster + count[c]);
+                std::sort(vertices.begin(), vertices.end());
+                vertices.erase(std::unique(vertices.begin(), vertices.end()), vertices.end());
+
+                Eigen::AlignedBox3f box;
+                for (GLuint v : vertices)
+                {
+                    box.extend(Eigen::Map<const Eigen::Vector3f>(&positions[3*static_cast<size_t>(v)]));
+                }
+                const Eigen::Vector3f center = box.center();
+                float r2 = 0.f;
+                for (GLuint v : vertices)
+                {
+                    r2 = std::max(r2, (Eigen::Map<const Eigen::Vector3f>(&positions[3*static_cast<size_t>(v)]) - center).squaredNorm());
+                }
+
+                normals.clear();
+                Eigen::Vector3f axis = Eigen::Vector3f::Zero();
+                for (GLuint i = 0; i < count[c]; i += 3)
+                {
+                    const Eigen::Map<const Eigen::Vector3f> a (&positions[3*static_cast<size_t>(cluster[i])]);
+                    const Eigen::Map<const Eigen::Vector3f> b (&positions[3*static_cast<size_t>(cluster[i+1])]);
+                    const Eigen::Map<const Eigen::Vector3f> d (&positions[3*static_cast<size_t>(cluster[i+2])]);
+                    const Eigen::Vector3f n = (b - a).cross(d - a);
+                    const float length = n.norm();
+                    if ( length > 0.f )
+                    {
+                        normals.push_back(n / length);
+                        axis += normals.back();
+                    }
+                }
+
+                // sine of the angle between the axis and the farthest normal; 1 never culls
+                float sine = 1.f;
+                if ( axis.norm() > 0.f )
+                {
+                    axis.normalize();
+                    float lowest = 1.f;
+                    for (const Eigen::Vector3f &n : normals)
+                    {
+                        lowest = std::min(lowest, axis.dot(n));
+                    }
+                    if ( lowest > 0.f )
+                    {
+                        sine = std::sqrt(std::max(0.f, 1.f - lowest*lowest));
+                    }
+                }
+
+                center_x[c] = center[0]; center_y[c] = center[1]; center_z[c] = center[2];
+                radius[c] = std::sqrt(r2);
+                axis_x[c] = axis[0]; axis_y[c] = axis[1]; axis_z[c] = axis[2];
+                cutoff[c] = sine;
+            }
+        });
+    }
+
+    /// Smallest number of clusters handed to a thread
+    static const size_t min_clusters = 1u << 14;
+
+    /// First index and number of indices of each cluster
+    std::vector<GLuint> first, count;
+
+    /// Bounding sphere of each cluster
+    std::vector<float> center_x, center_y, center_z, radius;
+
+    /// Cone of the normals of each cluster: axis, and sine of its half angle (1 if wider than a hemisphere)
+    std::vector<float> axis_x, axis_y, axis_z, cutoff;
+
+    /// Whether each cluster passed the last cull(), as ints so that the culling loops vectorize with the float bounds
+    std::vector<int> visible;
+};
+
+}
+
+#endif
@@ -0,0 +1,571 @@
+/**
+ * Tucano - A library for rapid prototying with Modern OpenGL and GLSL
+ * Copyright (C) 2014
+ * LCG - Laboratório de Computação Gráfica (Computer Graphics Lab) - COPPE
+ * UFRJ - Federal University of Rio de Janeiro
+ *
+ * This file is part of Tucano Library.
+ *
+ * Tucano Library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Tucano Library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Tucano Library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __MESHOPTIMIZER__
+#define __MESHOPTIMIZER__
+
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+#include <vector>
+
+#include <Eigen/Dense>
+
+#include <tucano/mesh.hpp>
+
+using namespace std;
+
+namespace Tucano
+{
+
+/**
+ * @brief Reordering of triangles and vertices for faster rendering.
+ *
+ * optimizeVertexCache() is Tipsify (Sander, Nehab and Barczak, "Fast Triangle
+ * Reordering for Vertex Locality and Reduced Overdraw", 2007): it fans around
+ * vertices still in the post-transform cache, so that each vertex is shaded as
+ * few times as possible.  optimizeOverdraw() then cuts the result into clusters
+ * and sorts them from the outside of the mesh in, so that the depth test rejects
+ * more fragments.  optimizeVertexFetch() finally renumbers the vertices in the
+ * order the triangles use them, for sequential reads of the vertex buffers.
+ */
+namespace MeshOptimizer
+{
+
+/**
+ * @brief Efficiency of a triangle order with a FIFO post-transform cache.
+ */
+struct VertexCacheStats
+{
+    /// Average cache miss ratio: vertices shaded per triangle, 3 at worst and about 0.5 at best
+    float acmr = 0.f;
+
+    /// Average transformed vertex ratio: times each vertex is shaded, 1 at best
+    float atvr = 0.f;
+};
+
+#if _WIN32  //define something for Windows (32-bit and 64-bit, this part is common)
+    #pragma warning(disable:4996)
+#else
+// avoid warnings of unused function
+static VertexCacheStats analyzeVertexCache (const GLuint *indices, size_t num_indices, size_t num_vertices, unsigned int cache_size) __attribute__ ((unused));
+static bool optimizeVertexCache (GLuint *indices, size_t num_indices, size_t num_vertices, unsigned int cache_size) __attribute__ ((unused));
+static bool optimizeOverdraw (GLuint *indices, size_t num_indices, const void *positions, size_t stride, size_t num_vertices, unsigned int cache_size, float threshold) __attribute__ ((unused));
+static bool optimizeVertexFetch (GLuint *indices, size_t num_indices, size_t num_vertices, vector<GLuint> &order) __attribute__ ((unused));
+static bool optimizeMesh (Mesh *mesh, bool overdraw, bool reorder_vertices, VertexCacheStats *before, VertexCacheStats *after, unsigned int cache_size) __attribute__ ((unused));
+#endif
+
+namespace Internal
+{
+    /// Whether every index refers to a vertex
+    inline bool validIndices (const GLuint *indices, size_t num_indices, size_t num_vertices)
+    {
+        for (size_t i = 0; i < num_indices; ++i)
+        {
+            if ( indices[i] >= num_vertices )
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * @brief FIFO post-transform cache, flushed in constant time.
+     *
+     * A vertex is cached if it was among the last cache_size vertices inserted,
+     * which the insertion time of each vertex tells.
+     */
+    class FifoCache
+    {
+    public:
+
+        FifoCache (size_t num_vertices, unsigned int size) :
+            timestamps(num_vertices, 0), time(size + 1), cache_size(size)
+        {}
+
+        /// Looks a vertex up, inserting it on a miss; returns true on a miss
+        bool miss (GLuint v)
+        {
+            if ( time - timestamps[v] > cache_size )
+            {
+                timestamps[v] = time++;
+                return true;
+            }
+            return false;
+        }
+
+        /// Number of cache misses of a triangle
+        unsigned int misses (const GLuint *triangle)
+        {
+            return miss(triangle[0]) + miss(triangle[1]) + miss(triangle[2]);
+        }
+
+        /// Whether the vertex was ever inserted
+        bool seen (GLuint v) const
+        {
+            return timestamps[v] != 0;
+        }
+
+        void flush ()
+        {
+            time += cache_size + 1;
+        }
+
+    private:
+
+        vector<size_t> timestamps;
+        size_t time;
+        size_t cache_size;
+    };
+
+    /// Order of the vertices by first use, then the unused ones
+    inline vector<GLuint> vertexFetchOrder (const GLuint *indices, size_t num_indices, size_t num_vertices)
+    {
+        vector<GLuint> order;
+        order.reserve(num_vertices);
+
+        vector<char> placed (num_vertices, 0);
+        for (size_t i = 0; i < num_indices; ++i)
+        {
+            if ( !placed[indices[i]] )
+            {
+                placed[indices[i]] = 1;
+                order.push_back(indices[i]);
+            }
+        }
+        for (size_t v = 0; v < num_vertices; ++v)
+        {
+            if ( !placed[v] )
+            {
+                order.push_back(static_cast<GLuint>(v));
+            }
+        }
+
+        return order;
+    }
+
+    /// Rewrites indices for vertices renumbered in the given order
+    inline void remapIndices (GLuint *indices, size_t num_indices, const vector<GLuint> &order)
+    {
+        vector<GLuint> remap (order.size());
+        for (size_t v = 0; v < order.size(); ++v)
+        {
+            remap[order[v]] = static_cast<GLuint>(v);
+        }
+        for (size_t i = 0; i < num_indices; ++i)
+        {
+            indices[i] = remap[indices[i]];
+        }
+    }
+}
+
+/**
+ * @brief Simulates a FIFO post-transform cache over a triangle list.
+ * @param indices Triangles (indices on the vertices' list).
+ * @param num_indices Number of indices.
+ * @param num_vertices Number of vertices.
+ * @param cache_size Number of vertices held by the cache.
+ * @return Misses per triangle and per vertex used; indices out of range are ignored.
+ */
+static VertexCacheStats analyzeVertexCache (const GLuint *indices, size_t num_indices, size_t num_vertices, unsigned int cache_size = 16)
+{
+    VertexCacheStats stats;
+
+    const size_t num_triangles = num_indices/3;
+    if ( num_triangles == 0 )
+    {
+        return stats;
+    }
+
+    Internal::FifoCache cache (num_vertices, cache_size);
+    size_t misses = 0;
+    size_t used = 0;
+    for (size_t i = 0; i < 3*num_triangles; ++i)
+    {
+        const GLuint v = indices[i];
+        if ( v >= num_vertices )
+        {
+            continue;
+        }
+
+        const bool first_use = !cache.seen(v);
+        if ( cache.miss(v) )
+        {
+            ++misses;
+            used += first_use;
+        }
+    }
+
+    stats.acmr = static_cast<float>(misses)/num_triangles;
+    stats.atvr = (used > 0) ? static_cast<float>(misses)/used : 0.f;
+
+    return stats;
+}
+
+/**
+ * @brief Reorders triangles for the post-transform vertex cache (Tipsify).
+ * @param indices Triangles (indices on the vertices' list), reordered in place.
+ * @param num_indices Number of indices.
+ * @param num_vertices Number of vertices.
+ * @param cache_size Number of vertices the order is tuned for.
+ * @return False, leaving the indices untouched, if an index is out of range.
+ */
+static bool optimizeVertexCache (GLuint *indices, size_t num_indices, size_t num_vertices, unsigned int cache_size = 16)
+{
+    const size_t num_triangles = num_indices/3;
+    if ( !Internal::validIndices(indices, 3*num_triangles, num_vertices) )
+    {
+        return false;
+    }
+    if ( num_triangles == 0 )
+    {
+        return true;
+    }
+
+    // triangles around each vertex, and how many of them are still to be emitted
+    vector<GLuint> offsets (num_vertices + 1, 0);
+    vector<unsigned int> live (num_vertices, 0);
+    for (size_t i = 0; i < 3*num_triangles; ++i)
+    {
+        ++live[indices[i]];
+    }
+    for (size_t v = 0; v < num_vertices; ++v)
+    {
+        offsets[v+1] = offsets[v] + live[v];
+    }
+    vector<GLuint> adjacency (3*num_triangles);
+    {
+        vector<GLuint> cursor (offsets.begin(), offsets.end() - 1);
+        for (size_t i = 0; i < 3*num_triangles; ++i)
+        {
+            adjacency[cursor[indices[i]]++] = static_cast<GLuint>(i/3);
+        }
+    }
+
+    vector<GLuint> timestamps (num_vertices, 0);
+    vector<char> emitted (num_triangles, 0);
+    vector<GLuint> dead_end;
+    vector<GLuint> candidates;
+    vector<GLuint> result;
+    result.reserve(3*num_triangles);
+
+    GLuint time = cache_size + 1;
+    size_t scan = 0;
+    long fan = 0;
+    while ( fan >= 0 )
+    {
+        // emit every triangle left around the fanning vertex
+        candidates.clear();
+        for (GLuint a = offsets[fan]; a < offsets[fan+1]; ++a)
+        {
+            const GLuint t = adjacency[a];
+            if ( emitted[t] )
+            {
+                continue;
+            }
+            emitted[t] = 1;
+
+            for (int c = 0; c < 3; ++c)
+            {
+                const GLuint v = indices[3*static_cast<size_t>(t) + c];
+                result.push_back(v);
+                dead_end.push_back(v);
+                candidates.push_back(v);
+                --live[v];
+                if ( time - timestamps[v] > cache_size )
+                {
+                    timestamps[v] = time++;
+                }
+            }
+        }
+
+        // next fan: the candidate that stays longest in the cache while its triangles are emitted
+        fan = -1;
+        long best = -1;
+        for (GLuint v : candidates)
+        {
+            if ( live[v] == 0 )
+            {
+                continue;
+            }
+
+            long priority = 0;
+            if ( time - timestamps[v] + 2*live[v] <= cache_size )
+            {
+                priority = static_cast<long>(time - timestamps[v]);
+            }
+            if ( priority > best )
+            {
+                best = priority;
+                fan = v;
+            }
+        }
+
+        // dead end: go back to a recently used vertex, or on to the next unfinished one
+        while ( (fan < 0) && !dead_end.empty() )
+        {
+            const GLuint v = dead_end.back();
+            dead_end.pop_back();
+            if ( live[v] > 0 )
+            {
+                fan = v;
+            }
+        }
+        while ( (fan < 0) && (scan < num_vertices) )
+        {
+            if ( live[scan] > 0 )
+            {
+                fan = static_cast<long>(scan);
+            }
+            ++scan;
+        }
+    }
+
+    std::memcpy(indices, result.data(), result.size()*sizeof(GLuint));
+
+    return true;
+}
+
+/**
+ * @brief Reorders clusters of triangles to reduce overdraw, keeping most of their vertex cache efficiency.
+ *
+ * Meant to follow optimizeVertexCache().  The triangles are cut wherever the
+ * cache starts over, then wherever the misses so far are within threshold of
+ * those of the whole cluster, and the clusters facing away from the center of
+ * the mesh are drawn first.
+ * @param indices Triangles (indices on the vertices' list), reordered in place.
+ * @param num_indices Number of indices.
+ * @param positions Position of the first vertex, three floats.
+ * @param stride Bytes from one position to the next.
+ * @param num_vertices Number of vertices.
+ * @param cache_size Number of vertices held by the cache.
+ * @param threshold Largest increase of cache misses allowed for finer clusters (1.05 gives up at most 5%).
+ * @return False, leaving the indices untouched, if an index is out of range.
+ */
+static bool optimizeOverdraw (GLuint *indices, size_t num_indices, const void *positions, size_t stride, size_t num_vertices, unsigned int cache_size = 16, float threshold = 1.05f)
+{
+    const size_t num_triangles = num_indices/3;
+    if ( !Internal::validIndices(indices, 3*num_triangles, num_vertices) )
+    {
+        return false;
+    }
+    if ( num_triangles == 0 )
+    {
+        return true;
+    }
+
+    Internal::FifoCache cache (num_vertices, cache_size);
+
+    // hard boundaries: triangles with no vertex in the cache
+    vector<size_t> hard;
+    for (size_t t = 0; t < num_triangles; ++t)
+    {
+        if ( (cache.misses(&indices[3*t]) == 3) || (t == 0) )
+        {
+            hard.push_back(t);
+        }
+    }
+    hard.push_back(num_triangles);
+
+    // soft boundaries: once a prefix of a cluster does about as well as the whole
+    vector<size_t> clusters;
+    for (size_t h = 0; h + 1 < hard.size(); ++h)
+    {
+        const size_t begin = hard[h];
+        const size_t end = hard[h+1];
+
+        cache.flush();
+        size_t misses = 0;
+        for (size_t t = begin; t < end; ++t)
+        {
+            misses += cache.misses(&indices[3*t]);
+        }
+        const float limit = threshold*static_cast<float>(misses)/(end - begin);
+
+        cache.flush();
+        clusters.push_back(begin);
+        size_t start = begin;
+        misses = 0;
+        for (size_t t = begin; t < end; ++t)
+        {
+            misses += cache.misses(&indices[3*t]);
+            if ( (t + 1 < end) && (static_cast<float>(misses) <= limit*(t + 1 - start)) )
+            {
+                clusters.push_back(t + 1);
+                start = t + 1;
+                misses = 0;
+                cache.flush();
+            }
+        }
+    }
+    clusters.push_back(num_triangles);
+
+    // area weighted centroid and normal of each cluster, and of the whole mesh
+    const char *bytes = static_cast<const char*>(positions);
+    auto position = [bytes, stride] (GLuint v) {
+        Eigen::Vector3f p;
+        std::memcpy(p.data(), bytes + v*stride, 3*sizeof(float));
+        return p.cast<double>().eval();
+    };
+
+    const size_t num_clusters = clusters.size() - 1;
+    vector<Eigen::Vector3d> centroids (num_clusters, Eigen::Vector3d::Zero());
+    vector<Eigen::Vector3d> normals (num_clusters, Eigen::Vector3d::Zero());
+    vector<double> areas (num_clusters, 0.0);
+    Eigen::Vector3d mesh_centroid = Eigen::Vector3d::Zero();
+    double mesh_area = 0.0;
+    for (size_t c = 0; c < num_clusters; ++c)
+    {
+        for (size_t t = clusters[c]; t < clusters[c+1]; ++t)
+        {
+            const Eigen::Vector3d p0 = position(indices[3*t]);
+            const Eigen::Vector3d p1 = position(indices[3*t+1]);
+            const Eigen::Vector3d p2 = position(indices[3*t+2]);
+
+            const Eigen::Vector3d n = (p1 - p0).cross(p2 - p0);
+            const double area = n.norm();
+            centroids[c] += area*(p0 + p1 + p2)/3.0;
+            normals[c] += n;
+            areas[c] += area;
+        }
+        mesh_centroid += centroids[c];
+        mesh_area += areas[c];
+    }
+    if ( mesh_area > 0.0 )
+    {
+        mesh_centroid /= mesh_area;
+    }
+
+    vector<double> sort_keys (num_clusters, 0.0);
+    for (size_t c = 0; c < num_clusters; ++c)
+    {
+        if ( (areas[c] > 0.0) && (normals[c].squaredNorm() > 0.0) )
+        {
+            sort_keys[c] = (centroids[c]/areas[c] - mesh_centroid).dot(normals[c].normalized());
+        }
+    }
+
+    vector<size_t> sorted (num_clusters);
+    std::iota(sorted.begin(), sorted.end(), 0);
+    std::stable_sort(sorted.begin(), sorted.end(), [&sort_keys] (size_t a, size_t b) {
+        return sort_keys[a] > sort_keys[b];
+    });
+
+    vector<GLuint> result;
+    result.reserve(3*num_triangles);
+    for (size_t c : sorted)
+    {
+        result.insert(result.end(), &indices[3*clusters[c]], &indices[3*clusters[c+1]]);
+    }
+    std::memcpy(indices, result.data(), result.size()*sizeof(GLuint));
+
+    return true;
+}
+
+/**
+ * @brief Renumbers the vertices in the order the triangles first use them.
+ *
+ * Vertices no triangle uses keep their relative order after all the others.
+ * @param indices Triangles (indices on the vertices' list), rewritten in place for the new numbers.
+ * @param num_indices Number of indices.
+ * @param num_vertices Number of vertices.
+ * @param order Receives the old number of each vertex, in the new order; the vertex buffers must follow it.
+ * @return False, leaving the indices untouched, if an index is out of range.
+ */
+static bool optimizeVertexFetch (GLuint *indices, size_t num_indices, size_t num_vertices, vector<GLuint> &order)
+{
+    if ( !Internal::validIndices(indices, num_indices, num_vertices) )
+    {
+        return false;
+    }
+
+    order = Internal::vertexFetchOrder(indices, num_indices, num_vertices);
+    Internal::remapIndices(indices, num_indices, order);
+
+    return true;
+}
+
+/**
+ * @brief Reorders the triangles of a mesh, and optionally its vertices, in place on the GPU.
+ *
+ * Indices and attributes are read back, reordered and written back in the same buffers.
+ * @param mesh Triangle mesh with an index buffer.
+ * @param overdraw Also sort the triangles for less overdraw (needs float or quantized positions).
+ * @param reorder_vertices Also renumber the vertices in the order they are used.
+ * @param before Receives the cache efficiency of the original order, if not null.
+ * @param after Receives the cache efficiency of the new order, if not null.
+ * @param cache_size Number of vertices the order is tuned for.
+ * @return True if the mesh was reordered.
+ */
+static bool optimizeMesh (Mesh *mesh, bool overdraw, bool reorder_vertices, VertexCacheStats *before = nullptr, VertexCacheStats *after = nullptr, unsigned int cache_size = 16)
+{
+    if ( (mesh == nullptr) || (mesh->getPrimitive() != Mesh::TRIANGLE) || (mesh->getNumberOfElements() < 3) )
+    {
+        return false;
+    }
+
+    vector<GLuint> indices;
+    mesh->readBackIndices(indices);
+    indices.resize(indices.size() - indices.size() % 3);
+
+    const size_t num_vertices = mesh->getNumberOfVertices();
+    if ( !Internal::validIndices(indices.data(), indices.size(), num_vertices) )
+    {
+        return false;
+    }
+
+    if ( before != nullptr )
+    {
+        *before = analyzeVertexCache(indices.data(), indices.size(), num_vertices, cache_size);
+    }
+
+    optimizeVertexCache(indices.data(), indices.size(), num_vertices, cache_size);
+
+    vector<float> positions;
+    if ( overdraw && mesh->readBackPositions(positions) && (positions.size() == 3*num_vertices) )
+    {
+        optimizeOverdraw(indices.data(), indices.size(), positions.data(), 3*sizeof(float), num_vertices, cache_size);
+    }
+
+    if ( reorder_vertices )
+    {
+        vector<GLuint> order = Internal::vertexFetchOrder(indices.data(), indices.size(), num_vertices);
+        if ( mesh->reorderVertices(order) )
+        {
+            Internal::remapIndices(indices.data(), indices.size(), order);
+        }
+    }
+
+    mesh->loadIndices(indices.data(), indices.size());
+
+    if ( after != nullptr )
+    {
+        *after = analyzeVertexCache(indices.data(), indices.size(), num_vertices, cache_size);
+    }
+
+    return true;
+}
+
+}
+}
+#endif
@@ -0,0 +1,740 @@
+/**
+ * Tucano - A library for rapid prototying with Modern OpenGL and GLSL
+ * Copyright (C) 2014
+ * LCG - Laboratório de Computação Gráfica (Computer Graphics Lab) - COPPE
+ * UFRJ - Federal University of Rio de Janeiro
+ *
+ * This file is part of Tucano Library.
+ *
+ * Tucano Library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Tucano Library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Tucano Library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __MESHSIMPLIFIER__
+#define __MESHSIMPLIFIER__
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <thread>
+#include <vector>
+
+#include <Eigen/Dense>
+
+
+namespace Tucano
+{
+
+/**
+ * @brief Simplifies a triangle mesh by collapsing edges in order of quadric error.
+ *
+ * Each vertex carries the quadric of the planes of its triangles (Garland and
+ * Heckbert, "Surface Simplification Using Quadric Error Metrics", 1997), plus
+ * planes across border edges to hold the borders in place.  An edge collapse
+ * moves one vertex onto the other, so the simplified triangles index the
+ * original vertices and can share their buffers, normals and colors included.
+ *
+ * Edges are collapsed in passes.  Each pass rates every edge on one thread per
+ * range of triangles, sorts the cheapest, and collapses as many of them as it
+ * can without two collapses touching the same triangles, so that the checks
+ * against folding triangles stay exact.  Vertices on a border only slide along
+ * it, and vertices sharing their position with another (texture or normal
+ * seams) stay in place.
+ *
+ * The quadric error of a collapse is a weighted mean of squared distances and
+ * understates how far the surface moved; error() instead measures the distance
+ * from each original vertex to the triangles around the vertex it ended up on.
+ */
+class MeshSimplifier
+{
+public:
+
+    /**
+     * @brief Takes a mesh to simplify.
+     * @param vertices Packed (x,y,z) vertex coordinates.
+     * @param indices Triangles (indices on the vertices' list).
+     * @param threads Number of threads, 0 for one per hardware thread.
+     * @return False if an index is out of range.
+     */
+    bool set (std::vector<float> &&vertices, std::vector<unsigned int> &&indices, unsigned int threads = 0)
+    {
+        positions = std::move(vertices);
+        positions.resize(positions.size() - positions.size() % 3);
+        triangles.clear();
+        num_threads = (threads > 0) ? threads : std::max(1u, std::thread::hardware_concurrency());
+
+        const size_t num_vertices = positions.size()/3;
+        for (unsigned int i : indices)
+        {
+            if ( i >= num_vertices )
+            {
+                return false;
+            }
+        }
+
+        // triangles listing a vertex twice have nothing to collapse
+        triangles.reserve(indices.size());
+        for (size_t t = 0; t + 2 < indices.size(); t += 3)
+        {
+            if ( (indices[t] != indices[t+1]) && (indices[t] != indices[t+2]) && (indices[t+1] != indices[t+2]) )
+            {
+                triangles.insert(triangles.end(), &indices[t], &indices[t+3]);
+            }
+        }
+        std::vector<unsigned int>().swap(indices);
+
+        // quadrics are summed in floats: work around the origin at unit scale
+        Eigen::AlignedBox3f box;
+        for (size_t v = 0; v < num_vertices; ++v)
+        {
+            box.extend(Eigen::Vector3f(positions[3*v], positions[3*v + 1], positions[3*v + 2]));
+        }
+        const Eigen::Vector3f center = box.isEmpty() ? Eigen::Vector3f(Eigen::Vector3f::Zero()) : Eigen::Vector3f(box.center());
+        scale = box.isEmpty() ? 1.f : box.sizes().maxCoeff();
+        if ( !(scale > 0.f) )
+        {
+            scale = 1.f;
+        }
+        for (size_t v = 0; v < num_vertices; ++v)
+        {
+            for (int c = 0; c < 3; ++c)
+            {
+                positions[3*v + c] = (positions[3*v + c] - center[c]) / scale;
+            }
+        }
+
+        remap.resize(num_vertices);
+        std::iota(remap.begin(), remap.end(), 0u);
+        collapsed_onto = remap;
+
+        buildAdjacency();
+        classifyVertices();
+        buildQuadrics();
+
+        return true;
+    }
+
+    /**
+     * @brief Collapses edges until at most target triangles are left.
+     *
+     * Can be called again with a smaller target to go on from the current triangles.
+     * @param target Number of triangles to reach.
+     * @param max_error Largest quadric error of a collapse, as a distance in the units of the vertices.
+     * @return Number of triangles left, more than target if max_error was reached or no edge could be collapsed.
+     */
+    size_t simplify (size_t target, float max_error = std::numeric_limits<float>::max())
+    {
+        const float max_normalized = max_error / scale;
+        const float cost_limit = (max_normalized < std::sqrt(std::numeric_limits<float>::max())) ?
+            max_normalized*max_normalized : std::numeric_limits<float>::max();
+
+        while ( (triangles.size()/3 > target) && collapsePass(target, cost_limit) )
+        {
+        }
+
+        return triangles.size()/3;
+    }
+
+    /**
+     * @brief Builds levels of detail, each simplified from the previous one.
+     *
+     * Levels that would keep more than 90% of the triangles of the previous one are left out.
+     * @param budgets Most triangles of each level, decreasing.
+     * @param indices Receives the triangles of all levels, one level after the other.
+     * @param sizes Receives the number of indices of each level.
+     * @param errors Receives the error of each level, in the units of the vertices.
+     */
+    void buildLevels (const std::vector<size_t> &budgets, std::vector<unsigned int> &indices, std::vector<size_t> &sizes, std::vector<float> &errors)
+    {
+        indices.clear();
+        sizes.clear();
+        errors.clear();
+
+        size_t previous = triangles.size()/3;
+        for (size_t budget : budgets)
+        {
+            const size_t left = simplify(budget);
+            if ( (left > budget) && (10*left > 9*previous) )
+            {
+                break;
+            }
+            if ( 10*left > 9*previous )
+            {
+                continue;
+            }
+
+            indices.insert(indices.end(), triangles.begin(), triangles.end());
+            sizes.push_back(triangles.size());
+            // a coarser level is never closer to the original than a finer one
+            errors.push_back(std::max(error(), errors.empty() ? 0.f : errors.back()));
+            previous = left;
+        }
+    }
+
+    /**
+     * @brief Returns the triangles left.
+     */
+    const std::vector<unsigned int>& indices (void) const
+    {
+        return triangles;
+    }
+
+    /**
+     * @brief Measures how far the simplified surface lies from the original vertices.
+     * Looks at the triangles up to two rings around the vertex each original vertex was collapsed onto,
+     * fewer around crowded vertices, which can only overstate the distance.
+     * @return Largest distance from an original vertex to the simplified triangles near it, in the units of the vertices.
+     */
+    float error (void)
+    {
+        const size_t num_vertices = positions.size()/3;
+
+        buildAdjacency();
+        for (size_t v = 0; v < num_vertices; ++v)
+        {
+            unsigned int root = collapsed_onto[v];
+            while ( collapsed_onto[root] != root )
+            {
+                root = collapsed_onto[root];
+            }
+            collapsed_onto[v] = root;
+        }
+
+        const size_t num_ranges = numRanges(num_vertices);
+        std::vector<float> largest (num_ranges, 0.f);
+        auto measure = [&] (size_t r) {
+            for (size_t v = num_vertices*r/num_ranges; v < num_vertices*(r+1)/num_ranges; ++v)
+            {
+                const unsigned int root = collapsed_onto[v];
+                if ( root == v )
+                {
+                    continue;
+                }
+
+                // around vertices gathering too many triangles, settle for the distance to the vertex itself
+                const unsigned int valence = adjacency_offsets[root+1] - adjacency_offsets[root];
+                if ( valence > max_measured_valence )
+                {
+                    const Eigen::Map<const Eigen::Vector3f> p (position(v)), q (position(root));
+                    largest[r] = std::max(largest[r], (p - q).norm());
+                    continue;
+                }
+
+                float nearest = std::numeric_limits<float>::max();
+                for (unsigned int i = adjacency_offsets[root]; i < adjacency_offsets[root+1]; ++i)
+                {
+                    nearest = std::min(nearest, triangleDistance(position(v), &triangles[3*static_cast<size_t>(adjacency[i])]));
+                }
+
+                // the vertex may have drifted over the neighbours' triangles: look two rings out, while it matters
+                for (unsigned int i = adjacency_offsets[root]; (valence <= max_ring_valence) && (i < adjacency_offsets[root+1]) && (nearest > largest[r]); ++i)
+                {
+                    const unsigned int *ring = &triangles[3*static_cast<size_t>(adjacency[i])];
+                    for (int k = 0; k < 3; ++k)
+                    {
+                        // the root's own triangles were already looked at; skip the crowded fans
+                        if ( (ring[k] == root) || (adjacency_offsets[ring[k]+1] - adjacency_offsets[ring[k]] > max_ring_valence) )
+                        {
+                            continue;
+                        }
+                        for (unsigned int j = adjacency_offsets[ring[k]]; j < adjacency_offsets[ring[k]+1]; ++j)
+                        {
+                            nearest = std::min(nearest, triangleDistance(position(v), &triangles[3*static_cast<size_t>(adjacency[j])]));
+                        }
+                    }
+                }
+                if ( nearest < std::numeric_limits<float>::max() )
+                {
+                    largest[r] = std::max(largest[r], nearest);
+                }
+            }
+        };
+        runRanges(num_ranges, measure);
+
+        return *std::max_element(largest.begin(), largest.end()) * scale;
+    }
+
+private:
+
+    enum VertexKind : unsigned char
+    {
+        /// Collapses onto any neighbour
+        INTERIOR,
+        /// Collapses only along a border edge
+        BORDER,
+        /// Never collapses
+        LOCKED
+    };
+
+    /// Sum of squared distances to weighted planes, p'Ap + 2b'p + c, with the sum of the weights
+    struct Quadric
+    {
+        float a00 = 0.f, a11 = 0.f, a22 = 0.f, a01 = 0.f, a02 = 0.f, a12 = 0.f;
+        float b0 = 0.f, b1 = 0.f, b2 = 0.f;
+        float c = 0.f;
+        float weight = 0.f;
+
+        /// Adds the plane n.p + d = 0 (n of unit length) with the given weight
+        void addPlane (const Eigen::Vector3f &n, float d, float w)
+        {
+            a00 += w*n[0]*n[0]; a11 += w*n[1]*n[1]; a22 += w*n[2]*n[2];
+            a01 += w*n[0]*n[1]; a02 += w*n[0]*n[2]; a12 += w*n[1]*n[2];
+            b0 += w*n[0]*d; b1 += w*n[1]*d; b2 += w*n[2]*d;
+            c += w*d*d;
+            weight += w;
+        }
+
+        void add (const Quadric &q)
+        {
+            a00 += q.a00; a11 += q.a11; a22 += q.a22;
+            a01 += q.a01; a02 += q.a02; a12 += q.a12;
+            b0 += q.b0; b1 += q.b1; b2 += q.b2;
+            c += q.c;
+            weight += q.weight;
+        }
+
+        /// Weighted mean squared distance of p to the planes of this quadric and another
+        static float error (const Quadric &q, const Quadric &r, const float *p)
+        {
+            const double x = p[0], y = p[1], z = p[2];
+            const double e =
+                (double(q.a00) + r.a00)*x*x + (double(q.a11) + r.a11)*y*y + (double(q.a22) + r.a22)*z*z +
+                2.0*((double(q.a01) + r.a01)*x*y + (double(q.a02) + r.a02)*x*z + (double(q.a12) + r.a12)*y*z) +
+                2.0*((double(q.b0) + r.b0)*x + (double(q.b1) + r.b1)*y + (double(q.b2) + r.b2)*z) +
+                (double(q.c) + r.c);
+            const double w = double(q.weight) + r.weight;
+
+            return (w > 0.0) ? static_cast<float>(std::max(0.0, e) / w) : 0.f;
+        }
+    };
+
+    /// Collapse of vertex from onto vertex to
+    struct Collapse
+    {
+        unsigned int from;
+        unsigned int to;
+        float cost;
+    };
+
+    /// Runs job(0) ... job(num_ranges - 1), one per thread
+    template <typename Job>
+    static void runRanges (size_t num_ranges, Job &job)
+    {
+        std::vector<std::thread> workers;
+        for (size_t r = 1; r < num_ranges; ++r)
+        {
+            workers.emplace_back(job, r);
+        }
+        job(0);
+        for (std::thread &worker : workers)
+        {
+            worker.join();
+        }
+    }
+
+    /// Number of ranges to split count items into, at least min_items each
+    size_t numRanges (size_t count) const
+    {
+        return std::max<size_t>(1, std::min<size_t>(num_threads, count/min_items));
+    }
+
+    const float* position (unsigned int v) const
+    {
+        return &positions[3*static_cast<size_t>(v)];
+    }
+
+    /// Twice the area of a triangle along its normal
+    Eigen::Vector3f triangleNormal (unsigned int a, unsigned int b, unsigned int c) const
+    {
+        const Eigen::Map<const Eigen::Vector3f> p0 (position(a)), p1 (position(b)), p2 (position(c));
+        return (p1 - p0).cross(p2 - p0);
+    }
+
+    /// Distance from point p to a triangle (Ericson, "Real-Time Collision Detection", 5.1.5)
+    float triangleDistance (const float *p, const unsigned int *corners) const
+    {
+        const Eigen::Map<const Eigen::Vector3f> x (p), a (position(corners[0])), b (position(corners[1])), c (position(corners[2]));
+        const Eigen::Vector3f ab = b - a, ac = c - a, ap = x - a;
+        const float d1 = ab.dot(ap), d2 = ac.dot(ap);
+        if ( (d1 <= 0.f) && (d2 <= 0.f) )
+            return ap.norm();
+
+        const Eigen::Vector3f bp = x - b;
+        const float d3 = ab.dot(bp), d4 = ac.dot(bp);
+        if ( (d3 >= 0.f) && (d4 <= d3) )
+            return bp.norm();
+
+        const float vc = d1*d4 - d3*d2;
+        if ( (vc <= 0.f) && (d1 >= 0.f) && (d3 <= 0.f) )
+            return (ap - ab*(d1/(d1 - d3))).norm();
+
+        const Eigen::Vector3f cp = x - c;
+        const float d5 = ab.dot(cp), d6 = ac.dot(cp);
+        if ( (d6 >= 0.f) && (d5 <= d6) )
+            return cp.norm();
+
+        const float vb = d5*d2 - d1*d6;
+        if ( (vb <= 0.f) && (d2 >= 0.f) && (d6 <= 0.f) )
+            return (ap - ac*(d2/(d2 - d6))).norm();
+
+        const float va = d3*d6 - d5*d4;
+        if ( (va <= 0.f) && (d4 - d3 >= 0.f) && (d5 - d6 >= 0.f) )
+            return (bp - (c - b)*((d4 - d3)/((d4 - d3) + (d5 - d6)))).norm();
+
+        const float sum = va + vb + vc;
+        if ( !(sum > 0.f) )
+            return ap.norm();
+        return (ap - ab*(vb/sum) - ac*(vc/sum)).norm();
+    }
+
+    /// Triangles around each vertex, as offsets into a single list
+    void buildAdjacency (void)
+    {
+        const size_t num_vertices = positions.size()/3;
+
+        adjacency_offsets.assign(num_vertices + 1, 0);
+        for (unsigned int v : triangles)
+        {
+            ++adjacency_offsets[v + 1];
+        }
+        for (size_t v = 0; v < num_vertices; ++v)
+        {
+            adjacency_offsets[v+1] += adjacency_offsets[v];
+        }
+
+        adjacency.resize(triangles.size());
+        std::vector<unsigned int> fill (adjacency_offsets.begin(), adjacency_offsets.end() - 1);
+        for (size_t i = 0; i < triangles.size(); ++i)
+        {
+            adjacency[fill[triangles[i]]++] = static_cast<unsigned int>(i/3);
+        }
+    }
+
+    /// Number of triangles using both vertices
+    unsigned int sharedTriangles (unsigned int a, unsigned int b) const
+    {
+        unsigned int count = 0;
+        for (unsigned int i = adjacency_offsets[a]; i < adjacency_offsets[a+1]; ++i)
+        {
+            const unsigned int *corners = &triangles[3*static_cast<size_t>(adjacency[i])];
+            count += (corners[0] == b) || (corners[1] == b) || (corners[2] == b);
+        }
+        return count;
+    }
+
+    void classifyVertices (void)
+    {
+        const size_t num_vertices = positions.size()/3;
+        kinds.assign(num_vertices, INTERIOR);
+
+        // seams: vertices at the same position
+        std::vector<unsigned int> order (num_vertices);
+        std::iota(order.begin(), order.end(), 0u);
+        auto less = [this] (unsigned int a, unsigned int b) {
+            return std::lexicographical_compare(position(a), position(a) + 3, position(b), position(b) + 3);
+        };
+        std::sort(order.begin(), order.end(), less);
+        for (size_t i = 1; i < num_vertices; ++i)
+        {
+            if ( !less(order[i-1], order[i]) )
+            {
+                kinds[order[i-1]] = LOCKED;
+                kinds[order[i]] = LOCKED;
+            }
+        }
+
+        // borders: edges of a single triangle
+        auto classify = [&] (size_t r) {
+            const size_t num_ranges = numRanges(num_vertices);
+            for (size_t v = num_vertices*r/num_ranges; v < num_vertices*(r+1)/num_ranges; ++v)
+            {
+                for (unsigned int i = adjacency_offsets[v]; (i < adjacency_offsets[v+1]) && (kinds[v] == INTERIOR); ++i)
+                {
+                    const unsigned int *corners = &triangles[3*static_cast<size_t>(adjacency[i])];
+                    for (int c = 0; c < 3; ++c)
+                    {
+                        if ( (corners[c] != v) && (sharedTriangles(v, corners[c]) == 1) )
+                        {
+                            kinds[v] = BORDER;
+                        }
+                    }
+                }
+            }
+        };
+        runRanges(numRanges(num_vertices), classify);
+    }
+
+    /// Sums the planes of the triangles around each vertex, and the planes across its border edges
+    void buildQuadrics (void)
+    {
+        const size_t num_vertices = positions.size()/3;
+        quadrics.assign(num_vertices, Quadric());
+
+        auto gather = [&] (size_t r) {
+            const size_t num_ranges = numRanges(num_vertices);
+            for (size_t v = num_vertices*r/num_ranges; v < num_vertices*(r+1)/num_ranges; ++v)
+            {
+                const Eigen::Map<const Eigen::Vector3f> p (position(v));
+                for (unsigned int i = adjacency_offsets[v]; i < adjacency_offsets[v+1]; ++i)
+                {
+                    const unsigned int *corners = &triangles[3*static_cast<size_t>(adjacency[i])];
+                    const Eigen::Vector3f n = triangleNormal(corners[0], corners[1], corners[2]);
+                    const float length = n.norm();
+                    if ( !(length > 0.f) )
+                    {
+                        continue;
+                    }
+
+                    const Eigen::Vector3f unit = n / length;
+                    quadrics[v].addPlane(unit, -unit.dot(p), 0.5f*length);
+
+                    if ( kinds[v] != BORDER )
+                    {
+                        continue;
+                    }
+                    for (int c = 0; c < 3; ++c)
+                    {
+                        const unsigned int w = corners[c];
+                        if ( (w == v) || (sharedTriangles(v, w) != 1) )
+                        {
+                            continue;
+                        }
+
+                        // plane through the edge, perpendicular to the triangle
+                        const Eigen::Vector3f edge = Eigen::Map<const Eigen::Vector3f>(position(w)) - p;
+                        const Eigen::Vector3f across = edge.cross(unit);
+                        const float across_length = across.norm();
+                        if ( across_length > 0.f )
+                        {
+                            const Eigen::Vector3f plane = across / across_length;
+                            quadrics[v].addPlane(plane, -plane.dot(p), border_weight*edge.squaredNorm());
+                        }
+                    }
+                }
+            }
+        };
+        runRanges(numRanges(num_vertices), gather);
+    }
+
+    /// Whether moving vertex from onto vertex to turns any of the remaining triangles around
+    bool flips (unsigned int from, unsigned int to) const
+    {
+        for (unsigned int i = adjacency_offsets[from]; i < adjacency_offsets[from+1]; ++i)
+        {
+            const unsigned int *corners = &triangles[3*static_cast<size_t>(adjacency[i])];
+            if ( (corners[0] == to) || (corners[1] == to) || (corners[2] == to) )
+            {
+                continue;
+            }
+
+            unsigned int moved[3] = {corners[0], corners[1], corners[2]};
+            for (int c = 0; c < 3; ++c)
+            {
+                if ( moved[c] == from )
+                    moved[c] = to;
+            }
+
+            const Eigen::Vector3f before = triangleNormal(corners[0], corners[1], corners[2]);
+            const Eigen::Vector3f after = triangleNormal(moved[0], moved[1], moved[2]);
+            if ( (before.squaredNorm() > 0.f) && (before.dot(after) <= 1e-2f*before.norm()*after.norm()) )
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /// Rates the edges, then collapses the cheapest ones that do not touch each other; false if none was collapsed
+    bool collapsePass (size_t target, float cost_limit)
+    {
+        const size_t num_triangles = triangles.size()/3;
+        const size_t num_vertices = positions.size()/3;
+
+        buildAdjacency();
+
+        // the cheapest way to collapse each edge, if any
+        const size_t num_ranges = numRanges(num_triangles);
+        std::vector< std::vector<Collapse> > found (num_ranges);
+        auto rate = [&] (size_t r) {
+            for (size_t t = num_triangles*r/num_ranges; t < num_triangles*(r+1)/num_ranges; ++t)
+            {
+                for (int e = 0; e < 3; ++e)
+                {
+                    const unsigned int a = triangles[3*t + e];
+                    const unsigned int b = triangles[3*t + (e+1)%3];
+                    const bool border = (sharedTriangles(a, b) == 1);
+
+                    // inner edges are rated from one of their two triangles
+                    if ( !border && (a > b) )
+                    {
+                        continue;
+                    }
+
+                    Collapse best = {a, a, std::numeric_limits<float>::max()};
+                    const unsigned int ends[2][2] = {{a, b}, {b, a}};
+                    for (const auto &end : ends)
+                    {
+                        const unsigned int from = end[0];
+                        const unsigned int to = end[1];
+                        if ( (kinds[from] == LOCKED) || ((kinds[from] == BORDER) && !border) )
+                        {
+                            continue;
+                        }
+
+                        const float cost = Quadric::error(quadrics[from], quadrics[to], position(to));
+                        if ( cost < best.cost )
+                        {
+                            best = Collapse{from, to, cost};
+                        }
+                    }
+
+                    if ( (best.from != best.to) && (best.cost <= cost_limit) )
+                    {
+                        found[r].push_back(best);
+                    }
+                }
+            }
+        };
+        runRanges(num_ranges, rate);
+
+        std::vector<Collapse> collapses;
+        for (std::vector<Collapse> &range : found)
+        {
+            collapses.insert(collapses.end(), range.begin(), range.end());
+            std::vector<Collapse>().swap(range);
+        }
+        if ( collapses.empty() )
+        {
+            return false;
+        }
+
+        // most collapses remove two triangles; only consider those not much worse than needed
+        auto cheaper = [] (const Collapse &x, const Collapse &y) { return x.cost < y.cost; };
+        const size_t goal = std::min(collapses.size(), std::max<size_t>({1, (num_triangles - target)/2, collapses.size()/8}));
+        std::nth_element(collapses.begin(), collapses.begin() + (goal - 1), collapses.end(), cheaper);
+        const float bound = collapses[goal - 1].cost*pass_error_bound;
+        auto considered = std::partition(collapses.begin(), collapses.end(), [bound] (const Collapse &x) { return x.cost <= bound; });
+        std::sort(collapses.begin(), considered, cheaper);
+
+        locked.assign(num_vertices, 0);
+        std::vector<unsigned int> collapsed;
+        size_t removed = 0;
+        const size_t excess = num_triangles - target;
+        auto apply = [&] (std::vector<Collapse>::iterator begin, std::vector<Collapse>::iterator end) {
+            for (auto it = begin; (it != end) && (removed < excess); ++it)
+            {
+                const Collapse &c = *it;
+                if ( locked[c.from] || locked[c.to] || flips(c.from, c.to) )
+                {
+                    continue;
+                }
+
+                // the triangles around from change: keep their vertices out of this pass
+                for (unsigned int i = adjacency_offsets[c.from]; i < adjacency_offsets[c.from+1]; ++i)
+                {
+                    const unsigned int *corners = &triangles[3*static_cast<size_t>(adjacency[i])];
+                    locked[corners[0]] = locked[corners[1]] = locked[corners[2]] = 1;
+                    removed += (corners[0] == c.to) || (corners[1] == c.to) || (corners[2] == c.to);
+                }
+
+                remap[c.from] = c.to;
+                quadrics[c.to].add(quadrics[c.from]);
+                collapsed_onto[c.from] = c.to;
+                collapsed.push_back(c.from);
+            }
+        };
+        apply(collapses.begin(), considered);
+        if ( collapsed.empty() )
+        {
+            // everything cheap folds triangles, try the others
+            std::sort(considered, collapses.end(), cheaper);
+            apply(considered, collapses.end());
+        }
+        if ( collapsed.empty() )
+        {
+            return false;
+        }
+
+        // move the triangles onto the remaining vertices, dropping the collapsed ones
+        std::vector< std::vector<unsigned int> > kept (num_ranges);
+        auto rewrite = [&] (size_t r) {
+            for (size_t t = num_triangles*r/num_ranges; t < num_triangles*(r+1)/num_ranges; ++t)
+            {
+                const unsigned int a = remap[triangles[3*t]];
+                const unsigned int b = remap[triangles[3*t + 1]];
+                const unsigned int c = remap[triangles[3*t + 2]];
+                if ( (a != b) && (a != c) && (b != c) )
+                {
+                    kept[r].push_back(a);
+                    kept[r].push_back(b);
+                    kept[r].push_back(c);
+                }
+            }
+        };
+        runRanges(num_ranges, rewrite);
+
+        triangles.clear();
+        for (std::vector<unsigned int> &range : kept)
+        {
+            triangles.insert(triangles.end(), range.begin(), range.end());
+        }
+        for (unsigned int v : collapsed)
+        {
+            remap[v] = v;
+        }
+
+        return true;
+    }
+
+    /// Smallest number of triangles or vertices handed to a thread
+    static const size_t min_items = 1u << 16;
+
+    /// Weight of the planes across border edges, relative to the planes of the triangles
+    static constexpr float border_weight = 2.f;
+
+    /// error() only looks two rings out around vertices with at most this many triangles around them
+    static const unsigned int max_ring_valence = 64;
+
+    /// error() only looks at the triangles around vertices with at most this many of them
+    static const unsigned int max_measured_valence = 512;
+
+    /// A pass considers collapses up to this factor of the cost of the last one it needs
+    static constexpr float pass_error_bound = 1.5f;
+
+    /// Vertex coordinates, centered and scaled to a unit box
+    std::vector<float> positions;
+    float scale = 1.f;
+
+    std::vector<unsigned int> triangles;
+    std::vector<VertexKind> kinds;
+    std::vector<Quadric> quadrics;
+
+    /// adjacency[adjacency_offsets[v] .. adjacency_offsets[v+1]) are the triangles around vertex v
+    std::vector<unsigned int> adjacency_offsets;
+    std::vector<unsigned int> adjacency;
+
+    /// Vertex each vertex collapses onto in the current pass, itself if none
+    std::vector<unsigned int> remap;
+
+    /// Vertices touched by a collapse in the current pass
+    std::vector<char> locked;
+
+    /// Vertex each vertex was collapsed onto, itself if it is still in use
+    std::vector<unsigned int> collapsed_onto;
+
+    unsigned int num_threads = 1;
+};
+
+}
+#endif
@@ -24,6 +24,7 @@
 #define __OBJIMPORTER__
 
 #include <tucano/mesh.hpp>
+#include <tucano/utils/objreader.hpp>
 
 using namespace std;
 
@@ -37,141 +38,54 @@ namespace MeshImporter
     #pragma warning(disable:4996)
 #else
 // avoid warnings of unused function
-static void loadObjFile (Mesh* mesh, string filename) __attribute__ ((unused));
+static bool loadObjFile (Mesh* mesh, string filename) __attribute__ ((unused));
+static bool readObjFile (const string &filename, ObjData &data) __attribute__ ((unused));
+static void uploadObjData (Mesh *mesh, ObjData &data) __attribute__ ((unused));
 #endif
 
 /**
- * @brief Loads a mesh from an OBJ file.
+ * @brief Reads an OBJ file into main memory, without touching the GL.
+ *
+ * Safe to call from any thread.  See ObjReader.
  *
- * Loads vertex coordinates and normals, texcoords and color when available.
- * @param mesh Pointer to mesh instance to load file.
  * @param filename Given filename of the OBJ file.
+ * @param data Attributes found in the file.
+ * @return True if the file could be read, false if it is missing or malformed.
  */
-static void loadObjFile (Mesh* mesh, string filename)
+static bool readObjFile (const string &filename, ObjData &data)
 {
-    vector<Eigen::Vector4f> vert;
-    vector<Eigen::Vector3f> norm;
-    vector<Eigen::Vector2f> texCoord;
-    vector<Eigen::Vector4f> color;
-    vector<GLuint> elementsVertices;
-    vector<GLuint> elementsNormals;
-    vector<GLuint> elementsTexIDs;
-
-    //Opening file:
-    #ifdef TUCANODEBUG
-    cout << "Opening Wavefront obj file " << filename.c_str() << endl << endl;
-    #endif
-
-    ifstream in(filename.c_str(),ios::in);
-    if (!in)
-    {
-        cerr << "Cannot open " << filename.c_str() << endl; exit(1);
-    }
-
-    //Reading file:
-    string line;
-    while(getline(in,line))
-    {
-
-        //Vertices reading:
-        if(line.substr(0,2) == "v ")
-        {
-
-            istringstream s(line.substr(2));
-            Eigen::Vector4f v;
-            s >> v[0]; s >> v[1]; s >> v[2]; v[3] = 1.0f;
-            vert.push_back(v);
-
-            if(s.rdbuf()->in_avail())
-            {
-                Eigen::Vector4f c;
-                s >> c[0]; s >> c[1]; s >> c[2]; c[3] = 1.0f;
-                color.push_back(c);
-            }
-        }
-
-        //Normals reading:
-        else if(line.substr(0,2) == "vn")
-        {
-            istringstream s(line.substr(3));
-            Eigen::Vector3f vn;
-            s >> vn[0]; s >> vn[1]; s >> vn[2];            
-            norm.push_back(vn);
-        }
-
-        //Texture Coordinates reading:
-        else if(line.substr(0,2) == "vt")
-        {
-            istringstream s(line.substr(2));
-            Eigen::Vector2f vt;
-            s >> vt[0]; s >> vt[1];
-            texCoord.push_back(vt);
-        }
-
-        //Elements reading: Elements are given through a string: "f vertexID/TextureID/NormalID". If no texture is given, then the string will be: "vertexID//NormalID".
-        else if(line.substr(0,2) == "f ")
-        {
-            GLuint vertexID1, normalID1, textureID1;
-            istringstream s(line.substr(2));
-            while(!s.eof())
-            {
-                s >> vertexID1;
-                elementsVertices.push_back(vertexID1-1);
-                if(s.peek() == '/')
-                {
-                    s.get();
-                    if(s.peek() == '/')
-                    {
-                        s.get();
-                        s >> normalID1;
-                        elementsNormals.push_back(normalID1-1);
-                    }
-                    else
-                    {
-                        s >> textureID1;
-                        elementsTexIDs.push_back(textureID1-1);
-                        if(s.peek() == '/')
-                        {
-                            s.get();
-                            s >> normalID1;
-                            elementsNormals.push_back(normalID1-1);
-                        }
-                    }
-                }
-            }
-        }
-
-        //Ignoring comment lines:
-        else if(line[0] == '#') { }
-
-        //Ignoring any other lines:
-        else {};
-    }
-    if(in.is_open())
-    {
-        in.close();
-    }
+    ObjReader reader;
+    return reader.read(filename, data);
+}
 
+/**
+ * @brief Loads attributes read by readObjFile() into a mesh.
+ *
+ * @param mesh Pointer to mesh instance to load the attributes.
+ * @param data Attributes read from an OBJ file.
+ */
+static void uploadObjData (Mesh *mesh, ObjData &data)
+{
     // load attributes found in file
-    if (vert.size() > 0)
+    if (data.vertices.size() > 0)
     {
-        mesh->loadVertices(vert);
+        mesh->loadVertices(data.vertices);
     }
-    if (norm.size() > 0)
+    if (data.normals.size() > 0)
     {
-        mesh->loadNormals(norm);
+        mesh->loadNormals(data.normals);
     }
-    if (texCoord.size() > 0)
+    if (data.tex_coords.size() > 0)
     {
-        mesh->loadTexCoords(texCoord);
+        mesh->loadTexCoords(data.tex_coords);
     }
-    if (color.size() > 0)
+    if (data.colors.size() > 0)
     {
-        mesh->loadColors(color);
+        mesh->loadColorsRGB(data.colors);
     }
-    if (elementsVertices.size() > 0)
+    if (data.indices.size() > 0)
     {
-        mesh->loadIndices(elementsVertices);
+        mesh->loadIndices(data.indices);
     }
 
     // sets the default locations for accesing attributes in shaders
@@ -182,6 +96,34 @@ static void loadObjFile (Mesh* mesh, string filename)
     #endif
 }
 
+/**
+ * @brief Loads a mesh from an OBJ file.
+ *
+ * Loads vertex coordinates and normals, texcoords and color when available.
+ * Each distinct (position, texcoord, normal) triple used by the faces becomes
+ * a vertex of the mesh, and polygons are split into triangles.
+ * @param mesh Pointer to mesh instance to load file.
+ * @param filename Given filename of the OBJ file.
+ * @return True if the file could be read, false otherwise (the mesh is left untouched).
+ */
+static bool loadObjFile (Mesh* mesh, string filename)
+{
+    #ifdef TUCANODEBUG
+    cout << "Opening Wavefront obj file " << filename.c_str() << endl << endl;
+    #endif
+
+    ObjData data;
+    if ( !readObjFile(filename, data) )
+    {
+        cerr << "Cannot read " << filename.c_str() << endl;
+        return false;
+    }
+
+    uploadObjData(mesh, data);
+
+    return true;
+}
+
 }
 }
 #endif
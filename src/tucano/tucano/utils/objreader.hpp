@@ -0,0 +1,667 @@
+/**
+ * Tucano - A library for rapid prototying with Modern OpenGL and GLSL
+ * Copyright (C) 2014
+ * LCG - Laboratório de Computação Gráfica (Computer Graphics Lab) - COPPE
+ * UFRJ - Federal University of Rio de Janeiro
+ *
+ * This file is part of Tucano Library.
+ *
+ * Tucano Library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Tucano Library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Tucano Library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __OBJREADER__
+#define __OBJREADER__
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <tucano/utils/mappedfile.hpp>
+
+
+namespace Tucano
+{
+namespace MeshImporter
+{
+
+/**
+ * @brief Mesh attributes read from a Wavefront OBJ file and kept in main memory.
+ *
+ * Each (position, texcoord, normal) index triple used by a face is a vertex
+ * of its own, so every attribute is a flat array with one value per vertex,
+ * laid out as the GL expects it.
+ */
+struct ObjData
+{
+    /// Packed (x,y,z) vertex coordinates
+    std::vector<float> vertices;
+
+    /// Packed (x,y,z) normals per vertex, empty if the faces reference none
+    std::vector<float> normals;
+
+    /// Packed (r,g,b) colors per vertex, from "v x y z r g b" lines; empty if there are none
+    std::vector<float> colors;
+
+    /// Packed (u,v) texture coordinates per vertex, empty if the faces reference none
+    std::vector<float> tex_coords;
+
+    /// Triangles (indices on the vertices' list)
+    std::vector<unsigned int> indices;
+};
+
+/**
+ * @brief Parallel reader for Wavefront OBJ files.
+ *
+ * The file is memory mapped and cut at line boundaries into one chunk per
+ * thread.  Chunks are parsed concurrently with hand written number parsers,
+ * then merged: relative (negative) indices are resolved, polygons are
+ * triangulated as fans and index triples are welded into unified vertices.
+ * Only geometry is read (v, vt, vn and f lines); materials, groups, lines and
+ * points are skipped.
+ */
+class ObjReader
+{
+public:
+
+    /**
+     * @brief Reads an OBJ file.
+     * @param filename Given filename of the OBJ file.
+     * @param data Attributes found in the file.
+     * @param threads Number of parsing threads, 0 for one per hardware thread.
+     * @return True if the file could be read, false if it is missing or malformed (ex. a face index out of range).
+     */
+    bool read (const std::string &filename, ObjData &data, unsigned int threads = 0)
+    {
+        data = ObjData();
+
+        MappedFile file;
+        if (!file.open(filename))
+        {
+            return false;
+        }
+
+        const char *first = file.data();
+        const char *last = first + file.size();
+
+        // one chunk per thread, but no chunk smaller than min_chunk_bytes
+        if (threads == 0)
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        const size_t chunks_by_size = std::max<size_t>(1, file.size()/min_chunk_bytes);
+        const size_t num_chunks = std::min<size_t>(threads, chunks_by_size);
+
+        std::vector<Chunk> chunks(num_chunks);
+        std::vector<const char*> bounds(num_chunks + 1, last);
+        bounds[0] = first;
+        for (size_t c = 1; c < num_chunks; ++c)
+        {
+            const char *cut = std::max(bounds[c-1], first + file.size()*c/num_chunks);
+            const char *newline = static_cast<const char*>(std::memchr(cut, '\n', last - cut));
+            bounds[c] = (newline != nullptr) ? newline + 1 : last;
+        }
+
+        std::vector<std::thread> workers;
+        for (size_t c = 1; c < num_chunks; ++c)
+        {
+            workers.emplace_back( [&chunks, &bounds, c] () { parseChunk(bounds[c], bounds[c+1], chunks[c]); } );
+        }
+        parseChunk(bounds[0], bounds[1], chunks[0]);
+        for (std::thread &worker : workers)
+        {
+            worker.join();
+        }
+
+        for (const Chunk &chunk : chunks)
+        {
+            if (chunk.failed)
+                return false;
+        }
+
+        return merge(chunks, data);
+    }
+
+private:
+
+    /// Attributes and face corners of one chunk of lines
+    struct Chunk
+    {
+        std::vector<float> positions;
+        std::vector<float> colors;
+        std::vector<float> tex_coords;
+        std::vector<float> normals;
+
+        /// (position, texcoord, normal) index triple of each triangle corner, -1 for a missing texcoord or normal
+        std::vector<std::int32_t> corners;
+
+        /// Entries of corners holding relative indices, counted from the first value of this chunk
+        std::vector<size_t> relative;
+
+        bool failed = false;
+    };
+
+    /// Smallest chunk worth a thread of its own
+    static const size_t min_chunk_bytes = 1 << 20;
+
+    /// Color of vertices without one, when others have colors (the Mesh default color)
+    static float defaultColor ()
+    {
+        return 0.7f;
+    }
+
+    static bool isSpace (char c)
+    {
+        return (c == ' ') || (c == '\t') || (c == '\r');
+    }
+
+    static const char* skipSpaces (const char *p, const char *end)
+    {
+        while ( (p != end) && isSpace(*p) )
+            ++p;
+        return p;
+    }
+
+    static bool isDigit (char c)
+    {
+        return (c >= '0') && (c <= '9');
+    }
+
+    /**
+     * @brief Parses a decimal number, returns the position after it or null if there is none.
+     *
+     * Numbers with at most 19 significant digits and small exponents are
+     * computed exactly in double precision; anything else (ex. "inf") is handed
+     * to strtod.
+     */
+    static const char* parseFloat (const char *p, const char *end, float &value)
+    {
+        static const double powers[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                                        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+        const char *start = p;
+        bool negative = false;
+        if ( (p != end) && ((*p == '-') || (*p == '+')) )
+        {
+            negative = (*p == '-');
+            ++p;
+        }
+
+        std::uint64_t mantissa = 0;
+        int digits = 0;
+        int exponent = 0;
+        bool any_digit = false;
+        bool exact = true;
+
+        for (; (p != end) && isDigit(*p); ++p)
+        {
+            any_digit = true;
+            if (digits < 19)
+            {
+                mantissa = mantissa*10 + (*p - '0');
+                digits += (mantissa != 0);
+            }
+            else
+            {
+                ++exponent;
+                exact = exact && (*p == '0');
+            }
+        }
+
+        if ( (p != end) && (*p == '.') )
+        {
+            for (++p; (p != end) && isDigit(*p); ++p)
+            {
+                any_digit = true;
+                if (digits < 19)
+                {
+                    mantissa = mantissa*10 + (*p - '0');
+                    digits += (mantissa != 0);
+                    --exponent;
+                }
+                else
+                {
+                    exact = exact && (*p == '0');
+                }
+            }
+        }
+
+        if ( any_digit && (p != end) && ((*p == 'e') || (*p == 'E')) )
+        {
+            const char *q = p + 1;
+            bool negative_exponent = false;
+            if ( (q != end) && ((*q == '-') || (*q == '+')) )
+            {
+                negative_exponent = (*q == '-');
+                ++q;
+            }
+
+            int e = 0;
+            const char *digits_start = q;
+            for (; (q != end) && isDigit(*q); ++q)
+            {
+                e = std::min(e*10 + (*q - '0'), 100000);
+            }
+
+            if (q != digits_start)
+            {
+                exponent += negative_exponent ? -e : e;
+                p = q;
+            }
+        }
+
+        const bool delimited = (p == end) || isSpace(*p) || (*p == '\n');
+        if ( any_digit && delimited && exact && (mantissa <= (std::uint64_t(1) << 53)) && (exponent >= -22) && (exponent <= 22) )
+        {
+            double v = static_cast<double>(mantissa);
+            v = (exponent < 0) ? v / powers[-exponent] : v * powers[exponent];
+            value = static_cast<float>(negative ? -v : v);
+            return p;
+        }
+
+        // the mapped file is not null terminated, strtod works on a copy of the token
+        const char *token_end = start;
+        while ( (token_end != end) && !isSpace(*token_end) && (*token_end != '\n') )
+            ++token_end;
+
+        char token[64];
+        const size_t length = std::min<size_t>(token_end - start, sizeof(token) - 1);
+        std::memcpy(token, start, length);
+        token[length] = '\0';
+
+        char *parsed = nullptr;
+        value = static_cast<float>(std::strtod(token, &parsed));
+        if ( (parsed == token) || (static_cast<size_t>(parsed - token) != length) )
+            return nullptr;
+
+        return token_end;
+    }
+
+    /// Parses a decimal integer, returns the position after it or null if there is none
+    static const char* parseInt (const char *p, const char *end, long &value)
+    {
+        bool negative = false;
+        if ( (p != end) && ((*p == '-') || (*p == '+')) )
+        {
+            negative = (*p == '-');
+            ++p;
+        }
+
+        const char *digits_start = p;
+        long v = 0;
+        for (; (p != end) && isDigit(*p); ++p)
+        {
+            v = std::min(v*10 + (*p - '0'), 1L << 40);
+        }
+
+        if (p == digits_start)
+            return nullptr;
+
+        value = negative ? -v : v;
+        return p;
+    }
+
+    /// Parses up to max_count floats, returns how many were found before the end of the line or anything else
+    static size_t parseFloats (const char *&p, const char *end, float *values, size_t max_count)
+    {
+        size_t count = 0;
+        while (count < max_count)
+        {
+            p = skipSpaces(p, end);
+            if ( (p == end) || (*p == '\n') )
+                break;
+
+            const char *next = parseFloat(p, end, values[count]);
+            if (next == nullptr)
+                break;
+
+            p = next;
+            ++count;
+        }
+        return count;
+    }
+
+    /**
+     * @brief Converts an OBJ index (1 based, or negative to count back from the last value) into a 0 based one.
+     * @param index Index read from the file.
+     * @param count Number of values read so far in the chunk.
+     * @param resolved 0 based index; relative indices give an index on the values of the chunk.
+     * @param relative Set if the index was relative.
+     * @return False if the index is 0 or out of the 32 bit range.
+     */
+    static bool resolveIndex (long index, size_t count, std::int32_t &resolved, bool &relative)
+    {
+        const long max_index = 0x7fffffffL;
+        if ( (index == 0) || (index > max_index) || (index < -max_index) )
+            return false;
+
+        relative = (index < 0);
+        resolved = static_cast<std::int32_t>(relative ? static_cast<long>(count) + index : index - 1);
+        return true;
+    }
+
+    /// Corners of the polygon being parsed, reused from line to line
+    struct Polygon
+    {
+        /// (position, texcoord, normal) triple of each corner
+        std::vector<std::int32_t> indices;
+
+        /// Bit k set if component k of the corner is relative to the chunk
+        std::vector<unsigned char> relative;
+    };
+
+    /// Parses the corners of an "f" line and appends its fan of triangles to the chunk
+    static bool parseFace (const char *&p, const char *end, Chunk &chunk, Polygon &polygon)
+    {
+        polygon.indices.clear();
+        polygon.relative.clear();
+
+        const size_t counts[3] = {chunk.positions.size()/3, chunk.tex_coords.size()/2, chunk.normals.size()/3};
+
+        while (true)
+        {
+            p = skipSpaces(p, end);
+            if ( (p == end) || (*p == '\n') )
+                break;
+
+            // v, v/vt, v//vn or v/vt/vn
+            std::int32_t indices[3] = {-1, -1, -1};
+            unsigned char relative = 0;
+            for (int k = 0; k < 3; ++k)
+            {
+                if (k > 0)
+                {
+                    if ( (p == end) || (*p != '/') )
+                        break;
+                    ++p;
+
+                    // no texcoord in v//vn
+                    if ( (k == 1) && (p != end) && (*p == '/') )
+                        continue;
+                }
+
+                long index = 0;
+                bool is_relative = false;
+                p = parseInt(p, end, index);
+                if ( (p == nullptr) || !resolveIndex(index, counts[k], indices[k], is_relative) )
+                    return false;
+                relative |= static_cast<unsigned char>(is_relative << k);
+            }
+
+            polygon.indices.insert(polygon.indices.end(), indices, indices + 3);
+            polygon.relative.push_back(relative);
+        }
+
+        // triangulate as a fan around the first corner; lines with less than 3 corners are skipped
+        const size_t corners = polygon.relative.size();
+        for (size_t i = 1; i + 1 < corners; ++i)
+        {
+            const size_t triangle[3] = {0, i, i + 1};
+            for (size_t c : triangle)
+            {
+                for (int k = 0; k < 3; ++k)
+                {
+                    if (polygon.relative[c] & (1 << k))
+                        chunk.relative.push_back(chunk.corners.size());
+                    chunk.corners.push_back(polygon.indices[3*c + k]);
+                }
+            }
+        }
+
+        return true;
+    }
+
+    /// Parses the lines in [p, end)
+    static void parseChunk (const char *p, const char *end, Chunk &chunk)
+    {
+        Polygon polygon;
+        float values[6];
+
+        while ( (p != end) && !chunk.failed )
+        {
+            p = skipSpaces(p, end);
+
+            const char type = (p != end) ? *p : '\0';
+            const char subtype = (end - p > 1) ? p[1] : '\0';
+
+            if ( (type == 'v') && isSpace(subtype) )
+            {
+                // x y z, optionally followed by w or by r g b
+                p += 1;
+                const size_t count = parseFloats(p, end, values, 6);
+                chunk.failed = (count < 3);
+                chunk.positions.insert(chunk.positions.end(), values, values + 3);
+
+                if (count == 6)
+                {
+                    // colors start with the first colored vertex
+                    chunk.colors.resize(chunk.positions.size() - 3, defaultColor());
+                    chunk.colors.insert(chunk.colors.end(), values + 3, values + 6);
+                }
+                else if (!chunk.colors.empty())
+                {
+                    chunk.colors.resize(chunk.positions.size(), defaultColor());
+                }
+            }
+            else if ( (type == 'v') && (subtype == 't') )
+            {
+                // u, optionally followed by v and w
+                p += 2;
+                values[1] = 0.0f;
+                chunk.failed = (parseFloats(p, end, values, 2) < 1);
+                chunk.tex_coords.insert(chunk.tex_coords.end(), values, values + 2);
+            }
+            else if ( (type == 'v') && (subtype == 'n') )
+            {
+                p += 2;
+                chunk.failed = (parseFloats(p, end, values, 3) < 3);
+                chunk.normals.insert(chunk.normals.end(), values, values + 3);
+            }
+            else if ( (type == 'f') && isSpace(subtype) )
+            {
+                p += 1;
+                chunk.failed = !parseFace(p, end, chunk, polygon);
+            }
+
+            // anything else (comments, groups, materials...) is skipped with the rest of the line
+            const char *newline = static_cast<const char*>(std::memchr(p, '\n', end - p));
+            p = (newline != nullptr) ? newline + 1 : end;
+        }
+    }
+
+    /// A unified vertex in the welding table, empty if v is -1
+    struct WeldSlot
+    {
+        std::int32_t v = -1;
+        std::int32_t t = -1;
+        std::int32_t n = -1;
+        std::uint32_t index = 0;
+    };
+
+    static size_t weldHash (std::int32_t v, std::int32_t t, std::int32_t n)
+    {
+        std::uint64_t h = static_cast<std::uint32_t>(v)*0x9E3779B97F4A7C15ull;
+        h ^= static_cast<std::uint32_t>(t)*0xC2B2AE3D27D4EB4Full;
+        h ^= static_cast<std::uint32_t>(n)*0x165667B19E3779F9ull;
+        return static_cast<size_t>(h ^ (h >> 29));
+    }
+
+    /// Inserts a slot into an open addressing table whose size is a power of 2 and that has free slots
+    static void weldInsert (std::vector<WeldSlot> &table, const WeldSlot &slot)
+    {
+        const size_t mask = table.size() - 1;
+        size_t i = weldHash(slot.v, slot.t, slot.n) & mask;
+        while (table[i].v != -1)
+            i = (i + 1) & mask;
+        table[i] = slot;
+    }
+
+    /// Resolves relative indices, checks every index and welds the corners into unified vertices
+    static bool merge (std::vector<Chunk> &chunks, ObjData &data)
+    {
+        size_t totals[3] = {0, 0, 0};
+        bool has_colors = false;
+        for (Chunk &chunk : chunks)
+        {
+            const size_t offsets[3] = {totals[0], totals[1], totals[2]};
+            totals[0] += chunk.positions.size()/3;
+            totals[1] += chunk.tex_coords.size()/2;
+            totals[2] += chunk.normals.size()/3;
+            has_colors = has_colors || !chunk.colors.empty();
+
+            for (size_t slot : chunk.relative)
+            {
+                const std::int64_t index = static_cast<std::int64_t>(chunk.corners[slot]) + static_cast<std::int64_t>(offsets[slot % 3]);
+                if (index < 0)
+                    return false;
+                chunk.corners[slot] = static_cast<std::int32_t>(index);
+            }
+        }
+
+        if ( (totals[0] > 0xffffffffu) || (totals[1] > 0x7fffffffu) || (totals[2] > 0x7fffffffu) )
+            return false;
+
+        bool has_tex_coords = false;
+        bool has_normals = false;
+        for (const Chunk &chunk : chunks)
+        {
+            const std::vector<std::int32_t> &corners = chunk.corners;
+            for (size_t i = 0; i < corners.size(); i += 3)
+            {
+                if ( (corners[i] < 0) || (static_cast<size_t>(corners[i]) >= totals[0]) ||
+                     (static_cast<size_t>(corners[i + 1] + 1) > totals[1]) || (static_cast<size_t>(corners[i + 2] + 1) > totals[2]) )
+                    return false;
+
+                has_tex_coords = has_tex_coords || (corners[i + 1] >= 0);
+                has_normals = has_normals || (corners[i + 2] >= 0);
+            }
+        }
+
+        // attributes of all chunks, indexed by the file's indices
+        std::vector<float> positions, colors, tex_coords, normals;
+        positions.reserve(3*totals[0]);
+        tex_coords.reserve(2*totals[1]);
+        normals.reserve(3*totals[2]);
+        if (has_colors)
+            colors.reserve(3*totals[0]);
+
+        size_t num_corners = 0;
+        for (Chunk &chunk : chunks)
+        {
+            positions.insert(positions.end(), chunk.positions.begin(), chunk.positions.end());
+            tex_coords.insert(tex_coords.end(), chunk.tex_coords.begin(), chunk.tex_coords.end());
+            normals.insert(normals.end(), chunk.normals.begin(), chunk.normals.end());
+            if (has_colors)
+            {
+                chunk.colors.resize(chunk.positions.size(), defaultColor());
+                colors.insert(colors.end(), chunk.colors.begin(), chunk.colors.end());
+            }
+            num_corners += chunk.corners.size()/3;
+
+            // release as we go, the file can be large
+            std::vector<float>().swap(chunk.positions);
+            std::vector<float>().swap(chunk.tex_coords);
+            std::vector<float>().swap(chunk.normals);
+            std::vector<float>().swap(chunk.colors);
+        }
+
+        data.indices.reserve(num_corners);
+
+        // positions only: the file's vertices are the mesh vertices
+        if ( !has_tex_coords && !has_normals )
+        {
+            for (const Chunk &chunk : chunks)
+            {
+                for (size_t i = 0; i < chunk.corners.size(); i += 3)
+                    data.indices.push_back(static_cast<unsigned int>(chunk.corners[i]));
+            }
+
+            data.vertices.swap(positions);
+            data.colors.swap(colors);
+            return true;
+        }
+
+        // weld (position, texcoord, normal) triples into unified vertices
+        std::vector<WeldSlot> table(64);
+        while (table.size() < 2*totals[0])
+            table.resize(2*table.size());
+
+        data.vertices.reserve(3*totals[0]);
+        size_t num_vertices = 0;
+
+        for (const Chunk &chunk : chunks)
+        {
+            const std::vector<std::int32_t> &corners = chunk.corners;
+            for (size_t i = 0; i < corners.size(); i += 3)
+            {
+                const std::int32_t v = corners[i], t = corners[i + 1], n = corners[i + 2];
+
+                const size_t mask = table.size() - 1;
+                size_t h = weldHash(v, t, n) & mask;
+                while ( (table[h].v != -1) && ((table[h].v != v) || (table[h].t != t) || (table[h].n != n)) )
+                    h = (h + 1) & mask;
+
+                if (table[h].v != -1)
+                {
+                    data.indices.push_back(table[h].index);
+                    continue;
+                }
+
+                WeldSlot slot;
+                slot.v = v;
+                slot.t = t;
+                slot.n = n;
+                slot.index = static_cast<std::uint32_t>(num_vertices++);
+                table[h] = slot;
+                data.indices.push_back(slot.index);
+
+                data.vertices.insert(data.vertices.end(), &positions[3*v], &positions[3*v] + 3);
+                if (has_colors)
+                    data.colors.insert(data.colors.end(), &colors[3*v], &colors[3*v] + 3);
+
+                // corners without a texcoord or normal get zeros
+                const float zeros[3] = {0.0f, 0.0f, 0.0f};
+                if (has_tex_coords)
+                {
+                    const float *uv = (t >= 0) ? &tex_coords[2*t] : zeros;
+                    data.tex_coords.insert(data.tex_coords.end(), uv, uv + 2);
+                }
+                if (has_normals)
+                {
+                    const float *normal = (n >= 0) ? &normals[3*n] : zeros;
+                    data.normals.insert(data.normals.end(), normal, normal + 3);
+                }
+
+                // keep the table at most half full
+                if (2*num_vertices > table.size())
+                {
+                    std::vector<WeldSlot> grown(2*table.size());
+                    for (const WeldSlot &old : table)
+                    {
+                        if (old.v != -1)
+                            weldInsert(grown, old);
+                    }
+                    table.swap(grown);
+                }
+            }
+        }
+
+        return true;
+    }
+};
+
+}
+}
+#endif
@@ -25,6 +25,7 @@
 
 #include <tucano/mesh.hpp>
 #include <tucano/utils/rply.hpp>
+#include <tucano/utils/plyreader.hpp>
 
 
 namespace Tucano
@@ -37,28 +38,62 @@ namespace MeshImporter
 
 #if defined(_WIN32) && defined(_MSC_VER)
     static bool loadPlyFile (Mesh* mesh, string filename);
-    static void faceToVertexTexCoords (vector<unsigned int> &indices, vector<float> &face_tex_coords, std::vector<Eigen::Vector4f> &vertices, std::vector<Eigen::Vector3f> &normals, std::vector<Eigen::Vector4f> &colors, std::vector<Eigen::Vector2f> &tex_coords);
+    static bool readPlyFile (const string &filename, PlyData &data, PlyProgress *progress);
+    static void uploadPlyData (Mesh *mesh, PlyData &data);
+    static void faceToVertexTexCoords (PlyData &data);
+    static void triangulatePolygons (PlyData &data);
+    static bool triangulatePolygon (const vector<Eigen::Vector3f> &points, vector<unsigned int> &triangles);
     static string getPlyTextureFile (string filename);
 #else
     // avoid warnings of unused function
     static bool loadPlyFile (Mesh* mesh, string filename) __attribute__ ((unused));
-    static void faceToVertexTexCoords (vector<unsigned int> &indices, vector<float> &face_tex_coords, std::vector<Eigen::Vector4f> &vertices, std::vector<Eigen::Vector3f> &normals, std::vector<Eigen::Vector4f> &colors, std::vector<Eigen::Vector2f> &tex_coords) __attribute__ ((unused));
+    static bool readPlyFile (const string &filename, PlyData &data, PlyProgress *progress) __attribute__ ((unused));
+    static void uploadPlyData (Mesh *mesh, PlyData &data) __attribute__ ((unused));
+    static void faceToVertexTexCoords (PlyData &data) __attribute__ ((unused));
+    static void triangulatePolygons (PlyData &data) __attribute__ ((unused));
+    static bool triangulatePolygon (const vector<Eigen::Vector3f> &points, vector<unsigned int> &triangles) __attribute__ ((unused));
     static string getPlyTextureFile (string filename) __attribute__ ((unused));
 #endif
 //#endif
 
 
 
-    static int normal_cb( p_ply_argument argument )
+    /// State of one read, handed to the rply callbacks (no statics, so files can be read concurrently)
+    struct RplyState
     {
-        static Eigen::Vector3f v;
+        PlyData *data = nullptr;
+        PlyProgress *progress = nullptr;
+
+        float vertex[3] = {0.0f, 0.0f, 0.0f};
+        float normal[3] = {0.0f, 0.0f, 0.0f};
+        float color[3] = {0.0f, 0.0f, 0.0f};
+
+        /// Corners of the face being read
+        std::vector<unsigned int> face;
+
+        /// Texture coordinates of the face being read
+        std::vector<float> face_tex_coords;
+
+        /// Counts an element read, returns false if reading was cancelled
+        bool elementRead ()
+        {
+            if (progress == nullptr)
+                return true;
+
+            progress->elements_read.fetch_add(1, std::memory_order_relaxed);
+            return !progress->cancel.load(std::memory_order_relaxed);
+        }
+    };
 
+    static int normal_cb( p_ply_argument argument )
+    {
         void* data;
         long coord;
 
         ply_get_argument_user_data( argument, &data, &coord );
 
-        vector<Eigen::Vector3f>* vec = static_cast< vector<Eigen::Vector3f>* >( data );
+        RplyState* reader = static_cast< RplyState* >( data );
+        float *v = reader->normal;
 
         switch( coord )
         {
@@ -69,7 +104,7 @@ namespace MeshImporter
 
             case 2:
                 v[2] = ply_get_argument_value( argument );
-                vec->push_back( v );
+                reader->data->normals.insert( reader->data->normals.end(), v, v + 3 );
                 break;
         }
 
@@ -78,13 +113,14 @@ namespace MeshImporter
 
     static int color_cb( p_ply_argument argument )
     {
-        static Eigen::Vector4f c;
-
         void* data;
         long coord;
 
         ply_get_argument_user_data( argument, &data, &coord );
 
+        RplyState* reader = static_cast< RplyState* >( data );
+        float *c = reader->color;
+
         float channel = ply_get_argument_value( argument );
         if (channel > 1.0)
             channel /= 255.0;
@@ -98,8 +134,7 @@ namespace MeshImporter
 
             case 2:
                 c[2] = channel;
-                c[3] = 1.0;
-                (static_cast< vector<Eigen::Vector4f>* >( data ))->push_back( c );
+                reader->data->colors.insert( reader->data->colors.end(), c, c + 3 );
                 break;
         }
 
@@ -108,12 +143,14 @@ namespace MeshImporter
 
     static int vertex_cb( p_ply_argument argument )
     {
-        static Eigen::Vector4f v;
         void* data;
         long coord;
 
         ply_get_argument_user_data( argument, &data, &coord );
 
+        RplyState* reader = static_cast< RplyState* >( data );
+        float *v = reader->vertex;
+
         switch( coord )
         {
             case 0:
@@ -123,9 +160,8 @@ namespace MeshImporter
 
             case 2:
                 v[2] = ply_get_argument_value( argument );
-                v[3] = 1.0;
-                (static_cast< vector<Eigen::Vector4f>* >( data ))->push_back( v );
-                break;
+                reader->data->vertices.insert( reader->data->vertices.end(), v, v + 3 );
+                return reader->elementRead();
         }
 
         return 1;
@@ -134,17 +170,37 @@ namespace MeshImporter
 
     static int face_cb( p_ply_argument argument )
     {
-        long value_index;
+        long length, value_index;
         void* data;
 
-        // 3rd parameter is the list length, which is always 3 for triangle meshes
-        // if necessary it can be retrieved passing a reference to a long var
-        ply_get_argument_property( argument, NULL, NULL, &value_index);
+        ply_get_argument_property( argument, NULL, &length, &value_index);
         ply_get_argument_user_data( argument, &data, NULL );
 
-        if (value_index >= 0 && value_index < 3)
+        RplyState* reader = static_cast< RplyState* >( data );
+
+        // the list length comes first, once per face
+        if (value_index < 0)
         {
-            (static_cast< vector<unsigned int>* >(data))->push_back(ply_get_argument_value(argument));
+            reader->face.clear();
+            return reader->elementRead();
+        }
+
+        reader->face.push_back(ply_get_argument_value(argument));
+        if (value_index + 1 < length)
+        {
+            return 1;
+        }
+
+        // triangles go straight to indices, larger polygons are split later (see triangulatePolygons())
+        PlyData *ply_data = reader->data;
+        if (length == 3)
+        {
+            ply_data->indices.insert(ply_data->indices.end(), reader->face.begin(), reader->face.end());
+        }
+        else if (length > 3)
+        {
+            ply_data->polygons.sizes.push_back(length);
+            ply_data->polygons.corners.insert(ply_data->polygons.corners.end(), reader->face.begin(), reader->face.end());
         }
 
         return 1;
@@ -152,19 +208,30 @@ namespace MeshImporter
 
     static int face_texcoords_cb( p_ply_argument argument )
     {
-        long value_index;
+        long length, value_index;
         void* data;
 
-        // 3rd parameter is the list length, which is always 6 for triangle meshes
-        // if necessary it can be retrieved passing a reference to a long var
-        ply_get_argument_property( argument, NULL, NULL, &value_index);
+        ply_get_argument_property( argument, NULL, &length, &value_index);
         ply_get_argument_user_data( argument, &data, NULL );
 
-        if (value_index >= 0 && value_index < 6)
+        RplyState* reader = static_cast< RplyState* >( data );
+
+        if (value_index < 0)
+        {
+            reader->face_tex_coords.clear();
+            return 1;
+        }
+
+        reader->face_tex_coords.push_back(ply_get_argument_value(argument));
+        if (value_index + 1 < length)
         {
-            (static_cast< vector<float>* >(data))->push_back(ply_get_argument_value(argument));
+            return 1;
         }
 
+        // six values for a triangle, two per corner of a polygon
+        std::vector<float> &tex_coords = (length > 6) ? reader->data->polygons.tex_coords : reader->data->face_tex_coords;
+        tex_coords.insert(tex_coords.end(), reader->face_tex_coords.begin(), reader->face_tex_coords.end());
+
         return 1;
     }
 
@@ -212,17 +279,16 @@ namespace MeshImporter
 
 
     /**
-     * @brief Loads a mesh from an PLY file.
-     *
-     * @param mesh Pointer to mesh instance to load file.
-     * @param filename Given filename of the PLY file.
+     * @brief Reads a PLY file of any format with rply, a callback per property value.
      */
-    static bool loadPlyFile (Mesh *mesh, string filename)
+    static bool readPlyFileWithRply (const string &filename, PlyData &data, PlyProgress *progress)
     {
         p_ply ply = ply_open( filename.c_str(), NULL, 0, NULL );
         if( !ply || !ply_read_header( ply ) )
         {
             std::cerr << "Cannot open " << filename.c_str() << std::endl;
+            if (ply)
+                ply_close( ply );
             return false;
         }
 
@@ -230,53 +296,132 @@ namespace MeshImporter
         std::cout << "Opening Stanford ply file " << filename.c_str() << std::endl << std::endl;
         #endif
 
-        std::vector<Eigen::Vector4f> vertices;
-        std::vector<Eigen::Vector3f> normals;
-        std::vector<Eigen::Vector4f> colors;
-        std::vector<Eigen::Vector2f> tex_coords;
-        std::vector<unsigned int> indices;
-        std::vector<float> face_tex_coords;
+        RplyState reader;
+        reader.data = &data;
+        reader.progress = progress;
+
+        if (progress != nullptr)
+        {
+            long total = 0;
+            p_ply_element element = nullptr;
+            while ( (element = ply_get_next_element( ply, element )) != nullptr )
+            {
+                const char *name = nullptr;
+                long ninstances = 0;
+                ply_get_element_info( element, &name, &ninstances );
+                if ( !strcmp(name, "vertex") || !strcmp(name, "face") )
+                    total += ninstances;
+            }
+            progress->elements_read = 0;
+            progress->elements_total = total;
+        }
 
-        ply_set_read_cb( ply, "vertex", "x", vertex_cb, ( void* )&vertices, 0 );
-        ply_set_read_cb( ply, "vertex", "y", vertex_cb, ( void* )&vertices, 1 );
-        ply_set_read_cb( ply, "vertex", "z", vertex_cb, ( void* )&vertices, 2 );
+        ply_set_read_cb( ply, "vertex", "x", vertex_cb, ( void* )&reader, 0 );
+        ply_set_read_cb( ply, "vertex", "y", vertex_cb, ( void* )&reader, 1 );
+        ply_set_read_cb( ply, "vertex", "z", vertex_cb, ( void* )&reader, 2 );
 
-        ply_set_read_cb( ply, "vertex", "red", color_cb, ( void* )&colors, 0 );
-        ply_set_read_cb( ply, "vertex", "green", color_cb, ( void* )&colors, 1 );
-        ply_set_read_cb( ply, "vertex", "blue", color_cb, ( void* )&colors, 2 );
+        ply_set_read_cb( ply, "vertex", "red", color_cb, ( void* )&reader, 0 );
+        ply_set_read_cb( ply, "vertex", "green", color_cb, ( void* )&reader, 1 );
+        ply_set_read_cb( ply, "vertex", "blue", color_cb, ( void* )&reader, 2 );
 
-        ply_set_read_cb( ply, "vertex", "ny", normal_cb, ( void* )&normals, 1 );
-        ply_set_read_cb( ply, "vertex", "nx", normal_cb, ( void* )&normals, 0 );
-        ply_set_read_cb( ply, "vertex", "nz", normal_cb, ( void* )&normals, 2 );
+        ply_set_read_cb( ply, "vertex", "ny", normal_cb, ( void* )&reader, 1 );
+        ply_set_read_cb( ply, "vertex", "nx", normal_cb, ( void* )&reader, 0 );
+        ply_set_read_cb( ply, "vertex", "nz", normal_cb, ( void* )&reader, 2 );
 
-        ply_set_read_cb(ply, "face", "vertex_indices", face_cb, &indices, 0);
+        ply_set_read_cb(ply, "face", "vertex_indices", face_cb, &reader, 0);
 
-        ply_set_read_cb(ply, "face", "texcoord", face_texcoords_cb, &face_tex_coords, 0);
+        ply_set_read_cb(ply, "face", "texcoord", face_texcoords_cb, &reader, 0);
 
         if( !ply_read( ply ) )
         {
+            ply_close( ply );
             return false;
         }
 
         ply_close( ply );
 
+        return true;
+    }
+
+    /**
+     * @brief Reads a PLY file into main memory, without touching the GL.
+     *
+     * Safe to call from any thread.  Face texture coordinates, if present, are
+     * already converted to vertex texture coordinates.
+     *
+     * @param filename Given filename of the PLY file.
+     * @param data Attributes found in the file.
+     * @param progress Optional progress report and cancellation flag.
+     * @return True if the file was read to the end, false if it could not be read or reading was cancelled.
+     */
+    static bool readPlyFile (const string &filename, PlyData &data, PlyProgress *progress)
+    {
+        data = PlyData();
+
+        // binary files are decoded in bulk, anything else goes through rply
+        BinaryPlyReader binary;
+        if ( binary.open(filename) && binary.canRead() )
+        {
+            if (progress != nullptr)
+            {
+                progress->elements_read = 0;
+                progress->elements_total = binary.numberOfElements();
+            }
+
+            if ( !binary.read(data, progress) )
+            {
+                return false;
+            }
+        }
+        else if ( !readPlyFileWithRply(filename, data, progress) )
+        {
+            return false;
+        }
+
+        // split faces with more than three corners
+        triangulatePolygons (data);
+
         // convert from face tex coords to vertex face coords by replicating vertices
-        if (face_tex_coords.size() > 0)
+        if (data.face_tex_coords.size() > 0)
         {
-            faceToVertexTexCoords (indices, face_tex_coords, vertices, normals, colors, tex_coords);
+            faceToVertexTexCoords (data);
         }
-   
+
+        return true;
+    }
+
+    /**
+     * @brief Loads attributes read by readPlyFile() into a mesh.
+     *
+     * @param mesh Pointer to mesh instance to load the attributes.
+     * @param data Attributes read from a PLY file.
+     */
+    static void uploadPlyData (Mesh *mesh, PlyData &data)
+    {
+        // positions and normals left in the mapped file go to the GL without a copy
+        const PlyData::MappedVertices &mapped = data.mapped_vertices;
+        if (mapped.records != nullptr)
+        {
+            vector<Mesh::RecordAttribute> attributes;
+            if (mapped.position_offset >= 0)
+                attributes.push_back(Mesh::RecordAttribute{"in_Position", 3, mapped.position_offset});
+            if (mapped.normal_offset >= 0)
+                attributes.push_back(Mesh::RecordAttribute{"in_Normal", 3, mapped.normal_offset});
+
+            mesh->loadVertexRecords(mapped.records, mapped.count, static_cast<GLsizei>(mapped.stride), attributes);
+        }
+
         // load attributes found in file
-        if (vertices.size() > 0)
-            mesh->loadVertices(vertices);
-        if (normals.size() > 0)
-            mesh->loadNormals(normals);
-        if (tex_coords.size() > 0)
-            mesh->loadTexCoords(tex_coords);
-        if (colors.size() > 0)
-            mesh->loadColors(colors);
-        if (indices.size() > 0)
-            mesh->loadIndices(indices);
+        if (data.vertices.size() > 0)
+            mesh->loadVertices(data.vertices);
+        if (data.normals.size() > 0)
+            mesh->loadNormals(data.normals);
+        if (data.tex_coords.size() > 0)
+            mesh->loadTexCoords(data.tex_coords);
+        if (data.colors.size() > 0)
+            mesh->loadColorsRGB(data.colors);
+        if (data.indices.size() > 0)
+            mesh->loadIndices(data.indices);
 
 
         // sets the default locations for accesing attributes in shaders
@@ -286,58 +431,311 @@ namespace MeshImporter
         #ifdef TUCANODEBUG
         Tucano::Misc::errorCheckFunc(__FILE__, __LINE__);
         #endif
+    }
+
+    /**
+     * @brief Loads a mesh from an PLY file.
+     *
+     * @param mesh Pointer to mesh instance to load file.
+     * @param filename Given filename of the PLY file.
+     */
+    static bool loadPlyFile (Mesh *mesh, string filename)
+    {
+        PlyData data;
+        if ( !readPlyFile(filename, data, nullptr) )
+        {
+            return false;
+        }
+
+        uploadPlyData(mesh, data);
 
         return true;
     }
 
+    /**
+     * @brief Splits a planar polygon into triangles by ear clipping.
+     *
+     * The polygon is projected on the plane of its dominant axis, and triangles
+     * keep the winding of the polygon.  Concave polygons are handled; if no ear
+     * is found (ex. self intersecting polygons) the rest is split as a fan.
+     * @param points Corners of the polygon, in order.
+     * @param triangles Triangles, as indices on points.
+     * @return False if the polygon is degenerate (no area), triangles is then left empty.
+     */
+    static bool triangulatePolygon (const vector<Eigen::Vector3f> &points, vector<unsigned int> &triangles)
+    {
+        triangles.clear();
+        const size_t n = points.size();
+
+        // Newell normal, the polygon orientation
+        Eigen::Vector3f normal = Eigen::Vector3f::Zero();
+        for (size_t i = 0; i < n; ++i)
+        {
+            normal += points[i].cross(points[(i + 1) % n]);
+        }
+
+        int axis = 0;
+        const float largest = normal.cwiseAbs().maxCoeff(&axis);
+        if ( !(largest > 0.0f) || !std::isfinite(largest) )
+        {
+            return false;
+        }
+
+        // project dropping the dominant axis, so that the polygon turns counterclockwise
+        int u = (axis + 1) % 3;
+        int v = (axis + 2) % 3;
+        if (normal[axis] < 0.0f)
+        {
+            std::swap(u, v);
+        }
+
+        vector<Eigen::Vector2f> projected(n);
+        for (size_t i = 0; i < n; ++i)
+        {
+            projected[i] = Eigen::Vector2f(points[i][u], points[i][v]);
+        }
+
+        auto cross = [&projected] (unsigned int a, unsigned int b, unsigned int c) {
+            const Eigen::Vector2f ab = projected[b] - projected[a];
+            const Eigen::Vector2f ac = projected[c] - projected[a];
+            return ab[0]*ac[1] - ab[1]*ac[0];
+        };
+
+        vector<unsigned int> remaining(n);
+        for (size_t i = 0; i < n; ++i)
+        {
+            remaining[i] = static_cast<unsigned int>(i);
+        }
+
+        while (remaining.size() > 3)
+        {
+            const size_t m = remaining.size();
+            bool clipped = false;
+
+            for (size_t i = 0; (i < m) && !clipped; ++i)
+            {
+                const unsigned int prev = remaining[(i + m - 1) % m];
+                const unsigned int cur = remaining[i];
+                const unsigned int next = remaining[(i + 1) % m];
+
+                // reflex or flat corner
+                if (cross(prev, cur, next) <= 0.0f)
+                    continue;
+
+                // an ear has no other corner inside or on its border (a corner on the diagonal would be cut off)
+                bool ear = true;
+                for (size_t j = 0; (j < m) && ear; ++j)
+                {
+                    const unsigned int other = remaining[j];
+                    if ( (other == prev) || (other == cur) || (other == next) )
+                        continue;
+
+                    // corners repeated at the same position do not count
+                    const Eigen::Vector2f &o = projected[other];
+                    if ( (o == projected[prev]) || (o == projected[cur]) || (o == projected[next]) )
+                        continue;
+
+                    ear = !( (cross(prev, cur, other) >= 0.0f) && (cross(cur, next, other) >= 0.0f) && (cross(next, prev, other) >= 0.0f) );
+                }
+
+                if (ear)
+                {
+                    triangles.insert(triangles.end(), {prev, cur, next});
+                    remaining.erase(remaining.begin() + i);
+                    clipped = true;
+                }
+            }
+
+            // no ear left, the polygon is not simple
+            if (!clipped)
+            {
+                for (size_t i = 1; i + 1 < remaining.size(); ++i)
+                {
+                    triangles.insert(triangles.end(), {remaining[0], remaining[i], remaining[i + 1]});
+                }
+                return true;
+            }
+        }
+
+        triangles.insert(triangles.end(), remaining.begin(), remaining.end());
+
+        return true;
+    }
+
+    /**
+     * @brief Splits the polygons read from a PLY file into triangles.
+     *
+     * Triangles are appended to indices (and their corners' texture coordinates
+     * to face_tex_coords, if the file has any).  Polygons are ear clipped, or
+     * split as fans if they are degenerate or reference missing vertices.
+     * @param data Attributes read from a PLY file, with polygons holding faces of more than three corners
+     */
+    static void triangulatePolygons (PlyData &data)
+    {
+        PlyData::Polygons &polygons = data.polygons;
+        if (polygons.sizes.empty())
+        {
+            return;
+        }
+
+        // positions are either decoded or still in the mapped file
+        const PlyData::MappedVertices &mapped = data.mapped_vertices;
+        const size_t num_vertices = (mapped.position_offset >= 0) ? mapped.count : data.vertices.size()/3;
+        auto position = [&data, &mapped] (unsigned int index) {
+            Eigen::Vector3f p;
+            if (mapped.position_offset >= 0)
+                std::memcpy(p.data(), mapped.records + index*mapped.stride + mapped.position_offset, sizeof(float)*3);
+            else
+                p = Eigen::Vector3f(data.vertices[3*index + 0], data.vertices[3*index + 1], data.vertices[3*index + 2]);
+            return p;
+        };
+
+        // face texture coordinates stay aligned with indices, two per corner
+        const bool polygon_tex_coords = (polygons.tex_coords.size() == 2*polygons.corners.size());
+        const bool tex_coords = polygon_tex_coords || !data.face_tex_coords.empty();
+        if (tex_coords)
+        {
+            data.face_tex_coords.resize(2*data.indices.size(), 0.0f);
+        }
+
+        vector<Eigen::Vector3f> points;
+        vector<unsigned int> triangles;
+        size_t first = 0;
+
+        for (unsigned int size : polygons.sizes)
+        {
+            const unsigned int *corners = &polygons.corners[first];
+
+            points.clear();
+            for (unsigned int c = 0; (c < size) && (corners[c] < num_vertices); ++c)
+            {
+                points.push_back(position(corners[c]));
+            }
+
+            if ( (points.size() != size) || !triangulatePolygon(points, triangles) )
+            {
+                triangles.clear();
+                for (unsigned int c = 1; c + 1 < size; ++c)
+                {
+                    triangles.insert(triangles.end(), {0u, c, c + 1});
+                }
+            }
+
+            for (unsigned int t : triangles)
+            {
+                data.indices.push_back(corners[t]);
+                if (tex_coords)
+                {
+                    const float u = polygon_tex_coords ? polygons.tex_coords[2*(first + t) + 0] : 0.0f;
+                    const float v = polygon_tex_coords ? polygons.tex_coords[2*(first + t) + 1] : 0.0f;
+                    data.face_tex_coords.push_back(u);
+                    data.face_tex_coords.push_back(v);
+                }
+            }
+
+            first += size;
+        }
+
+        polygons = PlyData::Polygons();
+    }
+
     /**
      * @brief Convert texture coordinates per face to texture coordinates per vertex
-     * Vertices are repeated for each incident face
-     * WARNING: load all vertex attributes before converting, since they will also be replicated
-     * @param face_tex_coords Float vector containing tex coords per face
+     *
+     * Corners that share a vertex and a texture coordinate are welded into a
+     * single vertex, so a vertex is only repeated along texture seams.  Normals
+     * and colors are per vertex in a PLY file, so the (vertex, texture
+     * coordinate) pair identifies a unique combination of attributes.
+     * @param data Attributes read from a PLY file, with face_tex_coords holding tex coords per face
      */
-    static void faceToVertexTexCoords (vector<unsigned int> &indices, vector<float> &face_tex_coords, std::vector<Eigen::Vector4f> &vertices, std::vector<Eigen::Vector3f> &normals, std::vector<Eigen::Vector4f> &colors, std::vector<Eigen::Vector2f> &tex_coords)
-    {    
-        std::vector <Eigen::Vector4f> vertices_tmp = vertices;
-        std::vector <Eigen::Vector3f> normals_tmp = normals;
-        std::vector <Eigen::Vector4f> colors_tmp = colors;
-        std::vector <unsigned int> indices_tmp = indices;
-        vertices.clear();
-        normals.clear();
-        colors.clear();
-        indices.clear();
-        tex_coords.clear();
-
-        Eigen::Vector2f coord;
-        // for each triangle (every three indices) replicate vertices and attributes
-        for (unsigned int i = 0, j = 0; i < indices_tmp.size(); i=i+3, j=j+6)
-        {   
-            vertices.push_back (vertices_tmp[indices_tmp[i+0]]);
-            vertices.push_back (vertices_tmp[indices_tmp[i+1]]);
-            vertices.push_back (vertices_tmp[indices_tmp[i+2]]);
-            if (normals_tmp.size() > 0)
+    static void faceToVertexTexCoords (PlyData &data)
+    {
+        const std::vector<float> vertices_tmp = std::move(data.vertices);
+        const std::vector<float> normals_tmp = std::move(data.normals);
+        const std::vector<float> colors_tmp = std::move(data.colors);
+        std::vector<float> face_tex_coords = std::move(data.face_tex_coords);
+        data.vertices.clear();
+        data.normals.clear();
+        data.colors.clear();
+        data.tex_coords.clear();
+        data.face_tex_coords.clear();
+
+        // corners without texture coordinates get (0,0)
+        face_tex_coords.resize(2*data.indices.size(), 0.0f);
+
+        struct Slot
+        {
+            unsigned int vertex;
+            std::uint32_t u;
+            std::uint32_t v;
+            unsigned int index;
+        };
+        const unsigned int empty = std::numeric_limits<unsigned int>::max();
+
+        auto hash = [] (unsigned int vertex, std::uint32_t u, std::uint32_t v) {
+            std::uint64_t h = vertex*0x9E3779B97F4A7C15ull;
+            h ^= u*0xC2B2AE3D27D4EB4Full;
+            h ^= v*0x165667B19E3779F9ull;
+            return static_cast<size_t>(h ^ (h >> 29));
+        };
+
+        // open addressing, kept at most half full
+        size_t capacity = 64;
+        while (capacity < 2*vertices_tmp.size()/3)
+            capacity *= 2;
+        std::vector<Slot> table(capacity, Slot{empty, 0, 0, 0});
+
+        const size_t num_vertices = vertices_tmp.size()/3;
+        auto replicate = []( const std::vector<float> &from, unsigned int index, std::vector<float> &to ) {
+            to.insert( to.end(), from.begin() + 3*index, from.begin() + 3*index + 3 );
+        };
+
+        unsigned int welded = 0;
+        for (size_t c = 0; c < data.indices.size(); ++c)
+        {
+            const unsigned int vertex = data.indices[c];
+            if (vertex >= num_vertices)
+                continue;
+
+            std::uint32_t u, v;
+            std::memcpy(&u, &face_tex_coords[2*c + 0], sizeof(u));
+            std::memcpy(&v, &face_tex_coords[2*c + 1], sizeof(v));
+
+            size_t h = hash(vertex, u, v) & (table.size() - 1);
+            while ( (table[h].vertex != empty) && ((table[h].vertex != vertex) || (table[h].u != u) || (table[h].v != v)) )
+                h = (h + 1) & (table.size() - 1);
+
+            if (table[h].vertex != empty)
             {
-                normals.push_back (normals_tmp[indices_tmp[i+0]]);
-                normals.push_back (normals_tmp[indices_tmp[i+1]]);
-                normals.push_back (normals_tmp[indices_tmp[i+2]]);
+                data.indices[c] = table[h].index;
+                continue;
             }
+
+            table[h] = Slot{vertex, u, v, welded};
+            data.indices[c] = welded++;
+
+            replicate (vertices_tmp, vertex, data.vertices);
+            if (normals_tmp.size() > 0)
+                replicate (normals_tmp, vertex, data.normals);
             if (colors_tmp.size() > 0)
+                replicate (colors_tmp, vertex, data.colors);
+            data.tex_coords.insert (data.tex_coords.end(), &face_tex_coords[2*c], &face_tex_coords[2*c] + 2);
+
+            if (2*size_t(welded) > table.size())
             {
-                colors.push_back (colors_tmp[indices_tmp[i+0]]);
-                colors.push_back (colors_tmp[indices_tmp[i+1]]);
-                colors.push_back (colors_tmp[indices_tmp[i+2]]);
+                std::vector<Slot> grown(2*table.size(), Slot{empty, 0, 0, 0});
+                for (const Slot &slot : table)
+                {
+                    if (slot.vertex == empty)
+                        continue;
+                    size_t g = hash(slot.vertex, slot.u, slot.v) & (grown.size() - 1);
+                    while (grown[g].vertex != empty)
+                        g = (g + 1) & (grown.size() - 1);
+                    grown[g] = slot;
+                }
+                table.swap(grown);
             }
-            coord << face_tex_coords[j+0], face_tex_coords[j+1];
-            tex_coords.push_back (coord);
-            coord << face_tex_coords[j+2], face_tex_coords[j+3];
-            tex_coords.push_back (coord);
-            coord << face_tex_coords[j+4], face_tex_coords[j+5];
-            tex_coords.push_back (coord);
-            indices.push_back(i+0);
-            indices.push_back(i+1);
-            indices.push_back(i+2);
         }
-
     }
 
 
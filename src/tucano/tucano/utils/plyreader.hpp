@@ -0,0 +1,871 @@
+/**
+ * Tucano - A library for rapid prototying with Modern OpenGL and GLSL
+ * Copyright (C) 2014
+ * LCG - Laboratório de Computação Gráfica (Computer Graphics Lab) - COPPE
+ * UFRJ - Federal University of Rio de Janeiro
+ *
+ * This file is part of Tucano Library.
+ *
+ * Tucano Library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Tucano Library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Tucano Library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __PLYREADER__
+#define __PLYREADER__
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <tucano/utils/mappedfile.hpp>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TUCANO_PLY_SSE2
+#endif
+
+
+namespace Tucano
+{
+namespace MeshImporter
+{
+
+/**
+ * @brief Mesh attributes read from a PLY file and kept in main memory.
+ *
+ * Each attribute is a flat array, laid out as the GL expects it.  Filled by
+ * readPlyFile() and sent to the GL by uploadPlyData(), so that the two steps
+ * can run on different threads.
+ */
+struct PlyData
+{
+    /// Packed (x,y,z) vertex coordinates
+    std::vector<float> vertices;
+
+    /// Packed (x,y,z) normals per vertex
+    std::vector<float> normals;
+
+    /// Packed (r,g,b) colors per vertex, in [0,1]
+    std::vector<float> colors;
+
+    /// Packed (u,v) texture coordinates per vertex
+    std::vector<float> tex_coords;
+
+    /// Triangles (indices on the vertices' list)
+    std::vector<unsigned int> indices;
+
+    /// Six (u,v) texture coordinates per triangle
+    std::vector<float> face_tex_coords;
+
+    /**
+     * @brief Faces with more than three corners, as read from the file.
+     *
+     * Split into triangles, appended to indices and face_tex_coords, by
+     * triangulatePolygons() once the vertices are known.
+     */
+    struct Polygons
+    {
+        /// Number of corners of each polygon
+        std::vector<unsigned int> sizes;
+
+        /// Corners of all polygons (indices on the vertices' list)
+        std::vector<unsigned int> corners;
+
+        /// One (u,v) texture coordinate per corner, empty if the faces have none
+        std::vector<float> tex_coords;
+    };
+
+    Polygons polygons;
+
+    /**
+     * @brief Vertex records left in the mapped file, for attributes the GL can read as they are.
+     *
+     * Positions or normals found here are not copied to vertices or normals.
+     */
+    struct MappedVertices
+    {
+        /// Keeps the records mapped
+        std::shared_ptr<MappedFile> file;
+
+        /// First vertex record, null if no attribute is read from the file
+        const char *records = nullptr;
+
+        /// Number of records
+        size_t count = 0;
+
+        /// Record size in bytes
+        size_t stride = 0;
+
+        /// Byte offset of the (x,y,z) floats in a record, -1 if positions are in vertices
+        long position_offset = -1;
+
+        /// Byte offset of the (nx,ny,nz) floats in a record, -1 if normals are in normals
+        long normal_offset = -1;
+    };
+
+    MappedVertices mapped_vertices;
+};
+
+/**
+ * @brief Progress of a readPlyFile() call, safe to poll from another thread.
+ */
+struct PlyProgress
+{
+    /// Number of elements (vertices and faces) read so far
+    std::atomic<long> elements_read{0};
+
+    /// Number of elements declared in the file header
+    std::atomic<long> elements_total{0};
+
+    /// Set to stop reading, readPlyFile() then returns false
+    std::atomic<bool> cancel{false};
+};
+
+/**
+ * @brief Reader for binary PLY files.
+ *
+ * The file is memory mapped (see MappedFile) and the vertex and face elements
+ * are decoded a chunk at a time, straight into the flat arrays of a PlyData.
+ * Properties of fixed size elements are decoded a column at a time, and big
+ * endian files are byte swapped a chunk at a time.  Float positions and
+ * normals whose layout the GL accepts are not decoded at all, but left in
+ * the mapping (see PlyData::MappedVertices).  ASCII files are not handled,
+ * see canRead().
+ */
+class BinaryPlyReader
+{
+public:
+
+    /**
+     * @brief Opens a PLY file and parses its header.
+     * @param filename Given filename of the PLY file.
+     * @return True if the file could be opened and its header is valid.
+     */
+    bool open (const std::string &filename)
+    {
+        elements.clear();
+        format = Format::Ascii;
+
+        file = std::make_shared<MappedFile>();
+        if (!file->open(filename))
+        {
+            return false;
+        }
+
+        input = file->data();
+        begin = 0;
+        end = file->size();
+
+        return readHeader();
+    }
+
+    /**
+     * @brief Whether the opened file can be read, that is, it is binary and its vertices have no list properties.
+     * Other files are left to rply.
+     */
+    bool canRead () const
+    {
+        if (format == Format::Ascii)
+            return false;
+
+        for (const Element &element : elements)
+        {
+            if ( (element.name == "vertex") && (element.stride == 0) && !element.properties.empty() )
+                return false;
+        }
+
+        return true;
+    }
+
+    /**
+     * @brief Number of vertices and faces declared in the header.
+     */
+    long numberOfElements () const
+    {
+        long total = 0;
+        for (const Element &element : elements)
+        {
+            if ( (element.name == "vertex") || (element.name == "face") )
+                total += element.count;
+        }
+        return total;
+    }
+
+    /**
+     * @brief Reads the body of a binary file.
+     * @param data Attributes found in the file.
+     * @param progress Optional progress report and cancellation flag.
+     * @param map_vertices Whether positions and normals may be left in the mapped file (see PlyData::MappedVertices).
+     * @return True if the file was read to the end, false if it is truncated or reading was cancelled.
+     */
+    bool read (PlyData &data, PlyProgress *progress, bool map_vertices = true)
+    {
+        swap = (format == Format::BinaryBigEndian) == hostIsLittleEndian();
+
+        for (const Element &element : elements)
+        {
+            bool success = true;
+            if (element.name == "vertex")
+                success = readVertices(element, data, progress, map_vertices && !swap && !hasFaceTexCoords());
+            else if (element.name == "face")
+                success = readFaces(element, data, progress);
+            else
+                success = skipElement(element);
+
+            if (!success)
+                return false;
+        }
+
+        return true;
+    }
+
+private:
+
+    enum class Format { Ascii, BinaryLittleEndian, BinaryBigEndian };
+
+    enum class Type { Int8, UInt8, Int16, UInt16, Int32, UInt32, Float32, Float64 };
+
+    struct Property
+    {
+        std::string name;
+        Type type = Type::Float32;
+        bool is_list = false;
+        Type count_type = Type::UInt8;
+    };
+
+    struct Element
+    {
+        std::string name;
+        long count = 0;
+        std::vector<Property> properties;
+
+        /// Record size if no property is a list, 0 otherwise
+        size_t stride = 0;
+    };
+
+    /// A scalar property decoded into a flat array
+    struct Column
+    {
+        size_t offset;
+        Type type;
+        std::vector<float> *destination;
+        size_t component;
+        size_t components;
+    };
+
+    static bool hostIsLittleEndian ()
+    {
+        const std::uint16_t one = 1;
+        unsigned char first;
+        std::memcpy(&first, &one, 1);
+        return first == 1;
+    }
+
+    static bool parseType (const std::string &name, Type &type)
+    {
+        if (name == "char" || name == "int8")             type = Type::Int8;
+        else if (name == "uchar" || name == "uint8")      type = Type::UInt8;
+        else if (name == "short" || name == "int16")      type = Type::Int16;
+        else if (name == "ushort" || name == "uint16")    type = Type::UInt16;
+        else if (name == "int" || name == "int32")        type = Type::Int32;
+        else if (name == "uint" || name == "uint32")      type = Type::UInt32;
+        else if (name == "float" || name == "float32")    type = Type::Float32;
+        else if (name == "double" || name == "float64")   type = Type::Float64;
+        else return false;
+
+        return true;
+    }
+
+    static size_t typeSize (Type type)
+    {
+        switch (type)
+        {
+            case Type::Int8: case Type::UInt8: return 1;
+            case Type::Int16: case Type::UInt16: return 2;
+            case Type::Int32: case Type::UInt32: case Type::Float32: return 4;
+            case Type::Float64: return 8;
+        }
+        return 0;
+    }
+
+    /// Reads the next header line, returns false at the end of the file
+    bool nextLine (std::string &line)
+    {
+        if (begin == end)
+            return false;
+
+        const char *first = input + begin;
+        const char *newline = static_cast<const char*>(std::memchr(first, '\n', end - begin));
+        const char *last = (newline != nullptr) ? newline : input + end;
+
+        line.assign(first, last);
+        begin = (newline != nullptr) ? (newline - input) + 1 : end;
+
+        return true;
+    }
+
+    bool readHeader ()
+    {
+        std::string line;
+        if ( !nextLine(line) || (line.compare(0, 3, "ply") != 0) )
+        {
+            return false;
+        }
+
+        while (nextLine(line))
+        {
+            if (!line.empty() && line.back() == '\r')
+                line.pop_back();
+
+            std::istringstream words(line);
+            std::string keyword;
+            words >> keyword;
+
+            if (keyword == "format")
+            {
+                std::string name;
+                words >> name;
+                if (name == "ascii")                        format = Format::Ascii;
+                else if (name == "binary_little_endian")    format = Format::BinaryLittleEndian;
+                else if (name == "binary_big_endian")       format = Format::BinaryBigEndian;
+                else return false;
+            }
+            else if (keyword == "element")
+            {
+                Element element;
+                if ( !(words >> element.name >> element.count) || (element.count < 0) )
+                    return false;
+                elements.push_back(element);
+            }
+            else if (keyword == "property")
+            {
+                if (elements.empty())
+                    return false;
+
+                Property property;
+                std::string type;
+                words >> type;
+                if (type == "list")
+                {
+                    std::string count_type;
+                    words >> count_type >> type;
+                    property.is_list = true;
+                    if (!parseType(count_type, property.count_type))
+                        return false;
+                }
+                if ( !parseType(type, property.type) || !(words >> property.name) )
+                    return false;
+
+                elements.back().properties.push_back(property);
+            }
+            else if (keyword == "end_header")
+            {
+                for (Element &element : elements)
+                {
+                    element.stride = 0;
+                    for (const Property &property : element.properties)
+                    {
+                        if (property.is_list)
+                        {
+                            element.stride = 0;
+                            break;
+                        }
+                        element.stride += typeSize(property.type);
+                    }
+                }
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    /// Whether size more bytes are left in the file
+    bool available (size_t size) const
+    {
+        return end - begin >= size;
+    }
+
+    /// True if count records of at least record_bytes each can fit in the bytes left, checked before anything is sized by count
+    bool fits (long count, size_t record_bytes) const
+    {
+        return (record_bytes == 0) || (static_cast<size_t>(count) <= (end - begin)/record_bytes);
+    }
+
+    static bool reportProgress (PlyProgress *progress, long count)
+    {
+        if (progress == nullptr)
+            return true;
+
+        progress->elements_read.fetch_add(count, std::memory_order_relaxed);
+        return !progress->cancel.load(std::memory_order_relaxed);
+    }
+
+    static std::uint8_t byteSwap (std::uint8_t v)
+    {
+        return v;
+    }
+
+    static std::uint16_t byteSwap (std::uint16_t v)
+    {
+        return static_cast<std::uint16_t>((v << 8) | (v >> 8));
+    }
+
+    static std::uint32_t byteSwap (std::uint32_t v)
+    {
+        return ((v & 0x000000FFu) << 24) | ((v & 0x0000FF00u) << 8) | ((v & 0x00FF0000u) >> 8) | ((v & 0xFF000000u) >> 24);
+    }
+
+    static std::uint64_t byteSwap (std::uint64_t v)
+    {
+        return (static_cast<std::uint64_t>(byteSwap(static_cast<std::uint32_t>(v))) << 32) | byteSwap(static_cast<std::uint32_t>(v >> 32));
+    }
+
+    /// Reverses the bytes of count consecutive 4 byte words, four words at a time where SSE2 is available
+    static void byteSwap32 (char *data, size_t count)
+    {
+        size_t i = 0;
+        #ifdef TUCANO_PLY_SSE2
+        for (; i + 4 <= count; i += 4)
+        {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 4*i));
+            // swap the bytes of each 16 bit half, then swap the halves
+            v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+            v = _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, 0xB1), 0xB1);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(data + 4*i), v);
+        }
+        #endif
+        for (; i < count; ++i)
+        {
+            std::uint32_t v;
+            std::memcpy(&v, data + 4*i, 4);
+            v = byteSwap(v);
+            std::memcpy(data + 4*i, &v, 4);
+        }
+    }
+
+    /// Reads a scalar of type T, swapping its bytes if needed
+    template <typename T, typename Bits>
+    static T load (const char *src, bool swap)
+    {
+        static_assert(sizeof(T) == sizeof(Bits), "mismatched scalar size");
+        Bits bits;
+        std::memcpy(&bits, src, sizeof(Bits));
+        if (swap)
+            bits = byteSwap(bits);
+        T value;
+        std::memcpy(&value, &bits, sizeof(T));
+        return value;
+    }
+
+    static double loadValue (const char *src, Type type, bool swap)
+    {
+        switch (type)
+        {
+            case Type::Int8:    return static_cast<std::int8_t>(*src);
+            case Type::UInt8:   return static_cast<std::uint8_t>(*src);
+            case Type::Int16:   return load<std::int16_t, std::uint16_t>(src, swap);
+            case Type::UInt16:  return load<std::uint16_t, std::uint16_t>(src, swap);
+            case Type::Int32:   return load<std::int32_t, std::uint32_t>(src, swap);
+            case Type::UInt32:  return load<std::uint32_t, std::uint32_t>(src, swap);
+            case Type::Float32: return load<float, std::uint32_t>(src, swap);
+            case Type::Float64: return load<double, std::uint64_t>(src, swap);
+        }
+        return 0.0;
+    }
+
+    /// Decodes one property of count records into every components-th float of dst
+    template <typename T, typename Bits>
+    static void decodeColumn (const char *src, size_t stride, size_t count, bool swap, float *dst, size_t components)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            dst[i*components] = static_cast<float>(load<T, Bits>(src + i*stride, swap));
+        }
+    }
+
+    static void decodeColumn (const char *src, Type type, size_t stride, size_t count, bool swap, float *dst, size_t components)
+    {
+        switch (type)
+        {
+            case Type::Int8:    decodeColumn<std::int8_t, std::uint8_t>(src, stride, count, false, dst, components); break;
+            case Type::UInt8:   decodeColumn<std::uint8_t, std::uint8_t>(src, stride, count, false, dst, components); break;
+            case Type::Int16:   decodeColumn<std::int16_t, std::uint16_t>(src, stride, count, swap, dst, components); break;
+            case Type::UInt16:  decodeColumn<std::uint16_t, std::uint16_t>(src, stride, count, swap, dst, components); break;
+            case Type::Int32:   decodeColumn<std::int32_t, std::uint32_t>(src, stride, count, swap, dst, components); break;
+            case Type::UInt32:  decodeColumn<std::uint32_t, std::uint32_t>(src, stride, count, swap, dst, components); break;
+            case Type::Float32: decodeColumn<float, std::uint32_t>(src, stride, count, swap, dst, components); break;
+            case Type::Float64: decodeColumn<double, std::uint64_t>(src, stride, count, swap, dst, components); break;
+        }
+    }
+
+    /// Finds the columns of a group of properties (e.g. x, y, z); returns false unless all of them exist
+    static bool findColumns (const Element &element, const char *const *names, size_t components, std::vector<float> *destination, std::vector<Column> &columns)
+    {
+        std::vector<Column> found;
+        for (size_t c = 0; c < components; ++c)
+        {
+            size_t offset = 0;
+            for (const Property &property : element.properties)
+            {
+                if (property.name == names[c])
+                {
+                    found.push_back(Column{offset, property.type, destination, c, components});
+                    break;
+                }
+                offset += typeSize(property.type);
+            }
+        }
+
+        if (found.size() != components)
+            return false;
+
+        columns.insert(columns.end(), found.begin(), found.end());
+        return true;
+    }
+
+    /// Whether vertices are replicated per face after reading, see faceToVertexTexCoords()
+    bool hasFaceTexCoords () const
+    {
+        for (const Element &element : elements)
+        {
+            for (const Property &property : element.properties)
+            {
+                if ( (element.name == "face") && property.is_list && (property.name == "texcoord") )
+                    return true;
+            }
+        }
+        return false;
+    }
+
+    /// Offset of a group of consecutive float properties the GL can read in place, -1 if there is none
+    static long mappableOffset (const Element &element, const char *const *names, size_t components)
+    {
+        std::vector<Column> found;
+        if (!findColumns(element, names, components, nullptr, found))
+            return -1;
+
+        for (size_t c = 0; c < components; ++c)
+        {
+            if ( (found[c].type != Type::Float32) || (found[c].offset != found[0].offset + 4*c) )
+                return -1;
+        }
+
+        // vertex attributes must be 4 byte aligned
+        if ( (found[0].offset % 4 != 0) || (element.stride % 4 != 0) )
+            return -1;
+
+        return static_cast<long>(found[0].offset);
+    }
+
+    bool readVertices (const Element &element, PlyData &data, PlyProgress *progress, bool map_vertices)
+    {
+        // vertices with list properties are left to rply, see canRead()
+        if (element.stride == 0)
+            return element.properties.empty() && (element.count == 0);
+
+        // a count the file cannot hold would only get as far as allocating for it
+        if (!fits(element.count, element.stride))
+            return false;
+
+        static const char *const position[] = {"x", "y", "z"};
+        static const char *const normal[] = {"nx", "ny", "nz"};
+        static const char *const color[] = {"red", "green", "blue"};
+
+        // float positions and normals are handed to the GL straight from the mapped records
+        PlyData::MappedVertices &mapped = data.mapped_vertices;
+        if (map_vertices)
+        {
+            mapped.position_offset = mappableOffset(element, position, 3);
+            mapped.normal_offset = mappableOffset(element, normal, 3);
+        }
+
+        std::vector<Column> columns;
+        if (mapped.position_offset < 0)
+            findColumns(element, position, 3, &data.vertices, columns);
+        if (mapped.normal_offset < 0)
+            findColumns(element, normal, 3, &data.normals, columns);
+        bool has_colors = findColumns(element, color, 3, &data.colors, columns);
+
+        if ( (mapped.position_offset >= 0) || (mapped.normal_offset >= 0) )
+        {
+            if (!available(element.count*element.stride))
+                return false;
+
+            mapped.file = file;
+            mapped.records = input + begin;
+            mapped.count = static_cast<size_t>(element.count);
+            mapped.stride = element.stride;
+        }
+
+        for (const Column &column : columns)
+        {
+            column.destination->resize(3*element.count);
+        }
+
+        // all properties 4 bytes wide: swap whole chunks up front
+        bool words_only = true;
+        for (const Property &property : element.properties)
+        {
+            words_only = words_only && (typeSize(property.type) == 4);
+        }
+
+        const size_t records_per_chunk = std::max<size_t>(1, chunk_bytes/element.stride);
+        for (size_t first = 0; first < static_cast<size_t>(element.count); )
+        {
+            const size_t count = std::min(records_per_chunk, element.count - first);
+            if (!available(count*element.stride))
+                return false;
+
+            const char *src = input + begin;
+            bool swap_values = swap;
+            if (swap && words_only && !columns.empty())
+            {
+                scratch.assign(src, src + count*element.stride);
+                byteSwap32(scratch.data(), scratch.size()/4);
+                src = scratch.data();
+                swap_values = false;
+            }
+
+            for (const Column &column : columns)
+            {
+                float *dst = column.destination->data() + first*column.components + column.component;
+                decodeColumn(src + column.offset, column.type, element.stride, count, swap_values, dst, column.components);
+            }
+
+            // integer channels are in [0,255]
+            if (has_colors)
+            {
+                for (float *c = data.colors.data() + 3*first, *last = c + 3*count; c != last; ++c)
+                {
+                    if (*c > 1.0f)
+                        *c = static_cast<float>(*c / 255.0);
+                }
+            }
+
+            begin += count*element.stride;
+            first += count;
+
+            if (!reportProgress(progress, static_cast<long>(count)))
+                return false;
+        }
+
+        return true;
+    }
+
+    enum class FaceRole { Skip, Indices, TexCoords };
+
+    /// Reads the properties of one face, appending a triangle to indices or a polygon to data.polygons
+    bool readFace (const Element &element, const std::vector<FaceRole> &roles, unsigned int *indices, size_t &written, PlyData &data)
+    {
+        for (size_t p = 0; p < element.properties.size(); ++p)
+        {
+            const Property &property = element.properties[p];
+            if (!property.is_list)
+            {
+                if (!available(typeSize(property.type)))
+                    return false;
+                begin += typeSize(property.type);
+                continue;
+            }
+
+            const size_t count_size = typeSize(property.count_type);
+            if (!available(count_size))
+                return false;
+            const long length = static_cast<long>(loadValue(input + begin, property.count_type, swap));
+            begin += count_size;
+
+            const size_t item_size = typeSize(property.type);
+            if ( (length < 0) || !available(length*item_size) )
+                return false;
+
+            const char *src = input + begin;
+            if ( (roles[p] == FaceRole::Indices) && (length == 3) )
+            {
+                for (long i = 0; i < 3; ++i)
+                    indices[written++] = static_cast<unsigned int>(loadValue(src + i*item_size, property.type, swap));
+            }
+            else if ( (roles[p] == FaceRole::Indices) && (length > 3) )
+            {
+                // split into triangles later, see triangulatePolygons()
+                data.polygons.sizes.push_back(static_cast<unsigned int>(length));
+                for (long i = 0; i < length; ++i)
+                    data.polygons.corners.push_back(static_cast<unsigned int>(loadValue(src + i*item_size, property.type, swap)));
+            }
+            else if (roles[p] == FaceRole::TexCoords)
+            {
+                // six values for a triangle, two per corner of a polygon
+                std::vector<float> &tex_coords = (length > 6) ? data.polygons.tex_coords : data.face_tex_coords;
+                for (long i = 0; i < length; ++i)
+                    tex_coords.push_back(static_cast<float>(loadValue(src + i*item_size, property.type, swap)));
+            }
+            begin += length*item_size;
+        }
+
+        return true;
+    }
+
+    bool readFaces (const Element &element, PlyData &data, PlyProgress *progress)
+    {
+        // smallest face on file, every list empty, and fewest bytes a triangle is read from
+        std::vector<FaceRole> roles;
+        size_t face_bytes = 0, triangle_bytes = 0, index_lists = 0;
+        for (const Property &property : element.properties)
+        {
+            if (property.is_list && (property.name == "vertex_indices"))
+                roles.push_back(FaceRole::Indices);
+            else if (property.is_list && (property.name == "texcoord"))
+                roles.push_back(FaceRole::TexCoords);
+            else
+                roles.push_back(FaceRole::Skip);
+
+            face_bytes += typeSize(property.is_list ? property.count_type : property.type);
+            if (roles.back() == FaceRole::Indices)
+            {
+                const size_t list_bytes = typeSize(property.count_type) + 3*typeSize(property.type);
+                triangle_bytes = (index_lists++ == 0) ? list_bytes : std::min(triangle_bytes, list_bytes);
+            }
+        }
+
+        // a count the file cannot hold would only get as far as allocating for it
+        if (!fits(element.count, face_bytes))
+            return false;
+
+        // triangles go straight to indices, larger polygons to data.polygons
+        const size_t max_triangles = (index_lists == 0) ? 0 :
+            std::min<size_t>(index_lists*element.count, (end - begin)/triangle_bytes);
+        data.indices.resize(3*max_triangles);
+        unsigned int *indices = data.indices.data();
+        size_t written = 0;
+
+        // the usual layout, a one byte count and 4 byte indices, is decoded a run of triangles at a time
+        const bool triangle_layout = (element.properties.size() == 1) && (roles[0] == FaceRole::Indices) &&
+            (typeSize(element.properties[0].count_type) == 1) && (typeSize(element.properties[0].type) == 4);
+
+        const long report_every = 1 << 16;
+        long unreported = 0;
+
+        for (long f = 0; f < element.count; )
+        {
+            bool read_one = true;
+            if (triangle_layout)
+            {
+                const size_t remaining = static_cast<size_t>(element.count - f);
+                const char *src = input + begin;
+                const size_t available = std::min({remaining, (end - begin)/triangle_bytes, chunk_bytes/triangle_bytes});
+
+                size_t n = 0;
+                for (; (n < available) && (src[n*triangle_bytes] == 3); ++n)
+                {
+                    const char *triangle = src + n*triangle_bytes + 1;
+                    indices[written + 0] = load<std::uint32_t, std::uint32_t>(triangle + 0, swap);
+                    indices[written + 1] = load<std::uint32_t, std::uint32_t>(triangle + 4, swap);
+                    indices[written + 2] = load<std::uint32_t, std::uint32_t>(triangle + 8, swap);
+                    written += 3;
+                }
+
+                begin += n*triangle_bytes;
+                f += static_cast<long>(n);
+                unreported += static_cast<long>(n);
+
+                // stopped short of the buffered faces: the next one is not a triangle
+                read_one = (n == 0) || (n < available);
+            }
+
+            // anything else is read a property at a time
+            if ( read_one && (f < element.count) )
+            {
+                if (!readFace(element, roles, indices, written, data))
+                    return false;
+                ++f;
+                ++unreported;
+            }
+
+            if (unreported >= report_every)
+            {
+                if (!reportProgress(progress, unreported))
+                    return false;
+                unreported = 0;
+            }
+        }
+
+        data.indices.resize(written);
+
+        return reportProgress(progress, unreported);
+    }
+
+    bool skipElement (const Element &element)
+    {
+        if (element.stride > 0)
+        {
+            if (!fits(element.count, element.stride))
+                return false;
+
+            size_t bytes = element.stride*element.count;
+            while (bytes > 0)
+            {
+                size_t step = std::min(bytes, chunk_bytes);
+                if (!available(step))
+                    return false;
+                begin += step;
+                bytes -= step;
+            }
+            return true;
+        }
+
+        for (long e = 0; e < element.count; ++e)
+        {
+            for (const Property &property : element.properties)
+            {
+                size_t size = typeSize(property.type);
+                if (property.is_list)
+                {
+                    if (!available(typeSize(property.count_type)))
+                        return false;
+                    long length = static_cast<long>(loadValue(input + begin, property.count_type, swap));
+                    begin += typeSize(property.count_type);
+                    size *= std::max(length, 0L);
+                }
+                if (!available(size))
+                    return false;
+                begin += size;
+            }
+        }
+        return true;
+    }
+
+    /// Bytes decoded at a time
+    size_t chunk_bytes = 1 << 22;
+
+    std::shared_ptr<MappedFile> file;
+    Format format = Format::Ascii;
+    std::vector<Element> elements;
+    bool swap = false;
+
+    /// File contents, read from input[begin] up to input[end]
+    const char *input = nullptr;
+    size_t begin = 0;
+    size_t end = 0;
+
+    /// Copy of a chunk being byte swapped
+    std::vector<char> scratch;
+};
+
+}
+}
+#endif
@@ -0,0 +1,376 @@
+/**
+ * Tucano - A library for rapid prototying with Modern OpenGL and GLSL
+ * Copyright (C) 2014
+ * LCG - Laboratório de Computação Gráfica (Computer Graphics Lab) - COPPE
+ * UFRJ - Federal University of Rio de Janeiro
+ *
+ * This file is part of Tucano Library.
+ *
+ * Tucano Library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Tucano Library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Tucano Library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __VERTEXNORMALS__
+#define __VERTEXNORMALS__
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include <Eigen/Dense>
+
+
+namespace Tucano
+{
+
+/**
+ * @brief Vertex normals of a triangle mesh, kept up to date as its vertices move.
+ *
+ * A vertex normal is the sum of the normals of the triangles around it,
+ * weighted by triangle area or by the angle of the triangle at the vertex.
+ *
+ * The whole mesh is computed with one thread per range of triangles, each
+ * accumulating into a buffer of its own, and the buffers are then summed
+ * over ranges of vertices, so no two threads ever write to the same value.
+ * After some vertices move, update() only recomputes the normals around them
+ * by gathering over a vertex to triangle table, built on the first update.
+ */
+class VertexNormals
+{
+public:
+
+    enum Weighting
+    {
+        /// Triangles contribute in proportion to their area
+        AREA,
+        /// Triangles contribute in proportion to their angle at the vertex
+        ANGLE
+    };
+
+    /**
+     * @brief Takes a mesh and computes all of its normals.
+     * @param vertices Packed (x,y,z) vertex coordinates.
+     * @param indices Triangles (indices on the vertices' list); triangles with an index out of range are ignored.
+     * @param weight How triangles are weighted.
+     * @param threads Number of threads, 0 for one per hardware thread.
+     */
+    void set (std::vector<float> &&vertices, std::vector<unsigned int> &&indices, Weighting weight = ANGLE, unsigned int threads = 0)
+    {
+        positions = std::move(vertices);
+        triangles = std::move(indices);
+        triangles.resize(triangles.size() - triangles.size() % 3);
+        weighting = weight;
+        num_threads = threads;
+
+        adjacency_offsets.clear();
+        adjacency.clear();
+
+        vertex_normals.resize(positions.size() - positions.size() % 3);
+        compute(positions.data(), vertex_normals.size()/3, triangles.data(), triangles.size(), vertex_normals.data(), weighting, num_threads);
+    }
+
+    /**
+     * @brief Moves a range of vertices and recomputes the normals around them.
+     * @param first Index of the first vertex to move.
+     * @param vertices Packed (x,y,z) new coordinates.
+     * @param size Number of floats in vertices (multiple of 3).
+     * @param changed_first Receives the index of the first normal that changed.
+     * @param changed_count Receives the number of normals from changed_first on that may have changed.
+     * @return True if the range fits inside the mesh.
+     */
+    bool update (size_t first, const float *vertices, size_t size, size_t &changed_first, size_t &changed_count)
+    {
+        const size_t num_vertices = vertex_normals.size()/3;
+        const size_t count = size/3;
+        if ( (vertices == nullptr) || (size % 3 != 0) || (first > num_vertices) || (count > num_vertices - first) )
+        {
+            return false;
+        }
+
+        std::memcpy(&positions[3*first], vertices, size*sizeof(float));
+
+        changed_first = 0;
+        changed_count = 0;
+        if ( count == 0 )
+        {
+            return true;
+        }
+
+        // past some point, walking the neighbourhoods costs more than starting over
+        if ( count > num_vertices/8 )
+        {
+            compute(positions.data(), num_vertices, triangles.data(), triangles.size(), vertex_normals.data(), weighting, num_threads);
+            changed_count = num_vertices;
+            return true;
+        }
+
+        if ( adjacency_offsets.empty() )
+        {
+            buildAdjacency();
+        }
+
+        // the moved vertices and their neighbours
+        std::vector<unsigned int> affected;
+        for (size_t v = first; v < first + count; ++v)
+        {
+            for (unsigned int a = adjacency_offsets[v]; a < adjacency_offsets[v+1]; ++a)
+            {
+                const unsigned int *corners = &triangles[3*static_cast<size_t>(adjacency[a])];
+                affected.insert(affected.end(), corners, corners + 3);
+            }
+            affected.push_back(static_cast<unsigned int>(v));
+        }
+        std::sort(affected.begin(), affected.end());
+        affected.erase(std::unique(affected.begin(), affected.end()), affected.end());
+
+        for (unsigned int v : affected)
+        {
+            Eigen::Vector3f sum = Eigen::Vector3f::Zero();
+            for (unsigned int a = adjacency_offsets[v]; a < adjacency_offsets[v+1]; ++a)
+            {
+                const size_t t = adjacency[a];
+                const unsigned int *corners = &triangles[3*t];
+                Eigen::Vector3f contribution[3];
+                if ( triangleContributions(positions.data(), corners, weighting, contribution) )
+                {
+                    for (int c = 0; c < 3; ++c)
+                    {
+                        if ( corners[c] == v )
+                            sum += contribution[c];
+                    }
+                }
+            }
+            storeNormal(sum, &vertex_normals[3*static_cast<size_t>(v)]);
+        }
+
+        changed_first = affected.front();
+        changed_count = affected.back() - affected.front() + 1;
+
+        return true;
+    }
+
+    /**
+     * @brief Returns the normals.
+     * @return Packed (x,y,z) unit normals, zero for vertices without triangles of non-zero area.
+     */
+    const std::vector<float>& normals (void) const
+    {
+        return vertex_normals;
+    }
+
+    /**
+     * @brief Computes the vertex normals of a triangle mesh.
+     * @param vertices Packed (x,y,z) vertex coordinates.
+     * @param num_vertices Number of vertices.
+     * @param indices Triangles (indices on the vertices' list); triangles with an index out of range are ignored.
+     * @param num_indices Number of indices.
+     * @param normals Receives num_vertices packed (x,y,z) normals.
+     * @param weight How triangles are weighted.
+     * @param threads Number of threads, 0 for one per hardware thread.
+     */
+    static void compute (const float *vertices, size_t num_vertices, const unsigned int *indices, size_t num_indices,
+            float *normals, Weighting weight = ANGLE, unsigned int threads = 0)
+    {
+        const size_t num_triangles = num_indices/3;
+        if ( threads == 0 )
+            threads = std::max(1u, std::thread::hardware_concurrency());
+
+        // not worth a thread below min_triangles triangles
+        const size_t num_ranges = std::max<size_t>(1, std::min<size_t>(threads, num_triangles/min_triangles));
+
+        // the first range accumulates straight into the result, the others into buffers of their own
+        std::fill(normals, normals + 3*num_vertices, 0.f);
+        std::vector< std::vector<float> > partial (num_ranges - 1);
+
+        auto accumulate = [&] (size_t r) {
+            float *sums = normals;
+            if ( r > 0 )
+            {
+                partial[r-1].assign(3*num_vertices, 0.f);
+                sums = partial[r-1].data();
+            }
+
+            const size_t begin = num_triangles*r/num_ranges;
+            const size_t end = num_triangles*(r+1)/num_ranges;
+            for (size_t t = begin; t < end; ++t)
+            {
+                const unsigned int *corners = &indices[3*t];
+                if ( (corners[0] >= num_vertices) || (corners[1] >= num_vertices) || (corners[2] >= num_vertices) )
+                    continue;
+
+                Eigen::Vector3f contribution[3];
+                if ( !triangleContributions(vertices, corners, weight, contribution) )
+                    continue;
+
+                for (int c = 0; c < 3; ++c)
+                {
+                    Eigen::Map<Eigen::Vector3f>(&sums[3*static_cast<size_t>(corners[c])]) += contribution[c];
+                }
+            }
+        };
+
+        auto reduce = [&] (size_t r) {
+            const size_t begin = num_vertices*r/num_ranges;
+            const size_t end = num_vertices*(r+1)/num_ranges;
+            for (size_t v = begin; v < end; ++v)
+            {
+                Eigen::Vector3f sum (normals[3*v + 0], normals[3*v + 1], normals[3*v + 2]);
+                for (const std::vector<float> &buffer : partial)
+                {
+                    sum += Eigen::Vector3f(buffer[3*v + 0], buffer[3*v + 1], buffer[3*v + 2]);
+                }
+                storeNormal(sum, &normals[3*v]);
+            }
+        };
+
+        runRanges(num_ranges, accumulate);
+        runRanges(num_ranges, reduce);
+    }
+
+private:
+
+    /// Runs job(0) ... job(num_ranges - 1), one per thread
+    template <typename Job>
+    static void runRanges (size_t num_ranges, Job &job)
+    {
+        std::vector<std::thread> workers;
+        for (size_t r = 1; r < num_ranges; ++r)
+        {
+            workers.emplace_back(job, r);
+        }
+        job(0);
+        for (std::thread &worker : workers)
+        {
+            worker.join();
+        }
+    }
+
+    /// Weighted normal of a triangle at each of its corners, false if the triangle has no area
+    static bool triangleContributions (const float *vertices, const unsigned int *corners, Weighting weight, Eigen::Vector3f contribution[3])
+    {
+        typedef Eigen::Map<const Eigen::Vector3f> Position;
+        const Position p[3] = {
+            Position(&vertices[3*static_cast<size_t>(corners[0])]),
+            Position(&vertices[3*static_cast<size_t>(corners[1])]),
+            Position(&vertices[3*static_cast<size_t>(corners[2])])
+        };
+
+        // twice the area along the normal
+        const Eigen::Vector3f n = (p[1] - p[0]).cross(p[2] - p[0]);
+        if ( weight == AREA )
+        {
+            contribution[0] = contribution[1] = contribution[2] = n;
+            return (n.squaredNorm() > 0.f);
+        }
+
+        const float length = n.norm();
+        if ( !(length > 0.f) )
+        {
+            return false;
+        }
+
+        const Eigen::Vector3f unit = n / length;
+        for (int c = 0; c < 3; ++c)
+        {
+            const Eigen::Vector3f a = p[(c+1)%3] - p[c];
+            const Eigen::Vector3f b = p[(c+2)%3] - p[c];
+            contribution[c] = unit * std::atan2(a.cross(b).norm(), a.dot(b));
+        }
+
+        return true;
+    }
+
+    /// Writes a summed normal, normalized
+    static void storeNormal (const Eigen::Vector3f &sum, float *normal)
+    {
+        const float length = sum.norm();
+        const Eigen::Vector3f n = (length > 0.f) ? Eigen::Vector3f(sum / length) : Eigen::Vector3f::Zero();
+        normal[0] = n[0];
+        normal[1] = n[1];
+        normal[2] = n[2];
+    }
+
+    /// Triangles around each vertex, as offsets into a single list
+    void buildAdjacency (void)
+    {
+        const size_t num_vertices = vertex_normals.size()/3;
+        const size_t num_triangles = triangles.size()/3;
+
+        adjacency_offsets.assign(num_vertices + 1, 0);
+        for (size_t t = 0; t < num_triangles; ++t)
+        {
+            if ( !validTriangle(t) )
+                continue;
+            for (int c = 0; c < 3; ++c)
+                ++adjacency_offsets[triangles[3*t + c] + 1];
+        }
+        for (size_t v = 0; v < num_vertices; ++v)
+        {
+            adjacency_offsets[v+1] += adjacency_offsets[v];
+        }
+
+        adjacency.resize(adjacency_offsets[num_vertices]);
+        std::vector<unsigned int> fill (adjacency_offsets.begin(), adjacency_offsets.end() - 1);
+        for (size_t t = 0; t < num_triangles; ++t)
+        {
+            if ( !validTriangle(t) )
+                continue;
+            for (int c = 0; c < 3; ++c)
+            {
+                const unsigned int v = triangles[3*t + c];
+                // a triangle listing a vertex twice is listed once
+                if ( (c > 0 && triangles[3*t] == v) || (c > 1 && triangles[3*t + 1] == v) )
+                    continue;
+                adjacency[fill[v]++] = static_cast<unsigned int>(t);
+            }
+        }
+
+        // drop the slots left by repeated vertices
+        size_t kept = 0;
+        for (size_t v = 0; v < num_vertices; ++v)
+        {
+            const unsigned int begin = adjacency_offsets[v];
+            adjacency_offsets[v] = static_cast<unsigned int>(kept);
+            for (unsigned int a = begin; a < fill[v]; ++a)
+            {
+                adjacency[kept++] = adjacency[a];
+            }
+        }
+        adjacency_offsets[num_vertices] = static_cast<unsigned int>(kept);
+        adjacency.resize(kept);
+    }
+
+    bool validTriangle (size_t t) const
+    {
+        const size_t num_vertices = vertex_normals.size()/3;
+        return (triangles[3*t] < num_vertices) && (triangles[3*t + 1] < num_vertices) && (triangles[3*t + 2] < num_vertices);
+    }
+
+    /// Smallest number of triangles handed to a thread
+    static const size_t min_triangles = 1u << 16;
+
+    std::vector<float> positions;
+    std::vector<unsigned int> triangles;
+    std::vector<float> vertex_normals;
+    Weighting weighting = ANGLE;
+    unsigned int num_threads = 0;
+
+    /// adjacency[adjacency_offsets[v] .. adjacency_offsets[v+1]) are the triangles around vertex v
+    std::vector<unsigned int> adjacency_offsets;
+    std::vector<unsigned int> adjacency;
+};
+
+}
+#endif
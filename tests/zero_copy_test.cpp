@@ -0,0 +1,200 @@
+/**
+ * Checks that the pointer+length and rvalue overloads of Scene::loadPointCloud
+ * and Scene::loadTriangleMesh hand the caller's buffers to the GL without
+ * copying them: global operator new is replaced by a counting version, and a
+ * load must not allocate anything close to the size of the mesh.
+ *
+ * Needs a GL context, created off screen with EGL; the test is skipped
+ * (exit code 77) where none can be made.
+ */
+
+#include <EGL/egl.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <vector>
+#include <utility>
+#include <functional>
+
+#include "tucanow/scene.hpp"
+
+namespace
+{
+    /// Counting is only on around the calls under test
+    bool counting = false;
+    std::size_t allocated_bytes = 0;
+    std::size_t allocations = 0;
+}
+
+void* operator new(std::size_t size)
+{
+    if ( counting )
+    {
+        allocated_bytes += size;
+        ++allocations;
+    }
+
+    if ( void *ptr = std::malloc(size ? size : 1) )
+    {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+namespace
+{
+    /// Makes an off screen OpenGL context current, false if the platform has none
+    bool makeContext()
+    {
+        EGLDisplay display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+        if ( (display == EGL_NO_DISPLAY) || !eglInitialize(display, nullptr, nullptr) )
+        {
+            return false;
+        }
+
+        const EGLint config_attributes[] = {
+            EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+            EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8, EGL_DEPTH_SIZE, 24,
+            EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+            EGL_NONE
+        };
+        EGLConfig config;
+        EGLint num_configs = 0;
+        if ( !eglChooseConfig(display, config_attributes, &config, 1, &num_configs) || (num_configs == 0) )
+        {
+            return false;
+        }
+
+        const EGLint surface_attributes[] = { EGL_WIDTH, 64, EGL_HEIGHT, 64, EGL_NONE };
+        EGLSurface surface = eglCreatePbufferSurface(display, config, surface_attributes);
+
+        const EGLint context_attributes[] = {
+            EGL_CONTEXT_MAJOR_VERSION, 4, EGL_CONTEXT_MINOR_VERSION, 3,
+            EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_COMPATIBILITY_PROFILE_BIT,
+            EGL_NONE
+        };
+        eglBindAPI(EGL_OPENGL_API);
+        EGLContext context = eglCreateContext(display, config, EGL_NO_CONTEXT, context_attributes);
+
+        return (surface != EGL_NO_SURFACE) && (context != EGL_NO_CONTEXT) && eglMakeCurrent(display, surface, surface, context);
+    }
+
+    /// A grid of side x side vertices split in triangles
+    void makeGrid(std::size_t side, std::vector<float> &vertices, std::vector<unsigned int> &indices, std::vector<float> &normals)
+    {
+        vertices.clear();
+        indices.clear();
+        normals.clear();
+        for ( std::size_t j = 0; j < side; ++j )
+        {
+            for ( std::size_t i = 0; i < side; ++i )
+            {
+                vertices.insert(vertices.end(), { float(i)/side, float(j)/side, 0.f });
+                normals.insert(normals.end(), { 0.f, 0.f, 1.f });
+            }
+        }
+        for ( std::size_t j = 0; j + 1 < side; ++j )
+        {
+            for ( std::size_t i = 0; i + 1 < side; ++i )
+            {
+                const unsigned int a = j*side + i, b = a + 1, c = a + side, d = c + 1;
+                indices.insert(indices.end(), { a, b, c, b, d, c });
+            }
+        }
+    }
+
+    /// Runs a load with counting on; fails if it did not succeed or allocated more than limit bytes
+    bool check(const char *name, std::size_t limit, const std::function<bool()> &load)
+    {
+        allocated_bytes = 0;
+        allocations = 0;
+        counting = true;
+        const bool loaded = load();
+        counting = false;
+
+        const bool passed = loaded && (allocated_bytes <= limit);
+        std::printf("%s: %s, %zu allocations, %zu bytes (limit %zu)\n", name, passed ? "ok" : "FAILED",
+                allocations, allocated_bytes, limit);
+
+        return passed;
+    }
+}
+
+int main()
+{
+    if ( !makeContext() )
+    {
+        std::printf("no OpenGL context, skipped\n");
+        return 77;
+    }
+
+    tucanow::Scene scene;
+    scene.initialize(64, 64);
+    // picking hierarchies keep their own copy of the mesh on the CPU
+    scene.setAutomaticBvh(false);
+
+    std::vector<float> vertices, normals;
+    std::vector<unsigned int> indices;
+    makeGrid(1024, vertices, indices, normals);
+
+    // A copy of the vertices alone would take 12 bytes per vertex: allow far
+    // less than one byte per vertex for the bookkeeping of a new object
+    const std::size_t num_vertices = vertices.size()/3;
+    const std::size_t limit = num_vertices/16;
+
+    bool passed = true;
+
+    passed &= check("loadPointCloud(pointer, size)", limit, [&] {
+            return scene.loadPointCloud(1, vertices.data(), vertices.size());
+        });
+
+    passed &= check("loadTriangleMesh(pointers, sizes)", limit, [&] {
+            return scene.loadTriangleMesh(2, vertices.data(), vertices.size(), indices.data(), indices.size(),
+                normals.data(), normals.size());
+        });
+
+    // Reloading an existing object takes the same path without new objects
+    passed &= check("loadTriangleMesh(pointers, sizes), reload", limit, [&] {
+            return scene.loadTriangleMesh(2, vertices.data(), vertices.size(), indices.data(), indices.size(),
+                normals.data(), normals.size());
+        });
+
+    std::vector<float> moved_points(vertices);
+    passed &= check("loadPointCloud(vector&&)", limit, [&] {
+            return scene.loadPointCloud(3, std::move(moved_points));
+        });
+
+    std::vector<float> moved_vertices(vertices), moved_normals(normals);
+    std::vector<unsigned int> moved_indices(indices);
+    passed &= check("loadTriangleMesh(vector&&)", limit, [&] {
+            return scene.loadTriangleMesh(4, std::move(moved_vertices), std::move(moved_indices), std::move(moved_normals));
+        });
+
+    return passed ? 0 : 1;
+}